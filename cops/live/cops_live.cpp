@@ -3,135 +3,155 @@
 #include "cops_live.hpp"
 
 #include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "diff_finder.hpp"
+#include "graph_library.hpp"
+#include "invariant.hpp"
 #include "invariant_finder.hpp"
-#include "invariant_options.hpp"
-#include "lgbench.hpp"
-#include "lgedgeiter.hpp"
 #include "lgraph.hpp"
-#include "live_options.hpp"
-#include "stitch_options.hpp"
+#include "perf_tracing.hpp"
 #include "stitcher.hpp"
-#include "structural.hpp"
 
-void setup_cops_live() {
-  Cops_live p;
-  p.setup();
-}
-
-void Cops_live::invariant_finder(Eprp_var &var) {
-  LGBench b("cops.live.inv_finder");
-
-  Invariant_find_options pack;
-  for (const auto &l : var.dict) {
-    pack.set(l.first, l.second);
-  }
+static Pass_plugin sample("cops_live", Cops_live::setup);
 
-  Invariant_finder worker(pack);
-  b.sample("cops.live.inv_finder.setup");
+void Cops_live::setup() {
+  Eprp_method inv_find("live.invariant_find",
+                       "find invariant boundaries between post-synthesis and post-elaboration lgraphs",
+                       &Cops_live::invariant_finder);
+  inv_find.add_label_required("top", "top module");
+  inv_find.add_label_required("elab_lgdb", "lgdb path of the elaborated netlist");
+  inv_find.add_label_required("synth_lgdb", "lgdb path of the synthesized (flat) netlist");
+  inv_find.add_label_required("invariant_file", "file to serialize the invariant boundaries object (used by diff)");
+  inv_find.add_label_optional("hier_sep", "hierarchical separator used in names by the synthesis tool", ".");
+  register_pass(inv_find);
 
-  Invariant_boundaries fibs = worker.get_boundaries();
-  b.sample("cops.live.inv_finder.work");
+  Eprp_method diff_find("live.diff_finder", "find cones that changed between two post-elaboration lgraphs", &Cops_live::diff_finder);
+  diff_find.add_label_required("olgdb", "original elaborated lgdb path");
+  diff_find.add_label_required("mlgdb", "modified elaborated lgdb path");
+  diff_find.add_label_required("invariant_file", "invariant boundaries file (generated by live.invariant_find)");
+  diff_find.add_label_required("dlgdb", "lgdb path for the delta netlist");
+  diff_find.add_label_required("diff_file", "output diff_file (used by live.merge_changes)");
+  register_pass(diff_find);
 
-  std::ofstream of(pack.invariant_file);
-  Invariant_boundaries::serialize(&fibs, of);
-  of.close();
-  b.sample("cops.live.inv_finder.output");
+  Eprp_method stitch("live.merge_changes",
+                     "merge synthesized delta into the original synthesized netlist",
+                     &Cops_live::netlist_merge);
+  stitch.add_label_required("osynth", "lgdb path for the original synthesized netlist");
+  stitch.add_label_required("nsynth", "lgdb path for the delta synthesized netlist");
+  stitch.add_label_required("invariant_file", "invariant boundaries file (updated with the new cones)");
+  stitch.add_label_required("diff_file", "input diff_file (generated by live.diff_finder)");
+  register_pass(stitch);
 }
 
-void Cops_live::diff_finder(Eprp_var &var) {
-  LGBench b("cops.live.diff");
+Cops_live::Cops_live(const Eprp_var &var) : Pass("cops.live", var) {}
 
-  Live_pass_options pack;
-  for (const auto &l : var.dict) {
-    pack.set(l.first, l.second);
+static std::unique_ptr<Invariant_boundaries> read_boundaries(std::string_view fname) {
+  std::ifstream ifs{std::string(fname)};
+  if (!ifs.good()) {
+    Pass::error("live: could not open invariant file {}", fname);
   }
 
-  Diff_finder worker(pack);
-  b.sample("cops.live.diff.setup");
-
-  std::set<Net_ID> diffs;
-  worker.generate_delta(pack.modified_lgdb, pack.delta_lgdb, diffs);
+  auto ib = Invariant_boundaries::deserialize(ifs);
+  if (!ib) {
+    Pass::error("live: invalid invariant file {}", fname);
+  }
 
-  b.sample("cops.live.diff.find_diffs");
+  return ib;
+}
 
-  std::ofstream of(pack.diff_file);
-  for (auto &diff_ : diffs) {
-    of << diff_.first << "\t" << diff_.second << std::endl;
+static Lgraph *open_lgraph(std::string_view lgdb, std::string_view top) {
+  auto *lg = Graph_library::instance(lgdb)->open_lgraph(top);
+  if (lg == nullptr) {
+    Pass::error("live: could not open {} in {}", top, lgdb);
   }
-  of.close();
 
-  b.sample("cops.live.diff.write_diff");
+  return lg;
 }
 
-void Cops_live::netlist_merge(Eprp_var &var) {
-  LGBench b("cops.live.stitch");
+void Cops_live::invariant_finder(Eprp_var &var) {
+  TRACE_EVENT("live", "LIVE_invariant_find");
+  Cops_live p(var);
+
+  auto top = var.get("top");
+
+  auto *elab  = open_lgraph(var.get("elab_lgdb"), top);
+  auto *synth = open_lgraph(var.get("synth_lgdb"), top);
+
+  Invariant_finder worker(elab, synth, var.get("hier_sep"));
 
-  Stitch_pass_options pack;
-  for (const auto &l : var.dict) {
-    pack.set(l.first, l.second);
+  auto          fname = var.get("invariant_file");
+  std::ofstream of{std::string(fname)};
+  worker.get_boundaries().serialize(of);
+  if (!of) {
+    error("live.invariant_find: could not write {}", fname);
   }
+}
+
+void Cops_live::diff_finder(Eprp_var &var) {
+  TRACE_EVENT("live", "LIVE_diff_finder");
+  Cops_live p(var);
 
-  if (pack.method == Stitch_pass_options::Live_method::LiveSynth) {
-    Live_stitcher worker(pack);
-    b.sample("cops.live.stitch.setup");
+  auto ib = read_boundaries(var.get("invariant_file"));
 
-    std::ifstream    ifs(pack.diff_file);
-    std::set<Net_ID> diffs;
-    WireName_ID      net;
-    uint32_t         bit;
+  auto *original = open_lgraph(var.get("olgdb"), ib->top);
+  auto *modified = open_lgraph(var.get("mlgdb"), ib->top);
 
-    while (ifs >> net >> bit) {
-      diffs.insert(std::make_pair(net, bit));
-    }
-    ifs.close();
+  Diff_finder worker(original, modified, *ib);
 
-    b.sample("cops.live.stitch.read_diff");
-    worker.stitch(pack.nsynth_lgdb, diffs);
+  const auto &diffs = worker.find_diffs();
 
-  } else if (pack.method == Stitch_pass_options::Live_method::Structural) {
-    Live_structural worker(pack);
-    b.sample("cops.live.stitch.setup");
-    worker.replace(pack.nsynth_lgdb);
+  auto *delta = Graph_library::instance(var.get("dlgdb"))->create_lgraph(ib->top, "-");
+  worker.generate_delta(delta);
+  delta->save();
 
-  } else {
-    Pass::error(std::format("cops.live: unsupported stitch method {}", pack.method));
-    return;
+  auto          fname = var.get("diff_file");
+  std::ofstream of{std::string(fname)};
+  for (auto id : diffs) {
+    of << ib->nets[id] << "\n";
+  }
+  if (!of) {
+    error("live.diff_finder: could not write {}", fname);
   }
 
-  b.sample("cops.live.stitch.done");
+  info("live.diff_finder: {} boundaries changed, delta with {} cells", diffs.size(), worker.get_delta_cells());
 }
 
-void Cops_live::setup() {
-  Eprp_method inv_find("live.invariant_find",
-                       "find invariant boundaries between post-synthesis and post-elaboration lgraphs",
-                       &Cops_live::invariant_finder);
-  inv_find.add_label_required("top", "top module");
-  inv_find.add_label_required("elab_lgdb", "lgdb path of the elaborated netlist");
-  inv_find.add_label_required("synth_lgdb", "lgdb path of the synthesized netlist");
-  inv_find.add_label_required("invariant_file", "file to serialize the invariant boundaries object (used by diff)");
-  inv_find.add_label_required("hier_sep", "hierarchical separator used in names by the synthesis tool");
-  register_pass(inv_find);
+void Cops_live::netlist_merge(Eprp_var &var) {
+  TRACE_EVENT("live", "LIVE_merge_changes");
+  Cops_live p(var);
 
-  Eprp_method diff_find("live.diff_finder",
-                        "find cones that changed between two post-elaboration lgraphs",
-                        &Cops_live::diff_finder);
-  diff_find.add_label_required("olgdb", "original elaborated lgdb path");
-  diff_find.add_label_required("mlgdb", "modified elaborated lgdb path");
-  diff_find.add_label_required("slgdb", "original synthesized lgdb path");
-  diff_find.add_label_required("invariant_file",
-                               "file to serialize the invariant boundaries object (generated by invariant finder)");
-  diff_find.add_label_required("dlgdb", "lgdb path for the delta netlist");
-  diff_find.add_label_required("diff_file", "output diff_file (used by the stitch pass)");
-  register_pass(diff_find);
+  auto ib_fname = var.get("invariant_file");
+  auto ib       = read_boundaries(ib_fname);
 
-  Eprp_method stitch("live.merge_changes",
-                     "merge synthesized delta into the original synthesized netlist",
-                     &Cops_live::netlist_merge);
-  stitch.add_label_required("osynth", "lgdb path for the original synthesized netlist");
-  stitch.add_label_required("nsynth", "lgdb path for the delta synthesized netlist");
-  stitch.add_label_required("method", "stitch method (options: LiveSynth and Structural");
-  stitch.add_label_required("diff_file", "input diff_file (generated by the diff pass)");
-  register_pass(stitch);
+  auto *original = open_lgraph(var.get("osynth"), ib->top);
+  auto *nsynth   = open_lgraph(var.get("nsynth"), ib->top);
+
+  std::vector<Invariant_boundaries::Net_id> diffs;
+  {
+    auto          fname = var.get("diff_file");
+    std::ifstream ifs{std::string(fname)};
+    if (!ifs.good()) {
+      error("live.merge_changes: could not open diff file {}", fname);
+    }
+    std::string net;
+    while (std::getline(ifs, net)) {
+      if (!ib->is_invariant_boundary(net)) {
+        error("live.merge_changes: {} is not an invariant boundary", net);
+      }
+      diffs.emplace_back(ib->get_id(net));
+    }
+  }
+
+  Live_stitcher worker(original, ib.get());
+  worker.stitch(nsynth, diffs);
+  original->save();
+
+  std::ofstream of{std::string(ib_fname)};
+  ib->serialize(of);
+  if (!of) {
+    error("live.merge_changes: could not write {}", ib_fname);
+  }
 }
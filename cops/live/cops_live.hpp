@@ -1,19 +1,19 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
-
-#ifndef COPS_LIVE_HPP_
-#define COPS_LIVE_HPP_
+#pragma once
 
 #include "pass.hpp"
 
+// Live incremental synthesis: find the invariant boundaries between the
+// elaborated and synthesized netlists, the cones changed by an edit, and
+// stitch the re-synthesized delta back into the synthesized netlist.
 class Cops_live : public Pass {
-public:
-  Cops_live() : Pass("cops") {}
-
-  void setup() final;
-
+protected:
   static void invariant_finder(Eprp_var &var);
   static void diff_finder(Eprp_var &var);
   static void netlist_merge(Eprp_var &var);
-};
 
-#endif
+public:
+  Cops_live(const Eprp_var &var);
+
+  static void setup();
+};
@@ -1,51 +1,50 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <vector>
+
 #include "invariant.hpp"
 #include "lgraph.hpp"
-#include "live_common.hpp"
-#include "live_options.hpp"
-
-using namespace Live;
 
+// Finds the invariant boundaries whose elaborated cone changed between the
+// original and the modified design, and builds the delta netlist to
+// re-synthesize (only the changed cones).
 class Diff_finder {
-private:
-  const Lgraph         *original;
-  const Lgraph         *synth;
-  Invariant_boundaries *boundaries;
-
-  std::string hier_sep;
+protected:
+  using Net_id = Invariant_boundaries::Net_id;
 
-  std::map<Graph_Node, std::set<Graph_Node>> cones;
-  std::map<Graph_Node, bool>                 different;
-  std::map<Graph_Node, std::set<Graph_Node>> endpoints;
-  std::set<Graph_Node>                       stack;
-  std::map<Graph_Node, Net_ID>               synth_map;
-  std::map<Graph_Node, std::string>          bound2net;
+  struct Cone {
+    std::vector<Node::Compact>     cells;      // modified netlist nodes
+    std::vector<Node_pin::Compact> endpoints;  // boundaries and graph inputs feeding the cone
+  };
 
-  using Name2graph_type = absl::flat_hash_map<std::string, Lgraph *>;
+  Lgraph *original;
+  Lgraph *modified;
 
-  std::set<Graph_Node> fwd_visited;
+  const Invariant_boundaries &ib;
 
-  bool is_user_def(Lgraph *current, Index_id idx, Port_ID pid) const;
-  bool set_invariant(Graph_Node node);
+  std::vector<Node_pin::Compact> orig_pins;  // per Net_id, invalid when not found
+  std::vector<Node_pin::Compact> mod_pins;
 
-  void find_fwd_boundaries(Graph_Node &start_boundary, std::set<Graph_Node> &discovered, bool went_up = false);
-  bool compare_cone(const Graph_Node &start_boundary, const Graph_Node &original_boundary, bool went_up = false);
+  std::vector<Cone>   cones;  // per Net_id, only for the changed boundaries
+  std::vector<Net_id> diffs;
 
-  auto go_up(const Graph_Node &boundary);
-  auto go_down(const Graph_Node &boundary, bool output);
+  static bool same_cell(const Node &a, const Node &b);
 
-  void generate_modules(std::set<Graph_Node> &different_nodes, const std::string &out_lgdb);
-
-  void add_ios_up(Lgraph *module, const Node_pin &pin, Name2graph_type &name2graph);
+  bool is_boundary(const Node_pin &dpin) const;
+  bool compare_cone(Net_id id) const;
+  void collect_cone(Net_id id, Cone &cone) const;
 
 public:
-  // FIXME: can we remove the dependency on the synthesized graph?
-  Diff_finder(Lgraph *original, Lgraph *synth, Invariant_boundaries *boundaries, const std::string &hier_sep = ".")
-      : original(original), synth(synth), boundaries(boundaries), hier_sep(hier_sep) {}
+  // Both are hierarchical elaborated designs (same top as ib)
+  Diff_finder(Lgraph *original, Lgraph *modified, const Invariant_boundaries &ib);
+
+  // Compares the cone of each boundary (in parallel). Returns the changed ones.
+  const std::vector<Net_id> &find_diffs();
 
-  Diff_finder(Live_pass_options pack);
+  // Flat netlist with the changed cones: endpoints are graph inputs, changed
+  // boundaries are graph outputs (all with the hierarchical net names).
+  void generate_delta(Lgraph *delta) const;
 
-  void generate_delta(const std::string &mod_lgdb, const std::string &out_lgdb, std::set<Net_ID> &diffs);
+  [[nodiscard]] size_t get_delta_cells() const;
 };
@@ -2,117 +2,150 @@
 
 #include "invariant.hpp"
 
-#include <iostream>
-
-void Invariant_boundaries::serialize(Invariant_boundaries* ib, std::ostream& ofs) {
-  ofs << "Invariant_boundaries: " << ib->top << " ##sep: " << ib->hierarchical_separator << std::endl;
-  ofs << ib->invariant_cones.size() << std::endl;
-  for (auto& c : ib->invariant_cones) {
-    ofs << c.first.first << " " << c.first.second << " " << c.second.size() << std::endl;
-    for (auto& d : c.second) {
-      ofs << d.first << " " << d.second << std::endl;
-    }
-  }
-  ofs << ib->instance_type_map.size() << std::endl;
-  for (auto inst : ib->instance_type_map) {
-    ofs << inst.first << " " << inst.second << std::endl;
+#include <charconv>
+
+Invariant_boundaries::Net_id Invariant_boundaries::add_net(std::string_view name, bool is_boundary) {
+  auto [it, inserted] = net2id.try_emplace(name, static_cast<Net_id>(nets.size()));
+  if (inserted) {
+    nets.emplace_back(name);
+    boundary.emplace_back(is_boundary);
+    endpoints.emplace_back();
+    cone_cells.emplace_back();
+  } else if (is_boundary) {
+    boundary[it->second] = true;
   }
 
-  ofs << ib->instance_collection.size() << std::endl;
-  for (auto& c : ib->instance_collection) {
-    ofs << c.first << " " << c.second.size() << std::endl;
-    for (auto& d : c.second) {
-      if (d != "") {
-        ofs << d << std::endl;
-      } else {
-        ofs << "##TOP##" << std::endl;
-      }
+  return it->second;
+}
+
+void Invariant_boundaries::update_gate_appearances() {
+  gate_appearances.clear();
+  for (const auto &cells : cone_cells) {
+    for (const auto &cell : cells) {
+      ++gate_appearances[cell];
     }
   }
+}
 
-  ofs << ib->invariant_cone_cells.size() << std::endl;
-  for (auto& c : ib->invariant_cone_cells) {
-    ofs << c.first.first << " " << c.first.second << " " << c.second.size() << std::endl;
-    for (auto& d : c.second) {
-      ofs << d << std::endl;
-    }
+// Text format (one entry per line, names can not have newlines):
+//   top <name>
+//   hier_sep <sep>
+//   nets <n>
+//   <0|1 boundary> <name>                                  (n lines, line i is Net_id i)
+//   cone <id> <n_endpoints> <endpoint ids...> <n_cells> <cell nids...>
+void Invariant_boundaries::serialize(std::ostream &ofs) const {
+  ofs << "top " << top << "\n";
+  ofs << "hier_sep " << hierarchical_separator << "\n";
+  ofs << "nets " << nets.size() << "\n";
+  for (size_t i = 0; i < nets.size(); ++i) {
+    ofs << (boundary[i] ? 1 : 0) << " " << nets[i] << "\n";
   }
 
-  ofs << ib->hierarchy_tree.size() << std::endl;
-  for (auto& c : ib->hierarchy_tree) {
-    ofs << c.first << " " << c.second.size() << std::endl;
-    for (auto& d : c.second) {
-      ofs << d << std::endl;
+  for (size_t i = 0; i < nets.size(); ++i) {
+    if (!boundary[i]) {
+      continue;
     }
+    ofs << "cone " << i << " " << endpoints[i].size();
+    for (auto id : endpoints[i]) {
+      ofs << " " << id;
+    }
+    ofs << " " << cone_cells[i].size();
+    for (const auto &cell : cone_cells[i]) {
+      ofs << " " << cell.get_nid().value;
+    }
+    ofs << "\n";
+  }
+}
+
+// Next space separated number of line. from_chars, so malformed input is an error instead of an exception.
+template <typename T>
+static bool parse_number(std::string_view &line, T &val) {
+  while (!line.empty() && line.front() == ' ') {
+    line.remove_prefix(1);
   }
 
-  ofs << ib->gate_appearances.size() << std::endl;
-  for (auto inst : ib->gate_appearances) {
-    ofs << inst.first << " " << inst.second << std::endl;
+  const auto *end        = line.data() + line.size();
+  const auto [ptr, errc] = std::from_chars(line.data(), end, val);
+  if (errc != std::errc() || (ptr != end && *ptr != ' ')) {
+    return false;
   }
+
+  line.remove_prefix(ptr - line.data());
+  return true;
 }
 
-Invariant_boundaries* Invariant_boundaries::deserialize(std::istream& ifs) {
-  Invariant_boundaries* ib = new Invariant_boundaries;
-  std::string           tmp1, tmp2;
-  int                   size1, size2, tmp;
-  ifs >> tmp1 >> ib->top;
-  ifs >> tmp1 >> ib->hierarchical_separator;
-  ifs >> size1;
-  WireName_ID tmpid;
-  uint32_t    bit;
-  for (int i = 0; i < size1; i++) {
-    ifs >> tmpid >> bit >> size2;
-    Net_ID bound = std::make_pair(tmpid, bit);
-    for (int j = 0; j < size2; j++) {
-      ifs >> tmpid >> bit;
-      Net_ID endpoint = std::make_pair(tmpid, bit);
-      ib->invariant_cones[bound].insert(endpoint);
-    }
+std::unique_ptr<Invariant_boundaries> Invariant_boundaries::deserialize(std::istream &ifs) {
+  auto ib = std::make_unique<Invariant_boundaries>();
+
+  std::string line;
+  if (!std::getline(ifs, line) || !line.starts_with("top ")) {
+    return nullptr;
   }
-  ifs >> size1;
-  for (int i = 0; i < size1; i++) {
-    ifs >> tmp1 >> tmp2;
-    ib->instance_type_map[tmp1] = tmp2;
+  ib->top = line.substr(4);
+
+  if (!std::getline(ifs, line) || !line.starts_with("hier_sep ")) {
+    return nullptr;
   }
+  ib->hierarchical_separator = line.substr(9);
 
-  ifs >> size1;
-  for (int i = 0; i < size1; i++) {
-    ifs >> tmp1 >> size2;
-    for (int j = 0; j < size2; j++) {
-      ifs >> tmp2;
-      if (tmp2 == "##TOP##") {
-        ib->instance_collection[tmp1].insert(tmp2);
-      } else {
-        ib->instance_collection[tmp1].insert("");
-      }
+  if (!std::getline(ifs, line) || !line.starts_with("nets ")) {
+    return nullptr;
+  }
+  std::string_view rest(line);
+  rest.remove_prefix(5);
+  size_t n_nets = 0;
+  if (!parse_number(rest, n_nets) || !rest.empty()) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < n_nets; ++i) {
+    if (!std::getline(ifs, line) || line.size() < 3 || line[1] != ' ' || (line[0] != '0' && line[0] != '1')) {
+      return nullptr;
+    }
+    if (ib->add_net(std::string_view(line).substr(2), line[0] == '1') != i) {
+      return nullptr;  // repeated name, line i must be Net_id i
     }
   }
 
-  ifs >> size1;
-  Index_id tmp_idx;
-  for (int i = 0; i < size1; i++) {
-    ifs >> tmpid >> bit >> size2;
-    Net_ID net = std::make_pair(tmpid, bit);
-    for (int j = 0; j < size2; j++) {
-      ifs >> tmp_idx.value;
-      ib->invariant_cone_cells[net].insert(tmp_idx);
+  while (std::getline(ifs, line)) {
+    if (!line.starts_with("cone ")) {
+      return nullptr;
     }
-  }
+    rest = line;
+    rest.remove_prefix(5);
 
-  ifs >> size1;
-  for (int i = 0; i < size1; i++) {
-    ifs >> tmp1 >> size2;
-    for (int j = 0; j < size2; j++) {
-      ifs >> tmp2;
-      ib->hierarchy_tree[tmp1].insert(tmp2);
+    // Every number takes at least two characters, so the counts are bounded by the line (no huge allocations)
+    size_t id = 0;
+    size_t n  = 0;
+    if (!parse_number(rest, id) || id >= n_nets || !parse_number(rest, n) || n > rest.size() / 2) {
+      return nullptr;
+    }
+
+    auto &ends = ib->endpoints[id];
+    ends.resize(n);
+    for (auto &e : ends) {
+      if (!parse_number(rest, e) || e >= n_nets) {
+        return nullptr;
+      }
     }
-  }
 
-  ifs >> size1;
-  for (int i = 0; i < size1; i++) {
-    ifs >> tmp_idx.value >> tmp;
-    ib->gate_appearances[tmp_idx] = tmp;
+    if (!parse_number(rest, n) || n > rest.size() / 2) {
+      return nullptr;
+    }
+    auto &cells = ib->cone_cells[id];
+    cells.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+      Lg_id_t nid = 0;
+      if (!parse_number(rest, nid)) {
+        return nullptr;
+      }
+      cells.emplace_back(Index_id(nid));
+    }
+    if (!rest.empty()) {
+      return nullptr;
+    }
   }
+
+  ib->update_gate_appearances();
+
   return ib;
 }
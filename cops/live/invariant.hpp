@@ -1,71 +1,60 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include <map>
-#include <set>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
-#include "absl/container/flat_hash_set.h"
-#include "lgraph.hpp"
-
-namespace Live_synth {
-
-// FIXME: can I reduce the dependency on string by using IDs from Lgraph?
-
-// typedef std::string Net_ID;
-typedef std::pair<WireName_ID, uint32_t> Net_ID;
-typedef std::string                      Graph_ID;
-typedef std::string                      Instance_name;
-
-struct Net_ID_hash {
-  size_t operator()(const std::pair<WireName_ID, uint32_t> &obj) const {
-    size_t v = obj.first;
-    v <<= 16;
-    v ^= obj.second;
-    return v;
-  }
-};
-
-typedef absl::flat_hash_set<Net_ID, Net_ID_hash> Net_set;
-typedef absl::flat_hash_set<Instance_name>       Instance_set;
-typedef absl::flat_hash_set<Graph_ID>            Graph_set;
-
-typedef absl::flat_hash_set<Index_id, Index_id_hash> Gate_set;
-}  // namespace Live_synth
-
-using namespace Live_synth;
+#include "node.hpp"
+
+// Invariant boundaries between the elaborated and the synthesized netlists.
+//
+// A boundary is a named net (hierarchical name, instances joined with
+// hierarchical_separator) present in both netlists. Each boundary has a cone
+// in the synthesized netlist: the cells reachable backwards until another
+// boundary or a graph input (the endpoints). Nets use dense ids, the same
+// name always gets the same id in a run. The synthesized netlist is flat.
 class Invariant_boundaries {
 public:
-  absl::flat_hash_map<Instance_name, Graph_ID> instance_type_map;    // all_instances
-  absl::flat_hash_map<Graph_ID, Instance_set>  instance_collection;  // instances
-  absl::flat_hash_map<Graph_ID, Graph_set>     hierarchy_tree;       // tree
+  using Net_id = uint32_t;
 
-  absl::flat_hash_map<Net_ID, Net_set, Net_ID_hash>      invariant_cones;       // sips
-  absl::flat_hash_map<Net_ID, Gate_set, Net_ID_hash>     invariant_cone_cells;  // gate_count
-  absl::flat_hash_map<Index_id, uint32_t, Index_id_hash> gate_appearances;      // shared_gates
+  std::vector<std::string>                      nets;        // Net_id -> hierarchical name
+  absl::flat_hash_map<std::string, Net_id>      net2id;      // hierarchical name -> Net_id
+  std::vector<bool>                             boundary;    // Net_id is a boundary (otherwise a graph input)
+  std::vector<std::vector<Net_id>>              endpoints;   // per Net_id, boundaries/inputs feeding the cone
+  std::vector<std::vector<Node::Compact_class>> cone_cells;  // per Net_id, synthesized cells in the cone
+
+  absl::flat_hash_map<Node::Compact_class, uint32_t> gate_appearances;  // number of cones with the cell
 
   std::string top;
   std::string hierarchical_separator;
 
-  Invariant_boundaries() {}
+  Invariant_boundaries() = default;
+  Invariant_boundaries(std::string_view _top, std::string_view hier_sep) : top(_top), hierarchical_separator(hier_sep) {}
 
-  Invariant_boundaries(const std::string &hier_sep) : hierarchical_separator(hier_sep) {}
+  Net_id add_net(std::string_view name, bool is_boundary);
 
-  static void                  serialize(Invariant_boundaries *ib, std::ostream &ofs);
-  static Invariant_boundaries *deserialize(std::istream &ifs);
+  [[nodiscard]] bool has_net(std::string_view name) const { return net2id.contains(name); }
+  [[nodiscard]] Net_id get_id(std::string_view name) const {
+    const auto it = net2id.find(name);
+    I(it != net2id.end());
+    return it->second;
+  }
 
-  static Graph_ID get_graphID(Lgraph *g) {
-    return std::string(
-        g->get_name());  // FIXME: It would be better to use string_view, BUT, Lgraph can delete/add Lgraphs names (can it???)
+  [[nodiscard]] bool is_invariant_boundary(std::string_view name) const {
+    const auto it = net2id.find(name);
+    return it != net2id.end() && boundary[it->second];
   }
+  [[nodiscard]] bool is_invariant_boundary(Net_id id) const { return boundary[id]; }
 
-  static Lgraph *get_graph(Graph_ID id, const std::string &lgdb) { return Lgraph_open(lgdb, id); }
+  [[nodiscard]] size_t size() const { return nets.size(); }
 
-  bool is_invariant_boundary(Net_ID net) const {
-    if (net.first == 0) {
-      return false;
-    }
+  // Recomputes gate_appearances from cone_cells
+  void update_gate_appearances();
 
-    return invariant_cones.find(net) != invariant_cones.end();
-  }
+  void                                         serialize(std::ostream &ofs) const;
+  static std::unique_ptr<Invariant_boundaries> deserialize(std::istream &ifs);
 };
@@ -2,233 +2,128 @@
 
 #include "invariant_finder.hpp"
 
+#include "absl/container/flat_hash_set.h"
 #include "lgedgeiter.hpp"
 #include "live_common.hpp"
+#include "perf_tracing.hpp"
+#include "thread_pool.hpp"
 
-using namespace Live;
+Invariant_finder::Invariant_finder(Lgraph *_elab, Lgraph *_synth, std::string_view hier_sep)
+    : elab(_elab), synth(_synth), ib(_elab->get_name(), hier_sep) {
+  find_boundaries();
 
-void Invariant_finder::get_topology() {
-  std::vector<Lgraph *>         discovered;
-  absl::flat_hash_set<Lgraph *> visited;
-
-  discovered.push_back(elab_graph);
-
-  // top module
-  boundaries.instance_collection[Invariant_boundaries::get_graphID(elab_graph)].insert("");
-  boundaries.instance_type_map["##TOP##"] = Invariant_boundaries::get_graphID(elab_graph);
-  boundaries.top                          = elab_graph->get_name();
-
-  while (discovered.size()) {
-    Lgraph *current = discovered.back();
-    discovered.pop_back();
-    if (visited.find(current) != visited.end()) {
-      continue;
-    }
-
-    visited.insert(current);
-
-    for (auto &idx : current->fast()) {
-      // filter out primitives, we're only interested in user defined modules
-      if (current->node_type_get(idx).op != SubGraph_Op) {
-        continue;
-      }
-
-      Lgraph *subgraph = Lgraph_open(current->get_path(), current->subgraph_id_get(idx));
-      I(subgraph);
-
-      boundaries.hierarchy_tree[Invariant_boundaries::get_graphID(subgraph)].insert(Invariant_boundaries::get_graphID(current));
-
-      for (auto &prefix : boundaries.instance_collection[Invariant_boundaries::get_graphID(current)]) {
-        if (current->get_instance_name_id(idx) == 0) {
-          Pass::info("RTP got node with no instance name {}", idx);
-          continue;
-        }
-
-        std::string instance_name;
-        if (prefix != "") {
-          instance_name = prefix + boundaries.hierarchical_separator;
-        }
-        instance_name.append(current->get_node_instancename(idx));
-
-        boundaries.instance_collection[Invariant_boundaries::get_graphID(subgraph)].insert(instance_name);
-        boundaries.instance_type_map[instance_name] = Invariant_boundaries::get_graphID(subgraph);
-      }
-
-      if (visited.find(subgraph) == visited.end()) {
-        discovered.push_back(subgraph);
-      }
+  std::vector<Invariant_boundaries::Net_id> ids;
+  for (Invariant_boundaries::Net_id id = 0; id < ib.size(); ++id) {
+    if (ib.is_invariant_boundary(id)) {
+      ids.emplace_back(id);
     }
   }
+  find_cones(synth, ib, ids);
 }
 
-void Invariant_finder::propagate_until_boundary(Index_id nid, uint32_t bit_selection) {
-  Index_id    master_id = synth_graph->get_master_nid(nid);
-  const auto &op        = synth_graph->node_type_get(master_id).op;
-  if (op == GraphIO_Op || op == U32Const_Op || op == StrConst_Op) {
-    return;
-  }
+void Invariant_finder::find_boundaries() {
+  TRACE_EVENT("live", "LIVE_find_boundaries");
 
-  I(synth_graph->get_bits(nid) > bit_selection);
-
-  const Node_bit nid_bit = std::make_pair(nid, bit_selection);
-  if (partial_endpoints.find(nid_bit) != partial_endpoints.end()) {
-    return;
+  absl::flat_hash_set<std::string_view> synth_names;
+  for (const auto &it : synth->get_node_pin_name_map()) {
+    synth_names.insert(it.second);
   }
 
-  const Node_bit mnid_bit = std::make_pair(master_id, bit_selection);
-  if (partial_endpoints.find(mnid_bit) != partial_endpoints.end()) {
-    partial_endpoints[nid_bit]  = partial_endpoints[mnid_bit];
-    partial_cone_cells[nid_bit] = partial_cone_cells[mnid_bit];
-    cached.insert(nid_bit);
-    return;
-  }
-
-  I(partial_endpoints.find(nid_bit) == partial_endpoints.end());
-  I(partial_cone_cells.find(nid_bit) == partial_cone_cells.end());
-
-  I(deleted.find(nid_bit) == deleted.end());
-
-  partial_endpoints[nid_bit]  = Net_set();
-  partial_cone_cells[nid_bit] = Gate_set();
-
-  stack.set_bit(nid);
+  // Graph inputs are cone endpoints, they must have an id before the cones
+  // are computed in parallel
+  synth->each_graph_input([this](Node_pin &dpin) { ib.add_net(dpin.get_name(), false); });
 
-  for (auto &edge : synth_graph->inp_edges(master_id)) {
-    // in cases like join/pick we only propagate to a specific bit
-    absl::flat_hash_set<uint32_t> bit_selections;
-    int propagate = resolve_bit(synth_graph, nid, bit_selection, edge.get_inp_pin().get_pid(), bit_selections);
-    if (propagate == -1) {
-      continue;
+  auto add_boundary = [this, &synth_names](const Node_pin &dpin) {
+    auto name = Live::get_net_name(dpin, ib.hierarchical_separator);
+    if (synth_names.contains(name)) {
+      ib.add_net(name, true);
     }
+  };
 
-    for (uint32_t t_bit_selection : bit_selections) {
-      Index_id driver_cell = synth_graph->get_node(edge.get_out_pin()).get_nid();
-      Node_bit driver_bit  = std::make_pair(driver_cell, t_bit_selection);
-      Net_ID   net_bit     = std::make_pair(synth_graph->get_wid(driver_cell), t_bit_selection);
-
-      if (synth_graph->get_bits(driver_cell) <= t_bit_selection && synth_graph->get_bits(driver_cell) == 1) {
-        // FIXME: is there a better way to detect control signals on multibit cells? (eg memory, registers)
-        t_bit_selection = 0;
-      }
-
-      partial_cone_cells[nid_bit].insert(driver_cell);
+  Live::setup_hierarchy(elab);
 
-      // FIXME: for registers don't propagate through clk, rst, enable
-      // FIXME: for fflops propagate data to data, valid to valid and retry to retry only
+  elab->each_graph_output([&add_boundary](Node_pin &dpin) { add_boundary(dpin); }, true);
 
-      if (stack.get_bit(driver_cell)) {
-        continue;
-      }
-
-      // no net name set, thus this is not a invariant boundary
-      if (synth_graph->get_wid(driver_cell) == 0 || !boundaries.is_invariant_boundary(net_bit)) {
-        // recurse
-        propagate_until_boundary(driver_cell, t_bit_selection);
-        partial_endpoints[nid_bit].insert(partial_endpoints[driver_bit].begin(), partial_endpoints[driver_bit].end());
-        partial_cone_cells[nid_bit].insert(partial_cone_cells[driver_bit].begin(), partial_cone_cells[driver_bit].end());
-
-        continue;
-      } else {
-        partial_endpoints[nid_bit].insert(driver_bit);
+  for (auto node : elab->fast(true)) {
+    for (const auto &dpin : node.out_connected_pins()) {
+      if (dpin.has_name()) {
+        add_boundary(dpin);
       }
     }
   }
-
-  cached.insert(nid_bit);
-  for (auto &edge : synth_graph->inp_edges(master_id)) {
-    for (uint32_t t_bit_selection = 0; t_bit_selection < synth_graph->get_bits(edge.get_out_pin()); t_bit_selection++) {
-      Index_id driver_cell = synth_graph->get_node(edge.get_out_pin()).get_nid();
-      Node_bit driver_bit  = std::make_pair(driver_cell, t_bit_selection);
-      clear_cache(driver_bit);
-    }
-  }
-
-  stack.clear_bit(nid);
 }
 
-void Invariant_finder::clear_cache(const Node_bit &entry) {
-  if (partial_endpoints.find(entry) == partial_endpoints.end() || stack.get_bit(entry.first)) {
-    return;
-  }
+void Invariant_finder::find_cone(Invariant_boundaries &bounds, Invariant_boundaries::Net_id id, const Node_pin &dpin) {
+  auto &ends  = bounds.endpoints[id];
+  auto &cells = bounds.cone_cells[id];
+  ends.clear();
+  cells.clear();
 
-  for (auto &oedge : synth_graph->out_edges(entry.first)) {
-    for (uint32_t bit = 0; bit < synth_graph->get_bits(oedge.get_out_pin()); bit++) {
-      if (cached.find(std::make_pair(oedge.get_idx(), bit)) == cached.end()) {
-        return;
-      }
-    }
-  }
-  partial_endpoints[entry].clear();
-  partial_endpoints.erase(entry);
-  partial_cone_cells.erase(entry);
+  absl::flat_hash_set<Node::Compact_class>          visited;
+  absl::flat_hash_set<Invariant_boundaries::Net_id> seen_ends;
+  std::vector<Node_pin>                             pending;
 
-#ifndef NDEBUG
-  deleted.insert(entry);
-#endif
-}
-
-void Invariant_finder::find_invariant_boundaries() {
-  std::string path = elab_graph->get_path();
-  get_topology();
-
-  absl::flat_hash_map<Net_ID, Index_id> invariant_boundaries;
-  for (auto &_inst : boundaries.instance_type_map) {
-    Instance_name inst = _inst.first;
-    if (inst == "##TOP##") {
-      inst = "";
-    } else {
-      inst = inst + boundaries.hierarchical_separator;
+  auto visit = [&visited, &cells, &pending](const Node &node) {
+    if (!visited.insert(node.get_compact_class()).second) {
+      return;
     }
+    cells.emplace_back(node.get_compact_class());
+    for (const auto &e : node.inp_edges()) {
+      pending.emplace_back(e.driver);
+    }
+  };
 
-    Lgraph *lg = Invariant_boundaries::get_graph(_inst.second, path);
-    I(lg);
-
-    for (auto &nid : lg->forward()) {
-      // FIXME: when testing with synopsys, bit gets merged into name, we need to
-      // take that into account here.
-      if (lg->get_wid(nid) == 0) {
-        continue;
-      }
-
-      auto net_name = lg->get_node_wirename(nid);
-
-      auto hierarchical_name = absl::StrCat(inst, net_name);
+  if (dpin.is_graph_output()) {
+    for (const auto &e : dpin.change_to_sink_from_graph_out_driver().inp_edges()) {
+      pending.emplace_back(e.driver);
+    }
+  } else {
+    visit(dpin.get_node());
+  }
 
-      Index_id    idx;
-      WireName_ID wire_id;
-      if (synth_graph->has_wirename(hierarchical_name)) {
-        idx     = synth_graph->get_node_id(hierarchical_name);
-        wire_id = synth_graph->get_wid(idx);
+  while (!pending.empty()) {
+    auto driver = pending.back();
+    pending.pop_back();
 
-      } else {
-        I(!synth_graph->has_wirename(("\\" + hierarchical_name).c_str()));
+    if (driver.has_name()) {
+      const auto it = bounds.net2id.find(Live::get_net_name(driver, bounds.hierarchical_separator));
+      if (it != bounds.net2id.end()) {
+        if (seen_ends.insert(it->second).second) {
+          ends.emplace_back(it->second);
+        }
         continue;
       }
-
-      for (int bit = 0; bit < synth_graph->get_bits(idx); bit++) {
-        Net_ID id                      = std::make_pair(wire_id, bit);
-        boundaries.invariant_cones[id] = Net_set();
-        invariant_boundaries.insert(std::make_pair(id, idx));
-      }
     }
-  }
-
-  for (auto &invar : invariant_boundaries) {
-    Index_id idx = invar.second;
-    uint32_t bit = invar.first.second;
-
-    propagate_until_boundary(idx, bit);
-
-    Node_bit nid_bit = std::make_pair(idx, bit);
+    if (driver.is_graph_input()) {
+      continue;
+    }
 
-    boundaries.invariant_cones[invar.first].insert(partial_endpoints[nid_bit].begin(), partial_endpoints[nid_bit].end());
-    boundaries.invariant_cone_cells[invar.first].insert(partial_cone_cells[nid_bit].begin(), partial_cone_cells[nid_bit].end());
+    visit(driver.get_node());
+  }
+}
 
-    for (auto &cell : partial_cone_cells[nid_bit]) {
-      if (boundaries.gate_appearances.find(cell) == boundaries.gate_appearances.end()) {
-        boundaries.gate_appearances[cell] = 0;
+void Invariant_finder::find_cones(Lgraph *lg, Invariant_boundaries &bounds, const std::vector<Invariant_boundaries::Net_id> &ids) {
+  TRACE_EVENT("live", "LIVE_find_cones");
+
+  auto pins = Live::find_nets(lg, bounds, false);
+
+  // Each task writes only the cone slots of its ids
+  constexpr size_t chunk = 64;
+  for (size_t start = 0; start < ids.size(); start += chunk) {
+    thread_pool.add([lg, &bounds, &ids, &pins, start]() {
+      auto end = std::min(ids.size(), start + chunk);
+      for (auto i = start; i < end; ++i) {
+        auto id = ids[i];
+        if (pins[id].is_invalid()) {
+          bounds.endpoints[id].clear();
+          bounds.cone_cells[id].clear();
+          continue;
+        }
+        find_cone(bounds, id, Node_pin(lg, pins[id]));
       }
-      boundaries.gate_appearances[cell]++;
-    }
+    });
   }
+  thread_pool.wait_all();
+
+  bounds.update_gate_appearances();
 }
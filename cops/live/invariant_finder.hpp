@@ -1,56 +1,29 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include "absl/container/flat_hash_map.h"
-#include "bm.h"
+#include <string_view>
+#include <vector>
+
 #include "invariant.hpp"
-#include "invariant_options.hpp"
 #include "lgraph.hpp"
 
 class Invariant_finder {
-private:
-  Lgraph              *elab_graph;
-  Lgraph              *synth_graph;
-  Invariant_boundaries boundaries;
-
-  bool          processed;
-  bm::bvector<> stack;
-
-  typedef std::pair<Index_id, uint32_t>   Node_bit;
-  absl::flat_hash_map<Node_bit, Gate_set> partial_cone_cells;  // partial_gate_count
-  absl::flat_hash_map<Node_bit, Net_set>  partial_endpoints;   // sips
+protected:
+  Lgraph *elab;
+  Lgraph *synth;
 
-  // there is a delay between allocation of the cache and populating it
-  absl::flat_hash_set<Node_bit> cached;
+  Invariant_boundaries ib;
 
-#ifndef NDEBUG
-  absl::flat_hash_set<Node_bit> deleted;
-#endif
+  void find_boundaries();
 
-  void get_topology();
+  static void find_cone(Invariant_boundaries &ib, Invariant_boundaries::Net_id id, const Node_pin &dpin);
 
-  void find_invariant_boundaries();
+public:
+  // elab is hierarchical, synth is the flat synthesized netlist of the same design
+  Invariant_finder(Lgraph *elab, Lgraph *synth, std::string_view hier_sep);
 
-  void propagate_until_boundary(Index_id nid, uint32_t bit_selection);
-  void clear_cache(const Node_bit &entry);
+  // Recomputes the synthesized cone of each id (in parallel) and the gate appearances
+  static void find_cones(Lgraph *synth, Invariant_boundaries &ib, const std::vector<Invariant_boundaries::Net_id> &ids);
 
-public:
-  Invariant_finder(Lgraph *elab, Lgraph *synth, const std::string &hier_sep = ".") : boundaries(hier_sep) {
-    processed   = false;
-    elab_graph  = elab;
-    synth_graph = synth;
-  }
-
-  Invariant_finder(const Invariant_find_options &pack) : boundaries(pack.hierarchical_separator) {
-    processed   = false;
-    elab_graph  = Lgraph_open(pack.elab_lgdb, pack.top);
-    synth_graph = Lgraph_open(pack.synth_lgdb, pack.top);
-  }
-
-  const Invariant_boundaries &get_boundaries() {
-    if (!processed) {
-      find_invariant_boundaries();
-    }
-    return boundaries;
-  }
+  Invariant_boundaries &get_boundaries() { return ib; }
 };
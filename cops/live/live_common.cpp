@@ -1,254 +1,87 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
 #include "live_common.hpp"
 
+#include "absl/strings/str_replace.h"
+#include "graph_library.hpp"
+#include "lgedgeiter.hpp"
+
 namespace Live {
 
-int resolve_bit(Lgraph *graph, Index_id idx, uint32_t current_bit, Port_ID pin, absl::flat_hash_set<uint32_t> &bits) {
-  if (graph->node_type_get(idx).op == Pick_Op) {
-    I(graph->get_bits(graph->get_node(idx).get_driver_pin()) >= current_bit);
-    if (pin != 0) {
-      return -1;  // do not propagate through this pid
-    }
-    Node_pin picked;
-    Node_pin offset;
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() == 0) {
-        picked = c.get_out_pin();
-      } else if (c.get_inp_pin().get_pid() == 1) {
-        offset = c.get_out_pin();
-      }
-    }
-    I(picked.is_valid());
-    I(offset.is_valid());
-    I(offset.get_node().get_type_op() == U32Const_Op);
-    I(graph->node_value_get(offset) + current_bit <= graph->get_bits(picked));
-    bits.insert(graph->node_value_get(offset) + current_bit);
-    return 0;
-  } else if (graph->node_type_get(idx).op == Join_Op) {
-    std::map<Index_id, uint32_t> port_size;
-    for (auto &c : graph->inp_edges(idx)) {
-      port_size[c.get_inp_pin().get_pid()] = graph->get_bits(c.get_out_pin());
-    }
-    uint32_t offset = 0;
-    int      last   = -1;
-    for (auto &ps : port_size) {
-      I(last + 1 == (int)ps.first);  // need to traverse in order
-      last = ps.first;
-      if (offset + ps.second > current_bit) {
-        if (ps.first != pin) {
-          return -1;  // do not propagate through this pid
-        }
-        I(current_bit >= offset);
-        bits.insert(current_bit - offset);
-        return 0;
-      }
-      offset += ps.second;
-    }
-    I(false);  // internal error in join
-    return -1;
-  } else if (graph->node_type_get(idx).op == Mux_Op) {
-    if (pin == 2) {
-      bits.insert(1);
-    } else {
-      bits.insert(current_bit);
-    }
-  } else if (graph->node_type_get(idx).op == ShiftRight_Op) {
-    if (pin == 2) {
-      bits.insert(0);
-      return 0;
-    }
-    int      const_shift   = -1;
-    Index_id relevant_port = 0;
+std::string get_net_name(const Node_pin &dpin, std::string_view hier_sep) {
+  I(dpin.has_name());
 
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() == 1 && graph->node_type_get(c.get_idx()).op == U32Const_Op) {
-        const_shift = graph->node_value_get(c.get_idx());
-      }
-      if (c.get_inp_pin().get_pid() == pin) {
-        relevant_port = c.get_idx();
-      }
-    }
-    if (const_shift >= 0) {
-      if (pin == 1) {
-        bits.insert(0);
-      } else if (pin == 0) {
-        bits.insert(current_bit + const_shift);
-      } else {
-        I(false);
-      }
-      return 0;
-    } else {
-      for (int bit = 0; bit < graph->get_bits(relevant_port); bit++) {
-        bits.insert(bit);
-      }
-    }
-    return 0;
-  } else if (graph->node_type_get(idx).op == ShiftLeft_Op) {
-    int      const_shift   = -1;
-    Index_id relevant_port = 0;
-
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() == 1 && graph->node_type_get(c.get_idx()).op == U32Const_Op) {
-        const_shift = graph->node_value_get(c.get_idx());
-      }
-      if (c.get_inp_pin().get_pid() == pin) {
-        relevant_port = c.get_idx();
-      }
-    }
-    if (const_shift >= 0) {
-      if (pin == 1) {
-        bits.insert(0);
-      } else if (pin == 0) {
-        I(current_bit >= static_cast<uint32_t>(const_shift));
-        bits.insert(current_bit - const_shift);
-      } else {
-        I(false);
-      }
-      return 0;
-    } else {
-      for (int bit = 0; bit < graph->get_bits(relevant_port); bit++) {
-        bits.insert(bit);
-      }
-    }
-    return 0;
-  } else if (graph->node_type_get(idx).op == Equals_Op || graph->node_type_get(idx).op == GreaterThan_Op
-             || graph->node_type_get(idx).op == GreaterEqualThan_Op || graph->node_type_get(idx).op == LessEqualThan_Op
-             || graph->node_type_get(idx).op == LessThan_Op || graph->node_type_get(idx).op == TechMap_Op) {
-    Index_id relevant_port = 0;
-
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() == pin) {
-        relevant_port = c.get_idx();
-        break;
-      }
-    }
-    for (int bit = 0; bit < graph->get_bits(relevant_port); bit++) {
-      bits.insert(bit);
-    }
-  } else {
-    bits.insert(current_bit);
+  auto name = dpin.get_wire_name();  // instance path joined with "."
+  if (dpin.is_hierarchical() && hier_sep != ".") {
+    absl::StrReplaceAll({{".", hier_sep}}, &name);
   }
-  return 0;
+
+  return name;
 }
 
-// resolves which bits are dependencies of the current bit based on node type
-// when propagating backwards
-int resolve_bit_fwd(Lgraph *graph, Index_id idx, uint32_t current_bit, Port_ID pin, absl::flat_hash_set<uint32_t> &bits) {
-  if (graph->node_type_get(idx).op == Pick_Op) {
-    if (pin != 0) {
-      return -1;  // do not propagate through this pid
-    }
-    Index_id picked = 0, offset = 0;
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() == 0) {
-        picked = c.get_out_pin().get_idx();
-      } else if (c.get_inp_pin().get_pid() == 1) {
-        offset = graph->get_node(c.get_out_pin()).get_nid();
-      }
-    }
-    I(picked);
-    I(offset);
+void setup_hierarchy(Lgraph *top) {
+  (void)top->fast(true).begin();  // builds the instance tree
 
-    if (current_bit < graph->node_value_get(offset)) {
-      // ignore this bit, not used by pick
-      return -1;
-    }
+  auto *htree = top->ref_htree();
 
-    bits.insert(current_bit - graph->node_value_get(offset));
-    return 0;  // graph->node_value_get(offset) + current_bit;
-  } else if (graph->node_type_get(idx).op == Join_Op) {
-    std::map<Index_id, uint32_t> port_size;
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() >= pin) {
-        continue;
-      }
-      port_size[c.get_inp_pin().get_pid()] = graph->get_bits(c.get_out_pin());
-    }
-    uint32_t offset = 0;
-    int      last   = -1;
-    for (auto &ps : port_size) {
-      I(last + 1 == static_cast<int>(ps.first));  // need to traverse in order
-      last = ps.first;
-      offset += ps.second;
-    }
-    bits.insert(current_bit + offset);
-    return 0;
-  } else if (graph->node_type_get(idx).op == Mux_Op) {
-    if (pin == 2) {
-      // select affects all output bits
-      for (int bit = 0; bit < graph->get_bits(idx); bit++) {
-        bits.insert(bit);
-      }
-      return 0;
-    } else {
-      bits.insert(current_bit);
-      return 0;
-    }
-  } else if (graph->node_type_get(idx).op == ShiftRight_Op) {
-    if (pin > 0) {
-      // shift amount and sign extension can affect all output bits
-      for (int bit = 0; bit < graph->get_bits(idx); bit++) {
-        bits.insert(bit);
-      }
-      return 0;
-    }
-    int  const_shift = -1;
-    bool sign        = false;
-
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() == 1 && graph->node_type_get(c.get_idx()).op == U32Const_Op) {
-        const_shift = graph->node_value_get(c.get_idx());
-      } else if (c.get_inp_pin().get_pid() == 2) {
-        sign = (graph->node_value_get(c.get_idx()) == 2);
-      }
-    }
-    if (const_shift >= 0 && (!sign || static_cast<int>(current_bit) != graph->get_bits(idx) - 1)) {
-      // if there is sign extension, MSB affects all bits
-      // bits lower than shift amount do no affect any bit
-      if (current_bit >= static_cast<uint32_t>(const_shift)) {
-        bits.insert(current_bit - const_shift);
-      }
-    } else {
-      for (int bit = graph->get_bits(idx) - 1; bit >= 0; bit--) {
-        // each bit can only affect lower bits
-        bits.insert(bit);
-      }
-    }
-    return 0;
-  } else if (graph->node_type_get(idx).op == ShiftLeft_Op) {
-    if (pin > 0) {
-      // shift amount affects all output bits
-      for (int bit = 0; bit < graph->get_bits(idx); bit++) {
-        bits.insert(bit);
-      }
-      return 0;
-    }
+  auto [hidx, lg] = htree->get_next(Hierarchy::hierarchical_root());
+  while (lg != top) {
+    (void)htree->get_name(hidx);
+    std::tie(hidx, lg) = htree->get_next(hidx);
+  }
+}
 
-    int const_shift = -1;
+std::vector<Node_pin::Compact> find_nets(Lgraph *lg, const Invariant_boundaries &ib, bool hierarchical) {
+  std::vector<Node_pin::Compact> pins(ib.size());
 
-    for (auto &c : graph->inp_edges(idx)) {
-      if (c.get_inp_pin().get_pid() == 1 && graph->node_type_get(c.get_idx()).op == U32Const_Op) {
-        const_shift = graph->node_value_get(c.get_idx());
-      }
+  auto add_pin = [&pins, &ib](const Node_pin &dpin) {
+    auto name = get_net_name(dpin, ib.hierarchical_separator);
+
+    const auto it = ib.net2id.find(name);
+    if (it != ib.net2id.end() && pins[it->second].is_invalid()) {
+      pins[it->second] = dpin.get_compact();
     }
-    if (const_shift >= 0) {
-      if (current_bit + const_shift < graph->get_bits(idx)) {
-        bits.insert(current_bit + const_shift);
-      }
-      return 0;
-    } else {
-      for (int bit = current_bit; bit < graph->get_bits(idx); bit++) {
-        bits.insert(bit);
+  };
+
+  if (hierarchical) {
+    setup_hierarchy(lg);
+  }
+
+  // top IOs first, an internal net with the same name drives the output
+  lg->each_graph_output([&add_pin](Node_pin &dpin) { add_pin(dpin); }, hierarchical);
+  lg->each_graph_input([&add_pin](Node_pin &dpin) { add_pin(dpin); }, hierarchical);
+
+  for (auto node : lg->fast(hierarchical)) {
+    for (const auto &dpin : node.out_connected_pins()) {
+      if (dpin.has_name()) {
+        add_pin(dpin);
       }
     }
-    return 0;
-  } else if (graph->node_type_get(idx).op == Equals_Op || graph->node_type_get(idx).op == GreaterThan_Op
-             || graph->node_type_get(idx).op == GreaterEqualThan_Op || graph->node_type_get(idx).op == LessEqualThan_Op
-             || graph->node_type_get(idx).op == LessThan_Op) {
-    bits.insert(1);
-  } else {
-    bits.insert(current_bit);
   }
-  return 0;
+
+  return pins;
+}
+
+Node copy_node(Lgraph *dst, const Node &src) {
+  if (!src.is_type_sub()) {
+    return dst->create_node(src);
+  }
+
+  const auto &src_sub = src.get_type_sub_node();
+
+  auto *lib     = dst->ref_library();
+  bool  fresh   = !lib->has_name(src_sub.get_name());
+  auto *dst_sub = lib->ref_or_create_sub(src_sub.get_name());
+  if (fresh) {
+    dst_sub->copy_from(src_sub.get_name(), dst_sub->get_lgid(), src_sub);  // same instance pids
+  }
+
+  auto node = dst->create_node_sub(dst_sub->get_lgid());
+  for (const auto &dpin : src.out_connected_pins()) {
+    node.setup_driver_pin_raw(dpin.get_pid()).set_bits(dpin.get_bits());
+  }
+
+  return node;
 }
+
 }  // namespace Live
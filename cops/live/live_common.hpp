@@ -1,40 +1,30 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include "absl/container/flat_hash_set.h"
-#include "lgedgeiter.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "invariant.hpp"
 #include "lgraph.hpp"
 
 namespace Live {
 
-class Graph_Node {  // FIXME: remove an use Node_pin (same info)
-public:
-  Lgraph     *module;
-  Index_id    idx;
-  uint32_t    bit;
-  std::string instance;
-  // we need to take into account PIDs for subgraphs
-  // for primitives, it doesn't matter since most have a single output
-  Port_ID pid;
-
-  Graph_Node(Lgraph *module, Index_id idx, uint32_t bit, const std::string &instance, Port_ID pid)
-      : module(module), idx(idx), bit(bit), instance(instance), pid(pid) {}
-
-  Graph_Node() {}
-
-  bool operator<(const Graph_Node &rhs) const {
-    return (module < rhs.module) || (module == rhs.module && idx < rhs.idx)
-           || (module == rhs.module && idx == rhs.idx && pid < rhs.pid)
-           || (module == rhs.module && idx == rhs.idx && pid == rhs.pid && bit < rhs.bit)
-           || (module == rhs.module && idx == rhs.idx && pid == rhs.pid && bit == rhs.bit && instance < rhs.instance);
-  }
-};
-
-// resolves which bits are dependencies of the current bit based on node type
-// when propagating backwards
-int resolve_bit(Lgraph *graph, Index_id idx, uint32_t current_bit, Port_ID pin, absl::flat_hash_set<uint32_t> &bits);
-
-// resolves which bits are dependencies of the current bit based on node type
-// when propagating backwards
-int resolve_bit_fwd(Lgraph *graph, Index_id idx, uint32_t current_bit, Port_ID pin, absl::flat_hash_set<uint32_t> &bits);
+// Hierarchical name of a named driver pin (instances joined with hier_sep)
+std::string get_net_name(const Node_pin &dpin, std::string_view hier_sep);
+
+// The hierarchy tree and its names are lazily populated. Populate them before
+// sharing a hierarchical Lgraph across threads (read only afterwards).
+void setup_hierarchy(Lgraph *top);
+
+// Driver pin of each net in ib (invalid if missing in lg). In hierarchical
+// mode the names come from the instance tree, otherwise lg is flat and the
+// pin names are already hierarchical.
+std::vector<Node_pin::Compact> find_nets(Lgraph *lg, const Invariant_boundaries &ib, bool hierarchical);
+
+// Copies the node (type, LUT/const/sub and driver bits) to another Lgraph,
+// possibly in another library (subs are matched by name).
+Node copy_node(Lgraph *dst, const Node &src);
+
 }  // namespace Live
@@ -0,0 +1,219 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <sstream>
+#include <string_view>
+
+#include "diff_finder.hpp"
+#include "graph_library.hpp"
+#include "gtest/gtest.h"
+#include "invariant.hpp"
+#include "invariant_finder.hpp"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "stitcher.hpp"
+
+class Live_test : public ::testing::Test {
+protected:
+  // o1 = (a + b) ^ c, o2 = a op c (the n3 net)
+  static Lgraph *build(std::string_view lgdb, Ntype_op n3_op) {
+    auto *lg = Graph_library::instance(lgdb)->create_lgraph("live_top", "-");
+
+    auto a = lg->add_graph_input("a", 1, 8);
+    auto b = lg->add_graph_input("b", 2, 8);
+    auto c = lg->add_graph_input("c", 3, 8);
+
+    auto n1 = lg->create_node(Ntype_op::Sum, 8);
+    n1.setup_sink_pin("A").connect_driver(a);
+    n1.setup_sink_pin("A").connect_driver(b);
+    n1.setup_driver_pin().set_name("n1");
+
+    auto n2 = lg->create_node(Ntype_op::Xor, 8);
+    n2.setup_sink_pin().connect_driver(n1.setup_driver_pin());
+    n2.setup_sink_pin().connect_driver(c);
+    n2.setup_driver_pin().set_name("n2");
+
+    auto n3 = lg->create_node(n3_op, 8);
+    n3.setup_sink_pin().connect_driver(a);
+    n3.setup_sink_pin().connect_driver(c);
+    n3.setup_driver_pin().set_name("n3");
+
+    lg->add_graph_output("o1", 4, 8).connect_driver(n2.setup_driver_pin());
+    lg->add_graph_output("o2", 5, 8).connect_driver(n3.setup_driver_pin());
+
+    return lg;
+  }
+
+  // Hierarchical elaborated design: o = u0.y & c (the n2 net), the live_child
+  // instance u0 has y = a op b (the n1 net)
+  static Lgraph *build_hier(std::string_view lgdb, Ntype_op n1_op) {
+    auto *lib   = Graph_library::instance(lgdb);
+    auto *child = lib->create_lgraph("live_child", "-");
+
+    auto ca = child->add_graph_input("a", 1, 8);
+    auto cb = child->add_graph_input("b", 2, 8);
+
+    auto n1 = child->create_node(n1_op, 8);
+    n1.setup_sink_pin().connect_driver(ca);
+    n1.setup_sink_pin().connect_driver(cb);
+    n1.setup_driver_pin().set_name("n1");
+
+    child->add_graph_output("y", 3, 8).connect_driver(n1.setup_driver_pin());
+
+    auto *lg = lib->create_lgraph("live_htop", "-");
+
+    auto a = lg->add_graph_input("a", 1, 8);
+    auto b = lg->add_graph_input("b", 2, 8);
+    auto c = lg->add_graph_input("c", 3, 8);
+
+    auto u0 = lg->create_node_sub("live_child");
+    u0.set_name("u0");
+    u0.setup_sink_pin("a").connect_driver(a);
+    u0.setup_sink_pin("b").connect_driver(b);
+
+    auto n2 = lg->create_node(Ntype_op::And, 8);
+    n2.setup_sink_pin().connect_driver(u0.setup_driver_pin("y"));
+    n2.setup_sink_pin().connect_driver(c);
+    n2.setup_driver_pin().set_name("n2");
+
+    lg->add_graph_output("o", 4, 8).connect_driver(n2.setup_driver_pin());
+
+    return lg;
+  }
+
+  // build_hier flattened, the instance path is in the net names
+  static Lgraph *build_flat(std::string_view lgdb) {
+    auto *lg = Graph_library::instance(lgdb)->create_lgraph("live_htop", "-");
+
+    auto a = lg->add_graph_input("a", 1, 8);
+    auto b = lg->add_graph_input("b", 2, 8);
+    auto c = lg->add_graph_input("c", 3, 8);
+
+    auto n1 = lg->create_node(Ntype_op::Xor, 8);
+    n1.setup_sink_pin().connect_driver(a);
+    n1.setup_sink_pin().connect_driver(b);
+    n1.setup_driver_pin().set_name("u0.n1");
+
+    auto n2 = lg->create_node(Ntype_op::And, 8);
+    n2.setup_sink_pin().connect_driver(n1.setup_driver_pin());
+    n2.setup_sink_pin().connect_driver(c);
+    n2.setup_driver_pin().set_name("n2");
+
+    lg->add_graph_output("o", 4, 8).connect_driver(n2.setup_driver_pin());
+
+    return lg;
+  }
+};
+
+TEST_F(Live_test, one_change) {
+  auto *orig  = build("lgdb_live_orig", Ntype_op::And);
+  auto *synth = build("lgdb_live_synth", Ntype_op::And);
+  auto *mod   = build("lgdb_live_mod", Ntype_op::Or);
+
+  Invariant_finder finder(orig, synth, ".");
+  auto            &ib = finder.get_boundaries();
+
+  for (auto name : {"n1", "n2", "n3", "o1", "o2"}) {
+    EXPECT_TRUE(ib.is_invariant_boundary(name)) << name;
+  }
+  EXPECT_FALSE(ib.is_invariant_boundary("a"));
+  EXPECT_EQ(ib.cone_cells[ib.get_id("n2")].size(), 1);  // just the xor, n1 is a boundary
+  EXPECT_EQ(ib.endpoints[ib.get_id("n2")].size(), 2);
+  EXPECT_EQ(ib.cone_cells[ib.get_id("o2")].size(), 0);
+
+  {
+    std::stringstream ss;
+    ib.serialize(ss);
+    auto ib2 = Invariant_boundaries::deserialize(ss);
+    ASSERT_NE(ib2, nullptr);
+    EXPECT_EQ(ib2->nets, ib.nets);
+    EXPECT_EQ(ib2->boundary, ib.boundary);
+    EXPECT_EQ(ib2->endpoints, ib.endpoints);
+    EXPECT_EQ(ib2->gate_appearances, ib.gate_appearances);
+  }
+
+  Diff_finder diff(orig, mod, ib);
+  const auto &diffs = diff.find_diffs();
+  ASSERT_EQ(diffs.size(), 1);
+  EXPECT_EQ(ib.nets[diffs[0]], "n3");
+  EXPECT_EQ(diff.get_delta_cells(), 1);
+
+  auto *delta = Graph_library::instance("lgdb_live_delta")->create_lgraph("live_top", "-");
+  diff.generate_delta(delta);
+  EXPECT_TRUE(delta->has_graph_input("a"));
+  EXPECT_FALSE(delta->has_graph_input("b"));
+  EXPECT_TRUE(delta->has_graph_input("c"));
+  EXPECT_TRUE(delta->has_graph_output("n3"));
+  EXPECT_FALSE(delta->has_graph_output("n2"));
+
+  // The delta is already "synthesized", stitch it back
+  Live_stitcher stitcher(synth, &ib);
+  stitcher.stitch(delta, diffs);
+
+  int n_and = 0;
+  int n_or  = 0;
+  for (auto node : synth->fast()) {
+    n_and += node.is_type(Ntype_op::And) ? 1 : 0;
+    n_or += node.is_type(Ntype_op::Or) ? 1 : 0;
+  }
+  EXPECT_EQ(n_and, 0);
+  EXPECT_EQ(n_or, 1);
+  EXPECT_EQ(synth->get_graph_output("o2").get_driver_pin().get_node().get_type_op(), Ntype_op::Or);
+  EXPECT_EQ(ib.cone_cells[ib.get_id("n3")].size(), 1);
+
+  Diff_finder nodiff(mod, mod, ib);
+  EXPECT_TRUE(nodiff.find_diffs().empty());
+}
+
+TEST_F(Live_test, hierarchical) {
+  auto *orig  = build_hier("lgdb_live_horig", Ntype_op::Xor);
+  auto *synth = build_flat("lgdb_live_hsynth");
+  auto *mod   = build_hier("lgdb_live_hmod", Ntype_op::Or);
+
+  Invariant_finder finder(orig, synth, ".");
+  auto            &ib = finder.get_boundaries();
+
+  for (auto name : {"u0.n1", "n2", "o"}) {
+    EXPECT_TRUE(ib.is_invariant_boundary(name)) << name;
+  }
+  EXPECT_EQ(ib.cone_cells[ib.get_id("u0.n1")].size(), 1);
+  EXPECT_EQ(ib.cone_cells[ib.get_id("n2")].size(), 1);  // just the and, u0.n1 is a boundary
+  EXPECT_EQ(ib.endpoints[ib.get_id("n2")].size(), 2);
+
+  {
+    std::stringstream ss;
+    ib.serialize(ss);
+    auto ib2 = Invariant_boundaries::deserialize(ss);
+    ASSERT_NE(ib2, nullptr);
+    EXPECT_EQ(ib2->nets, ib.nets);
+    EXPECT_EQ(ib2->endpoints, ib.endpoints);
+  }
+
+  Diff_finder diff(orig, mod, ib);
+  const auto &diffs = diff.find_diffs();
+  ASSERT_EQ(diffs.size(), 1);
+  EXPECT_EQ(ib.nets[diffs[0]], "u0.n1");
+
+  Diff_finder nodiff(orig, orig, ib);
+  EXPECT_TRUE(nodiff.find_diffs().empty());
+}
+
+TEST_F(Live_test, deserialize_malformed) {
+  const std::string header = "top t\nhier_sep .\nnets 2\n0 a\n1 n\n";
+
+  auto parse = [](const std::string &text) {
+    std::stringstream ss(text);
+    return Invariant_boundaries::deserialize(ss);
+  };
+
+  EXPECT_NE(parse(header + "cone 1 1 0 1 7\n"), nullptr);
+
+  EXPECT_EQ(parse("top t\nhier_sep .\nnets x\n"), nullptr);
+  EXPECT_EQ(parse("top t\nhier_sep .\nnets 2\n0 a\n1 a\n"), nullptr);  // repeated net
+  EXPECT_EQ(parse(header + "cone 2 0 0\n"), nullptr);                      // net id out of range
+  EXPECT_EQ(parse(header + "cone 1 1 5 1 7\n"), nullptr);                  // endpoint out of range
+  EXPECT_EQ(parse(header + "cone 1 1 -1 1 7\n"), nullptr);
+  EXPECT_EQ(parse(header + "cone 1 99999999999 0\n"), nullptr);  // more endpoints than the line has
+  EXPECT_EQ(parse(header + "cone 1 1 0 1 7x\n"), nullptr);
+  EXPECT_EQ(parse(header + "cone 1 1 0 2 7\n"), nullptr);  // truncated
+  EXPECT_EQ(parse(header + "cone 1 1 0 1 7 8\n"), nullptr);
+}
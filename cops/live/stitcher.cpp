@@ -2,130 +2,104 @@
 
 #include "stitcher.hpp"
 
-#include <fstream>
-
+#include "absl/container/flat_hash_map.h"
+#include "invariant_finder.hpp"
 #include "lgedgeiter.hpp"
-
-Live_stitcher::Live_stitcher(Stitch_pass_options &pack) {
-  std::ifstream invariant_file(pack.boundaries_name);
-
-  if (!invariant_file.good()) {
-    Pass::error(std::format("Live_stitcher: Error reading boundaries file {}", pack.boundaries_name));
-    return;
+#include "live_common.hpp"
+#include "pass.hpp"
+#include "perf_tracing.hpp"
+
+void Live_stitcher::stitch(Lgraph *nsynth, const std::vector<Invariant_boundaries::Net_id> &diffs) {
+  TRACE_EVENT("live", "LIVE_stitch");
+
+  auto pins = Live::find_nets(original, *boundaries, false);
+
+  // Check before touching original, an error leaves it unchanged
+  absl::flat_hash_map<std::string, Node_pin> inputs;  // nsynth input -> original driver
+  nsynth->each_graph_input([this, &pins, &inputs](Node_pin &dpin) {
+    auto name = dpin.get_name();
+    if (boundaries->has_net(name) && !pins[boundaries->get_id(name)].is_invalid()) {
+      inputs.emplace(name, Node_pin(original, pins[boundaries->get_id(name)]));
+    } else if (original->has_graph_input(name)) {
+      inputs.emplace(name, original->get_graph_input(name));
+    } else {
+      Pass::error("live.merge_changes: delta input {} not found in the original synthesized netlist {}", name, original->get_name());
+    }
+  });
+  nsynth->each_graph_output([this, &pins](Node_pin &dpin) {
+    auto name = dpin.get_name();
+    if (!boundaries->is_invariant_boundary(name) || pins[boundaries->get_id(name)].is_invalid()) {
+      Pass::error("live.merge_changes: delta output {} is not a boundary in {}", name, original->get_name());
+    }
+  });
+
+  // Cells only used by the changed cones go away
+  std::vector<Node::Compact_class> dead;
+  for (auto id : diffs) {
+    for (const auto &cell : boundaries->cone_cells[id]) {
+      auto it = boundaries->gate_appearances.find(cell);
+      if (it != boundaries->gate_appearances.end() && --it->second == 0) {
+        dead.emplace_back(cell);
+      }
+    }
   }
 
-  boundaries = Invariant_boundaries::deserialize(invariant_file);
-  invariant_file.close();
-
-  original = Lgraph_open(pack.osynth_lgdb, boundaries->top);
-
-  if (!original) {
-    Pass::error(std::format("Live_stitcher: I was not able to open original synthesized netlist {} in {}",
-                            boundaries->top,
-                            pack.osynth_lgdb));
+  absl::flat_hash_map<Node::Compact_class, Node> copied;  // nsynth -> original
+  for (auto node : nsynth->fast()) {
+    copied.emplace(node.get_compact_class(), Live::copy_node(original, node));
   }
-}
-
-void Live_stitcher::stitch(Lgraph *nsynth, const std::set<Net_ID> &diffs) {
-  std::map<Index_id, Index_id> nsynth2originalid;
-  std::map<Index_id, Index_id> inp2originalid;
-  std::map<Index_id, Index_id> out2originalid;
-
-  // add new cells
-  for (auto &idx : nsynth->fast()) {
-    if (nsynth->node_type_get(idx).op == GraphIO_Op) {
-      // FIXME: how to check if there are new global IOs?
-      // FIXME: how to check if I need to delete global IOs?
-
-      auto name = nsynth->get_node_wirename(idx);
 
-      if (original->has_graph_input(name)) {
-        inp2originalid[idx] = original->get_graph_input(name).get_idx();
-      } else if (original->has_graph_output(name)) {
-        out2originalid[idx] = original->get_graph_output(name).get_idx();
-      } else {
-        if (original->has_wirename(name)) {
-          inp2originalid[idx] = original->get_node_id(name);
-        } else {
-          // Pass::>error("Wire {} not found in original synthesized graph\n",name);
-        }
-      }
-      else {
-        Index_id nidx          = original->create_node().get_nid();
-        nsynth2originalid[idx] = nidx;
-
-        switch (nsynth->node_type_get(idx).op) {
-          case TechMap_Op: original->node_tmap_set(nidx, nsynth->tmap_id_get(idx)); break;
-          case Join_Op:
-          case Pick_Op: original->node_type_set(nidx, nsynth->node_type_get(idx).op); break;
-          case U32Const_Op: original->node_u32type_set(nidx, nsynth->node_value_get(idx)); break;
-          case StrConst_Op: original->node_const_type_set(nidx, nsynth->node_const_value_get(idx)); break;
-
-          default: Pass::error("live.stitcher: unsupported synthesized type");
-        }
-      }
+  auto get_driver = [&copied, &inputs](const Node_pin &ndriver) -> Node_pin {
+    if (ndriver.is_graph_input()) {
+      return inputs[ndriver.get_name()];
     }
+    const auto it = copied.find(ndriver.get_node().get_compact_class());
+    I(it != copied.end());
+    return it->second.setup_driver_pin_raw(ndriver.get_pid());
+  };
+
+  for (auto [ncell, onode] : copied) {
+    Node nnode(nsynth, ncell);
+    for (const auto &e : nnode.inp_edges()) {
+      get_driver(e.driver).connect_sink(onode.setup_sink_pin_raw(e.sink.get_pid()));
+    }
+  }
 
-    // connect new cells
-    for (auto &idx : nsynth->fast()) {
-      if (!nsynth->has_graph_output(idx)) {
-        for (auto &c : nsynth->inp_edges(idx)) {
-          // if driver is in the delta region
-          if (nsynth2originalid.find(nsynth->get_node(c.get_out_pin()).get_nid()) != nsynth2originalid.end()) {
-            auto dnode = original->get_node(nsynth2originalid[nsynth->get_node(c.get_out_pin()).get_nid()]);
-            auto snode = original->get_node(nsynth2originalid[nsynth->get_node(c.get_inp_pin()).get_nid()]);
-            auto dpin  = dnode.setup_driver_pin(c.get_out_pin().get_pid());
-            auto spin  = snode.setup_sink_pin(c.get_inp_pin().get_pid());
-
-            original->add_edge(dpin, spin);
-          } else {
-            if (inp2originalid.find(idx) != inp2originalid.end()) {
-              auto dnode = original->get_node(inp2originalid[idx]);
-              auto snode = original->get_node(nsynth2originalid[nsynth->get_node(c.get_inp_pin()).get_nid()]);
-              auto spin  = snode.setup_sink_pin(c.get_inp_pin().get_pid());
-              auto dpin  = dnode.setup_driver_pin();  // FIXME: is there a case where I need to consider the out pid?
-              original->add_edge(dpin, spin);
-            }
-          }
-        }
-      } else {
-        if (out2originalid.find(idx) != out2originalid.end()) {
-          // global output
-          // FIXME: I need to consider the inp PID
-          for (auto &c : nsynth->inp_edges(idx)) {
-            Node_pin dpin = original->get_node(nsynth2originalid[nsynth->get_node(c.get_out_pin()).get_nid()])
-                                .setup_driver_pin(c.get_out_pin().get_pid());
-            Node_pin spin = original->get_node(out2originalid[idx]).setup_sink_pin(out2originalid[idx]);
-            original->add_edge(dpin, spin);
-          }
-        } else {
-          // invariant boundary
-          auto name = nsynth->get_node_wirename(idx);
-          if (!original->has_wirename(name)) {
-            continue;
-          }
-          Index_id oidx = original->get_node_id(name);
-          for (auto &edge : original->out_edges(oidx)) {
-            Node_pin dpin = original->get_node(nsynth2originalid[idx]).setup_driver_pin(edge.get_out_pin().get_pid());
+  // Move the sinks (and the name) of each changed boundary to the new driver
+  nsynth->each_graph_output([&](Node_pin &dpin) {
+    auto name = dpin.get_name();
+    auto ndrv = dpin.change_to_sink_from_graph_out_driver().get_driver_pin();
+    if (ndrv.is_invalid()) {
+      return;
+    }
+    auto new_driver = get_driver(ndrv);
 
-            original->add_edge(dpin, edge.get_inp_pin());
-            original->del_edge(edge);
-          }
-        }
+    Node_pin old_driver(original, pins[boundaries->get_id(name)]);
+    if (old_driver.is_graph_output()) {
+      auto spin = old_driver.change_to_sink_from_graph_out_driver();
+      for (auto &e : spin.inp_edges()) {
+        e.del_edge();
       }
+      new_driver.connect_sink(spin);
+      return;
     }
 
-    // removed original graph
-    for (auto &diff : diffs) {
-      I(boundaries->invariant_cone_cells.find(diff) != boundaries->invariant_cone_cells.end());
-      for (auto &gate : boundaries->invariant_cone_cells[diff]) {
-        I(boundaries->gate_appearances.find(gate) != boundaries->gate_appearances.end());
-        boundaries->gate_appearances[gate]--;
-        if (boundaries->gate_appearances[gate] <= 0) {
-          // original->del_node(gate);
-        }
-      }
+    for (auto &e : old_driver.out_edges()) {
+      new_driver.connect_sink(e.sink);
+      e.del_edge();
+    }
+    old_driver.del_name();
+    if (!new_driver.has_name()) {  // not just a pass through of another net
+      new_driver.set_name(name);
     }
+  });
 
-    original->sync();
+  for (const auto &cell : dead) {
+    Node node(original, cell);
+    if (!node.is_graph_io()) {
+      node.del_node();
+    }
   }
+
+  Invariant_finder::find_cones(original, *boundaries, diffs);
+}
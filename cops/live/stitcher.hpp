@@ -1,10 +1,13 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
-#ifndef LIVE_STITCHER_H_
-#define LIVE_STITCHER_H_
+#pragma once
+
+#include <vector>
 
 #include "invariant.hpp"
-#include "stitch_options.hpp"
+#include "lgraph.hpp"
 
+// Replaces the changed invariant cones of the original synthesized netlist
+// with the synthesized delta (live.diff_finder output after synthesis).
 class Live_stitcher {
 private:
   Lgraph *original;
@@ -12,16 +15,9 @@ private:
   Invariant_boundaries *boundaries;
 
 public:
-  Live_stitcher(Lgraph *original, Invariant_boundaries *boundaries) : original(original), boundaries(boundaries) {}
-
-  Live_stitcher(Stitch_pass_options &pack);
+  Live_stitcher(Lgraph *_original, Invariant_boundaries *_boundaries) : original(_original), boundaries(_boundaries) {}
 
-  void stitch(const std::string &nsynth, const std::set<Net_ID> &diffs) {
-    Lgraph *synth = Lgraph_open(nsynth, boundaries->top);
-    stitch(synth, diffs);
-  }
-
-  void stitch(Lgraph *nsynth, const std::set<Net_ID> &diffs);
+  // nsynth inputs/outputs are named after the nets in boundaries. The cones
+  // of diffs are recomputed, so boundaries stays valid for the next change.
+  void stitch(Lgraph *nsynth, const std::vector<Invariant_boundaries::Net_id> &diffs);
 };
-
-#endif
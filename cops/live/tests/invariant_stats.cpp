@@ -19,14 +19,21 @@ int main(int argc, char** argv) {
     exit(2);
   }
 
-  Invariant_boundaries* bound = Invariant_boundaries::deserialize(ifs);
+  auto bound = Invariant_boundaries::deserialize(ifs);
+  if (!bound) {
+    Pass::error(std::format("invalid invariant file {}", bounds_name));
+    exit(3);
+  }
 
   std::cout << "\n\n#########################################################\n";
   std::print("stats on bounds: top {}, hier_sep {}\n\n", bound->top, bound->hierarchical_separator);
   std::cout << "invar_cones\n";
-  for (auto& cones : bound->invariant_cones) {
-    std::print("id: {} count: {}\n", cones.first.first, cones.second.size());
+  for (size_t id = 0; id < bound->size(); ++id) {
+    if (bound->is_invariant_boundary(id)) {
+      std::print("net: {} endpoints: {} cells: {}\n", bound->nets[id], bound->endpoints[id].size(), bound->cone_cells[id].size());
+    }
   }
+  std::print("cells in cones: {}\n", bound->gate_appearances.size());
 
   ifs.close();
 
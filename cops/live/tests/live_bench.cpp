@@ -0,0 +1,144 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <string_view>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "diff_finder.hpp"
+#include "graph_library.hpp"
+#include "invariant_finder.hpp"
+#include "lgraph.hpp"
+
+// n_chains chains of chain_len xor cells (every 4th net named). changed_chain
+// has one cell replaced (the one line change), -1 for none.
+static constexpr int chain_len = 32;
+
+// With hier_names the nets are named as in build_hier_design flattened
+static Lgraph *build_design(std::string_view lgdb, int n_chains, int changed_chain, bool hier_names = false) {
+  auto *lg = Graph_library::instance(lgdb)->create_lgraph("live_bench", "-");
+
+  Port_ID pos = 1;
+  auto    k   = lg->add_graph_input("k", pos++, 16);
+  for (int i = 0; i < n_chains; ++i) {
+    auto dpin = lg->add_graph_input(absl::StrCat("i", i), pos++, 16);
+    for (int j = 0; j < chain_len; ++j) {
+      auto op   = (i == changed_chain && j == chain_len / 2) ? Ntype_op::Or : Ntype_op::Xor;
+      auto node = lg->create_node(op, 16);
+      node.setup_sink_pin().connect_driver(dpin);
+      node.setup_sink_pin().connect_driver(k);
+      dpin = node.setup_driver_pin();
+      if (j % 4 == 3) {
+        dpin.set_name(hier_names ? absl::StrCat("u", i, ".c", j) : absl::StrCat("c", i, "_", j));
+      }
+    }
+    lg->add_graph_output(absl::StrCat("o", i), pos++, 16).connect_driver(dpin);
+  }
+
+  return lg;
+}
+
+// Same design with each chain in an instance (u<i>) of a chain module, the
+// changed chain instantiates its own module
+static Lgraph *build_hier_design(std::string_view lgdb, int n_chains, int changed_chain) {
+  auto *lib = Graph_library::instance(lgdb);
+
+  auto build_chain = [lib](std::string_view name, bool changed) {
+    auto *lg   = lib->create_lgraph(name, "-");
+    auto  k    = lg->add_graph_input("k", 1, 16);
+    auto  dpin = lg->add_graph_input("i", 2, 16);
+    for (int j = 0; j < chain_len; ++j) {
+      auto op   = (changed && j == chain_len / 2) ? Ntype_op::Or : Ntype_op::Xor;
+      auto node = lg->create_node(op, 16);
+      node.setup_sink_pin().connect_driver(dpin);
+      node.setup_sink_pin().connect_driver(k);
+      dpin = node.setup_driver_pin();
+      if (j % 4 == 3) {
+        dpin.set_name(absl::StrCat("c", j));
+      }
+    }
+    lg->add_graph_output("o", 3, 16).connect_driver(dpin);
+  };
+  build_chain("live_bench_chain", false);
+  if (changed_chain >= 0) {
+    build_chain("live_bench_chain_mod", true);
+  }
+
+  auto *lg = lib->create_lgraph("live_bench", "-");
+
+  Port_ID pos = 1;
+  auto    k   = lg->add_graph_input("k", pos++, 16);
+  for (int i = 0; i < n_chains; ++i) {
+    auto inst = lg->create_node_sub(i == changed_chain ? "live_bench_chain_mod" : "live_bench_chain");
+    inst.set_name(absl::StrCat("u", i));
+    inst.setup_sink_pin("k").connect_driver(k);
+    inst.setup_sink_pin("i").connect_driver(lg->add_graph_input(absl::StrCat("i", i), pos++, 16));
+    lg->add_graph_output(absl::StrCat("o", i), pos++, 16).connect_driver(inst.setup_driver_pin("o"));
+  }
+
+  return lg;
+}
+
+static Lgraph *build_elab(std::string_view lgdb, int n_chains, int changed_chain, bool hier) {
+  return hier ? build_hier_design(lgdb, n_chains, changed_chain) : build_design(lgdb, n_chains, changed_chain);
+}
+
+template <bool hier>
+static void BM_invariant_find(benchmark::State &state) {
+  auto  n     = static_cast<int>(state.range(0));
+  auto *elab  = build_elab("lgdb_live_bench_orig", n, -1, hier);
+  auto *synth = build_design("lgdb_live_bench_synth", n, -1, hier);
+
+  size_t n_bounds = 0;
+  for (auto _ : state) {
+    Invariant_finder finder(elab, synth, ".");
+    n_bounds = finder.get_boundaries().size();
+  }
+
+  state.counters["nets"]  = n_bounds;
+  state.counters["speed"] = benchmark::Counter(state.iterations() * n * chain_len, benchmark::Counter::kIsRate);
+}
+
+// Only the changed invariant cone goes to the delta (to re-synthesize)
+template <bool hier>
+static void BM_diff_delta(benchmark::State &state) {
+  auto  n     = static_cast<int>(state.range(0));
+  auto *orig  = build_elab("lgdb_live_bench_orig", n, -1, hier);
+  auto *synth = build_design("lgdb_live_bench_synth", n, -1, hier);
+  auto *mod   = build_elab("lgdb_live_bench_mod", n, n / 2, hier);
+
+  Invariant_finder finder(orig, synth, ".");
+  const auto      &ib = finder.get_boundaries();
+
+  size_t n_diffs     = 0;
+  size_t delta_cells = 0;
+  for (auto _ : state) {
+    Diff_finder diff(orig, mod, ib);
+    n_diffs = diff.find_diffs().size();
+
+    auto *delta = Graph_library::instance("lgdb_live_bench_delta")->create_lgraph("live_bench", "-");
+    diff.generate_delta(delta);
+    delta_cells = diff.get_delta_cells();
+  }
+
+  state.counters["total_cells"]   = n * chain_len;
+  state.counters["delta_cells"]   = delta_cells;
+  state.counters["changed_cones"] = n_diffs;
+  state.counters["speed"]         = benchmark::Counter(state.iterations() * n * chain_len, benchmark::Counter::kIsRate);
+}
+
+#ifndef NDEBUG
+BENCHMARK_TEMPLATE(BM_invariant_find, false)->Arg(1 << 6);
+BENCHMARK_TEMPLATE(BM_invariant_find, true)->Arg(1 << 6);
+BENCHMARK_TEMPLATE(BM_diff_delta, false)->Arg(1 << 6);
+BENCHMARK_TEMPLATE(BM_diff_delta, true)->Arg(1 << 6);
+#else
+BENCHMARK_TEMPLATE(BM_invariant_find, false)->Range(1 << 6, 1 << 12);
+BENCHMARK_TEMPLATE(BM_invariant_find, true)->Range(1 << 6, 1 << 12);
+BENCHMARK_TEMPLATE(BM_diff_delta, false)->Range(1 << 6, 1 << 12);
+BENCHMARK_TEMPLATE(BM_diff_delta, true)->Range(1 << 6, 1 << 12);
+#endif
+
+int main(int argc, char *argv[]) {
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+}
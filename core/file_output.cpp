@@ -4,9 +4,9 @@
 
 #include <fcntl.h>
 #include <string.h>
-#include <sys/mman.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <format>
 #include <iostream>
@@ -14,7 +14,9 @@
 
 #include "iassert.hpp"
 
-File_output::File_output(std::string_view fname) : filename(fname), sz(0), aborted(false) {}
+File_output::File_output(std::string_view fname) : filename(fname), sz(0), aborted(false), fd(-1), head_size(0) {}
+
+File_output::File_output() : sz(0), aborted(false), fd(-1), head_size(0) {}
 
 // Portable, thread-safe error string helper for GNU & POSIX strerror_r.
 #include <cerrno>
@@ -42,43 +44,96 @@ static std::string strerror_threadsafe(int err) {
 #endif
 }
 
-File_output::~File_output() {
-  if (aborted) {
-    return;
+static void write_all(int fd, const char *data, size_t len, const std::string &filename) {
+  while (len) {
+    auto n = ::write(fd, data, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      std::println("write errno:{} for filename {}\n", strerror_threadsafe(errno), filename);
+      I(false);
+      return;
+    }
+    data += n;
+    len -= n;
+  }
+}
+
+void File_output::add(std::string_view s1) {
+  sz += s1.size();
+  if (chunks.empty() || chunks.back().size() + s1.size() > chunk_size) {
+    if (chunks.size() >= max_buffered && !filename.empty()) {
+      stream_chunks();
+    }
+    chunks.emplace_back();
+    chunks.back().reserve(std::max(chunk_size, s1.size()));
+  }
+  chunks.back().append(s1);
+}
+
+void File_output::reserve_head(size_t n) {
+  I(sz == 0 && head_size == 0);  // before any append
+  head_size = n;
+  add(std::string(n, ' '));
+}
+
+void File_output::fill_head(std::string_view s1) {
+  I(s1.size() <= head_size);
+  head = s1;
+}
+
+void File_output::append(File_output &&block) {
+  I(block.filename.empty() && block.head_size == 0);  // only in-memory blocks can be spliced
+
+  sz += block.sz;
+  for (auto &c : block.chunks) {
+    chunks.emplace_back(std::move(c));
   }
+  block.chunks.clear();
+  block.sz = 0;
 
-  //---------------------------------- OPEN
+  if (chunks.size() > max_buffered && !filename.empty()) {
+    stream_chunks();
+  }
+}
 
-  int fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0644);
-  I(fd >= 0);  // throw std::runtime_error(std::format("could not create destination {} file (permissions?)", filename));
+void File_output::stream_chunks() {
+  if (fd < 0) {
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    I(fd >= 0);  // throw std::runtime_error(std::format("could not create destination {} file (permissions?)", filename));
+  }
 
-  size_t map_size = sz;
-  map_size >>= 12;
-  ++map_size;
-  map_size <<= 12;
-  auto ok = ftruncate(fd, map_size);
-  I(ok == 0);
+  for (const auto &c : chunks) {
+    write_all(fd, c.data(), c.size(), filename);
+  }
+  chunks.clear();
+}
 
-  void *base = ::mmap(0, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);  // no superpages
-  if (base == MAP_FAILED) {
-    std::println("mmap errno:{} for filename{}\n", strerror_threadsafe(errno), filename);
-    I(false);
+File_output::~File_output() {
+  if (filename.empty()) {
+    return;  // in-memory block
   }
 
-  //---------------------------------- SAVE
+  if (aborted) {
+    if (fd >= 0) {
+      ::close(fd);
+      ::unlink(filename.c_str());
+    }
+    return;
+  }
 
-  char *ptr = static_cast<char *>(base);
-  for (const auto &e : sequence) {
-    memcpy(ptr, e.data(), e.size());
-    ptr += e.size();
-    I(static_cast<size_t>(ptr - static_cast<char *>(base)) <= sz);
+  if (fd < 0) {
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    I(fd >= 0);  // throw std::runtime_error(std::format("could not create destination {} file (permissions?)", filename));
   }
 
-  //---------------------------------- CLOSE
-  ::munmap(base, map_size);
-  if (map_size != sz) {
-    auto ok2 = ftruncate(fd, sz);
-    (void)ok2;
+  stream_chunks();
+
+  if (!head.empty()) {
+    auto w = ::pwrite(fd, head.data(), head.size(), 0);  // over the reserve_head() blanks
+    I(w == static_cast<ssize_t>(head.size()));
   }
+
   ::close(fd);
 }
@@ -5,62 +5,79 @@
 #include <string_view>
 #include <vector>
 
+// Chunked arena writer. Fragments are copied into large chunks (no heap string
+// per fragment). A file backed File_output streams full chunks to disk once a
+// few are buffered; an in-memory one (no filename) is a block buffer that can
+// be filled in parallel and later spliced into a file backed one with append().
 class File_output {
   std::string filename;
 
   size_t sz;
   bool   aborted;
+  int    fd;  // -1 until the first chunk is streamed
 
-  std::vector<std::string> sequence;
+  static constexpr size_t chunk_size   = 1 << 20;
+  static constexpr size_t max_buffered = 4;  // chunks kept before streaming to disk
+
+  std::vector<std::string> chunks;
+  size_t                   head_size;  // reserve_head() bytes at the start of the file
+  std::string              head;       // fill_head() text, written over them at close
+
+  void add(std::string_view s1);
+  void stream_chunks();
 
 public:
   File_output(std::string_view fname);
+  File_output();
   ~File_output();
 
-  void prepend(std::string s1) {
-    sequence.insert(sequence.begin(), s1);
-    sz += s1.size();
-  }
-  void append(std::string_view s1) {
-    sequence.emplace_back(s1);
-    sz += s1.size();
-  }
+  File_output(const File_output &)            = delete;
+  File_output &operator=(const File_output &) = delete;
+
+  // Fixed size head (e.g. a hash that marks a complete file). reserve_head()
+  // before the first append writes blanks; fill_head() text (up to that size)
+  // is written over them when the file is closed, after all the body, so the
+  // body never shifts and an interrupted write never carries the head.
+  void reserve_head(size_t n);
+  void fill_head(std::string_view s1);
+
+  void append(std::string_view s1) { add(s1); }
   void append(std::string_view s1, std::string_view s2) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sz += s1.size() + s2.size();
+    add(s1);
+    add(s2);
   }
   void append(std::string_view s1, std::string_view s2, std::string_view s3) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sz += s1.size() + s2.size() + s3.size();
+    add(s1);
+    add(s2);
+    add(s3);
   }
   void append(std::string_view s1, std::string_view s2, std::string_view s3, std::string_view s4) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sequence.emplace_back(s4);
-    sz += s1.size() + s2.size() + s3.size() + s4.size();
+    add(s1);
+    add(s2);
+    add(s3);
+    add(s4);
   }
   void append(std::string_view s1, std::string_view s2, std::string_view s3, std::string_view s4, std::string_view s5) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sequence.emplace_back(s4);
-    sequence.emplace_back(s5);
-    sz += s1.size() + s2.size() + s3.size() + s4.size() + s5.size();
+    add(s1);
+    add(s2);
+    add(s3);
+    add(s4);
+    add(s5);
   }
   void append(std::string_view s1, std::string_view s2, std::string_view s3, std::string_view s4, std::string_view s5,
               std::string_view s6) {
-    sequence.emplace_back(s1);
-    sequence.emplace_back(s2);
-    sequence.emplace_back(s3);
-    sequence.emplace_back(s4);
-    sequence.emplace_back(s5);
-    sequence.emplace_back(s6);
-    sz += s1.size() + s2.size() + s3.size() + s4.size() + s5.size() + s6.size();
+    add(s1);
+    add(s2);
+    add(s3);
+    add(s4);
+    add(s5);
+    add(s6);
   }
 
-  void abort() { aborted = true; }  // abort/cancel (the destructor will do nothing)
+  // Splice an in-memory block (moves the chunks, no copy)
+  void append(File_output &&block);
+
+  size_t size() const { return sz; }
+
+  void abort() { aborted = true; }  // abort/cancel (the destructor discards any output)
 };
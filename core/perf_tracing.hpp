@@ -6,10 +6,12 @@
 
 PERFETTO_DEFINE_CATEGORIES(perfetto::Category("core").SetDescription("Core functions"),
                            perfetto::Category("inou").SetDescription("In and out"),
+                           perfetto::Category("lgraph").SetDescription("Lgraph library load/save"),
                            perfetto::Category("liveparse").SetDescription("liveparse parsing"),
                            perfetto::Category("verilog").SetDescription("verilog parsing"),
                            perfetto::Category("pyrope").SetDescription("pyrope parsing"),
                            perfetto::Category("cgen").SetDescription("verilog code generation"),
+                           perfetto::Category("live").SetDescription("live incremental synthesis"),
                            perfetto::Category("pass").SetDescription("Passes"));
 
 void start_tracing();
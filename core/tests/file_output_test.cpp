@@ -0,0 +1,83 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "file_output.hpp"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string read_file(const std::string &name) {
+  std::ifstream     f(name);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+TEST(File_output, small) {
+  {
+    File_output fout("file_output_small.txt");
+    fout.reserve_head(17);
+    fout.append("module ", "foo", "(\n");
+    fout.append(");\n");
+    fout.fill_head("`include \"bar.v\"\n");
+    EXPECT_EQ(fout.size(), 32);
+  }
+  EXPECT_EQ(read_file("file_output_small.txt"), "`include \"bar.v\"\nmodule foo(\n);\n");
+
+  {
+    File_output fout("file_output_small.txt");
+    fout.reserve_head(8);
+    fout.append("body\n");
+    fout.fill_head("// h\n");  // shorter than reserved, the rest stays blank
+  }
+  EXPECT_EQ(read_file("file_output_small.txt"), "// h\n   body\n");
+}
+
+TEST(File_output, streamed_with_blocks) {
+  std::string expected;
+  {
+    File_output fout("file_output_big.txt");
+    fout.reserve_head(10);
+
+    File_output block1;
+    File_output block2;
+    for (int i = 0; i < 200000; ++i) {
+      auto n = std::to_string(i);
+      fout.append("  assign w", n, " = a", n, ";\n");
+      block1.append("b1 ", n, "\n");
+      block2.append("b2 ", n, "\n");
+      expected += "  assign w" + n + " = a" + n + ";\n";
+    }
+    for (int i = 0; i < 200000; ++i) {
+      expected += "b1 " + std::to_string(i) + "\n";
+    }
+    for (int i = 0; i < 200000; ++i) {
+      expected += "b2 " + std::to_string(i) + "\n";
+    }
+    fout.append(std::move(block1));
+    fout.append(std::move(block2));
+
+    fout.fill_head("// header\n");  // after the start was already streamed
+    expected = "// header\n" + expected;
+  }
+  EXPECT_TRUE(read_file("file_output_big.txt") == expected);
+}
+
+TEST(File_output, abort) {
+  {
+    File_output fout("file_output_abort.txt");
+    for (int i = 0; i < 1000000; ++i) {
+      fout.append("0123456789");
+    }
+    fout.abort();
+  }
+  EXPECT_NE(access("file_output_abort.txt", F_OK), 0);
+}
+
+}  // namespace
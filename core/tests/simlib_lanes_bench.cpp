@@ -0,0 +1,119 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Stimulus throughput of a stage evaluated once per stimulus with UInt
+// against a single Simlib_lanes evaluation that advances 64 stimuli. The
+// stage is written by hand for lanes mode (mux/mem_read/mem_write, no branch
+// on a signal), so the same code compiles for both value types.
+
+#include <array>
+
+#include "benchmark/benchmark.h"
+#include "simlib_lanes.hpp"
+#include "uint.hpp"
+
+// Scalar counterparts of the lanes mux/mem helpers
+template <int w>
+UInt<w> mux(const UInt<1> &sel, const UInt<w> &t, const UInt<w> &f) {
+  return sel ? t : f;
+}
+
+template <int w, int aw, size_t N>
+UInt<w> mem_read(const std::array<UInt<w>, N> &mem, const UInt<aw> &addr) {
+  return mem[addr.as_single_word() % N];
+}
+
+template <int w, int aw, size_t N>
+void mem_write(std::array<UInt<w>, N> &mem, const UInt<aw> &addr, const UInt<w> &data, const UInt<1> &enable) {
+  if (enable) {
+    mem[addr.as_single_word() % N] = data;
+  }
+}
+
+template <int w>
+using Scalar = UInt<w>;
+
+// LFSR driven accumulator, optionally with a small register file (the lanes
+// memories gather/scatter lane by lane, so they dominate when present)
+template <template <int> class V, bool with_mem>
+struct Bench_stage {
+  V<16>                 lfsr;
+  V<16>                 acc;
+  V<8>                  cnt;
+  std::array<V<16>, 16> mem;
+
+  void cycle() {
+    const V<1> fb = lfsr.template bit<0>() ^ lfsr.template bit<2>() ^ lfsr.template bit<3>() ^ lfsr.template bit<5>();
+
+    if constexpr (with_mem) {
+      const V<16> sum = acc.addw(mem_read(mem, lfsr.template bits<3, 0>()));
+      acc             = mux(cnt.template bit<0>(), sum, acc ^ lfsr);
+      mem_write(mem, cnt.template bits<3, 0>(), acc, lfsr.template bit<7>());
+    } else {
+      const V<16> sum = acc.addw(lfsr);
+      acc             = mux(cnt.template bit<0>(), sum, acc ^ cnt.template pad<16>());
+    }
+
+    cnt  = cnt.addw(V<8>(1));
+    lfsr = fb.cat(lfsr.template bits<15, 1>());
+  }
+};
+
+static constexpr int nlanes = Simlib_lanes<1>::nlanes;
+
+// Same seeds for both modes: scalar stimulus l starts from lane l
+template <typename Lanes_stage, typename Scalar_stage>
+static void seed(Lanes_stage &lanes, std::array<Scalar_stage, nlanes> &scalar) {
+  lanes.lfsr.rand_init();
+  for (int l = 0; l < nlanes; ++l) {
+    scalar[l].lfsr = UInt<16>(lanes.lfsr.lane(l));
+  }
+}
+
+template <typename Lanes_stage, typename Scalar_stage>
+static bool same_state(const Lanes_stage &lanes, const std::array<Scalar_stage, nlanes> &scalar) {
+  for (int l = 0; l < nlanes; ++l) {
+    if (lanes.acc.lane(l) != scalar[l].acc.as_single_word() || lanes.lfsr.lane(l) != scalar[l].lfsr.as_single_word()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <bool use_lanes, bool with_mem>
+static void BM_stage(benchmark::State &state) {
+  Bench_stage<Simlib_lanes, with_mem>                lanes;
+  std::array<Bench_stage<Scalar, with_mem>, nlanes> scalar;
+  seed(lanes, scalar);
+
+  for (int i = 0; i < 100; ++i) {
+    lanes.cycle();
+    for (auto &s : scalar) {
+      s.cycle();
+    }
+  }
+  if (!same_state(lanes, scalar)) {
+    state.SkipWithError("lanes and scalar stages diverged");
+    return;
+  }
+
+  for (auto _ : state) {
+    if constexpr (use_lanes) {
+      lanes.cycle();
+      benchmark::DoNotOptimize(lanes);
+    } else {
+      for (auto &s : scalar) {
+        s.cycle();
+      }
+      benchmark::DoNotOptimize(scalar);
+    }
+  }
+  // items_per_second is stimulus cycles per second in both modes
+  state.SetItemsProcessed(state.iterations() * nlanes);
+}
+
+BENCHMARK_TEMPLATE(BM_stage, false, false);
+BENCHMARK_TEMPLATE(BM_stage, true, false);
+BENCHMARK_TEMPLATE(BM_stage, false, true);
+BENCHMARK_TEMPLATE(BM_stage, true, true);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,132 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "simlib_lanes.hpp"
+
+#include "gtest/gtest.h"
+#include "uint.hpp"
+
+class Simlib_lanes_test : public ::testing::Test {
+protected:
+  Simlib_lanes<13> a;
+  Simlib_lanes<13> b;
+  Simlib_lanes<1>  sel;
+
+  void SetUp() override {
+    a.rand_init();
+    b.rand_init();
+    sel.rand_init();
+    b.set_lane(3, a.lane(3));  // at least one lane with a == b
+  }
+};
+
+TEST_F(Simlib_lanes_test, broadcast_and_lane_access) {
+  Simlib_lanes<8> c(0xA5);
+  for (int l = 0; l < Simlib_lanes<8>::nlanes; ++l) {
+    EXPECT_EQ(c.lane(l), 0xA5);
+  }
+  c.set_lane(7, 0x3C);
+  EXPECT_EQ(c.lane(7), 0x3C);
+  EXPECT_EQ(c.lane(6), 0xA5);
+}
+
+TEST_F(Simlib_lanes_test, matches_scalar_uint) {
+  auto sum  = a + b;
+  auto sumw = a.addw(b);
+  auto subw = a.subw(b);
+  auto x    = a ^ b;
+  auto m    = mux(sel, a, b);
+  auto lt   = a < b;
+  auto eq   = a == b;
+  auto ge   = a >= b;
+  auto hi   = a.bits<12, 4>();
+  auto cat  = a.cat(sel);
+
+  for (int l = 0; l < Simlib_lanes<13>::nlanes; ++l) {
+    UInt<13> ua(a.lane(l));
+    UInt<13> ub(b.lane(l));
+
+    EXPECT_EQ(sum.lane(l), (ua + ub).as_single_word());
+    EXPECT_EQ(sumw.lane(l), ua.addw(ub).as_single_word());
+    EXPECT_EQ(subw.lane(l), (a.lane(l) - b.lane(l)) & 0x1FFF);
+    EXPECT_EQ(x.lane(l), (ua ^ ub).as_single_word());
+    EXPECT_EQ(m.lane(l), sel.lane(l) ? a.lane(l) : b.lane(l));
+    EXPECT_EQ(lt.lane(l), static_cast<uint64_t>(static_cast<bool>(ua < ub)));
+    EXPECT_EQ(eq.lane(l), static_cast<uint64_t>(static_cast<bool>(ua == ub)));
+    EXPECT_EQ(ge.lane(l), static_cast<uint64_t>(static_cast<bool>(ua >= ub)));
+    EXPECT_EQ(hi.lane(l), (ua.template bits<12, 4>().as_single_word()));
+    EXPECT_EQ(cat.lane(l), (a.lane(l) << 1) | sel.lane(l));
+  }
+  EXPECT_TRUE(eq.any());
+}
+
+TEST_F(Simlib_lanes_test, assertion_demux) {
+  auto ok = a == a;
+  EXPECT_EQ(simlib_lanes_failed(ok), 0);
+
+  auto c = a;
+  c.set_lane(5, a.lane(5) ^ 1);
+  EXPECT_EQ(simlib_lanes_failed(a == c), uint64_t(1) << 5);
+
+  simlib_trace_lane = 5;
+  EXPECT_EQ(c.to_string_binary(), c.to_string_binary(5));
+  simlib_trace_lane = 0;
+}
+
+TEST_F(Simlib_lanes_test, memory_per_lane) {
+  std::array<Simlib_lanes<13>, 16> mem;
+  Simlib_lanes<4>                  addr;
+  addr.rand_init();
+
+  mem_write(mem, addr, a, Simlib_lanes<1>(1));
+  auto rd = mem_read(mem, addr);
+  for (int l = 0; l < Simlib_lanes<13>::nlanes; ++l) {
+    EXPECT_EQ(rd.lane(l), a.lane(l));
+  }
+
+  mem_write(mem, addr, b, sel);
+  rd = mem_read(mem, addr);
+  for (int l = 0; l < Simlib_lanes<13>::nlanes; ++l) {
+    EXPECT_EQ(rd.lane(l), sel.lane(l) ? b.lane(l) : a.lane(l));
+  }
+}
+
+TEST_F(Simlib_lanes_test, memory_uniform_and_aliased_addresses) {
+  // 12 entries and 4 address bits: addresses 12..15 wrap around
+  std::array<Simlib_lanes<13>, 12> mem;
+  std::array<uint64_t, 12 * 64>    ref{};  // [entry * 64 + lane]
+
+  Simlib_lanes<4> uniform(7);
+  mem_write(mem, uniform, a, sel);
+  for (int l = 0; l < Simlib_lanes<13>::nlanes; ++l) {
+    if (sel.lane(l)) {
+      ref[7 * 64 + l] = a.lane(l);
+    }
+  }
+
+  Simlib_lanes<4> addr;
+  addr.rand_init();
+  addr.set_lane(0, 15);
+  addr.set_lane(1, 3);  // same entry as lane 0
+  mem_write(mem, addr, b, Simlib_lanes<1>(1));
+  for (int l = 0; l < Simlib_lanes<13>::nlanes; ++l) {
+    ref[(addr.lane(l) % 12) * 64 + l] = b.lane(l);
+  }
+
+  for (const auto &rd_addr : {uniform, addr}) {
+    auto rd = mem_read(mem, rd_addr);
+    for (int l = 0; l < Simlib_lanes<13>::nlanes; ++l) {
+      EXPECT_EQ(rd.lane(l), ref[(rd_addr.lane(l) % 12) * 64 + l]);
+    }
+  }
+}
+
+TEST_F(Simlib_lanes_test, zero_shift) {
+  auto s = a.shl<0>();
+  auto w = a.shlw<0>();
+  auto r = a.shr<0>();
+  for (int l = 0; l < Simlib_lanes<13>::nlanes; ++l) {
+    EXPECT_EQ(s.lane(l), a.lane(l));
+    EXPECT_EQ(w.lane(l), a.lane(l));
+    EXPECT_EQ(r.lane(l), a.lane(l));
+  }
+}
@@ -0,0 +1,172 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Checks the simlib_kernel dispatch (AVX2/AVX-512 when the build enables them,
+// scalar with SIMLIB_NO_SIMD) and the wide UInt operators against a bit level
+// reference. The same source is built as uint_kernels_test and
+// uint_kernels_nosimd_test.
+
+#include <array>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "uint.hpp"
+
+namespace {
+
+template <int N>
+using Limbs = std::array<uint64_t, N>;
+
+template <int N>
+bool get_bit(const Limbs<N> &a, int i) {
+  return (a[i / 64] >> (i % 64)) & 1;
+}
+
+template <int N>
+void set_bit(Limbs<N> &a, int i, bool v) {
+  if (v) {
+    a[i / 64] |= 1ULL << (i % 64);
+  } else {
+    a[i / 64] &= ~(1ULL << (i % 64));
+  }
+}
+
+// Ripple carry, one bit at a time
+template <int N, bool subtract>
+uint64_t ref_add_sub(Limbs<N> &r, const Limbs<N> &a, const Limbs<N> &b) {
+  bool carry = subtract;
+  for (int i = 0; i < N * 64; ++i) {
+    const bool x = get_bit<N>(a, i);
+    const bool y = get_bit<N>(b, i) ^ subtract;
+    set_bit<N>(r, i, x ^ y ^ carry);
+    carry = (x & y) | (carry & (x ^ y));
+  }
+  return carry;
+}
+
+template <int N>
+int ref_cmp(const Limbs<N> &a, const Limbs<N> &b) {
+  for (int i = N * 64 - 1; i >= 0; --i) {
+    if (get_bit<N>(a, i) != get_bit<N>(b, i)) {
+      return get_bit<N>(a, i) ? 1 : -1;
+    }
+  }
+  return 0;
+}
+
+template <int N>
+Limbs<N> ref_shr(const Limbs<N> &a, uint64_t shamt) {
+  Limbs<N> r{};
+  for (uint64_t i = 0; i + shamt < N * 64; ++i) {
+    set_bit<N>(r, i, get_bit<N>(a, i + shamt));
+  }
+  return r;
+}
+
+template <int N>
+Limbs<N> ref_shl(const Limbs<N> &a, uint64_t shamt) {
+  Limbs<N> r{};
+  for (uint64_t i = shamt; i < N * 64; ++i) {
+    set_bit<N>(r, i, get_bit<N>(a, i - shamt));
+  }
+  return r;
+}
+
+// Random limbs mixed with the values that stress the carry chain
+template <int N>
+std::vector<Limbs<N>> operands() {
+  std::mt19937_64       gen(N);
+  std::vector<Limbs<N>> v;
+  for (int k = 0; k < 24; ++k) {
+    Limbs<N> a;
+    for (auto &l : a) {
+      switch (gen() % 4) {
+        case 0: l = 0; break;
+        case 1: l = ~0ULL; break;
+        default: l = gen();
+      }
+    }
+    v.emplace_back(a);
+  }
+  Limbs<N> ones;
+  ones.fill(~0ULL);
+  v.emplace_back(ones);
+  v.emplace_back(Limbs<N>{});
+  Limbs<N> one{};
+  one[0] = 1;
+  v.emplace_back(one);
+  return v;
+}
+
+template <int N>
+UInt<N * 64> to_uint(const Limbs<N> &a) {
+  std::array<uint64_t, N> rev;
+  for (int i = 0; i < N; ++i) {
+    rev[N - 1 - i] = a[i];
+  }
+  return UInt<N * 64>(rev);
+}
+
+template <int N>
+void check_kernels() {
+  const auto ops = operands<N>();
+  for (const auto &a : ops) {
+    for (const auto &b : ops) {
+      Limbs<N> r;
+      Limbs<N> expected{};
+
+      auto c = simlib_kernel::add_sub<N, false>(r.data(), a.data(), b.data());
+      EXPECT_EQ(c, (ref_add_sub<N, false>(expected, a, b)));
+      EXPECT_EQ(r, expected);
+
+      c = simlib_kernel::add_sub<N, true>(r.data(), a.data(), b.data());
+      EXPECT_EQ(c, (ref_add_sub<N, true>(expected, a, b)));
+      EXPECT_EQ(r, expected);
+
+      const int cmp = simlib_kernel::cmp<N>(a.data(), b.data());
+      EXPECT_EQ((cmp > 0) - (cmp < 0), ref_cmp<N>(a, b));
+      EXPECT_EQ(simlib_kernel::eq<N>(a.data(), b.data()), a == b);
+
+      // UInt operators on the same values
+      const auto ua = to_uint<N>(a);
+      const auto ub = to_uint<N>(b);
+      ref_add_sub<N, false>(expected, a, b);
+      EXPECT_TRUE(ua.addw(ub) == to_uint<N>(expected));
+      EXPECT_EQ(static_cast<bool>(ua < ub), ref_cmp<N>(a, b) < 0);
+      EXPECT_EQ(static_cast<bool>(ua >= ub), ref_cmp<N>(a, b) >= 0);
+      EXPECT_EQ(static_cast<bool>(ua == ub), a == b);
+    }
+
+    for (uint64_t shamt : {0UL, 1UL, 63UL, 64UL, 65UL, 127UL, 200UL, N * 64UL - 1, N * 64UL}) {
+      Limbs<N> r;
+      simlib_kernel::shr<N, N>(r.data(), a.data(), shamt);
+      EXPECT_EQ(r, ref_shr<N>(a, shamt)) << "shr " << shamt;
+      simlib_kernel::shl<N, N>(r.data(), a.data(), shamt);
+      EXPECT_EQ(r, ref_shl<N>(a, shamt)) << "shl " << shamt;
+
+      const auto ua = to_uint<N>(a);
+      const auto us = UInt<16>(shamt);
+      EXPECT_TRUE((ua >> us) == to_uint<N>(ref_shr<N>(a, shamt))) << "UInt >> " << shamt;
+      EXPECT_TRUE(ua.dshlw(us) == to_uint<N>(ref_shl<N>(a, shamt))) << "UInt dshlw " << shamt;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(Uint_kernels, w128) { check_kernels<2>(); }
+TEST(Uint_kernels, w256) { check_kernels<4>(); }
+TEST(Uint_kernels, w512) { check_kernels<8>(); }
+TEST(Uint_kernels, w1024) { check_kernels<16>(); }
+
+// The constexpr path does not use the kernels. An all ones limb plus a carry
+// in must still carry out (and reach bit 128 of the sum).
+TEST(Uint_kernels, constexpr_carry_through_all_ones) {
+  constexpr UInt<128> a(std::array<uint64_t, 2>{~0ULL, ~0ULL});
+  constexpr UInt<128> b(std::array<uint64_t, 2>{~0ULL, 1});
+  constexpr auto      sum = a + b;
+
+  const UInt<129> expected(std::array<uint64_t, 3>{1, ~0ULL, 0});
+  EXPECT_TRUE(sum == expected);
+  EXPECT_TRUE((a.addw(b) == UInt<128>(std::array<uint64_t, 2>{~0ULL, 0})));
+}
@@ -0,0 +1,146 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+// Compare the simlib_kernel SIMD kernels against the scalar path. Build with
+// --config=bench so -march=native enables AVX2/AVX-512 when available.
+
+#include <random>
+
+#include "benchmark/benchmark.h"
+#include "uint.hpp"
+
+template <int N>
+struct Limbs {
+  uint64_t a[N];
+  uint64_t b[N];
+  uint64_t r[N];
+
+  Limbs() {
+    std::mt19937_64 gen(N);
+    for (int i = 0; i < N; ++i) {
+      a[i] = gen();
+      b[i] = gen();
+      r[i] = gen();
+    }
+  }
+};
+
+template <int N, bool simd>
+static void BM_add(benchmark::State& state) {
+  Limbs<N> l;
+  for (auto _ : state) {
+    uint64_t carry;
+    if constexpr (simd) {
+      carry = simlib_kernel::add_sub<N, false>(l.r, l.a, l.r);
+    } else {
+      carry = simlib_kernel::scalar::add_sub<N, false>(l.r, l.a, l.r);
+    }
+    benchmark::DoNotOptimize(carry);
+    benchmark::ClobberMemory();
+  }
+  state.counters["bits"] = N * 64;
+}
+
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+// The AVX2 kernel below its dispatch threshold, to check avx2_add_min_limbs
+template <int N>
+static void BM_add_avx2(benchmark::State& state) {
+  Limbs<N> l;
+  for (auto _ : state) {
+    uint64_t carry = simlib_kernel::avx2::add_sub<N, false>(l.r, l.a, l.r);
+    benchmark::DoNotOptimize(carry);
+    benchmark::ClobberMemory();
+  }
+  state.counters["bits"] = N * 64;
+}
+#endif
+
+template <int N, bool simd>
+static void BM_xor(benchmark::State& state) {
+  Limbs<N> l;
+  for (auto _ : state) {
+    if constexpr (simd) {
+      simlib_kernel::bitop<N, simlib_kernel::Bitop::Xor>(l.r, l.a, l.r);
+    } else {
+      simlib_kernel::scalar::bitop<N, simlib_kernel::Bitop::Xor>(l.r, l.a, l.r);
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+template <int N, bool simd>
+static void BM_cmp(benchmark::State& state) {
+  Limbs<N> l;
+  l.b[N - 1] = l.a[N - 1];  // force the compare to scan past the top limb
+  for (auto _ : state) {
+    int c;
+    if constexpr (simd) {
+      c = simlib_kernel::cmp<N>(l.a, l.b);
+    } else {
+      c = simlib_kernel::scalar::cmp<N>(l.a, l.b);
+    }
+    benchmark::DoNotOptimize(c);
+  }
+}
+
+template <int N, bool simd>
+static void BM_shr(benchmark::State& state) {
+  Limbs<N> l;
+  uint64_t shamt = 67;
+  for (auto _ : state) {
+    if constexpr (simd) {
+      simlib_kernel::shr<N, N>(l.r, l.a, shamt);
+    } else {
+      simlib_kernel::scalar::shr<N, N>(l.r, l.a, shamt);
+    }
+    benchmark::DoNotOptimize(shamt);
+    benchmark::ClobberMemory();
+  }
+}
+
+template <int w, bool use_add>
+static void BM_uint(benchmark::State& state) {
+  UInt<w> a;
+  UInt<w> b;
+  a.rand_init();
+  b.rand_init();
+  for (auto _ : state) {
+    if constexpr (use_add) {
+      a = a.addw(b);
+    } else {
+      a = a ^ b;
+    }
+    benchmark::DoNotOptimize(a);
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_add, 4, false);
+BENCHMARK_TEMPLATE(BM_add, 4, true);
+BENCHMARK_TEMPLATE(BM_add, 8, false);
+BENCHMARK_TEMPLATE(BM_add, 8, true);
+BENCHMARK_TEMPLATE(BM_add, 16, false);  // avx2_add_min_limbs: the AVX2 carry chain starts here
+BENCHMARK_TEMPLATE(BM_add, 16, true);
+BENCHMARK_TEMPLATE(BM_add, 32, false);
+BENCHMARK_TEMPLATE(BM_add, 32, true);
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+BENCHMARK_TEMPLATE(BM_add_avx2, 4);
+BENCHMARK_TEMPLATE(BM_add_avx2, 8);
+BENCHMARK_TEMPLATE(BM_add_avx2, 16);
+BENCHMARK_TEMPLATE(BM_add_avx2, 32);
+#endif
+BENCHMARK_TEMPLATE(BM_xor, 4, false);
+BENCHMARK_TEMPLATE(BM_xor, 4, true);
+BENCHMARK_TEMPLATE(BM_xor, 8, false);
+BENCHMARK_TEMPLATE(BM_xor, 8, true);
+BENCHMARK_TEMPLATE(BM_cmp, 4, false);
+BENCHMARK_TEMPLATE(BM_cmp, 4, true);
+BENCHMARK_TEMPLATE(BM_cmp, 8, false);
+BENCHMARK_TEMPLATE(BM_cmp, 8, true);
+BENCHMARK_TEMPLATE(BM_shr, 4, false);
+BENCHMARK_TEMPLATE(BM_shr, 4, true);
+BENCHMARK_TEMPLATE(BM_shr, 8, false);
+BENCHMARK_TEMPLATE(BM_shr, 8, true);
+BENCHMARK_TEMPLATE(BM_uint, 256, true);
+BENCHMARK_TEMPLATE(BM_uint, 512, true);
+BENCHMARK_TEMPLATE(BM_uint, 512, false);
+
+BENCHMARK_MAIN();
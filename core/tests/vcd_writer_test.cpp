@@ -0,0 +1,117 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "uint.hpp"
+#include "vcd_writer.hpp"
+
+namespace {
+
+std::string read_file(const std::string &name) {
+  std::ifstream     f(name);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+// Both writers see the same changes at the same (global) time, enough
+// cycles to fill several chunks and compressed blocks
+void dump(vcd::VCDWriter &plain, vcd::VCDWriter &block, int ncycles) {
+  vcd::VCDWriter *writers[2] = {&plain, &block};
+  vcd::VarPtr     v_clk[2], v_cnt[2], v_wide[2], v_str[2];
+  for (int k = 0; k < 2; ++k) {
+    v_clk[k]  = writers[k]->register_var("top", "clk", vcd::VariableType::wire, 1);
+    v_cnt[k]  = writers[k]->register_var("top.sub", "cnt", vcd::VariableType::wire, 17);
+    v_wide[k] = writers[k]->register_var("top.sub", "wide", vcd::VariableType::wire, 130);
+    v_str[k]  = writers[k]->register_var("top", "state", vcd::VariableType::wire, 4);
+  }
+
+  UInt<17>  cnt(0);
+  UInt<130> wide(UInt<64>(0x9e3779b97f4a7c15ULL).cat(UInt<66>(0x2545f4914f6cdd1dULL)));
+  for (int i = 0; i < ncycles; ++i) {
+    vcd::advance_to_posedge();
+    cnt = cnt.addw(UInt<17>(1));
+    if (i % 7 == 0) {
+      wide = wide.addw(wide.template shr<3>().template pad<130>());
+    }
+    for (int k = 0; k < 2; ++k) {
+      writers[k]->change_value(v_clk[k], UInt<1>(1));
+      writers[k]->change_value(v_cnt[k], cnt);
+      writers[k]->change_value(v_wide[k], wide);
+      writers[k]->change(v_str[k], i % 5 == 0 ? "bx" : "b1010");
+    }
+    vcd::advance_to_negedge();
+    for (int k = 0; k < 2; ++k) {
+      writers[k]->change_value(v_clk[k], UInt<1>(0));
+    }
+  }
+  plain.close();
+  block.close();
+}
+
+TEST(Vcd_writer, block_matches_plain) {
+  {
+    auto           header = [] { return vcd::makeVCDHeader(vcd::TimeScale::ONE, vcd::TimeScaleUnit::ns, "today", "", ""); };
+    vcd::VCDWriter plain{"vcd_writer_test.vcd", header()};
+    vcd::VCDWriter block{"vcd_writer_test.vcdz", header(), 0u, vcd::OutputFormat::block};
+    dump(plain, block, 50000);
+  }
+
+  auto plain = read_file("vcd_writer_test.vcd");
+  auto block = read_file("vcd_writer_test.vcdz");
+  EXPECT_GT(plain.size(), 1u << 20);
+  EXPECT_LT(block.size(), plain.size());
+  EXPECT_TRUE(plain == vcd::decompress_vcd("vcd_writer_test.vcdz"));
+}
+
+TEST(Vcd_writer, change_format) {
+  {
+    vcd::VCDWriter writer{"vcd_writer_fmt.vcd", vcd::makeVCDHeader(vcd::TimeScale::ONE, vcd::TimeScaleUnit::ns, "today", "", "")};
+
+    auto v_a = writer.register_var("top", "a", vcd::VariableType::wire, 8);
+    auto v_b = writer.register_var("top", "b", vcd::VariableType::wire, 1);
+
+    vcd::advance_to_posedge();
+    EXPECT_TRUE(writer.change_value(v_a, UInt<8>(5)));
+    EXPECT_FALSE(writer.change(v_a, "b00000101"));  // same value through the string API
+    EXPECT_TRUE(writer.change_value(v_b, UInt<1>(1)));
+
+    vcd::advance_to_posedge();
+    EXPECT_FALSE(writer.change_value(v_b, UInt<1>(1)));
+    uint64_t w = 0x1ff;  // bits above the variable size are ignored
+    EXPECT_TRUE(writer.change_bits(v_a, &w));
+    EXPECT_FALSE(writer.change(v_a, "b11111111"));
+    writer.close();
+  }
+
+  auto txt = read_file("vcd_writer_fmt.vcd");
+  EXPECT_NE(txt.find("$dumpvars\nb0 0\n01\n$end\n"), std::string::npos);
+  auto pos = txt.find("$end\n#");
+  ASSERT_NE(pos, std::string::npos);
+  EXPECT_NE(txt.find("b101 0\n11\n#", pos), std::string::npos);
+  EXPECT_NE(txt.find("b11111111 0\n", pos), std::string::npos);
+}
+
+TEST(Vcd_writer, change_value_width) {
+  {
+    vcd::VCDWriter writer{"vcd_writer_width.vcd", vcd::makeVCDHeader(vcd::TimeScale::ONE, vcd::TimeScaleUnit::ns, "today", "", "")};
+
+    auto v_wide   = writer.register_var("top", "wide", vcd::VariableType::wire, 130);
+    auto v_narrow = writer.register_var("top", "narrow", vcd::VariableType::wire, 4);
+
+    vcd::advance_to_posedge();
+    EXPECT_TRUE(writer.change_value(v_wide, UInt<8>(0x81)));                      // zero extended
+    EXPECT_TRUE(writer.change_value(v_narrow, UInt<64>(0).cat(UInt<66>(0x35))));  // truncated
+    writer.close();
+  }
+
+  auto txt = read_file("vcd_writer_width.vcd");
+  auto pos = txt.find("$end\n#");
+  ASSERT_NE(pos, std::string::npos);
+  EXPECT_NE(txt.find("b10000001 0\nb101 1\n", pos), std::string::npos);
+}
+
+}  // namespace
@@ -6,13 +6,20 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <algorithm>
+#include <charconv>
+#include <exception>
+
 #include "cell.hpp"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "pass.hpp"
 #include "perf_tracing.hpp"
+#include "thread_pool.hpp"
 
-Cgen_verilog::Cgen_verilog(bool _verbose, std::string_view _odir) : verbose(_verbose), odir(_odir), nrunning(0) {
+Cgen_verilog::Cgen_verilog(bool _verbose, std::string_view _odir, size_t _block_nodes)
+    : verbose(_verbose), odir(_odir), block_nodes(_block_nodes), shared(nullptr), nrunning(0) {
+  I(block_nodes > 0);
   if (reserved_keyword.empty()) {
     std::lock_guard<std::mutex> guard(lgs_mutex);
 
@@ -33,10 +40,40 @@ Cgen_verilog::Cgen_verilog(bool _verbose, std::string_view _odir) : verbose(_ver
   }
 }
 
-std::string Cgen_verilog::get_wire_or_const(const Node_pin &dpin) const {
+Cgen_verilog::Cgen_verilog(const Cgen_verilog *_shared)
+    : verbose(_shared->verbose)
+    , odir(_shared->odir)
+    , first_array_block(false)
+    , block_nodes(_shared->block_nodes)
+    , shared(_shared)
+    , nrunning(0) {}
+
+const std::string *Cgen_verilog::find_var(const Node_pin &dpin) const {
   auto var_it = pin2var.find(dpin.get_compact_class());
   if (var_it != pin2var.end()) {
-    return var_it->second;
+    return &var_it->second;
+  }
+  if (shared) {
+    return shared->find_var(dpin);
+  }
+  return nullptr;
+}
+
+const Cgen_verilog::Expr *Cgen_verilog::find_expr(const Node_pin &dpin) const {
+  auto expr_it = pin2expr.find(dpin.get_compact_class());
+  if (expr_it != pin2expr.end()) {
+    return &expr_it->second;
+  }
+  if (shared) {
+    return shared->find_expr(dpin);
+  }
+  return nullptr;
+}
+
+std::string Cgen_verilog::get_wire_or_const(const Node_pin &dpin) const {
+  const auto *var = find_var(dpin);
+  if (var) {
+    return *var;
   }
 
   if (dpin.is_type_const()) {
@@ -80,18 +117,18 @@ std::string Cgen_verilog::get_append_to_name(std::string_view name, std::string_
 }
 
 std::string Cgen_verilog::get_expression(const Node_pin &dpin) const {
-  auto var_it = pin2var.find(dpin.get_compact_class());
-  if (var_it != pin2var.end()) {
-    return var_it->second;
+  const auto *var = find_var(dpin);
+  if (var) {
+    return *var;
   }
 
-  const auto expr_it = pin2expr.find(dpin.get_compact_class());
-  I(expr_it != pin2expr.end());
-  if (expr_it->second.needs_parenthesis) {
-    return absl::StrCat("(", expr_it->second.var, ")");
+  const auto *expr = find_expr(dpin);
+  I(expr);
+  if (expr->needs_parenthesis) {
+    return absl::StrCat("(", expr->var, ")");
   }
 
-  return expr_it->second.var;
+  return expr->var;
 }
 
 std::string Cgen_verilog::add_expression(std::string_view txt_seq, std::string_view txt_op, Node_pin &dpin) const {
@@ -232,8 +269,7 @@ void Cgen_verilog::process_memory(std::shared_ptr<File_output> fout, Node &node)
     name = absl::StrCat(name, n_rd_ports, "rd_");
     name = absl::StrCat(name, n_wr_ports, "wr");
 
-    // include
-    fout->prepend(absl::StrCat("`include \"", name, ".v\" \n"));
+    mem_includes.insert(name);  // `include after endmodule (see do_from_lgraph)
     fout->append(absl::StrCat(name));
 
     // parameters
@@ -380,10 +416,10 @@ void Cgen_verilog::process_mux(std::shared_ptr<File_output> fout, Node &node) {
   auto ordered_inp = node.inp_edges_ordered();
   I(ordered_inp.size() > 2);  // at least 0 + 1 + 2
 
-  auto sel_expr    = get_expression(ordered_inp[0].driver);
-  auto dest_var_it = pin2var.find(node.get_driver_pin().get_compact_class());
-  I(dest_var_it != pin2var.end());
-  auto dest_var = dest_var_it->second;
+  auto        sel_expr     = get_expression(ordered_inp[0].driver);
+  const auto *dest_var_ptr = find_var(node.get_driver_pin());
+  I(dest_var_ptr);
+  const auto &dest_var = *dest_var_ptr;
 
   auto mux2vec_it = mux2vector.find(node.get_compact_class());
   if (mux2vec_it == mux2vector.end()) {
@@ -511,11 +547,11 @@ void Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &
           a_replaced = absl::StrCat(value, "[", value_bits_to_use - 1, ":0]");
         }
 
-        auto var_it = pin2var.find(dpin.get_compact_class());
-        assert(var_it != pin2var.end());
+        const auto *var = find_var(dpin);
+        assert(var);
         if (value_bits_to_use < dpin.get_bits()) {
-          if (var_it->second != a) {
-            fout->append("  ", var_it->second, " = ", a, ";\n");
+          if (*var != a) {
+            fout->append("  ", *var, " = ", a, ";\n");
           }
         }
         std::string replace;
@@ -525,7 +561,7 @@ void Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &
         } else {
           replace = absl::StrCat("[", range_end - 1, ":", range_begin, "] = ");
         }
-        fout->append("  ", var_it->second, replace, value, ";\n");
+        fout->append("  ", *var, replace, value, ";\n");
         return;  // special case, multiple statements
       }
     }
@@ -681,11 +717,11 @@ void Cgen_verilog::process_simple_node(std::shared_ptr<File_output> fout, Node &
     absl::StrAppend(&final_expr, " /* color:", std::to_string(node.get_color()), "*/");
   }
 
-  auto var_it = pin2var.find(dpin.get_compact_class());
-  if (var_it == pin2var.end()) {
+  const auto *var = find_var(dpin);
+  if (var == nullptr) {
     pin2expr.emplace(dpin.get_compact_class(), Expr(final_expr, true));
-  } else if (var_it->second != final_expr) {
-    fout->append("  ", var_it->second, " = ", final_expr, ";\n");
+  } else if (*var != final_expr) {
+    fout->append("  ", *var, " = ", final_expr, ";\n");
   }
 }
 
@@ -764,34 +800,128 @@ void Cgen_verilog::create_subs(std::shared_ptr<File_output> fout, Lgraph *lg) {
   });
 }
 
+bool Cgen_verilog::is_combinational(Node &node) {
+  if (Ntype::is_multi_driver(node.get_type_op())) {
+    return false;
+  }
+
+  return node.has_outputs() && !node.is_type_flop();
+}
+
+void Cgen_verilog::process_combinational(std::shared_ptr<File_output> fout, Node &node) {
+  auto op = node.get_type_op();
+
+  if (node.get_driver_pin().get_bits() == 0) {
+    if (op != Ntype_op::Const && op != Ntype_op::AttrSet && op != Ntype_op::Mux) {
+      node.dump();
+      // Pass::error("node:{} does not have bits set. It needs bits to generate correct verilog", node.debug_name());
+    }
+  }
+
+  // flops added to the last always with outputs
+  if (op == Ntype_op::Mux) {
+    process_mux(fout, node);
+  } else {
+    process_simple_node(fout, node);
+  }
+}
+
 void Cgen_verilog::create_combinational(std::shared_ptr<File_output> fout, Lgraph *lg) {
   fout->append("always_comb begin\n");
 
   for (auto node : lg->forward()) {
-    auto op = node.get_type_op();
-    if (Ntype::is_multi_driver(op)) {
-      continue;
+    if (is_combinational(node)) {
+      process_combinational(fout, node);
     }
+  }
 
-    if (!node.has_outputs() || node.is_type_flop()) {
-      continue;
+  fout->append("end\n");
+}
+
+void Cgen_verilog::create_combinational_blocks(std::shared_ptr<File_output> fout, Lgraph *lg) {
+  // Blocks run on thread_pool helpers and on this thread. do_from_lgraph is
+  // already a thread_pool task, so it never waits for a helper to start: any
+  // block not claimed yet is done here. A helper may start after this returns,
+  // so what it touches is owned by the shared Blocks.
+  struct Blocks {
+    std::vector<Node>                          nodes;
+    std::vector<std::unique_ptr<Cgen_verilog>> workers;
+    std::vector<std::shared_ptr<File_output>>  outs;
+    std::vector<std::exception_ptr>            errors;
+    std::atomic<size_t>                        next_block{0};
+    std::atomic<size_t>                        n_done{0};
+  };
+  auto  st    = std::make_shared<Blocks>();
+  auto &nodes = st->nodes;
+  for (auto node : lg->forward()) {
+    if (is_combinational(node)) {
+      nodes.emplace_back(node);
+    }
+  }
+
+  const size_t n_blocks = (nodes.size() + block_nodes - 1) / block_nodes;
+
+  absl::flat_hash_map<Node::Compact_class, size_t> node2block;
+  for (auto i = 0u; i < nodes.size(); ++i) {
+    node2block.emplace(nodes[i].get_compact_class(), i / block_nodes);
+  }
+
+  // An inlined expression read from a later block becomes a variable (the
+  // IDEA in create_locals): edges that cross blocks only read pin2var
+  for (auto i = 0u; i < nodes.size(); ++i) {
+    for (auto &e : nodes[i].inp_edges()) {
+      auto &dpin = e.driver;
+      if (pin2var.contains(dpin.get_compact_class()) || pin2expr.contains(dpin.get_compact_class())) {
+        continue;
+      }
+      auto it = node2block.find(dpin.get_node().get_compact_class());
+      if (it != node2block.end() && it->second < i / block_nodes) {
+        add_to_pin2var(fout, dpin, get_scaped_name(dpin.get_wire_name()), dpin.is_unsign());
+      }
     }
+  }
 
-    if (node.get_driver_pin().get_bits() == 0) {
-      if (op != Ntype_op::Const && op != Ntype_op::AttrSet && op != Ntype_op::Mux) {
-        node.dump();
-        // Pass::error("node:{} does not have bits set. It needs bits to generate correct verilog", node.debug_name());
+  st->errors.resize(n_blocks);
+  for (auto b = 0u; b < n_blocks; ++b) {
+    st->workers.emplace_back(new Cgen_verilog(this));
+    st->outs.emplace_back(std::make_shared<File_output>());
+  }
+
+  auto run = [st, n_blocks, bsize = block_nodes]() {
+    for (size_t b = st->next_block++; b < n_blocks; b = st->next_block++) {
+      try {
+        auto end = std::min(st->nodes.size(), (b + 1) * bsize);
+        for (auto i = b * bsize; i < end; ++i) {
+          st->workers[b]->process_combinational(st->outs[b], st->nodes[i]);
+        }
+      } catch (...) {
+        st->errors[b] = std::current_exception();
       }
+      st->n_done.fetch_add(1, std::memory_order_release);
+      st->n_done.notify_all();
     }
+  };
 
-    // flops added to the last always with outputs
-    if (op == Ntype_op::Mux) {
-      process_mux(fout, node);
-    } else {
-      process_simple_node(fout, node);
+  const auto n_helpers = std::min<size_t>(n_blocks - 1, thread_pool.size());
+  for (auto t = 0u; t < n_helpers; ++t) {
+    thread_pool.add(run);
+  }
+  run();
+  for (auto done = st->n_done.load(std::memory_order_acquire); done < n_blocks; done = st->n_done.load(std::memory_order_acquire)) {
+    st->n_done.wait(done, std::memory_order_acquire);  // blocks a helper claimed are still running
+  }
+
+  for (auto &err : st->errors) {
+    if (err) {
+      std::rethrow_exception(err);
     }
   }
 
+  fout->append("always_comb begin\n");
+  for (auto b = 0u; b < n_blocks; ++b) {
+    fout->append(std::move(*st->outs[b]));
+    pin2expr.merge(st->workers[b]->pin2expr);  // create_outputs reads them
+  }
   fout->append("end\n");
 }
 
@@ -1050,6 +1180,119 @@ void Cgen_verilog::create_locals(std::shared_ptr<File_output> fout, Lgraph *lg)
   }
 }
 
+Cgen_verilog::Body_hash Cgen_verilog::get_body_hash(Lgraph *lg, bool verbose) {
+  auto hash_str = [](std::string_view str) { return lh::woothash64(str.data(), str.size()); };
+  auto hash_rec = [](std::initializer_list<uint64_t> rec) { return lh::woothash64(rec.begin(), rec.size() * sizeof(uint64_t)); };
+  auto hash_pin = [&](const Node_pin &dpin) {
+    return hash_rec({hash_str(dpin.get_wire_name()), dpin.get_pid(), static_cast<uint64_t>(dpin.get_bits()), dpin.is_unsign()});
+  };
+
+  Body_hash body{lg->get_lgid(), lg->get_mutation_epoch(), verbose, 0, {}};
+
+  // Hashset is order independent, so the traversal order does not matter
+  Hashset hs;
+  hs.insert(hash_rec({cgen_version, hash_str(lg->get_name()), verbose}));
+
+  lg->each_sorted_graph_io([&](Node_pin &pin, Port_ID pos) { hs.insert(hash_rec({hash_pin(pin), pin.is_graph_input(), pos})); });
+  lg->each_graph_output([&](Node_pin &dpin) {
+    auto spin = dpin.change_to_sink_from_graph_out_driver();
+    if (spin.is_connected()) {
+      auto out_dpin = spin.get_driver_pin();
+      hs.insert(hash_rec({dpin.get_pid(), static_cast<uint64_t>(out_dpin.get_node().get_nid()), out_dpin.get_pid()}));
+    }
+  });
+
+  for (auto node : lg->fast()) {
+    const auto op = node.get_type_op();
+
+    uint64_t extra = 0;
+    if (op == Ntype_op::Const) {
+      extra = node.get_type_const().hash();
+    } else if (op == Ntype_op::Sub) {
+      const Lg_id_t sub_lgid = node.get_type_sub().value;
+      extra                  = hash_rec({sub_lgid, hash_str(node.default_instance_name())});
+      body.subs.emplace_back(sub_lgid);
+    }
+
+    const auto nid = static_cast<uint64_t>(node.get_nid());
+    hs.insert(hash_rec({nid,
+                        static_cast<uint64_t>(op),
+                        node.has_name() ? hash_str(node.get_name()) : 0,
+                        node.has_color() ? static_cast<uint64_t>(node.get_color()) + 1 : 0,
+                        extra}));
+
+    for (auto &dpin : node.out_connected_pins()) {
+      hs.insert(hash_rec({nid, hash_pin(dpin)}));
+    }
+    for (auto &e : node.inp_edges()) {
+      hs.insert(hash_rec({nid, e.sink.get_pid(), static_cast<uint64_t>(e.driver.get_node().get_nid()), e.driver.get_pid()}));
+    }
+  }
+
+  std::sort(body.subs.begin(), body.subs.end());
+  body.subs.erase(std::unique(body.subs.begin(), body.subs.end()), body.subs.end());
+
+  body.hash = hs.get_value();
+  return body;
+}
+
+uint64_t Cgen_verilog::get_module_hash(Lgraph *lg, bool verbose) {
+  auto hash_str = [](std::string_view str) { return lh::woothash64(str.data(), str.size()); };
+  auto hash_rec = [](std::initializer_list<uint64_t> rec) { return lh::woothash64(rec.begin(), rec.size() * sizeof(uint64_t)); };
+
+  Body_hash body;
+  bool      cached = false;
+  {
+    std::lock_guard<std::mutex> guard(body_hash_mutex);
+    const auto                  it = body_hashes.find(lg);
+    if (it != body_hashes.end() && it->second.lgid == lg->get_lgid() && it->second.epoch == lg->get_mutation_epoch()
+        && it->second.verbose == verbose) {
+      body   = it->second;
+      cached = true;
+    }
+  }
+  if (!cached) {
+    body = get_body_hash(lg, verbose);
+
+    std::lock_guard<std::mutex> guard(body_hash_mutex);
+    body_hashes.insert_or_assign(lg, body);
+  }
+
+  // The child IO (names and order) is printed in the instance, a renamed/reordered port must regenerate the parent
+  uint64_t    hash    = body.hash;
+  const auto &library = lg->get_library();
+  for (const auto sub_lgid : body.subs) {
+    const auto &sub = library.get_sub(Lg_type_id(sub_lgid));
+    hash            = hash_rec({hash, sub_lgid, hash_str(sub.get_name())});
+
+    uint64_t pos = 0;
+    for (const auto &io_pin : sub.get_sorted_io_pins()) {
+      hash = hash_rec({hash, pos++, hash_str(io_pin.name), io_pin.get_instance_pid(), io_pin.is_input()});
+    }
+  }
+
+  return hash;
+}
+
+uint64_t Cgen_verilog::get_emitted_hash(const std::string &filename) {
+  char  line[64];
+  FILE *fp = fopen(filename.c_str(), "r");
+  if (fp == nullptr) {
+    return 0;
+  }
+  auto *ok = fgets(line, sizeof(line), fp);
+  fclose(fp);
+
+  std::string_view first{ok ? line : ""};
+  if (!first.starts_with(hash_tag)) {
+    return 0;
+  }
+
+  uint64_t hash = 0;
+  std::from_chars(first.data() + hash_tag.size(), first.data() + first.size(), hash, 16);
+  return hash;
+}
+
 void Cgen_verilog::do_from_lgraph(Lgraph *lg) {
   // TRACE_EVENT("cgen", perfetto::DynamicString(lg->get_name()));
   // note: tricks to make perfetto display different color on sub-modules
@@ -1058,6 +1301,18 @@ void Cgen_verilog::do_from_lgraph(Lgraph *lg) {
     ctx.event()->set_name(absl::StrCat(converted_str, lg->get_name()));
   });
 
+  std::string filename;
+  if (odir.empty()) {
+    filename = absl::StrCat(lg->get_name(), ".v");
+  } else {
+    filename = absl::StrCat(odir, "/", lg->get_name(), ".v");
+  }
+
+  const auto hash = get_module_hash(lg, verbose);
+  if (hash == get_emitted_hash(filename)) {
+    return;  // unchanged since the last emit, do not touch the file
+  }
+
   assert(nrunning == 0);
   ++nrunning;
 
@@ -1068,14 +1323,10 @@ void Cgen_verilog::do_from_lgraph(Lgraph *lg) {
   mux2vector.clear();
   first_array_block = true;
 
-  std::string filename;
-  if (odir.empty()) {
-    filename = absl::StrCat(lg->get_name(), ".v");
-  } else {
-    filename = absl::StrCat(odir, "/", lg->get_name(), ".v");
-  }
+  mem_includes.clear();
 
   auto fout = std::make_shared<File_output>(filename);
+  fout->reserve_head(hash_line_size);  // filled at close, so a partial file never has the hash
 
   fout->append("/* verilator lint_off WIDTH */\n");
 
@@ -1087,11 +1338,22 @@ void Cgen_verilog::do_from_lgraph(Lgraph *lg) {
   create_memories(fout, lg);  // no local access
   create_subs(fout, lg);      // no local access
 
-  create_combinational(fout, lg);  // pin2expr adds, reads pin2var & mux2vector
+  if (lg->size() > 2 * block_nodes) {
+    create_combinational_blocks(fout, lg);  // same, in parallel blocks
+  } else {
+    create_combinational(fout, lg);  // pin2expr adds, reads pin2var & mux2vector
+  }
   create_outputs(fout, lg);        // reads pin2expr
   create_registers(fout, lg);      // reads pin2var
 
   fout->append("endmodule\n");
 
+  // Memory modules can be defined after their use, and each one only once
+  for (const auto &name : mem_includes) {
+    fout->append("`include \"", name, ".v\"\n");
+  }
+
+  fout->fill_head(absl::StrCat(hash_tag, absl::Hex(hash, absl::kZeroPad16), "\n"));
+
   --nrunning;
 }
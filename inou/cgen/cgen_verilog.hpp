@@ -4,9 +4,13 @@
 
 #include <atomic>
 #include <mutex>
+#include <set>
 #include <string>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "file_output.hpp"
+#include "hashset.hpp"
 #include "lgraph.hpp"
 
 class Cgen_verilog {
@@ -29,10 +33,22 @@ private:
 
   bool first_array_block;
 
+  std::set<std::string> mem_includes;  // cgen_memory_* modules used (sorted, stable output)
+
+  // Large modules (over 2 blocks) emit the combinational logic in blocks of
+  // nodes (forward order) processed in parallel. Each block has its own
+  // Cgen_verilog with a local pin2expr; pin2var (and the pin2expr built by
+  // create_locals) are shared read-only through "shared".
+  const size_t        block_nodes;
+  const Cgen_verilog *shared;
+
   std::atomic<int>                               nrunning;
   inline static std::mutex                       lgs_mutex;  // just needed for the once at a time setup of static reserved_keyword
   inline static absl::flat_hash_set<std::string> reserved_keyword;
 
+  const std::string *find_var(const Node_pin &dpin) const;
+  const Expr        *find_expr(const Node_pin &dpin) const;
+
   std::string        get_wire_or_const(const Node_pin &dpin) const;
   static std::string get_scaped_name(std::string_view name);
 
@@ -49,15 +65,45 @@ private:
   void create_module_io(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_memories(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_subs(std::shared_ptr<File_output> fout, Lgraph *lg);
-  void create_combinational(std::shared_ptr<File_output> fout, Lgraph *lg);
+  static bool is_combinational(Node &node);
+  void        process_combinational(std::shared_ptr<File_output> fout, Node &node);
+  void        create_combinational(std::shared_ptr<File_output> fout, Lgraph *lg);
+  void        create_combinational_blocks(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_outputs(std::shared_ptr<File_output> fout, Lgraph *lg);
   void create_registers(std::shared_ptr<File_output> fout, Lgraph *lg);
 
   void add_to_pin2var(std::shared_ptr<File_output> fout, Node_pin &dpin, std::string_view name, bool out_unsigned);
   void create_locals(std::shared_ptr<File_output> fout, Lgraph *lg);
 
+  Cgen_verilog(const Cgen_verilog *_shared);  // per block worker
+
+  // The emitted file starts with "// cgen hash:<hex>", a content hash of the
+  // Lgraph (structure and the attributes used by cgen). Bump cgen_version
+  // when the generated verilog changes so older files are regenerated.
+  static constexpr uint64_t         cgen_version   = 2;
+  static constexpr std::string_view hash_tag       = "// cgen hash:";
+  static constexpr size_t           hash_line_size = hash_tag.size() + 16 + 1;  // tag, 16 hex digits, newline
+
+  // Walk of lg for the module hash, reused while the mutation epoch of lg (and verbose) do not change. The IO of the
+  // instantiated subs is not in that epoch, it is added on each call from the sub lgids.
+  struct Body_hash {
+    Lg_type_id           lgid;
+    uint64_t             epoch;
+    bool                 verbose;
+    uint64_t             hash;
+    std::vector<Lg_id_t> subs;  // sorted, unique
+  };
+  inline static std::mutex                                     body_hash_mutex;
+  inline static absl::flat_hash_map<const Lgraph *, Body_hash> body_hashes;
+
+  static Body_hash get_body_hash(Lgraph *lg, bool verbose);
+  static uint64_t  get_module_hash(Lgraph *lg, bool verbose);
+  static uint64_t get_emitted_hash(const std::string &filename);
+
 public:
+  static constexpr size_t default_block_nodes = 1 << 16;
+
   void do_from_lgraph(Lgraph *lg_parent);
 
-  Cgen_verilog(bool _verbose, std::string_view _odir);
+  Cgen_verilog(bool _verbose, std::string_view _odir, size_t _block_nodes = default_block_nodes);
 };
@@ -0,0 +1,135 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "cgen_verilog.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "lgraph.hpp"
+
+class Cgen_verilog_test : public ::testing::Test {
+protected:
+  static constexpr int    width       = 64;
+  static constexpr int    levels      = 40;
+  static constexpr size_t small_block = 100;  // ~25 blocks, the block edges fall in the middle of a level
+
+  Graph_library *lib = nullptr;
+
+  void SetUp() override { lib = Graph_library::instance("lgdb_cgen_verilog_test"); }
+
+  // Levels of Sum/Xor/And nodes. With shared, node i of a level reads nodes i and i+1 of the previous one, so every
+  // driver has two sinks and becomes a variable. Without it, each node reads one driver of the previous level and its
+  // own neighbour in the current level, so there are single sink expressions that cross block edges.
+  Lgraph *create(std::string_view name, bool shared) {
+    auto *g = lib->create_lgraph(name, "-");
+
+    auto a = g->add_graph_input("a", 1, 8);
+    auto b = g->add_graph_input("b", 2, 8);
+
+    std::vector<Node_pin> prev;
+    for (int i = 0; i < width; ++i) {
+      prev.emplace_back(i % 2 ? a : b);
+    }
+    for (int level = 0; level < levels; ++level) {
+      std::vector<Node_pin> next;
+      for (int i = 0; i < width; ++i) {
+        const Ntype_op op   = i % 3 == 0 ? Ntype_op::Sum : (i % 3 == 1 ? Ntype_op::Xor : Ntype_op::And);
+        auto           node = g->create_node(op, 8);
+        auto           spin = node.setup_sink_pin("A");
+        auto           in2  = op == Ntype_op::Sum ? node.setup_sink_pin("B") : spin;
+        if (shared || level == 0) {
+          g->add_edge(prev[i], spin);
+          g->add_edge(prev[(i + 1) % width], in2);
+        } else {
+          g->add_edge(prev[i], spin);
+          g->add_edge(next.empty() ? (level % 2 ? a : b) : next.back(), in2);
+        }
+        next.emplace_back(node.setup_driver_pin());
+      }
+      prev = std::move(next);
+    }
+
+    for (int i = 0; i < width; ++i) {
+      g->add_edge(prev[i], g->add_graph_output(absl::StrCat("o", i), 3 + i, 8));
+    }
+    return g;
+  }
+
+  static std::string emit(Lgraph *g, std::string_view odir, size_t block_nodes, bool clean = true) {
+    if (clean) {
+      std::filesystem::remove_all(odir);
+    }
+    std::filesystem::create_directories(odir);
+    {
+      Cgen_verilog cgen(false, odir, block_nodes);
+      cgen.do_from_lgraph(g);
+    }
+    std::ifstream     in(absl::StrCat(odir, "/", g->get_name(), ".v"));
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+  }
+
+  static size_t count(const std::string &txt, std::string_view what) {
+    size_t n = 0;
+    for (auto pos = txt.find(what); pos != std::string::npos; pos = txt.find(what, pos + 1)) {
+      ++n;
+    }
+    return n;
+  }
+};
+
+TEST_F(Cgen_verilog_test, parallel_blocks_match_serial) {
+  auto *g = create("cgen_blocks_shared", true);
+
+  const auto serial   = emit(g, "lgdb_cgen_verilog_test/serial", Cgen_verilog::default_block_nodes);
+  const auto parallel = emit(g, "lgdb_cgen_verilog_test/parallel", small_block);
+
+  ASSERT_FALSE(serial.empty());
+  EXPECT_EQ(serial, parallel);
+
+  g->clear();
+}
+
+TEST_F(Cgen_verilog_test, crossing_expressions_become_variables) {
+  auto *g = create("cgen_blocks_chain", false);
+
+  const auto serial   = emit(g, "lgdb_cgen_verilog_test/serial", Cgen_verilog::default_block_nodes);
+  const auto parallel = emit(g, "lgdb_cgen_verilog_test/parallel", small_block);
+
+  // Same module, more variables (one per expression read from a later block), and the same output on each run
+  EXPECT_EQ(serial.substr(0, serial.find(");\n")), parallel.substr(0, parallel.find(");\n")));
+  EXPECT_GT(count(parallel, "reg "), count(serial, "reg "));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(parallel, emit(g, "lgdb_cgen_verilog_test/parallel", small_block));
+  }
+
+  g->clear();
+}
+
+TEST_F(Cgen_verilog_test, unchanged_module_is_not_rewritten) {
+  auto *g = create("cgen_blocks_skip", true);
+
+  const std::string odir  = "lgdb_cgen_verilog_test/skip";
+  const auto        first = emit(g, odir, Cgen_verilog::default_block_nodes);
+  ASSERT_FALSE(first.empty());
+
+  // Keep the hash line, change the body: an emit that skips the module leaves it as is
+  const auto marked = first.substr(0, first.find('\n') + 1) + "// untouched\n";
+  std::ofstream(absl::StrCat(odir, "/", g->get_name(), ".v"), std::ios::trunc) << marked;
+  EXPECT_EQ(emit(g, odir, Cgen_verilog::default_block_nodes, false), marked);
+
+  // Any edit moves the mutation epoch, the module is hashed again and regenerated
+  auto node = g->create_node(Ntype_op::Not, 8);
+  g->add_edge(g->get_graph_input("a"), node.setup_sink_pin());
+  g->add_edge(node.setup_driver_pin(), g->add_graph_output("o_not", 3 + width, 8));
+  const auto edited = emit(g, odir, Cgen_verilog::default_block_nodes, false);
+  EXPECT_NE(edited, marked);
+  EXPECT_NE(edited, first);
+
+  g->clear();
+}
@@ -5,6 +5,7 @@
 #include "cgen_verilog.hpp"
 #include "file_utils.hpp"
 #include "perf_tracing.hpp"
+#include "str_tools.hpp"
 #include "thread_pool.hpp"
 
 static Pass_plugin sample("inou_cgen", Inou_cgen::setup);
@@ -12,12 +13,24 @@ static Pass_plugin sample("inou_cgen", Inou_cgen::setup);
 Inou_cgen::Inou_cgen(const Eprp_var &var) : Pass("inou.cgen", var) {
   auto v  = var.get("verbose");
   verbose = v != "false" && v != "0";
+
+  block_nodes = Cgen_verilog::default_block_nodes;
+  if (var.has_label("block_nodes")) {
+    auto b = var.get("block_nodes");
+    if (!str_tools::is_i(b) || str_tools::to_i(b) <= 0) {
+      error("inou.cgen.verilog block_nodes must be a positive integer not '{}'", b);
+    }
+    block_nodes = str_tools::to_i(b);
+  }
 }
 
 void Inou_cgen::setup() {
   Eprp_method m1("inou.cgen.verilog", "export verilog from an Lgraph", &Inou_cgen::to_cgen_verilog);
 
   m1.add_label_optional("verbose", "dump bits and wirename (true/false)", "false");
+  m1.add_label_optional("block_nodes",
+                        "combinational nodes per parallel block (modules with over 2 blocks are split)",
+                        std::to_string(Cgen_verilog::default_block_nodes));
   register_inou("cgen", m1);
 }
 
@@ -26,14 +39,15 @@ void Inou_cgen::to_cgen_verilog(Eprp_var &var) {
 
   Inou_cgen pp(var);
 
-  auto dir     = pp.get_odir(var);
-  auto verbose = pp.verbose;
+  auto dir         = pp.get_odir(var);
+  auto verbose     = pp.verbose;
+  auto block_nodes = pp.block_nodes;
 
   std::sort(var.lgs.begin(), var.lgs.end(), [](Lgraph *a, Lgraph *b) { return a->size() > b->size(); });
 
   for (auto *lg : var.lgs) {
-    thread_pool.add([lg, verbose, dir]() -> void {
-      Cgen_verilog p(verbose, dir);
+    thread_pool.add([lg, verbose, dir, block_nodes]() -> void {
+      Cgen_verilog p(verbose, dir, block_nodes);
       p.do_from_lgraph(lg);
     });
   }
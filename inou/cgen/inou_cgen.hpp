@@ -7,6 +7,7 @@ class Inou_cgen : public Pass {
 private:
   bool        verbose;
   std::string odir;
+  size_t      block_nodes;
 
 protected:
   static void to_cgen_verilog(Eprp_var &var);
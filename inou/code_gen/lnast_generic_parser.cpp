@@ -303,7 +303,7 @@ void Cpp_parser::call_dump_maps() const { Cpp_parser::dump_maps(); }
 int  Cpp_parser::indent_final_system() const { return 1; }
 
 void Cpp_parser::set_for_vcd_comb(std::string_view key1, std::string_view key2) {
-  absl::StrAppend(&buff_to_print_vcd, "vcd_writer->change(vcd_", key1, ", ", key2, ".to_string_binary());\n");
+  absl::StrAppend(&buff_to_print_vcd, "vcd_writer->change_value(vcd_", key1, ", ", key2, ");\n");
 }
 
 void Cpp_parser::add_to_buff_vec_for_cpp(std::string_view s) { buff_vec_for_cpp.emplace_back(s); }
@@ -324,11 +324,11 @@ void Cpp_parser::set_final_print(std::string_view modname, std::shared_ptr<File_
   std::string rst_vals_nline, rst_vals_nline_vcd;
   for (auto const &[key, val] : outp_bw) {
     absl::StrAppend(&rst_vals_nline, "  outputs.", key, " = UInt<", val, "> (0);\n");
-    absl::StrAppend(&rst_vals_nline_vcd, "  vcd_writer->change(vcd_", key, ", outputs.", key, ".to_string_binary());\n");
+    absl::StrAppend(&rst_vals_nline_vcd, "  vcd_writer->change_value(vcd_", key, ", outputs.", key, ");\n");
   }
   for (auto const &[key, val] : reg_bw) {
     absl::StrAppend(&rst_vals_nline, "  regs.", key, " = UInt<", val, "> (0);\n");
-    absl::StrAppend(&rst_vals_nline_vcd, "  vcd_writer->change(vcd_", key, ", regs.", key, ".to_string_binary());\n");
+    absl::StrAppend(&rst_vals_nline_vcd, "  vcd_writer->change_value(vcd_", key, ", regs.", key, ");\n");
   }
   auto reset_vcd  = absl::StrCat("void ", modname, "_sim::vcd_reset_cycle() {\n", rst_vals_nline, rst_vals_nline_vcd, "}\n");
   auto reset_func = absl::StrCat("void ", modname, "_sim::reset_cycle() {\n", rst_vals_nline, "}\n");
@@ -0,0 +1,168 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "chunkify.hpp"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <fstream>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+
+Chunk_index::Chunk_index(std::string_view chunk_dir) : filename(absl::StrCat(chunk_dir, "/chunk.idx")), dirty(false) {
+  // One "<hex hash> <chunk>" per line. A missing or bad line just means that
+  // chunk is generated again.
+  std::ifstream fs(filename);
+  std::string   line;
+  while (std::getline(fs, line)) {
+    auto sep = line.find(' ');
+    if (sep == std::string::npos || sep + 1 >= line.size()) {
+      continue;
+    }
+
+    uint64_t hash = 0;
+
+    auto [ptr, ec] = std::from_chars(line.data(), line.data() + sep, hash, 16);
+    if (ec != std::errc() || ptr != line.data() + sep) {
+      continue;
+    }
+    hashes[line.substr(sep + 1)] = hash;
+  }
+}
+
+Chunk_index::~Chunk_index() { save(); }
+
+bool Chunk_index::is_current(std::string_view chunk, uint64_t hash) const {
+  std::lock_guard<std::mutex> guard(mutex);
+
+  auto it = hashes.find(chunk);
+  return it != hashes.end() && it->second == hash;
+}
+
+void Chunk_index::update(std::string_view chunk, uint64_t hash) {
+  std::lock_guard<std::mutex> guard(mutex);
+
+  auto it = hashes.find(chunk);
+  if (it != hashes.end() && it->second == hash) {
+    return;
+  }
+
+  hashes.insert_or_assign(std::string(chunk), hash);
+  dirty = true;
+}
+
+void Chunk_index::save() {
+  std::lock_guard<std::mutex> guard(mutex);
+  if (!dirty) {
+    return;
+  }
+
+  std::string buffer;
+  for (const auto &[chunk, hash] : hashes) {
+    absl::StrAppend(&buffer, absl::Hex(hash, absl::kZeroPad16), " ", chunk, "\n");
+  }
+
+  auto tmp = absl::StrCat(filename, ".tmp");
+  {
+    std::ofstream fs(tmp, std::ios::trunc);
+    fs << buffer;
+    if (!fs) {
+      return;  // keep dirty, no index means a full regeneration next time
+    }
+  }
+  if (rename(tmp.c_str(), filename.c_str()) == 0) {
+    dirty = false;
+  }
+}
+
+Chunkify::Chunkify(std::string_view _path, bool _incremental_mode, Chunk_index *_index)
+    : path(_path), incremental_mode(_incremental_mode), index(_index) {
+  chunk_dir = absl::StrCat(path, "/liveparse");
+  if (access(chunk_dir.c_str(), F_OK) != 0) {
+    std::string spath(path);
+    int         err = mkdir(spath.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    if (err < 0 && errno != EEXIST) {
+      throw scan_error(*this, "could not create {} directory", path);
+    }
+
+    err = mkdir(chunk_dir.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    if (err < 0 && errno != EEXIST) {
+      throw scan_error(*this, "could not create {}/{} directory", path, "liveparse");
+    }
+  }
+
+  if (index == nullptr) {
+    own_index = std::make_unique<Chunk_index>(chunk_dir);
+    index     = own_index.get();
+  }
+}
+
+int Chunkify::open_write_file(std::string_view fname) const {
+  std::string f(fname);
+
+  int fd = open(f.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+  if (fd < 0) {
+    throw scan_error(*this, "could not open {} for output", fname);
+  }
+
+  return fd;
+}
+
+void Chunkify::write_file(std::string_view fname, std::string_view text1, std::string_view text2) const {
+  int fd = open_write_file(fname);
+  if (fd < 0) {
+    return;
+  }
+
+  // A partial chunk is removed, so the next run does not take it as current
+  size_t sz = write(fd, text1.data(), text1.size());
+  if (sz != text1.size()) {
+    close(fd);
+    unlink(std::string(fname).c_str());
+    throw scan_error(*this, "could not write contents to file err:{} vs {}", sz, text1.size());
+  }
+  sz = write(fd, text2.data(), text2.size());
+  if (sz != text2.size()) {
+    close(fd);
+    unlink(std::string(fname).c_str());
+    throw scan_error(*this, "could not write contents to file err:{} vs {}", sz, text2.size());
+  }
+
+  if (close(fd) != 0) {
+    unlink(std::string(fname).c_str());
+    throw scan_error(*this, "could not write contents to file {}", fname);
+  }
+}
+
+void Chunkify::write_file(std::string_view fname, std::string_view text) const {
+  auto fd = open_write_file(fname);
+  if (fd < 0) {
+    return;
+  }
+
+  size_t sz2 = write(fd, text.data(), text.size());
+  if (sz2 != text.size()) {
+    throw scan_error(*this, "could not write contents to file err:{} vs {}", sz2, text.size());
+  }
+
+  close(fd);
+}
+
+void Chunkify::emit_chunk(std::string_view module_name, std::string_view ext, uint64_t hash, std::string_view text1,
+                          std::string_view text2) {
+  auto chunk   = absl::StrCat(module_name, ext);
+  auto outfile = absl::StrCat(chunk_dir, "/", chunk);
+
+  if (incremental_mode && index->is_current(chunk, hash) && access(outfile.c_str(), F_OK) == 0) {
+    return;
+  }
+
+  write_file(outfile, text1, text2);  // throws on failure, so the index keeps the old hash
+  index->update(chunk, hash);         // recorded even when not incremental, so the next run can skip it
+  generated_files.emplace_back(outfile);
+}
@@ -0,0 +1,72 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "elab_scanner.hpp"
+#include "woothash.hpp"
+
+// Persistent per chunk content hash (path/liveparse/chunk.idx). The hash is
+// over the normalized tokens (no whitespace, no comments), so formatting only
+// edits do not trigger a new chunk. Shared by the chunkers of a liveparse run
+// (thread safe).
+class Chunk_index {
+  std::string filename;
+
+  mutable std::mutex                         mutex;
+  absl::flat_hash_map<std::string, uint64_t> hashes;
+  bool                                       dirty;
+
+public:
+  explicit Chunk_index(std::string_view chunk_dir);
+  ~Chunk_index();
+
+  Chunk_index(const Chunk_index &)            = delete;
+  Chunk_index &operator=(const Chunk_index &) = delete;
+
+  // True if chunk was last written with this hash
+  bool is_current(std::string_view chunk, uint64_t hash) const;
+
+  // Records the hash for chunk (only once its file was written)
+  void update(std::string_view chunk, uint64_t hash);
+
+  void save();
+
+  static uint64_t hash_token(uint64_t hash, const Ref_token &tok) {
+    auto txt = tok.get_text();
+    return lh::woothash64(txt.data(), txt.size(), hash ^ tok.tok);
+  }
+};
+
+// Common part of the Verilog and Pyrope chunkers: each module is written to
+// path/liveparse/<module><ext> when its content hash changed (or always when
+// not in incremental mode). generated_files has the chunks written.
+class Chunkify : public Elab_scanner {
+protected:
+  std::string path;
+  std::string chunk_dir;
+
+  bool incremental_mode;
+
+  std::vector<std::string> generated_files;
+
+  Chunk_index                 *index;
+  std::unique_ptr<Chunk_index> own_index;  // when no shared index is given
+
+  int open_write_file(std::string_view filename) const;
+
+  void write_file(std::string_view filename, std::string_view text1, std::string_view text2) const;
+  void write_file(std::string_view filename, std::string_view text) const;
+
+  void emit_chunk(std::string_view module_name, std::string_view ext, uint64_t hash, std::string_view text1, std::string_view text2);
+
+public:
+  Chunkify(std::string_view path, bool incremental_mode, Chunk_index *index);
+
+  const std::vector<std::string> &get_generated_files() const { return generated_files; }
+};
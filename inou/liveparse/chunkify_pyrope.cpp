@@ -0,0 +1,28 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "chunkify_pyrope.hpp"
+
+#include "perf_tracing.hpp"
+#include "str_tools.hpp"
+
+Chunkify_pyrope::Chunkify_pyrope(std::string_view _path, bool _incremental_mode, Chunk_index *_index)
+    : Chunkify(_path, _incremental_mode, _index) {}
+
+void Chunkify_pyrope::elaborate() {
+  TRACE_EVENT("liveparse", "liveparse_pyrope");
+
+  generated_files.clear();
+
+  uint64_t hash = 0;
+  for (size_t i = 1; i < token_list.size(); ++i) {  // skip bogus zero entry
+    if (token_list[i].tok == Token_id_comment) {
+      continue;
+    }
+    hash = Chunk_index::hash_token(hash, token_list[i]);
+  }
+
+  auto basename       = str_tools::get_str_after_last_if_exists(get_filename(), '/');
+  auto basename_noext = str_tools::get_str_before_first(basename, '.');
+
+  emit_chunk(basename_noext, ".prp", hash, get_memblock(), "");
+}
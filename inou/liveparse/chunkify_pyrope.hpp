@@ -0,0 +1,12 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include "chunkify.hpp"
+
+// A Pyrope file is a module (named after the file), so the whole file is the
+// chunk. It is copied to path/liveparse/<module>.prp when its tokens change.
+class Chunkify_pyrope : public Chunkify {
+public:
+  Chunkify_pyrope(std::string_view path, bool incremental_mode, Chunk_index *index = nullptr);
+  void elaborate() final;
+};
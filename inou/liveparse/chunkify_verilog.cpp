@@ -2,17 +2,6 @@
 
 #include "chunkify_verilog.hpp"
 
-#include <fcntl.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-
-#include <format>
-#include <iostream>
-#include <set>
 #include <string>
 
 #include "file_utils.hpp"
@@ -21,102 +10,9 @@
 #include "lgraph.hpp"
 #include "perf_tracing.hpp"
 
-Chunkify_verilog::Chunkify_verilog(std::string_view _path, bool _incremental_mode)
-    : path(_path), incremental_mode(_incremental_mode) {
+Chunkify_verilog::Chunkify_verilog(std::string_view _path, bool _incremental_mode, Chunk_index *_index)
+    : Chunkify(_path, _incremental_mode, _index) {
   library = Graph_library::instance(path);
-
-  chunk_dir = absl::StrCat(path, "/liveparse");
-  if (access(chunk_dir.c_str(), F_OK) != 0) {
-    std::string spath(path);
-    int         err = mkdir(spath.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-    if (err < 0 && errno != EEXIST) {
-      throw scan_error(*this, "could not create {} directory", path);
-    }
-
-    err = mkdir(chunk_dir.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
-    if (err < 0 && errno != EEXIST) {
-      throw scan_error(*this, "could not create {}/{} directory", path, "liveparse");
-    }
-  }
-}
-
-int Chunkify_verilog::open_write_file(std::string_view fname) const {
-  std::string f(fname);
-
-  int fd = open(f.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
-  if (fd < 0) {
-    throw scan_error(*this, "could not open {} for output", fname);
-  }
-
-  return fd;
-}
-
-bool Chunkify_verilog::is_same_file(std::string_view module_name, std::string_view text1, std::string_view text2) const {
-  I(incremental_mode);
-
-  const std::string elab_filename = absl::StrCat(chunk_dir, "/", module_name, ".v");
-  int               fd            = open(elab_filename.c_str(), O_RDONLY);
-  if (fd < 0) {
-    return false;
-  }
-
-  struct stat sb;
-  fstat(fd, &sb);
-
-  if (static_cast<size_t>(sb.st_size) != (text1.size() + text2.size())) {
-    close(fd);
-    return false;
-  }
-
-  char *memblock2 = (char *)mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);  // Read only mmap
-  if (memblock2 == MAP_FAILED) {
-    Inou_liveparse::error(std::format("mmap failed?? for {}", module_name));
-    close(fd);
-    return false;
-  }
-
-  int n = memcmp(memblock2, text1.data(), text1.size());
-  if (n) {
-    close(fd);
-    munmap(memblock2, sb.st_size);
-  }
-  n = memcmp(&memblock2[text1.size()], text2.data(), text2.size());
-  close(fd);
-  munmap(memblock2, sb.st_size);
-
-  return n == 0;  // same file if n==0
-}
-
-void Chunkify_verilog::write_file(std::string_view fname, std::string_view text1, std::string_view text2) const {
-  int fd = open_write_file(fname);
-  if (fd < 0) {
-    return;
-  }
-
-  size_t sz = write(fd, text1.data(), text1.size());
-  if (sz != text1.size()) {
-    throw scan_error(*this, "could not write contents to file err:{} vs {}", sz, text1.size());
-  }
-  sz = write(fd, text2.data(), text2.size());
-  if (sz != text2.size()) {
-    throw scan_error(*this, "could not write contents to file err:{} vs {}", sz, text2.size());
-  }
-
-  close(fd);
-}
-
-void Chunkify_verilog::write_file(std::string_view fname, std::string_view text) const {
-  auto fd = open_write_file(fname);
-  if (fd < 0) {
-    return;
-  }
-
-  size_t sz2 = write(fd, text.data(), text.size());
-  if (sz2 != text.size()) {
-    throw scan_error(*this, "could not write contents to file err:{} vs {}", sz2, text.size());
-  }
-
-  close(fd);
 }
 
 void Chunkify_verilog::add_io(Sub_node *sub, bool input, std::string_view io_name, Port_ID pos) {
@@ -150,6 +46,10 @@ void Chunkify_verilog::elaborate() {
   std::string module_name;
   Port_ID     module_io_pos = 1;
 
+  // Normalized token hashes (whitespace and comments do not change them)
+  uint64_t not_in_module_hash = 0;
+  uint64_t in_module_hash     = 0;
+
   // This has to be cut&pasted to each file
   std::string not_in_module_text;
 
@@ -171,7 +71,7 @@ void Chunkify_verilog::elaborate() {
         if (in_module) {
           throw scan_error(*this, "unexpected nested modules");
         }
-        format_append(in_module_text);
+        token_append(in_module_text, in_module_hash);
         scan_next();
         absl::StrAppend(&module_name, scan_text());
         module_io_pos = 1;
@@ -226,17 +126,16 @@ void Chunkify_verilog::elaborate() {
     }
 
     if (!in_module && !endmodule_found) {
-      format_append(not_in_module_text);
+      token_append(not_in_module_text, not_in_module_hash);
     } else {
-      format_append(in_module_text);
+      token_append(in_module_text, in_module_hash);
       if (endmodule_found) {
-        bool same = incremental_mode && is_same_file(module_name, not_in_module_text, in_module_text);
-        if (!same) {
-          auto outfile = absl::StrCat(chunk_dir, "/", module_name, ".v");
-          write_file(outfile, not_in_module_text, in_module_text);
-          generated_files.emplace_back(outfile);
-        }
-        module_name = "";
+        // The text outside modules (defines, includes...) is copied to each chunk, so it is part of the hash
+        uint64_t hashes[2] = {not_in_module_hash, in_module_hash};
+        emit_chunk(module_name, ".v", lh::woothash64(hashes, sizeof(hashes)), not_in_module_text, in_module_text);
+
+        module_name    = "";
+        in_module_hash = 0;
         in_module_text.clear();
       }
     }
@@ -1,24 +1,17 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include "elab_scanner.hpp"
+#include "chunkify.hpp"
 #include "lgedge.hpp"
 
 class Graph_library;
 class Sub_node;
 
-class Chunkify_verilog : public Elab_scanner {
+class Chunkify_verilog : public Chunkify {
 private:
   static inline int trace_module_cnt = 0;
 
 protected:
-  std::string path;
-  std::string chunk_dir;
-
-  bool incremental_mode;
-
-  std::vector<std::string> generated_files;
-
   Graph_library *library;
 
   void format_append(std::string &text) const {
@@ -40,18 +33,14 @@ protected:
     absl::StrAppend(&text, txt);
   }
 
-  int open_write_file(std::string_view filename) const;
-
-  bool is_same_file(std::string_view filename, std::string_view text1, std::string_view text2) const;
-
-  void write_file(std::string_view filename, std::string_view text1, std::string_view text2) const;
-  void write_file(std::string_view filename, std::string_view text) const;
+  void token_append(std::string &text, uint64_t &hash) const {
+    format_append(text);
+    hash = Chunk_index::hash_token(hash, token_list[scanner_pos]);
+  }
 
   void add_io(Sub_node *sub, bool input, std::string_view io_name, Port_ID pos);
 
 public:
-  Chunkify_verilog(std::string_view path, bool incremental_mode);
+  Chunkify_verilog(std::string_view path, bool incremental_mode, Chunk_index *index = nullptr);
   void elaborate() final;
-
-  const std::vector<std::string> &get_generated_files() const { return generated_files; }
 };
@@ -1,8 +1,11 @@
 
 #include "chunkify_verilog.hpp"
 
+#include <fstream>
 #include <iostream>
 
+#include "chunkify_pyrope.hpp"
+
 #include "file_utils.hpp"
 #include "gtest/gtest.h"
 
@@ -78,6 +81,80 @@ TEST_F(VTest1, interface) {
   EXPECT_EQ(v[0], "tdelta/liveparse/test1_moda.v");
 }
 
+TEST_F(VTest1, whitespace_only) {
+  file_utils::clean_dir("tws");
+
+  std::string test1_verilog
+      = "`define FOO 1\n"
+        "module ws_a(input a, output b); assign b = a; endmodule\n"
+        "module ws_b(input a, output b); assign b = ~a; endmodule\n";
+
+  {
+    Chunkify_verilog chunker("tws", true);
+    chunker.parse_inline(test1_verilog);
+    EXPECT_EQ(chunker.get_generated_files().size(), 2);
+  }
+  EXPECT_EQ(access("tws/liveparse/chunk.idx", R_OK), F_OK);
+
+  // Only spacing and comments change, index reloaded from disk
+  std::string test2_verilog
+      = "`define   FOO 1 // foo\n"
+        "module ws_a (\n  input a,\n  output b\n);\n  assign b = a;\nendmodule\n"
+        "/* nothing */ module ws_b(input a, output b);\n\tassign b = ~a;\nendmodule\n";
+  {
+    Chunkify_verilog chunker("tws", true);
+    chunker.parse_inline(test2_verilog);
+    EXPECT_TRUE(chunker.get_generated_files().empty());
+  }
+
+  // A change outside the modules is copied to every chunk
+  std::string test3_verilog = "`define FOO 2\n" + test1_verilog.substr(test1_verilog.find('\n') + 1);
+  {
+    Chunkify_verilog chunker("tws", true);
+    chunker.parse_inline(test3_verilog);
+    EXPECT_EQ(chunker.get_generated_files().size(), 2);
+  }
+}
+
+TEST_F(VTest1, pyrope) {
+  file_utils::clean_dir("tprp");
+
+  Chunk_index index("tprp/liveparse");
+
+  Chunkify_pyrope chunker("tprp", true, &index);
+  chunker.parse_inline("a = 1 // comment\nb = a + 2\n");
+  auto v1 = chunker.get_generated_files();
+  ASSERT_EQ(v1.size(), 1);
+  EXPECT_EQ(v1[0], "tprp/liveparse/inline.prp");
+
+  chunker.parse_inline("a  =  1\n\nb = a+2 /* other comment */\n");
+  EXPECT_TRUE(chunker.get_generated_files().empty());
+
+  chunker.parse_inline("a = 1\nb = a + 3\n");
+  EXPECT_EQ(chunker.get_generated_files().size(), 1);
+}
+
+TEST_F(VTest1, failed_write) {
+  file_utils::clean_dir("tfail");
+
+  Chunk_index index("tfail/liveparse");
+
+  Chunkify_pyrope chunker("tfail", true, &index);
+  chunker.parse_inline("a = 1\n");
+  ASSERT_EQ(chunker.get_generated_files().size(), 1);
+
+  // A directory in place of the chunk makes the write fail
+  unlink("tfail/liveparse/inline.prp");
+  mkdir("tfail/liveparse/inline.prp", 0755);
+  EXPECT_THROW(chunker.parse_inline("a = 2\n"), std::runtime_error);
+
+  // The stale chunk must not be taken as current
+  rmdir("tfail/liveparse/inline.prp");
+  std::ofstream("tfail/liveparse/inline.prp") << "a = 1\n";
+  chunker.parse_inline("a = 2\n");
+  EXPECT_EQ(chunker.get_generated_files().size(), 1);
+}
+
 void test_throw() {
   std::string test2_verilog = "";
 
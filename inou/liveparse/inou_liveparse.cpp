@@ -2,9 +2,15 @@
 
 #include "inou_liveparse.hpp"
 
+#include <mutex>
+#include <vector>
+
 #include "absl/strings/str_split.h"
+#include "chunkify_pyrope.hpp"
 #include "chunkify_verilog.hpp"
+#include "graph_library.hpp"
 #include "str_tools.hpp"
+#include "thread_pool.hpp"
 
 void setup_inou_liveparse() { Inou_liveparse::setup(); }
 
@@ -28,26 +34,63 @@ void Inou_liveparse::do_tolg(Eprp_var &var) {
     }
   }
 
-  Chunkify_verilog chunker_v(path, incremental_mode);
-
+  std::vector<std::string> fnames;
   for (const auto &f : absl::StrSplit(files, ',')) {
-    if (str_tools::ends_with(f, ".v") || str_tools::ends_with(f, ".sv")) {
-      chunker_v.parse_file(f);
-    } else if (str_tools::ends_with(f, ".prp")) {
-      error("inou.liveparse chunkify Pyrope not implemented yet {}", f);
-      return;
-    } else {
+    if (!str_tools::ends_with(f, ".v") && !str_tools::ends_with(f, ".sv") && !str_tools::ends_with(f, ".prp")) {
       error("inou.liveparse chunkify unrecognized file format {}", f);
       return;
     }
+    fnames.emplace_back(f);
+  }
+
+  [[maybe_unused]] auto *library = Graph_library::instance(path);  // create it before the parallel chunkers
+
+  Chunk_index index(absl::StrCat(path, "/liveparse"));
+
+  // Each file is scanned and chunked in parallel. Only the chunks whose
+  // content hash changed are forwarded.
+  std::vector<std::vector<std::string>> generated(fnames.size());
+  std::mutex                            error_mutex;
+  std::string                           error_msg;
+
+  for (size_t i = 0; i < fnames.size(); ++i) {
+    thread_pool.add([this, i, incremental_mode, &fnames, &index, &generated, &error_mutex, &error_msg]() -> void {
+      const auto &fname = fnames[i];
+      try {
+        if (str_tools::ends_with(fname, ".prp")) {
+          Chunkify_pyrope chunker(path, incremental_mode, &index);
+          chunker.parse_file(fname);
+          generated[i] = chunker.get_generated_files();
+        } else {
+          Chunkify_verilog chunker(path, incremental_mode, &index);
+          chunker.parse_file(fname);
+          generated[i] = chunker.get_generated_files();
+        }
+      } catch (const std::runtime_error &e) {
+        const std::lock_guard<std::mutex> guard(error_mutex);
+        if (error_msg.empty()) {
+          error_msg = absl::StrCat(fname, ": ", e.what());
+        }
+      }
+    });
+  }
+  thread_pool.wait_all();
+
+  index.save();
+
+  if (!error_msg.empty()) {
+    error("inou.liveparse {}", error_msg);
+    return;
   }
 
   std::string files2;
-  for (const auto &f : chunker_v.get_generated_files()) {
-    if (files2.empty()) {
-      files2 = f;
-    } else {
-      absl::StrAppend(&files2, ",", f);
+  for (const auto &gen : generated) {
+    for (const auto &f : gen) {
+      if (files2.empty()) {
+        files2 = f;
+      } else {
+        absl::StrAppend(&files2, ",", f);
+      }
     }
   }
 
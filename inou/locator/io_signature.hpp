@@ -0,0 +1,93 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "node_pin.hpp"
+
+// IO set of a map_of_sets entry with the pins interned to dense ids. The sorted ids give exact intersections (the
+// matching weights depend on the exact counts), the 256 bit fingerprint (bit id%256) rejects disjoint sets with a few
+// popcounts before any merge.
+class Io_signature {
+public:
+  static constexpr size_t fp_words = 4;
+
+  std::array<uint64_t, fp_words> fp{};
+  std::vector<uint32_t>          ids;  // sorted
+
+  [[nodiscard]] size_t size() const { return ids.size(); }
+  [[nodiscard]] bool   empty() const { return ids.empty(); }
+
+  [[nodiscard]] bool may_intersect(const Io_signature &other) const {
+    uint64_t common = 0;
+    for (size_t i = 0; i < fp_words; ++i) {
+      common |= fp[i] & other.fp[i];
+    }
+    return std::popcount(common) != 0;
+  }
+
+  [[nodiscard]] size_t intersection_size(const Io_signature &other) const {
+    if (!may_intersect(other)) {
+      return 0;
+    }
+    size_t n = 0;
+    auto   a = ids.begin();
+    auto   b = other.ids.begin();
+    while (a != ids.end() && b != other.ids.end()) {
+      if (*a < *b) {
+        ++a;
+      } else if (*b < *a) {
+        ++b;
+      } else {
+        ++n;
+        ++a;
+        ++b;
+      }
+    }
+    return n;
+  }
+
+  [[nodiscard]] bool intersects(const Io_signature &other) const {
+    if (!may_intersect(other)) {
+      return false;
+    }
+    auto a = ids.begin();
+    auto b = other.ids.begin();
+    while (a != ids.end() && b != other.ids.end()) {
+      if (*a < *b) {
+        ++a;
+      } else if (*b < *a) {
+        ++b;
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+// Dense id per IO pin. Ids are never reused, so signatures from different calls can be compared.
+class Io_signature_table {
+public:
+  [[nodiscard]] Io_signature get(const absl::flat_hash_set<Node_pin::Compact_flat> &set) {
+    Io_signature sig;
+    sig.ids.reserve(set.size());
+    for (const auto &pin_cf : set) {
+      const auto id = pin2id.try_emplace(pin_cf, static_cast<uint32_t>(pin2id.size())).first->second;
+      sig.ids.emplace_back(id);
+      sig.fp[(id >> 6) % Io_signature::fp_words] |= uint64_t{1} << (id & 63);
+    }
+    std::sort(sig.ids.begin(), sig.ids.end());
+    return sig;
+  }
+
+private:
+  absl::flat_hash_map<Node_pin::Compact_flat, uint32_t> pin2id;
+};
@@ -11,6 +11,7 @@
 
 #include "lgedgeiter.hpp"
 #include "perf_tracing.hpp"
+#include "thread_pool.hpp"
 
 int                VISITED_COLORED = 401;
 static Pass_plugin sample("traverse_lg", Traverse_lg::setup);
@@ -582,16 +583,23 @@ void Traverse_lg::make_io_maps(Lgraph* lg, map_of_sets& inp_map_of_sets, map_of_
   print_everything();
 #endif
 
-  /*propagate sets. stop at sequential/IO... (_last)*/
-  traverse_order.clear();
-  fwd_traversal_for_inp_map(lg, inp_map_of_sets, is_orig_lg);
+  collect_traverse_order(lg);
+
+  /*fwd: propagate sets. stop at sequential/IO... (_last)
+   *bwd: propagate sets. stop at sequential/IO/const... (_last & _first). walks traverse_order in reverse.
+   *each one only writes its own map, so both run at the same time (one after the other with the debug prints)*/
+#if defined(BASIC_DBG) || defined(EXTENSIVE_DBG)
+  fwd_traversal_for_inp_map(inp_map_of_sets, is_orig_lg);
 #ifdef BASIC_DBG
   std::print("9.1 Printing after fwd traversal! (with {} origLG) ", is_orig_lg);
   print_everything();
 #endif
-
-  /*propagate sets. stop at sequential/IO/const... (_last & _first). this is like backward traversal*/
   bwd_traversal_for_out_map(out_map_of_sets, is_orig_lg);
+#else
+  thread_pool.add([this, &inp_map_of_sets, is_orig_lg]() { fwd_traversal_for_inp_map(inp_map_of_sets, is_orig_lg); });
+  bwd_traversal_for_out_map(out_map_of_sets, is_orig_lg);
+  thread_pool.wait_all();
+#endif
 
   if (!is_orig_lg) {
     /* during the traversals, the nodes which were matched getts re-inserted in MoS(s).
@@ -950,97 +958,108 @@ void Traverse_lg::fast_pass_for_inputs(Lgraph* lg, map_of_sets& inp_map_of_sets,
   }
 }
 
-void Traverse_lg::fwd_traversal_for_inp_map(Lgraph* lg, map_of_sets& inp_map_of_sets, bool is_orig_lg) {
-#ifdef BASIC_DBG
-  std::cout << "&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&\n";
-  std::print("\t\tis_orig_lg: {}\n", is_orig_lg);
-#endif
+/*driver pins in fwd order (consts skipped), with the loop stop check done once for both traversals*/
+void Traverse_lg::collect_traverse_order(Lgraph* lg) {
+  traverse_order.clear();
+  traverse_loop_stop.clear();
   for (const auto& node : lg->forward(true)) {
     if (node.is_type_const() || (node.is_type_sub() && node.get_type_sub_node().get_name() == "__fir_const")) {
       continue;
     }
+    const bool node_is_stop = node.is_type_loop_last() || node.is_type_loop_first();
     for (const auto node_dpins : node.out_connected_pins()) {
       traverse_order.emplace_back(node_dpins);
-      const auto node_dpin_cf = node_dpins.get_compact_flat();
+      traverse_loop_stop.emplace_back(node_is_stop || mark_loop_stop.contains(node_dpins.get_compact_flat()));
+    }
+  }
+}
+
+void Traverse_lg::fwd_traversal_for_inp_map(map_of_sets& inp_map_of_sets, bool is_orig_lg) {
 #ifdef BASIC_DBG
-      std::print("node obtained from fwd traversal: n{},{} \n",
-                 node.get_nid(),
-                 node_dpins.has_name() ? node_dpins.get_name() : std::to_string(node_dpins.get_pid()));
+  std::cout << "&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&\n";
+  std::print("\t\tis_orig_lg: {}\n", is_orig_lg);
 #endif
-      bool is_loop_stop
-          = node.is_type_loop_last() || node.is_type_loop_first() || (mark_loop_stop.find(node_dpin_cf) != mark_loop_stop.end());
-
+  for (size_t pos = 0; pos < traverse_order.size(); ++pos) {
+    const auto& node_dpins   = traverse_order[pos];
+    const auto  node         = node_dpins.get_node();
+    const auto  node_dpin_cf = node_dpins.get_compact_flat();
 #ifdef BASIC_DBG
-      std::print("\t\tnode is loop stop: LL?{}, LF?{}, MLS?{} \n",
-                 node.is_type_loop_last(),
-                 node.is_type_loop_first(),
-                 (mark_loop_stop.find(node_dpin_cf) != mark_loop_stop.end()));
+    std::print("node obtained from fwd traversal: n{},{} \n",
+               node.get_nid(),
+               node_dpins.has_name() ? node_dpins.get_name() : std::to_string(node_dpins.get_pid()));
 #endif
-      const absl::flat_hash_set<Node_pin::Compact_flat>* self_set = nullptr;
-      auto                                               it       = inp_map_of_sets.find(node_dpin_cf);
-      if (it != inp_map_of_sets.end()) {
-        self_set = &it->second;
+    const bool is_loop_stop = traverse_loop_stop[pos];
+
 #ifdef BASIC_DBG
-        std::cout << "\tnode present in inp_map_of_sets. It's SS:";
-        print_set(*self_set);
-        std::cout << "\n";
+    std::print("\t\tnode is loop stop: LL?{}, LF?{}, MLS?{} \n",
+               node.is_type_loop_last(),
+               node.is_type_loop_first(),
+               (mark_loop_stop.find(node_dpin_cf) != mark_loop_stop.end()));
 #endif
-      }
+    const absl::flat_hash_set<Node_pin::Compact_flat>* self_set = nullptr;
+    auto                                               it       = inp_map_of_sets.find(node_dpin_cf);
+    if (it != inp_map_of_sets.end()) {
+      self_set = &it->second;
 #ifdef BASIC_DBG
-      else {
-        std::cout << "\tnode NOT present in inp_map_of_sets already.\n";
-      }
+      std::cout << "\tnode present in inp_map_of_sets. It's SS:";
+      print_set(*self_set);
+      std::cout << "\n";
 #endif
-      for (auto e : node.out_edges()) {
-        if (e.sink.get_node().is_type_loop_first() /*need not keep outputs of const/graphIO in in_map_of_sets*/
-            /*|| e.sink.get_node().is_type_loop_last() is_type_loop_last processed in previous fast pass*/) {
+    }
 #ifdef BASIC_DBG
-          std::cout << "\tChild node is loop_first. continuing!\n";
+    else {
+      std::cout << "\tnode NOT present in inp_map_of_sets already.\n";
+    }
 #endif
-          continue;
-        }
-        // if ( is_orig_lg && !e.sink.get_node().has_loc() ) {
-        //   /* In original LG, if a node does NOT have LoC, then the node should not be kept in map of sets.*/
-        //   continue;
-        // }
-        for (const auto out_cfs : e.sink.get_node().out_connected_pins()) {
+    for (auto e : node.out_edges()) {
+      if (e.sink.get_node().is_type_loop_first() /*need not keep outputs of const/graphIO in in_map_of_sets*/
+          /*|| e.sink.get_node().is_type_loop_last() is_type_loop_last processed in previous fast pass*/) {
 #ifdef BASIC_DBG
-          std::print("\tChild node's dpin:\t\t {}(n{})\n",
-                     out_cfs.has_name() ? out_cfs.get_name() : std::to_string(out_cfs.get_pid()),
-                     out_cfs.get_node().get_nid());
+        std::cout << "\tChild node is loop_first. continuing!\n";
 #endif
-          auto out_cf = out_cfs.get_compact_flat();
-          if (is_loop_stop) {
-            if (!is_orig_lg && !(get_matching_map_val(node_dpin_cf)).empty()) {
-              auto match_val = get_matching_map_val(node_dpin_cf);
+        continue;
+      }
+      // if ( is_orig_lg && !e.sink.get_node().has_loc() ) {
+      //   /* In original LG, if a node does NOT have LoC, then the node should not be kept in map of sets.*/
+      //   continue;
+      // }
+      for (const auto out_cfs : e.sink.get_node().out_connected_pins()) {
 #ifdef BASIC_DBG
-              std::print("\t\t\tmatch_val is the I/P! K[n{}]::V[-match_val_value-]\n", out_cfs.get_node().get_nid());
+        std::print("\tChild node's dpin:\t\t {}(n{})\n",
+                   out_cfs.has_name() ? out_cfs.get_name() : std::to_string(out_cfs.get_pid()),
+                   out_cfs.get_node().get_nid());
 #endif
-              inp_map_of_sets[out_cf].insert(match_val.begin(), match_val.end());  // resolution
-              /*} else if (self_set) { //this is a trial for accuracy (inserting the inputs of unresolved loop_stop instead of the
-                l9oops top itself) inp_map_of_sets[out_cf].insert(self_set->begin(), self_set->end()); #ifdef EXTENSIVE_DBG
-                  std::print("\t\t\tSS is the I/P! K[n{}]::V[ss val]\n", out_cfs.get_node().get_nid());
-                #endif
-              */
-            } else {
-              inp_map_of_sets[out_cf].insert(node_dpin_cf);
+        auto out_cf = out_cfs.get_compact_flat();
+        if (is_loop_stop) {
+          if (!is_orig_lg && !(get_matching_map_val(node_dpin_cf)).empty()) {
+            auto match_val = get_matching_map_val(node_dpin_cf);
 #ifdef BASIC_DBG
-              std::print("\t\t\tnode itself is the I/P! K[n{}]::V[n{}]\n", out_cfs.get_node().get_nid(), node.get_nid());
+            std::print("\t\t\tmatch_val is the I/P! K[n{}]::V[-match_val_value-]\n", out_cfs.get_node().get_nid());
 #endif
-            }
+            inp_map_of_sets[out_cf].insert(match_val.begin(), match_val.end());  // resolution
+            /*} else if (self_set) { //this is a trial for accuracy (inserting the inputs of unresolved loop_stop instead of the
+              l9oops top itself) inp_map_of_sets[out_cf].insert(self_set->begin(), self_set->end()); #ifdef EXTENSIVE_DBG
+                std::print("\t\t\tSS is the I/P! K[n{}]::V[ss val]\n", out_cfs.get_node().get_nid());
+              #endif
+            */
           } else {
-            if (self_set) {
-              inp_map_of_sets[out_cf].insert(self_set->begin(), self_set->end());
+            inp_map_of_sets[out_cf].insert(node_dpin_cf);
 #ifdef BASIC_DBG
-              std::print("\t\t\tSS is the I/P! K[n{}]::V[ss val]\n", out_cfs.get_node().get_nid());
+            std::print("\t\t\tnode itself is the I/P! K[n{}]::V[n{}]\n", out_cfs.get_node().get_nid(), node.get_nid());
 #endif
-            }
+          }
+        } else {
+          if (self_set) {
+            inp_map_of_sets[out_cf].insert(self_set->begin(), self_set->end());
 #ifdef BASIC_DBG
-            else {
-              std::cout << "\tNot inserting anyhting in inp_map_of_sets\n";
-            }
+            std::print("\t\t\tSS is the I/P! K[n{}]::V[ss val]\n", out_cfs.get_node().get_nid());
 #endif
           }
+#ifdef BASIC_DBG
+          else {
+            std::cout << "\tNot inserting anyhting in inp_map_of_sets\n";
+          }
+#endif
         }
       }
     }
@@ -1056,10 +1075,9 @@ void Traverse_lg::bwd_traversal_for_out_map(map_of_sets& out_map_of_sets, bool i
   std::print("\t\tis_orig_lg: {}\n", is_orig_lg);
 #endif
   absl::flat_hash_set<Node::Compact_flat> traversed_nodes;
-  for (std::vector<Node_pin>::const_reverse_iterator rit = traverse_order.rbegin(); rit != traverse_order.rend();
-       ++rit) {  // const iter for const vec
-    auto node_dpin = *rit;
-    auto node      = node_dpin.get_node();
+  for (auto pos = traverse_order.size(); pos-- > 0;) {
+    const auto& node_dpin = traverse_order[pos];
+    auto        node      = node_dpin.get_node();
     if (traversed_nodes.find(node.get_compact_flat()) != traversed_nodes.end()) {
       continue;  // we have processed for this node's inputs
     }
@@ -1067,8 +1085,7 @@ void Traverse_lg::bwd_traversal_for_out_map(map_of_sets& out_map_of_sets, bool i
 #ifdef BASIC_DBG
     std::print("node obtained from traverse_order: n{},{} \n", node.get_nid(), node_dpin.get_pid());
 #endif
-    bool is_loop_stop = node.is_type_loop_last() || node.is_type_loop_first()
-                        || (mark_loop_stop.find(node_dpin.get_compact_flat()) != mark_loop_stop.end());
+    const bool is_loop_stop = traverse_loop_stop[pos];
 
     const absl::flat_hash_set<Node_pin::Compact_flat>* self_set = nullptr;
     auto                                               it       = out_map_of_sets.find(node_dpin.get_compact_flat());
@@ -1649,6 +1666,16 @@ float Traverse_lg::get_matching_weight(const absl::flat_hash_set<Node_pin::Compa
   return 5 * (matches / mismatches);
 }
 
+/* same weight as above, on the interned sets*/
+float Traverse_lg::get_matching_weight(const Io_signature& synth_sig, const Io_signature& orig_sig) const {
+  const int matches    = synth_sig.intersection_size(orig_sig);
+  float     mismatches = synth_sig.size() - matches;
+  if (mismatches <= 0.0) {
+    mismatches = 1;
+  }
+  return 5 * (matches / mismatches);
+}
+
 Traverse_lg::inverted_map_arr Traverse_lg::convert_set_to_sorted_array(
     const absl::flat_hash_set<Node_pin::Compact_flat>& np_set) const {
   inverted_map_arr inv_arr;
@@ -3284,11 +3311,9 @@ void Traverse_lg::weighted_match_LoopLastOnly(int perc_resolved) {
      * I want those flop nodes only which has atleast 1 input matching with this synth_set.
      * Additionally, atleast 1 output should also match!
      */
-    const auto&                                 synth_out_iter = out_map_of_sets_synth.find(synth_key);
-    absl::flat_hash_set<Node_pin::Compact_flat> synth_out_set;
-    if (synth_out_iter != out_map_of_sets_synth.end()) {
-      synth_out_set = synth_out_iter->second;
-    }
+    static const absl::flat_hash_set<Node_pin::Compact_flat> no_out_set;
+    const auto  synth_out_iter = out_map_of_sets_synth.find(synth_key);
+    const auto& synth_out_set  = synth_out_iter != out_map_of_sets_synth.end() ? synth_out_iter->second : no_out_set;
     absl::flat_hash_set<Node_pin::Compact_flat> relevant_orig_nodes;
     for (const auto& synth_in : synth_set) {
       auto orig_entry_it = inp_map_of_node_sets_orig.find(synth_in);
@@ -3296,7 +3321,7 @@ void Traverse_lg::weighted_match_LoopLastOnly(int perc_resolved) {
 #ifdef BASIC_DBG
         std::cout << "\t\t\t Orig nodes with common INPUT found. \n";
 #endif
-        auto inp_intersecting_orig_nodes = orig_entry_it->second;  // set of orig nodes
+        const auto& inp_intersecting_orig_nodes = orig_entry_it->second;  // set of orig nodes
 
         if (perc_resolved == -1) {
           relevant_orig_nodes.insert(inp_intersecting_orig_nodes.begin(), inp_intersecting_orig_nodes.end());
@@ -3349,9 +3374,9 @@ void Traverse_lg::weighted_match_LoopLastOnly(int perc_resolved) {
                inp_map_of_sets_orig.size());
 #endif
     for (const auto& relevant_orig_node : relevant_orig_nodes) {
-      auto orig_entry = inp_map_of_sets_orig.find(relevant_orig_node);
-      auto orig_key   = orig_entry->first;
-      auto orig_set   = orig_entry->second;
+      const auto  orig_entry = inp_map_of_sets_orig.find(relevant_orig_node);
+      const auto& orig_key   = orig_entry->first;
+      const auto& orig_set   = orig_entry->second;
 // /*if(loop_last_only):for only those keys that are is_type_loop_last*/
 // auto node_o = Node_pin("lgdb", orig_key).get_node();
 // if ( !node_o.is_type_loop_last()  ) {
@@ -3434,6 +3459,8 @@ void Traverse_lg::weighted_match_LoopLastOnly(int perc_resolved) {
   std::print("num_of_matches: {}, IN_FUNC: weighted_match_LoopLastOnly \n", net_to_orig_pin_match_map.size() - num_of_matches);
 }
 
+static constexpr size_t weighted_match_chunk = 64;  // crit entries per thread_pool task
+
 void Traverse_lg::weighted_match() {  // only for the crit_node_entries remaining!
 #ifdef BASIC_DBG
   std::cout << "In weighted_match:\n\n";
@@ -3442,40 +3469,67 @@ void Traverse_lg::weighted_match() {  // only for the crit_node_entries remainin
   std::cout << "SynthNode, SrcNode, OUTmatches, OUTmismatches, INmatches, INmismatches, crossovers, loops, match\n";
 #endif
   const auto num_of_matches = net_to_orig_pin_match_map.size();
+
+  /* orig entries that can be matched, with their sets as signatures. Done once instead of once per crit entry.*/
+  struct Orig_entry {
+    Node_pin::Compact_flat key;
+    Io_signature           inp;
+    Io_signature           out;
+    bool                   has_out;
+  };
+  std::vector<Orig_entry> orig_entries;
+  for (const auto& [orig_key, orig_set] : inp_map_of_sets_orig) {
+    if (unwanted_orig_NPs.contains(orig_key)) {
+      continue;
+    }
+    // #ifndef FULL_RUN_FOR_EVAL
+    if (!Node_pin("lgdb", orig_key).get_node().has_loc()) {
+      continue;
+    }
+    // #endif
+    auto       out_it  = out_map_of_sets_orig.find(orig_key);
+    const bool has_out = out_it != out_map_of_sets_orig.end();
+    orig_entries.emplace_back(orig_key, io_ids.get(orig_set), has_out ? io_ids.get(out_it->second) : Io_signature(), has_out);
+  }
+
+  struct Synth_entry {
+    Node_pin::Compact_flat              key;
+    Io_signature                        inp;
+    Io_signature                        out;
+    bool                                has_out;
+    float                               match_prev = 0.0;
+    int                                 crossovers = 0;
+    std::vector<Node_pin::Compact_flat> matched_node_pins;
+  };
+  std::vector<Synth_entry> synth_entries;
   for (const auto& synth_key : crit_node_set) {
+    const auto inp_it = inp_map_of_sets_synth.find(synth_key);
+    I(inp_it != inp_map_of_sets_synth.end(), "\n synth_key NOT in inp_Map_of_sets_synth!! check!\n");
+    auto       out_it  = out_map_of_sets_synth.find(synth_key);
+    const bool has_out = out_it != out_map_of_sets_synth.end();
+    synth_entries.emplace_back(synth_key,
+                               inp_it != inp_map_of_sets_synth.end() ? io_ids.get(inp_it->second) : Io_signature(),
+                               has_out ? io_ids.get(out_it->second) : Io_signature(),
+                               has_out);
+  }
+
+  /* best orig entries for one synth entry. Only reads the signatures, so the entries are independent.*/
+  auto match_entry = [this, &orig_entries](Synth_entry& synth) {
 #ifdef BASIC_DBG
-    auto synth_key_pin = Node_pin("lgdb", synth_key);
+    auto synth_key_pin = Node_pin("lgdb", synth.key);
     std::print("\nsynth_key_pin name:{}, pid:{}\n",
                synth_key_pin.has_name() ? synth_key_pin.get_name() : ("p" + std::to_string(synth_key_pin.get_pid())),
                std::to_string(synth_key_pin.get_pid()));
-#endif
-    I(inp_map_of_sets_synth.find(synth_key) != inp_map_of_sets_synth.end(), "\n synth_key NOT in inp_Map_of_sets_synth!! check!\n");
-    const auto& synth_set = inp_map_of_sets_synth[synth_key];
-#ifdef BASIC_DBG
     std::cout << "|||||||| synth_set|||||||\n";
-    print_set(synth_set);
+    print_set(inp_map_of_sets_synth[synth.key]);
     std::cout << "\n||||---||||\n";
 #endif
+    // some common point in synth in set and out set means loop! we don't want to bother any such key.
+    const bool loop_detected = synth.has_out && synth.out.intersects(synth.inp);
 
-    const auto synth_out_set = out_map_of_sets_synth.find(synth_key);
-    bool loop_detected = false;  // some common point in synth in set and out set means loop! we don't want to bother any such key.
-    if (synth_out_set != out_map_of_sets_synth.end()) {
-      loop_detected = common_element_present(synth_out_set->second, synth_set);
-    }
-
-    float                                       match_prev = 0.0;
-    absl::flat_hash_set<Node_pin::Compact_flat> matched_node_pins;
-    for (const auto& [orig_key, orig_set] : inp_map_of_sets_orig) {
-      if (unwanted_orig_NPs.contains(orig_key)) {
-        continue;
-      }
-      // #ifndef FULL_RUN_FOR_EVAL
-      const auto np_o = Node_pin("lgdb", orig_key);
-      if (!((np_o.get_node()).has_loc())) {
-        continue;
-      }
-// #endif
+    for (const auto& orig : orig_entries) {
 #ifdef BASIC_DBG
+      const auto np_o = Node_pin("lgdb", orig.key);
       std::print("\t\t\t matching with: {}, n{} ({})\n",
                  np_o.has_name() ? np_o.get_name() : ("n" + std::to_string(np_o.get_node().get_nid())),
                  np_o.get_node().get_nid(),
@@ -3483,20 +3537,18 @@ void Traverse_lg::weighted_match() {  // only for the crit_node_entries remainin
 #endif
 
 #ifdef FULL_RUN_FOR_EVAL_TESTING
-      const auto& synth_node      = Node_pin("lgdb", synth_key).get_node();
-      const auto& orig_node       = Node_pin("lgdb", orig_key).get_node();
+      const auto& synth_node      = Node_pin("lgdb", synth.key).get_node();
+      const auto& orig_node       = Node_pin("lgdb", orig.key).get_node();
       const auto& synth_node_name = synth_node.has_name() ? synth_node.get_name() : "N.A";
       const auto& orig_node_name  = orig_node.has_name() ? orig_node.get_name() : "N.A";
       std::print("{}, {}, ", synth_node_name, orig_node_name);
 #endif
       float match_curr = 0.0;
       auto  out_match  = 0.0;
-      if (synth_out_set != out_map_of_sets_synth.end()
-          && out_map_of_sets_orig.find(orig_key) != out_map_of_sets_orig.end()) {  // both outs are present
-        out_match = get_matching_weight(out_map_of_sets_synth[synth_key], out_map_of_sets_orig[orig_key]);
-      } else if (synth_out_set != out_map_of_sets_synth.end()
-                 || out_map_of_sets_orig.find(orig_key) != out_map_of_sets_orig.end()) {  // only 1 out is present
-        out_match = 0.0;                                                                  // no match at all
+      if (synth.has_out && orig.has_out) {  // both outs are present
+        out_match = get_matching_weight(synth.out, orig.out);
+      } else if (synth.has_out || orig.has_out) {  // only 1 out is present
+        out_match = 0.0;                           // no match at all
 #ifdef FULL_RUN_FOR_EVAL_TESTING
         std::cout << "0, 0, ";
 #endif
@@ -3506,14 +3558,14 @@ void Traverse_lg::weighted_match() {  // only for the crit_node_entries remainin
         std::cout << "F, 0, ";
 #endif
       }
-      const auto in_match = get_matching_weight(synth_set, orig_set);
+      const auto in_match = get_matching_weight(synth.inp, orig.inp);
       match_curr          = in_match + out_match;
 
-      if (match_curr >= match_prev) {
-        if (!loop_detected && synth_out_set != out_map_of_sets_synth.end()) {  // no loop in synth and synth-out set present
-          if (common_element_present(orig_set, synth_out_set->second)) {       // some pin of synth-out-set is in orig-in-set
+      if (match_curr >= synth.match_prev) {
+        if (!loop_detected && synth.has_out) {  // no loop in synth and synth-out set present
+          if (orig.inp.intersects(synth.out)) {  // some pin of synth-out-set is in orig-in-set
             match_curr = 0;
-            crossover_count++;
+            synth.crossovers++;
 #ifdef FULL_RUN_FOR_EVAL_TESTING
             std::cout << "Y, ";  // crossover detected
 #endif
@@ -3540,18 +3592,18 @@ void Traverse_lg::weighted_match() {  // only for the crit_node_entries remainin
       std::print("{}, ", loop_detected);
 #endif
 
-      if (match_curr > match_prev) {
-        matched_node_pins.clear();
-        matched_node_pins.insert(orig_key);
-        match_prev = match_curr;
+      if (match_curr > synth.match_prev) {
+        synth.matched_node_pins.clear();
+        synth.matched_node_pins.emplace_back(orig.key);
+        synth.match_prev = match_curr;
 #ifdef BASIC_DBG
         std::cout << "\t\t\t\t -- Found better match\n";
 #endif
 #ifdef FULL_RUN_FOR_EVAL_TESTING
         std::cout << "OverwritingPrevious \n";
 #endif
-      } else if (match_curr == match_prev) {
-        matched_node_pins.insert(orig_key);
+      } else if (match_curr == synth.match_prev) {
+        synth.matched_node_pins.emplace_back(orig.key);
 #ifdef BASIC_DBG
         std::cout << "\t\t\t\t -- Found similar match\n";
 #endif
@@ -3565,10 +3617,29 @@ void Traverse_lg::weighted_match() {  // only for the crit_node_entries remainin
       }
 #endif
     }
+  };
 
-    // std::cout << "matched node pins :\n";
-    // print_set(matched_node_pins);
-    // std::cout << "\n";
+#if defined(BASIC_DBG) || defined(FULL_RUN_FOR_EVAL_TESTING)
+  for (auto& synth : synth_entries) {  // keep the per entry prints in order
+    match_entry(synth);
+  }
+#else
+  for (size_t start = 0; start < synth_entries.size(); start += weighted_match_chunk) {
+    thread_pool.add([&synth_entries, &match_entry, start]() {
+      const auto end = std::min(synth_entries.size(), start + weighted_match_chunk);
+      for (auto i = start; i < end; ++i) {
+        match_entry(synth_entries[i]);
+      }
+    });
+  }
+  thread_pool.wait_all();
+#endif
+
+  for (const auto& synth : synth_entries) {
+    const auto& synth_key         = synth.key;
+    const auto& matched_node_pins = synth.matched_node_pins;
+    const auto  match_prev        = synth.match_prev;
+    crossover_count += synth.crossovers;
 
     if (!matched_node_pins.empty() && (match_prev > 0.00)) {
       net_to_orig_pin_match_map[synth_key].insert(matched_node_pins.begin(), matched_node_pins.end());
@@ -3610,34 +3681,35 @@ void Traverse_lg::weighted_match() {  // only for the crit_node_entries remainin
 bool Traverse_lg::set_theory_match(Traverse_lg::map_of_sets& io_map_of_sets_synth, Traverse_lg::map_of_sets& io_map_of_sets_orig) {
   bool       some_matching_done = false;
   const auto num_of_matches     = net_to_orig_pin_match_map.size();
+
+  std::vector<std::pair<Node_pin::Compact_flat, Io_signature>> orig_sigs;
+  orig_sigs.reserve(io_map_of_sets_orig.size());
+  for (const auto& [orig_key, orig_set] : io_map_of_sets_orig) {
+    orig_sigs.emplace_back(orig_key, io_ids.get(orig_set));
+  }
+
   for (auto it = io_map_of_sets_synth.begin(); it != io_map_of_sets_synth.end();) {
     unsigned long match_count    = 0;
     unsigned long mismatch_count = 0;
     const auto&   synth_key      = it->first;
     const auto&   synth_set      = it->second;
+    const auto    synth_sig      = io_ids.get(synth_set);
     some_matching_done           = false;
     absl::flat_hash_set<Node_pin::Compact_flat> matched_node_pins;
     auto                                        counter       = 0;
     auto                                        counter_total = 0;
-    for (const auto& [orig_key, orig_set] : io_map_of_sets_orig) {
+    for (const auto& [orig_key, orig_sig] : orig_sigs) {
 #ifdef BASIC_DBG
-      auto synth_key_name = Node_pin("lgdb", synth_key);
+      const auto& orig_set       = io_map_of_sets_orig.find(orig_key)->second;
+      auto        synth_key_name = Node_pin("lgdb", synth_key);
       auto orig_key_name  = Node_pin("lgdb", orig_key);
       std::print(
           "-- checking for synth key: {} VS. orig key: {} -- ",
           synth_key_name.has_name() ? synth_key_name.get_name() : ('n' + std::to_string(synth_key_name.get_node().get_nid())),
           orig_key_name.has_name() ? orig_key_name.get_name() : ('n' + std::to_string(orig_key_name.get_node().get_nid())));
 #endif
-      unsigned long matches  = 0;
-      const auto&   smallest = synth_set.size() < orig_set.size() ? synth_set : orig_set;
-      const auto&   largest  = synth_set.size() >= orig_set.size() ? synth_set : orig_set;
-
-      for (const auto& it_set : smallest) {
-        if (largest.contains(it_set)) {
-          ++matches;
-        }
-      }
-      unsigned long mismatches = synth_set.size() + orig_set.size() - matches - matches;
+      const unsigned long matches    = synth_sig.intersection_size(orig_sig);
+      const unsigned long mismatches = synth_sig.size() + orig_sig.size() - matches - matches;
       if (matches > match_count) {
         matched_node_pins.clear();
         matched_node_pins.insert(orig_key);
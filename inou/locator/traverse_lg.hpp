@@ -17,6 +17,7 @@
 #include "absl/container/internal/raw_hash_set.h"
 #include "absl/container/node_hash_map.h"
 #include "cell.hpp"
+#include "io_signature.hpp"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "node.hpp"
@@ -96,8 +97,10 @@ private:
   void                                print_total_named_dpins(Lgraph *lg, bool is_orig_lg) const;
   void                                do_travers(Lgraph *orig_lg, Lgraph *synth_lg, bool is_orig_lg);
   void                                fast_pass_for_inputs(Lgraph *lg, map_of_sets &inp_map_of_sets, bool is_orig_lg);
-  void                                fwd_traversal_for_inp_map(Lgraph *lg, map_of_sets &inp_map_of_sets, bool is_orig_lg);
+  void                                collect_traverse_order(Lgraph *lg);
+  void                                fwd_traversal_for_inp_map(map_of_sets &inp_map_of_sets, bool is_orig_lg);
   std::vector<Node_pin>               traverse_order;
+  std::vector<bool>                   traverse_loop_stop;  // per traverse_order entry
   std::vector<Node_pin::Compact_flat> forced_match_vec;
   void                                bwd_traversal_for_out_map(map_of_sets &out_map_of_sets, bool is_orig_lg);
   void make_io_maps(Lgraph *lg, map_of_sets &inp_map_of_sets, map_of_sets &out_map_of_sets, bool is_orig_lg);
@@ -145,6 +148,8 @@ private:
                                      const absl::flat_hash_set<Node_pin::Compact_flat> &set2) const;
   float       get_matching_weight(const absl::flat_hash_set<Node_pin::Compact_flat> &synth_set,
                                   const absl::flat_hash_set<Node_pin::Compact_flat> &orig_set) const;
+  float       get_matching_weight(const Io_signature &synth_sig, const Io_signature &orig_sig) const;
+  Io_signature_table io_ids;
   void        print_SynthSet_sizes() const;
   absl::flat_hash_set<Node_pin::Compact_flat>      get_matching_map_val(const Node_pin::Compact_flat &dpin_cf) const;
   absl::node_hash_map<Node_pin::Compact_flat, int> crit_node_map;
@@ -9,11 +9,11 @@
 
 #include "lgraph.hpp"
 #include "perf_tracing.hpp"
-#include "thread_pool.hpp"
 
 // clang-format on
 
-extern int slang_main(int argc, char **argv, Slang_tree &tree);  // in slang_driver.cpp
+extern int slang_compile_units(const std::vector<std::string> &args,
+                               std::vector<std::shared_ptr<Lnast>> &lnasts);  // in slang_driver.cpp
 
 static Pass_plugin sample("inou.verilog", Inou_slang::setup);
 
@@ -34,81 +34,45 @@ void Inou_slang::work(Eprp_var &var) {
   TRACE_EVENT("verilog", "verilog_tolnast");
   Inou_slang p(var);
 
-  std::vector<char *> argv;
-
-  argv.push_back(strdup("lgshell"));
-
-  // #ifdef NDEBUG
-  argv.push_back(strdup("--quiet"));
-  // #endif
-
-  argv.push_back(strdup("--ignore-unknown-modules"));
-  // argv.push_back(strdup("--single-unit"));
+  std::vector<std::string> args{"lgshell", "--quiet", "--ignore-unknown-modules"};
+  // args.emplace_back("--single-unit");
 
   if (var.has_label("includes")) {
     auto txt = var.get("includes");
     for (const auto f : absl::StrSplit(txt, ',')) {
-      argv.push_back(strdup("-I"));
-      argv.push_back(strdup(std::string(f).c_str()));
+      args.emplace_back("-I");
+      args.emplace_back(f);
     }
   }
 
   if (var.has_label("defines")) {
     auto txt = var.get("defines");
     for (const auto f : absl::StrSplit(txt, ',')) {
-      argv.push_back(strdup("-D"));
-      argv.push_back(strdup(std::string(f).c_str()));
+      args.emplace_back("-D");
+      args.emplace_back(f);
     }
   }
 
   if (var.has_label("undefines")) {
     auto txt = var.get("undefines");
     for (const auto f : absl::StrSplit(txt, ',')) {
-      argv.push_back(strdup("-U"));
-      argv.push_back(strdup(std::string(f).c_str()));
+      args.emplace_back("-U");
+      args.emplace_back(f);
     }
   }
 
-  std::mutex var_add_mutex;
-
-  std::vector<std::string> file_list = absl::StrSplit(p.files, ',');
-
-  for (const auto &fname : file_list) {
-    thread_pool.add([fname, &var, &argv, &var_add_mutex]() -> void {
-      // std::lock_guard<std::mutex> guard(var_add_mutex); // FIXME: slang multithread fails
-
-      // TRACE_EVENT("verilog", perfetto::DynamicString{fname});
-      TRACE_EVENT("verilog", nullptr, [&fname](perfetto::EventContext ctx) {
-        std::string converted_str{(char)('A' + (trace_module_cnt++ % 25))};
-        ctx.event()->set_name(converted_str + fname.c_str());
-      });
-
-      Slang_tree tree;
-
-      std::vector<char *> argv_final{argv};
-
-      char *ptr_fname = strdup(fname.c_str());
-
-      argv_final.emplace_back(ptr_fname);
-      argv_final.emplace_back(nullptr);
-
-      slang_main(argv_final.size() - 1, argv_final.data(), tree);  // compile to lnasts
+  for (const auto f : absl::StrSplit(p.files, ',')) {
+    args.emplace_back(f);
+  }
 
-      {
-        std::lock_guard<std::mutex> guard(var_add_mutex);  // FIXME: slang
-        for (auto &ln : tree.pick_lnast()) {
-          var.add(ln);
-        }
-      }
+  std::vector<std::shared_ptr<Lnast>> lnasts;
 
-      free(ptr_fname);
-    });
+  const auto rc = slang_compile_units(args, lnasts);  // compile to lnasts, one unit per file
+  if (rc != 0) {
+    Pass::error("inou.verilog: slang could not compile the input files (code {})", rc);
   }
-  thread_pool.wait_all();
 
-  for (char *ptr : argv) {
-    if (ptr) {
-      free(ptr);
-    }
+  for (auto &ln : lnasts) {
+    var.add(ln);
   }
 }
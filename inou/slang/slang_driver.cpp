@@ -5,9 +5,13 @@
 // SPDX-FileCopyrightText: Michael Popoloski
 // SPDX-License-Identifier: MIT
 //------------------------------------------------------------------------------
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "slang/ast/ASTSerializer.h"
 #include "slang/ast/symbols/CompilationUnitSymbols.h"
@@ -24,6 +28,8 @@ using namespace slang::ast;
 using namespace slang::driver;
 
 #include "pass.hpp"
+#include "perf_tracing.hpp"
+#include "thread_pool.hpp"
 
 void writeToFile(std::string_view fileName, std::string_view contents);
 
@@ -225,6 +231,95 @@ void writeToFile(std::string_view fileName, std::string_view contents) {
 
 #ifndef FUZZ_TARGET
 int slang_main(int argc, char** argv, Slang_tree& tree) { return driverMain(argc, argv, tree); }
+
+// Library mode for inou.verilog. A single Driver (one SourceManager, so include files are loaded once) parses all the
+// files. Each file is still its own compilation unit: elaborated and translated to LNAST in a thread_pool task that
+// only writes its own slot. Diagnostics are reported afterwards in file order.
+int slang_compile_units(const std::vector<std::string>& args, std::vector<std::shared_ptr<Lnast>>& lnasts) {
+  SLANG_TRY {
+    Driver driver;
+    driver.addStandardArgs();
+
+    std::optional<bool> quiet;
+    driver.cmdLine.add("-q,--quiet", quiet, "Suppress non-essential output");
+
+    std::vector<const char*> argv;
+    argv.reserve(args.size());
+    for (const auto& arg : args) {
+      argv.emplace_back(arg.c_str());
+    }
+    if (!driver.parseCommandLine(static_cast<int>(argv.size()), argv.data())) {
+      return 1;
+    }
+    if (!driver.processOptions()) {
+      return 2;
+    }
+
+    bool ok = true;
+    {
+      TRACE_EVENT("verilog", "verilog_parse");
+      ok = driver.parseAllSources();  // the parse diagnostics are also reported with each unit
+    }
+
+    struct Unit {
+      std::unique_ptr<Compilation>        compilation;
+      std::vector<std::shared_ptr<Lnast>> lnasts;
+      std::string                         error;  // exception from the task (e.g: Pass::error in Slang_tree)
+    };
+    const auto        options = driver.createOptionBag();
+    std::vector<Unit> units(driver.syntaxTrees.size());
+    for (size_t i = 0; i < units.size(); ++i) {
+      thread_pool.add([&driver, &options, &units, i]() -> void {
+        TRACE_EVENT("verilog", "verilog_unit");
+        auto& unit = units[i];
+        SLANG_TRY {  // an exception must not escape a pool thread (std::terminate)
+          unit.compilation = std::make_unique<Compilation>(options);
+          unit.compilation->addSyntaxTree(driver.syntaxTrees[i]);
+
+          const auto& diags = unit.compilation->getAllDiagnostics();
+          if (std::ranges::any_of(diags, [](const Diagnostic& diag) { return diag.isError(); })) {
+            return;
+          }
+
+          Slang_tree tree;
+          tree.process_root(unit.compilation->getRoot());
+          unit.lnasts = tree.pick_lnast();
+        }
+        SLANG_CATCH(const std::exception& e) {
+#if __cpp_exceptions
+          unit.error = e.what();
+#endif
+          unit.lnasts.clear();
+        }
+      });
+    }
+    thread_pool.wait_all();
+
+    bool thrown = false;
+    for (auto& unit : units) {
+      if (unit.compilation) {
+        ok &= driver.reportCompilation(*unit.compilation, quiet == true);
+      }
+      if (!unit.error.empty()) {
+        OS::printE(std::format("{}\n", unit.error));
+        thrown = true;
+        continue;
+      }
+      lnasts.insert(lnasts.end(), unit.lnasts.begin(), unit.lnasts.end());
+    }
+
+    if (thrown) {
+      return 4;  // same code driverMain returned when the exception was caught there
+    }
+    return ok ? 0 : 5;
+  }
+  SLANG_CATCH(const std::exception& e) {
+#if __cpp_exceptions
+    OS::printE(std::format("{}\n", e.what()));
+#endif
+    return 6;
+  }
+}
 #endif
 
 #endif
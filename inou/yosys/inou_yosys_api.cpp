@@ -10,6 +10,7 @@
 #include <format>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 
 #include "file_utils.hpp"
@@ -20,6 +21,9 @@
 
 static void log_error_atexit() { throw std::runtime_error("yosys finished"); }
 
+Yosys::RTLIL::Design                         *Inou_yosys_api::design = nullptr;
+absl::flat_hash_map<std::string, std::string> Inou_yosys_api::script_cache;
+
 void setup_inou_yosys() {
   Yosys::log_error_stderr    = true;
   Yosys::log_cmd_error_throw = true;
@@ -30,6 +34,16 @@ void setup_inou_yosys() {
 
 Inou_yosys_api::Inou_yosys_api(Eprp_var &var, bool do_read) : Pass("inou.yosys", var) { set_script_yosys(var, do_read); }
 
+Yosys::RTLIL::Design *Inou_yosys_api::get_design() {
+  static std::once_flag setup_flag;
+  std::call_once(setup_flag, []() {
+    Yosys::yosys_setup();
+    design = new Yosys::RTLIL::Design;
+  });
+
+  return design;
+}
+
 void Inou_yosys_api::set_script_yosys(const Eprp_var &var, bool do_read) {
   auto script = var.get("script");
 
@@ -49,6 +63,12 @@ void Inou_yosys_api::set_script_yosys(const Eprp_var &var, bool do_read) {
                                      "/../inou/yosys/",
                                      "/inou/yosys/"};
 
+  static std::string default_script[2];  // [do_read]
+  if (script.empty() && !default_script[do_read].empty()) {
+    script_file = default_script[do_read];
+    return;
+  }
+
   if (script.empty()) {
     std::string do_read_str;
     if (do_read) {
@@ -65,7 +85,8 @@ void Inou_yosys_api::set_script_yosys(const Eprp_var &var, bool do_read) {
       }
     }
   } else {
-    script_file = script;
+    script_file   = script;
+    custom_script = true;
   }
 
   if (access(std::string(script_file).c_str(), R_OK) != F_OK) {
@@ -73,25 +94,37 @@ void Inou_yosys_api::set_script_yosys(const Eprp_var &var, bool do_read) {
     return;
   }
 
+  if (script.empty()) {
+    default_script[do_read] = script_file;
+  }
+
   std::print("path:{} script:{}\n", main_path, script_file);
 }
 
-void Inou_yosys_api::call_yosys(mustache::data &vars) {
-  std::ifstream inFile;
-  inFile.open(std::string(script_file));
-  if (!inFile.good()) {
-    error("inou_yosys_api: could not open {}", script_file);
-  }
+void Inou_yosys_api::call_yosys(mustache::data &vars, bool reset_design) {
+  auto it = script_cache.find(script_file);
+  if (custom_script || it == script_cache.end()) {
+    std::ifstream inFile;
+    inFile.open(std::string(script_file));
+    if (!inFile.good()) {
+      error("inou_yosys_api: could not open {}", script_file);
+    }
+
+    std::stringstream strStream;
+    strStream << inFile.rdbuf();  // read the whole file
 
-  std::stringstream strStream;
-  strStream << inFile.rdbuf();  // read the whole file
+    it = script_cache.insert_or_assign(script_file, strStream.str()).first;
+  }
 
-  mustache::mustache tmpl(strStream.str());
+  mustache::mustache tmpl(it->second);
   tmpl.set_custom_escape([](const std::string &s) { return s; });  // No HTML escape
 
   const std::string yosys_all_cmds = tmpl.render(vars);
 
-  Yosys::RTLIL::Design design;
+  auto *yosys_design = get_design();
+  if (reset_design) {
+    Yosys::Pass::call(yosys_design, "design -reset");
+  }
 
   auto cmd_list = absl::StrSplit(yosys_all_cmds, '\n');
 
@@ -105,7 +138,7 @@ void Inou_yosys_api::call_yosys(mustache::data &vars) {
 
     std::print("yosys cmd:{}\n", cmd);
     try {
-      Yosys::Pass::call(&design, cmd);
+      Yosys::Pass::call(yosys_design, cmd);
     } catch (...) {
       err_tracker::logger("inou.yosys cmd:{} failed\n", cmd);
       error("inou.yosys cmd:{} failed\n", cmd);
@@ -220,6 +253,9 @@ void Inou_yosys_api::do_tolg(Eprp_var &var) {
   const auto techmap{var.get("techmap")};
   const auto abc{var.get("abc")};
   const auto top{var.get("top")};
+  const auto dump{var.get("dump")};
+  const auto keep{var.get("keep_design")};
+  const auto parallel{var.get("parallel")};
   // const auto lib{var.get("liberty")};
 
   mustache::data vars;
@@ -262,13 +298,19 @@ void Inou_yosys_api::do_tolg(Eprp_var &var) {
     error("unrecognized abc {} option. Either true or false", techmap);
   }
 
+  if (dump == "true" || dump == "1") {
+    vars.set("dump", mustache::data::type::bool_true);
+  }
+
+  if (parallel == "true" || parallel == "1") {
+    vars.set("parallel", mustache::data::type::bool_true);
+  }
+
   auto *gl = Graph_library::instance(path);
 
   uint32_t max_version = gl->get_max_version();
 
-  Yosys::yosys_setup();
-
-  call_yosys(vars);
+  call_yosys(vars, !(keep == "true" || keep == "1"));
 
   std::vector<Lgraph *> lgs;
   gl->each_sub([&lgs, gl, max_version](Lg_type_id id, std::string_view name) {
@@ -290,8 +332,6 @@ void Inou_yosys_api::do_tolg(Eprp_var &var) {
 void Inou_yosys_api::fromlg(Eprp_var &var) {
   Inou_yosys_api p(var, false);
 
-  Yosys::yosys_setup();
-
   for (auto &lg : var.lgs) {
     mustache::data vars;
 
@@ -309,7 +349,7 @@ void Inou_yosys_api::fromlg(Eprp_var &var) {
       vars.set("hier", mustache::data::type::bool_false);
     }
 
-    p.call_yosys(vars);
+    p.call_yosys(vars, true);
   }
 }
 
@@ -323,6 +363,9 @@ void Inou_yosys_api::setup() {
   m1.add_label_optional("script", "alternative custom inou_yosys_read.ys command");
   m1.add_label_optional("yosys", "path for yosys command", "");
   m1.add_label_optional("top", "define top module, will call yosys hierarchy pass (-auto-top allowed)");
+  m1.add_label_optional("dump", "write the yosys pp.il/pp.v netlists before loading lgraph", "false");
+  m1.add_label_optional("parallel", "convert the yosys modules to lgraph concurrently", "false");
+  m1.add_label_optional("keep_design", "keep the modules already in the resident yosys design (e.g: read_liberty)", "false");
 
   register_inou("yosys", m1);
 
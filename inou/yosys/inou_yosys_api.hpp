@@ -10,19 +10,32 @@ using namespace kainjow;
 
 #pragma GCC diagnostic pop
 
+#include "absl/container/flat_hash_map.h"
 #include "eprp.hpp"
 #include "lgraph.hpp"
 #include "pass.hpp"
 
+namespace Yosys::RTLIL {
+struct Design;
+}
+
 class Inou_yosys_api : public Pass {
 protected:
   std::string script_file;
+  bool        custom_script = false;  // custom scripts are not cached (may be edited between commands)
+
+  // yosys is linked in lgshell: one design stays resident across commands,
+  // and the scripts are read once per process.
+  static Yosys::RTLIL::Design                         *design;
+  static absl::flat_hash_map<std::string, std::string> script_cache;
+
+  static Yosys::RTLIL::Design *get_design();
 
   void set_script_yosys(const Eprp_var &var, bool do_read);
 
   void do_tolg(Eprp_var &var);
 
-  void call_yosys(mustache::data &vars);
+  void call_yosys(mustache::data &vars, bool reset_design);
 
   // eprp callback
   static void tolg(Eprp_var &var);
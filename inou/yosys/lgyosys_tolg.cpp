@@ -5,8 +5,10 @@
 #pragma GCC diagnostic ignored "-Wshadow"
 #pragma GCC diagnostic ignored "-Wsign-compare"
 
+#include <exception>
 #include <format>
 #include <iostream>
+#include <mutex>
 #include <string>
 
 #include "absl/container/flat_hash_map.h"
@@ -23,6 +25,7 @@
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "perf_tracing.hpp"
+#include "thread_pool.hpp"
 
 // When true, the cell bits should have no effect (set to zero or large num for
 // bitwidth to adjust should work too)
@@ -31,20 +34,57 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+// Design wide tables, read-only while the module bodies are converted
 static CellTypes                        ct_all;
-static absl::flat_hash_set<size_t>      driven_signals;
 static absl::flat_hash_set<std::string> cell_port_inputs;
 static absl::flat_hash_set<std::string> cell_port_outputs;
 
 typedef std::pair<const RTLIL::Wire *, int> Wire_bit;
 
-static absl::flat_hash_map<const RTLIL::Wire *, Node_pin>          wire2pin;
-static absl::flat_hash_map<const RTLIL::Cell *, Node>              cell2node;  // Points to the exit_node for the block
-static absl::flat_hash_map<const RTLIL::Wire *, Node_pin_iterator> partially_assigned;
-static absl::flat_hash_map<const RTLIL::Wire *, std::vector<int>>  partially_assigned_bits;
-static absl::flat_hash_map<const RTLIL::Wire *, std::vector<int>>  partially_assigned_fwd;
+// Per module tables (thread_local, yosys2lg -parallel converts one module per thread)
+static thread_local absl::flat_hash_set<size_t>                                 driven_signals;
+static thread_local absl::flat_hash_map<const RTLIL::Wire *, Node_pin>          wire2pin;
+static thread_local absl::flat_hash_map<const RTLIL::Cell *, Node>              cell2node;  // Points to the exit_node for the block
+static thread_local absl::flat_hash_map<const RTLIL::Wire *, Node_pin_iterator> partially_assigned;
+static thread_local absl::flat_hash_map<const RTLIL::Wire *, std::vector<int>>  partially_assigned_bits;
+static thread_local absl::flat_hash_map<const RTLIL::Wire *, std::vector<int>>  partially_assigned_fwd;
+
+static thread_local std::vector<const RTLIL::Wire *> pending_outputs;
+
+// Sub_node pins of black boxes are discovered from the instances, and the
+// yosys log is not thread safe. Both are serialized across modules.
+static std::mutex sub_mutex;
+static std::mutex log_mutex;
+
+// IdString frees are off while modules convert in parallel (the refcounts are not atomic). Older yosys releases keep
+// the flag in destruct_guard.ok, newer ones in destruct_guard_ok, use whichever this yosys has.
+//
+// This relies on two things:
+//  * No IdString copied by a worker outlives the parallel phase. The thread_local tables above are keyed by Wire*
+//    and Cell* and hold Node_pins, so every copy is a temporary dropped before convert_module returns.
+//  * With the guard off, IdString::put_reference returns before touching the refcount, so a racing increment can
+//    at worst leak a name, it never drops a count to zero and frees a name still in use.
+template <typename Id = RTLIL::IdString>
+static void set_idstring_frees(bool on) {
+  if constexpr (requires { Id::destruct_guard_ok; }) {
+    Id::destruct_guard_ok = on;
+  } else {
+    static_assert(requires { Id::destruct_guard.ok; }, "RTLIL::IdString has no destruct guard, update set_idstring_frees");
+    Id::destruct_guard.ok = on;
+  }
+}
 
-static std::vector<const RTLIL::Wire *> pending_outputs;
+template <typename... Args>
+static void log_module(const char *format, Args... args) {
+  std::lock_guard<std::mutex> guard(log_mutex);
+  log(format, args...);
+}
+
+template <typename... Args>
+static void print_module(std::format_string<Args...> format, Args &&...args) {
+  std::lock_guard<std::mutex> guard(log_mutex);
+  std::print(format, std::forward<Args>(args)...);
+}
 
 static void set_loc(Node &node, const std::string &src) {
   if (src.empty()) {
@@ -173,7 +213,7 @@ bool operator==(const Pick_ID &lhs, const Pick_ID &rhs) {
   return lhs.driver == rhs.driver && lhs.width == rhs.width && lhs.offset == rhs.offset && lhs.is_signed == rhs.is_signed;
 }
 
-static absl::flat_hash_map<Pick_ID, Node_pin> picks;
+static thread_local absl::flat_hash_map<Pick_ID, Node_pin> picks;
 
 static Node_pin create_pick_operator(const Node_pin &wide_dpin, int offset, int width, bool is_signed) {
   if (offset == 0 && (int)wide_dpin.get_bits() == width && !is_signed) {
@@ -548,7 +588,7 @@ static Node_pin get_partial_dpin(Lgraph *g, const RTLIL::Wire *wire) {
     } else if (unlikely(or_dpin.get_type_op() == Ntype_op::Sub)) {
       real_or_node.setup_sink_pin().connect_driver(or_dpin);
     } else if (!or_dpin.get_node().is_type(Ntype_op::Or)) {
-      std::print("WARNING: wire:{} is mapped to dpin:{} node or_wire\n", wire->name.str(), or_dpin.debug_name());
+      print_module("WARNING: wire:{} is mapped to dpin:{} node or_wire\n", wire->name.str(), or_dpin.debug_name());
       or_dpin.get_node().dump();
     }
 
@@ -659,11 +699,11 @@ static bool is_black_box_output(const RTLIL::Cell *cell, const RTLIL::IdString &
   auto cell_port = absl::StrCat(cell->type.str(), "_:_", port_name.str());
 
   if (cell_port_outputs.find(cell_port) != cell_port_outputs.end()) {
-    fprintf(stderr, "WARNING: lgyosys_tolg guessing that cell %s pin %s is an output\n", cell->name.c_str(), port_name.c_str());
+    log_module("WARNING: lgyosys_tolg guessing that cell %s pin %s is an output\n", cell->name.c_str(), port_name.c_str());
     return true;
   }
   if (cell_port_inputs.find(cell_port) != cell_port_inputs.end()) {
-    fprintf(stderr, "WARNING: lgyosys_tolg guessing that cell %s pin %s is an input\n", cell->name.c_str(), port_name.c_str());
+    log_module("WARNING: lgyosys_tolg guessing that cell %s pin %s is an input\n", cell->name.c_str(), port_name.c_str());
     return false;
   }
 
@@ -691,11 +731,11 @@ static bool is_black_box_input(const RTLIL::Cell *cell, const RTLIL::IdString &p
 
   // Opposite of is_black_box_output
   if (cell_port_outputs.find(cell_port) != cell_port_outputs.end()) {
-    fprintf(stderr, "WARNING: lgyosys_tolg guessing that cell %s pin %s is an output\n", cell->name.c_str(), port_name.c_str());
+    log_module("WARNING: lgyosys_tolg guessing that cell %s pin %s is an output\n", cell->name.c_str(), port_name.c_str());
     return false;
   }
   if (cell_port_inputs.find(cell_port) != cell_port_inputs.end()) {
-    fprintf(stderr, "WARNING: lgyosys_tolg guessing that cell %s pin %s is an input\n", cell->name.c_str(), port_name.c_str());
+    log_module("WARNING: lgyosys_tolg guessing that cell %s pin %s is an input\n", cell->name.c_str(), port_name.c_str());
     return true;
   }
 
@@ -718,7 +758,10 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
     if (cell->type.c_str()[0] == '\\' || strncmp(cell->type.c_str(), "$paramod\\", 8) == 0) {  // sub_cell type
       std::string mod_name(&(cell->type.c_str()[1]));
 
-      sub = g->ref_library()->ref_or_create_sub(mod_name, "-");
+      {
+        std::lock_guard<std::mutex> sub_guard(sub_mutex);
+        sub = g->ref_library()->ref_or_create_sub(mod_name, "-");
+      }
 
       if (sub && !node.is_type_sub()) {  // Not set already
         node.set_type_sub(sub->get_lgid());
@@ -735,7 +778,8 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
       }
 
       if (sub) {
-        std::string pin_name(&(conn.first.c_str()[1]));
+        std::lock_guard<std::mutex> sub_guard(sub_mutex);  // black box pins are added from any module
+        std::string                 pin_name(&(conn.first.c_str()[1]));
 
         if (str_tools::is_i(pin_name)) {
           // hardcoded pin position
@@ -768,11 +812,10 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
               } else if (!is_input && is_output) {
                 sub->add_output_pin(pin_name, pos);
               } else {
-                fprintf(stderr,
-                        "Warning: impossible to figure out direction in module %s cell type %s pin_name to %s\n",
-                        mod->name.c_str(),
-                        cell->type.c_str(),
-                        pin_name.c_str());
+                log_module("Warning: impossible to figure out direction in module %s cell type %s pin_name to %s\n",
+                           mod->name.c_str(),
+                           cell->type.c_str(),
+                           pin_name.c_str());
                 continue;
               }
             }
@@ -783,7 +826,7 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
           }
 
 #ifndef NDEBUG
-          printf("module %s cell type %s has output pin_name %s\n", mod->name.c_str(), cell->type.c_str(), pin_name.c_str());
+          log_module("module %s cell type %s has output pin_name %s\n", mod->name.c_str(), cell->type.c_str(), pin_name.c_str());
 #endif
         } else {
           if (!sub->has_pin(pin_name)) {
@@ -816,8 +859,6 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
               } else if (!is_input && is_output) {
                 sub->add_output_pin(pin_name);
               } else {
-                log_error("unknown port %s at module %s cell %s\n", conn.first.c_str(), mod->name.c_str(), cell->type.c_str());
-
                 ::Lgraph::error(
                     "Could not find a definition for module {}, treating as a blackbox but could not determine whether {} is an "
                     "output",
@@ -844,7 +885,8 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
 
       Node_pin driver_pin;
       if (node.is_type_sub()) {
-        std::string pin_name(&(conn.first.c_str()[1]));
+        std::string                 pin_name(&(conn.first.c_str()[1]));
+        std::lock_guard<std::mutex> sub_guard(sub_mutex);
         driver_pin = node.setup_driver_pin(pin_name);
       } else {
         driver_pin = node.setup_driver_pin();
@@ -896,11 +938,11 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
 
             if (wire2pin.find(wire) != wire2pin.end()) {
               auto dpin = wire2pin[wire];
-              std::print("partial wire {} from module {} cell type {} (switching to partial node:{})\n",
-                         wire->name.c_str(),
-                         mod->name.c_str(),
-                         cell->type.c_str(),
-                         dpin.get_node().debug_name());
+              print_module("partial wire {} from module {} cell type {} (switching to partial node:{})\n",
+                           wire->name.c_str(),
+                           mod->name.c_str(),
+                           cell->type.c_str(),
+                           dpin.get_node().debug_name());
             }
             auto n2_dpin = n2.setup_driver_pin();
             if (wire->name.c_str()[0] != '$') {
@@ -943,7 +985,7 @@ static void process_cell_drivers_intialization(RTLIL::Module *mod, Lgraph *g) {
 static void dump_partially_assigned() {
   for (auto it : partially_assigned) {
     const auto *wire = it.first;
-    std::print("wire:{} width:{}\n", wire->name.str(), wire->width);
+    print_module("wire:{} width:{}\n", wire->name.str(), wire->width);
 
     int i = 0;
     while (i < (int)it.second.size()) {
@@ -955,13 +997,13 @@ static void dump_partially_assigned() {
       const auto &dpin = it.second[i];
 
       if (dpin.is_invalid()) {
-        std::print("OOPSY! 1st: {}\n", dpin.debug_name());
+        print_module("OOPSY! 1st: {}\n", dpin.debug_name());
         i += width;
         continue;
       }
       // I(!dpin.is_invalid());
 
-      std::print("   [{}:{}] name:{}\n", i, i + width - 1, dpin.debug_name());
+      print_module("   [{}:{}] name:{}\n", i, i + width - 1, dpin.debug_name());
 
 #ifndef NDEBUG
       for (int j = i + 1; j < i + width; ++j) {
@@ -990,7 +1032,7 @@ static void process_assigns(RTLIL::Module *mod, Lgraph *g) {
       }
 
       if (lhs_wire->port_input) {
-        log_error("Assignment to input port %s\n", lhs_wire->name.c_str());
+        ::Lgraph::error("inou.yosys.tolg: assignment to input port {} in module {}", lhs_wire->name.str(), mod->name.str());
       } else if (lchunk.width == lhs_wire->width) {
 #ifndef NDEBUG
         if (lhs_wire->port_output) {
@@ -1024,7 +1066,7 @@ static void process_assigns(RTLIL::Module *mod, Lgraph *g) {
               if (!rhs_dpin.has_name()) {
                 rhs_dpin.set_name(wname);
                 rhs_adjusted_name = true;
-                std::print("1.which pin to assign {} dpin:{}\n", wname, rhs_dpin.get_wire_name());
+                print_module("1.which pin to assign {} dpin:{}\n", wname, rhs_dpin.get_wire_name());
               }
             }
           }
@@ -1299,7 +1341,7 @@ static void connect_partial_dpin(Lgraph *g, Node &or_node, uint32_t or_offset, B
 static void process_partially_assigned_other(Lgraph *g) {
   for (const auto &it : partially_assigned) {
     const RTLIL::Wire *wire = it.first;
-    std::print(" wire:{} width:{}\n", wire->name.str(), wire->width);
+    print_module(" wire:{} width:{}\n", wire->name.str(), wire->width);
     I(it.second.size() == it.first->width);  // every bit set (maye be same dpin)
 
     auto or_dpin = get_partial_dpin(g, wire);
@@ -1314,7 +1356,7 @@ static void process_partially_assigned_other(Lgraph *g) {
       }
       const auto &dpin = it.second[i];
       if (dpin.is_invalid()) {
-        std::print("OOPSY! 2nd: {}\n", dpin.debug_name());
+        print_module("OOPSY! 2nd: {}\n", dpin.debug_name());
       }
       // I(!dpin.is_invalid());
       if (!dpin.is_invalid()) {
@@ -2315,7 +2357,7 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
 
       std::string name(&cell->getParam(ID::MEMID).decode_string().c_str()[1]);
 
-      std::print("name:{} depth:{} wrports:{} rdports:{}\n", name, depth, wrports, rdports);
+      print_module("name:{} depth:{} wrports:{} rdports:{}\n", name, depth, wrports, rdports);
 
       exit_node.setup_sink_pin("bits").connect_driver(g->create_node_const(width));
       exit_node.setup_sink_pin("clock_pin").connect_driver(get_dpin(g, cell, ID::WR_CLK));
@@ -2377,7 +2419,7 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
             continue;
           }
 
-          log("oops rd_port:%d does not need clk cell %s\n", i, cell->type.c_str());
+          log_module("oops rd_port:%d does not need clk cell %s\n", i, cell->type.c_str());
         }
       }
       int wr_clk_enabled  = 0;
@@ -2422,7 +2464,7 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
         clock = cell->getPort("\\WR_CLK")[0].wire;
       }
       if (clock == nullptr) {
-        log_error("No clock found for memory.\n");
+        ::Lgraph::error("inou.yosys.tolg: no clock found for memory {}", cell->name.str());
       }
 
       exit_node.set_name(name);
@@ -2431,7 +2473,7 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
       // external graph reference
       auto sub_lgid = g->get_library().get_lgid(&cell->type.c_str()[1]);
       I(sub_lgid);
-      log("module name original was %s\n", cell->type.c_str());
+      log_module("module name original was %s\n", cell->type.c_str());
 
       entry_node.set_type_sub(sub_lgid);
 
@@ -2441,7 +2483,7 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
       }
 #ifndef NDEBUG
       else {
-        std::print("yosys2lg got empty inst_name for cell type {}\n", cell->type.c_str());
+        print_module("yosys2lg got empty inst_name for cell type {}\n", cell->type.c_str());
       }
 #endif
 
@@ -2450,7 +2492,7 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
       // DO NOT MERGE THE BELLOW WITH THE OTHER ANDs, NOTs, DFFs
       //--------------------------------------------------------------
     } else if (cell->type.c_str()[0] == '$' && cell->type.c_str()[1] != '_' && strncmp(cell->type.c_str(), "$paramod", 8) != 0) {
-      log("likely error: add this cell type %s to lgraph\n", cell->type.c_str());
+      log_module("likely error: add this cell type %s to lgraph\n", cell->type.c_str());
 
       //--------------------------------------------------------------
     } else if (std::strncmp(cell->type.c_str(), "$_AND_", 6) == 0) {
@@ -2497,8 +2539,8 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
     } else if (std::strncmp(cell->type.c_str(), "$_DFF_NN", 8) == 0 || std::strncmp(cell->type.c_str(), "$_DFF_NP", 8) == 0
                || std::strncmp(cell->type.c_str(), "$_DFF_PP", 8) == 0 || std::strncmp(cell->type.c_str(), "$_DFF_PN", 8) == 0) {
       // TODO: add support for those DFF types
-      log_error("Found complex yosys DFFs, run `techmap -map +/adff2dff.v` before calling the yosys2lg pass\n");
-      I(false);
+      ::Lgraph::error("inou.yosys.tolg: found complex yosys DFF {}, run `techmap -map +/adff2dff.v` before calling yosys2lg",
+                      cell->type.str());
 
     } else if (cell->type.c_str()[0] == '\\' || strncmp(cell->type.c_str(), "$paramod\\", 8) == 0) {  // sub_cell type
 
@@ -2507,41 +2549,48 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
       } else {
         I(exit_node.is_type_sub());
 
-        absl::flat_hash_set<XEdge::Compact> added_edges;
+        // Only the pin lookup needs the lock (other modules may add black box pins to the same Sub_node)
+        std::vector<std::pair<Node_pin, const RTLIL::SigSpec *>> inputs;
+        {
+          std::lock_guard<std::mutex> sub_guard(sub_mutex);
 
-        const auto &sub = exit_node.get_type_sub_node();
+          const auto &sub = exit_node.get_type_sub_node();
 
-        for (auto &conn : cell->connections()) {
-          RTLIL::SigSpec ss = conn.second;
-          if (ss.size() == 0) {
-            continue;
-          }
+          for (auto &conn : cell->connections()) {
+            if (conn.second.size() == 0) {
+              continue;
+            }
 
-          std::string name(&conn.first.c_str()[1]);
-          if (str_tools::is_i(name)) {
-            int pos = str_tools::to_i(name);
-            name    = sub.get_name_from_graph_pos(pos);
-          }
+            std::string name(&conn.first.c_str()[1]);
+            if (str_tools::is_i(name)) {
+              int pos = str_tools::to_i(name);
+              name    = sub.get_name_from_graph_pos(pos);
+            }
 
-          if (sub.is_output(name)) {
-            continue;
-          }
-          if (!sub.is_input(name)) {
-            log_error("sub:%s does not have pin:%s as input\n", std::string(sub.get_name()).c_str(), name.c_str());
-          }
+            if (sub.is_output(name)) {
+              continue;
+            }
+            if (!sub.is_input(name)) {
+              ::Lgraph::error("inou.yosys.tolg: sub:{} does not have pin:{} as input", sub.get_name(), name);
+            }
 
-          Node_pin spin = exit_node.setup_sink_pin(name);
-          if (spin.is_invalid()) {
-            continue;
+            Node_pin spin = exit_node.setup_sink_pin(name);
+            if (spin.is_invalid()) {
+              continue;
+            }
+            inputs.emplace_back(spin, &conn.second);
           }
+        }
 
-          Node_pin dpin = create_pick_concat_dpin(g, ss, true);
+        absl::flat_hash_set<XEdge::Compact> added_edges;
+        for (const auto &[spin, ss] : inputs) {
+          Node_pin dpin = create_pick_concat_dpin(g, *ss, true);
 
           if (added_edges.find(XEdge(dpin, spin).get_compact()) != added_edges.end()) {
             // there are two edges from dpin to spin
             // this is not allowed in lgraph, add a Ntype_op::Or in between
             auto or_node = exit_node.create(Ntype_op::Or);
-            or_node.setup_driver_pin().set_bits(ss.size());
+            or_node.setup_driver_pin().set_bits(ss->size());
             g->add_edge(dpin, or_node.setup_sink_pin());
             dpin = or_node.setup_driver_pin();
           }
@@ -2560,6 +2609,58 @@ static void process_cells(RTLIL::Module *mod, Lgraph *g) {
   }
 }
 
+static void convert_module(RTLIL::Module *mod, Lgraph *g) {
+  std::string mod_name(&(mod->name.c_str()[1]));
+#ifndef NDEBUG
+  print_module("inou.yosys.tolg module:{}\n", mod_name);
+#endif
+
+  driven_signals.clear();
+  wire2pin.clear();
+  cell2node.clear();
+  partially_assigned.clear();
+  partially_assigned_bits.clear();
+  partially_assigned_fwd.clear();
+  picks.clear();
+  pending_outputs.clear();
+
+  TRACE_EVENT("inou", nullptr, [&mod_name](perfetto::EventContext ctx) { ctx.event()->set_name("YOSYS_tolg_" + mod_name); });
+
+  // Populate the driven_signals (only needed for unknown modules)
+  for (const auto &conn : mod->connections()) {
+    const RTLIL::SigSpec lhs = conn.first;
+    for (auto &lchunk : lhs.chunks()) {
+      const RTLIL::Wire *lhs_wire = lchunk.wire;
+
+      if (lchunk.width == 0) {
+        continue;
+      }
+      // std::print("Assignment to {}\n", lhs_wire->name.c_str());
+      driven_signals.insert(lhs_wire->hash());
+    }
+  }
+
+  for (const auto &port : mod->ports) {
+    RTLIL::Wire *wire = mod->wire(port);
+    // std::string  wire_name(&wire->name.c_str()[1]);
+    if (wire->port_output) {
+      pending_outputs.emplace_back(wire);
+    }
+  }
+
+  process_cell_drivers_intialization(mod, g);
+  process_assigns(mod, g);
+  process_cells(mod, g);
+  process_partially_assigned(g);
+  process_connect_outputs(mod, g);
+
+  wire2pin.clear();
+  cell2node.clear();
+  partially_assigned.clear();
+  picks.clear();
+  pending_outputs.clear();
+}
+
 // each pass contains a singleton object that is derived from Pass
 struct Yosys2lg_Pass : public Yosys::Pass {
   Yosys2lg_Pass() : Pass("yosys2lg") {}
@@ -2573,6 +2674,9 @@ struct Yosys2lg_Pass : public Yosys::Pass {
     log("    -path [default=lgdb]\n");
     log("        Specify from which path to read\n");
     log("\n");
+    log("    -parallel\n");
+    log("        Convert the selected modules concurrently (one module per thread)\n");
+    log("\n");
     log("\n");
   }
 
@@ -2583,12 +2687,17 @@ struct Yosys2lg_Pass : public Yosys::Pass {
     // parse options
     size_t      argidx;
     std::string path("lgdb");
+    bool        parallel = false;
 
     for (argidx = 1; argidx < args.size(); argidx++) {
       if (args[argidx] == "-path") {
         path = std::string(args[++argidx]);
         continue;
       }
+      if (args[argidx] == "-parallel") {
+        parallel = true;
+        continue;
+      }
       break;
     }
 
@@ -2598,10 +2707,11 @@ struct Yosys2lg_Pass : public Yosys::Pass {
     ct_all.setup(design);
     cell_port_outputs.clear();
     cell_port_inputs.clear();
-    driven_signals.clear();
 
     auto *library = Graph_library::instance(path);
 
+    // Serial phase: every lgraph with its IOs, and every Sub_node instantiated,
+    // exist before any module body is converted.
     for (const auto &it : design->modules_) {
       RTLIL::Module *mod = it.second;
       std::string    mod_name(&mod->name.c_str()[1]);
@@ -2636,62 +2746,59 @@ struct Yosys2lg_Pass : public Yosys::Pass {
       }
     }
 
+    std::vector<std::pair<RTLIL::Module *, Lgraph *>> work;
     for (const auto &it : design->modules_) {
       RTLIL::Module *mod = it.second;
-      if (design->selected_module(it.first)) {
-        std::string mod_name(&(mod->name.c_str()[1]));
-#ifndef NDEBUG
-        std::print("inou.yosys.tolg module:{}\n", mod_name);
-#endif
-
-        driven_signals.clear();
-        cell_port_inputs.clear();
-        cell_port_outputs.clear();
-        wire2pin.clear();
-        cell2node.clear();
-        partially_assigned.clear();
-        partially_assigned_bits.clear();
-        partially_assigned_fwd.clear();
+      if (!design->selected_module(it.first)) {
+        continue;
+      }
 
-        TRACE_EVENT("inou", nullptr, [&mod_name](perfetto::EventContext ctx) { ctx.event()->set_name("YOSYS_tolg_" + mod_name); });
+      for (auto cell : mod->cells()) {
+        if (cell->type.c_str()[0] == '\\' || strncmp(cell->type.c_str(), "$paramod\\", 8) == 0) {
+          (void)library->ref_or_create_sub(&(cell->type.c_str()[1]), "-");
+        }
+      }
 
-        // Populate the driven_signals (only needed for unknown modules)
-        for (const auto &conn : mod->connections()) {
-          const RTLIL::SigSpec lhs = conn.first;
-          for (auto &lchunk : lhs.chunks()) {
-            const RTLIL::Wire *lhs_wire = lchunk.wire;
+      auto *g = library->try_ref_lgraph(&(mod->name.c_str()[1]));
+      I(g);
+      work.emplace_back(mod, g);
+    }
 
-            if (lchunk.width == 0) {
-              continue;
-            }
-            // std::print("Assignment to {}\n", lhs_wire->name.c_str());
-            driven_signals.insert(lhs_wire->hash());
-          }
-        }
+    if (!parallel || work.size() < 2) {
+      for (auto &[mod, g] : work) {
+        convert_module(mod, g);
+      }
+      return;
+    }
 
-        for (const auto &port : mod->ports) {
-          RTLIL::Wire *wire = mod->wire(port);
-          // std::string  wire_name(&wire->name.c_str()[1]);
-          if (wire->port_output) {
-            pending_outputs.emplace_back(wire);
+    // Only the names above are created by the converter, all the other
+    // IdStrings already exist. Frees are off while the threads copy
+    // IdStrings (the refcounts are not atomic), so a racing count can
+    // only leak a name, never release one still in use.
+    static const RTLIL::IdString mem_port_names[] = {"\\RD_CLK", "\\RD_DATA", "\\WR_CLK"};
+    (void)mem_port_names;
+
+    std::mutex         error_mutex;
+    std::exception_ptr error;
+
+    set_idstring_frees(false);
+    for (auto &[mod, g] : work) {
+      thread_pool.add([mod, g, &error_mutex, &error]() -> void {
+        try {
+          convert_module(mod, g);
+        } catch (...) {
+          std::lock_guard<std::mutex> guard(error_mutex);
+          if (!error) {
+            error = std::current_exception();
           }
         }
+      });
+    }
+    thread_pool.wait_all();
+    set_idstring_frees(true);
 
-        auto *g = library->try_ref_lgraph(mod_name);
-        I(g);
-
-        process_cell_drivers_intialization(mod, g);
-        process_assigns(mod, g);
-        process_cells(mod, g);
-        process_partially_assigned(g);
-        process_connect_outputs(mod, g);
-
-        wire2pin.clear();
-        cell2node.clear();
-        partially_assigned.clear();
-        picks.clear();
-        pending_outputs.clear();
-      }
+    if (error) {
+      std::rethrow_exception(error);
     }
   }
 } Yosys2lg_Pass;
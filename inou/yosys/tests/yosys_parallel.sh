@@ -0,0 +1,68 @@
+#!/bin/bash
+# This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+# Converts a multi-module design with yosys2lg serially and with -parallel,
+# and checks that both lgdbs produce the same verilog.
+
+echo "yosys_parallel.sh running in "$(pwd)
+
+LGSHELL=./bazel-bin/main/lgshell
+
+if [ ! -x $LGSHELL ]; then
+  if [ -x ./main/lgshell ]; then
+    LGSHELL=./main/lgshell
+    echo "lgshell is in $(pwd)"
+  else
+    echo "FAILED: yosys_parallel.sh could not find lgshell binary in $(pwd)";
+    exit 1
+  fi
+fi
+
+if [ "$1" == "" ]; then
+  echo "FAILED: yosys_parallel.sh needs a verilog file"
+  exit 1
+fi
+
+full_input=$1
+input=$(basename ${full_input})
+base=${input%.*}
+
+rm -rf tmp_yosys_par
+mkdir -p tmp_yosys_par
+
+for mode in false true
+do
+  lgdb=tmp_yosys_par/lgdb_${mode}
+  odir=tmp_yosys_par/v_${mode}
+  mkdir -p ${odir}
+
+  echo "inou.yosys.tolg path:${lgdb} top:${base} files:${full_input} parallel:${mode} |> lgraph.save" | ${LGSHELL} -q >tmp_yosys_par/${mode}.log 2>tmp_yosys_par/${mode}.err
+  if [ $? -ne 0 ]; then
+    echo "FAIL: yosys2lg parallel:${mode} terminated with an error (testcase ${input})"
+    cat tmp_yosys_par/${mode}.log
+    cat tmp_yosys_par/${mode}.err
+    exit 1
+  fi
+
+  echo "lgraph.match path:${lgdb} |> inou.cgen.verilog odir:${odir}" | ${LGSHELL} -q >>tmp_yosys_par/${mode}.log 2>>tmp_yosys_par/${mode}.err
+  if [ $? -ne 0 ]; then
+    echo "FAIL: verilog generation for parallel:${mode} terminated with an error (testcase ${input})"
+    cat tmp_yosys_par/${mode}.err
+    exit 1
+  fi
+done
+
+NV=$(ls tmp_yosys_par/v_false/*.v 2>/dev/null | wc -l)
+if [[ $NV -lt 2 ]]; then
+  echo "FAIL: ${input} produced ${NV} modules, expected a multi-module design"
+  exit 1
+fi
+
+diff -r tmp_yosys_par/v_false tmp_yosys_par/v_true
+if [ $? -ne 0 ]; then
+  echo "FAIL: serial and parallel yosys2lg produce different lgraphs for ${input}"
+  exit 1
+fi
+
+echo "SUCCESS: serial and parallel yosys2lg match for ${NV} modules of ${input}"
+exit 0
@@ -4,11 +4,15 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <cassert>
 #include <climits>
 #include <cstdlib>
+#include <cstring>
 #include <format>
 #include <fstream>
 #include <iostream>
@@ -21,15 +25,73 @@
 #else
 #include <sys/sendfile.h>
 #endif
+#include "lgindex.hpp"
 #include "lgraph.hpp"
+#include "perf_tracing.hpp"
 #include "rapidjson/document.h"
 #include "rapidjson/error/en.h"
 #include "rapidjson/filereadstream.h"
 #include "rapidjson/filewritestream.h"
 #include "rapidjson/prettywriter.h"
+#include "thread_pool.hpp"
+#include "woothash.hpp"
 
 Graph_library::Global_instances Graph_library::global_instances;
 
+static bool write_all(int fd, std::string_view data) {
+  while (!data.empty()) {
+    auto sz = write(fd, data.data(), data.size());
+    if (sz <= 0) {
+      return false;
+    }
+    data.remove_prefix(sz);
+  }
+  return true;
+}
+
+// Journal records after the index magic: the last record of each lgid wins.
+// Returns the number of records, data is left with the torn tail (if any).
+static size_t split_index_records(std::string_view &data, std::vector<std::string_view> &last) {
+  size_t n_records = 0;
+  while (data.size() >= sizeof(uint32_t)) {
+    uint32_t rec_sz;
+    std::memcpy(&rec_sz, data.data(), sizeof(rec_sz));
+    if (rec_sz > data.size() - sizeof(uint32_t) || rec_sz < sizeof(uint32_t) + sizeof(uint64_t)) {
+      break;
+    }
+    data.remove_prefix(sizeof(uint32_t));
+    auto rec = data.substr(0, rec_sz);
+    data.remove_prefix(rec_sz);
+
+    uint32_t id;
+    std::memcpy(&id, rec.data(), sizeof(id));
+    if (id >= last.size()) {
+      last.resize(id + 1);
+    }
+    last[id] = rec;
+    ++n_records;
+  }
+  return n_records;
+}
+
+// Whole index file, read under the caller lock. last has the records, torn is
+// set if they end in a partial one (or the magic does not match).
+static bool read_index_records(int fd, size_t file_sz, std::string_view magic, std::string &file,
+                               std::vector<std::string_view> &last, bool &torn) {
+  file.resize(file_sz);
+  if (pread(fd, file.data(), file_sz, 0) != static_cast<ssize_t>(file_sz)) {
+    return false;
+  }
+
+  std::string_view data(file);
+  if (data.substr(0, magic.size()) == magic) {
+    data.remove_prefix(magic.size());
+    split_index_records(data, last);
+  }
+  torn = !data.empty();
+  return true;
+}
+
 class Cleanup_graph_library {
 public:
   Cleanup_graph_library() = default;
@@ -61,13 +123,7 @@ void Graph_library::sync_all_int() {
   }
 }
 
-void Graph_library::clean_library_int() {
-#if 0
-  // Possible to call sub_nodes directly and miss this update
-  if (graph_library_clean)
-    return;
-#endif
-
+void Graph_library::export_json_int(std::string_view file) const {
   rapidjson::StringBuffer                          s;
   rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(s);
 
@@ -132,18 +188,161 @@ void Graph_library::clean_library_int() {
   {
     std::ofstream fs;
 
-    fs.open(library_file, std::ios::out | std::ios::trunc);
+    fs.open(std::string(file), std::ios::out | std::ios::trunc);
     if (!fs.is_open()) {
-      Lgraph::error("graph_library::clean_library could not open graph_library file {}", library_file);
+      Lgraph::error("graph_library::export_json could not open graph_library file {}", file);
       return;
     }
     fs << s.GetString() << std::endl;
     fs.close();
   }
+}
+
+void Graph_library::index_record_int(size_t id, std::string &out) const {
+  // [u32 size][u32 lgid][u64 version][source][Sub_node], a version 0 is a recycled lgid
+  auto start = out.size();
+  lgindex::put_u32(out, 0);  // patched below
+
+  lgindex::put_u32(out, static_cast<uint32_t>(id));
+  lgindex::put_u64(out, attributes[id].version);
+  lgindex::put_str(out, attributes[id].source);
+  sub_nodes[id]->to_binary(out);
+
+  uint32_t sz = out.size() - start - sizeof(uint32_t);
+  std::memcpy(out.data() + start, &sz, sizeof(sz));
+}
+
+int Graph_library::open_index_int(int flags, int lock_op) const {
+  // The compaction replaces the file (rename), so a lock taken on a replaced inode must be retried
+  while (true) {
+    int fd = open(index_file.c_str(), flags, 0644);
+    if (fd < 0) {
+      return fd;
+    }
+    flock(fd, lock_op);
+
+    struct stat st_fd;
+    struct stat st_path;
+    if (fstat(fd, &st_fd) == 0 && stat(index_file.c_str(), &st_path) == 0 && st_fd.st_ino == st_path.st_ino) {
+      return fd;
+    }
+    close(fd);
+  }
+}
+
+void Graph_library::clean_library_int() {
+  // Only the entries that changed since the last sync/reload are appended to
+  // the index journal. The hash catches updates done straight on sub_nodes.
+  std::string journal;
+  size_t      n_records = 0;
+
+  synced_hash.resize(attributes.size(), 0);
+  for (size_t i = 1; i < attributes.size(); ++i) {  // Not position zero
+    auto start = journal.size();
+    index_record_int(i, journal);
+
+    auto h = lh::woothash64(journal.data() + start + sizeof(uint32_t), journal.size() - start - sizeof(uint32_t));
+    if (synced_hash[i] == h) {
+      journal.resize(start);
+      continue;
+    }
+    synced_hash[i] = h;
+    ++n_records;
+  }
+
+  if (journal.empty() && !index_torn) {
+    graph_library_clean = true;
+    return;
+  }
+
+  int fd = open_index_int(O_RDWR | O_CREAT, LOCK_EX);
+  if (fd < 0) {
+    Lgraph::error("graph_library::clean_library could not open graph_library index {}", index_file);
+    return;
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+  size_t file_sz = st.st_size;
+
+  // When another process wrote the index, its records are not in attributes
+  // (a compaction must merge them) and it may have left a torn tail (an append
+  // after it is never read back, so compact instead).
+  std::string                   file;
+  std::vector<std::string_view> last;
+  bool                          file_read = false;
+  bool                          file_torn = false;
+  if (file_sz && file_sz != index_bytes) {
+    index_shared = true;
+    file_read    = read_index_records(fd, file_sz, index_magic, file, last, file_torn);
+    index_torn |= file_torn;
+  }
+
+  auto n_live  = attributes.size() - 1;
+  bool compact = file_sz == 0 || index_torn || index_records + n_records > 2 * n_live + 64;
+  if (compact && index_shared && file_sz && !file_read) {
+    file_read = read_index_records(fd, file_sz, index_magic, file, last, file_torn);
+    if (!file_read) {
+      flock(fd, LOCK_UN);
+      close(fd);
+      Lgraph::error("graph_library::clean_library could not read graph_library index {}", index_file);
+      return;
+    }
+  }
+
+  if (compact) {
+    std::string all(index_magic);
+    size_t      n_written = 0;
+    if (index_shared) {
+      // Current file records (a torn tail is dropped, no reader got past it)
+      // with the ones changed here on top
+      std::string_view changed(journal);
+      split_index_records(changed, last);
+
+      for (const auto &rec : last) {
+        if (rec.empty()) {
+          continue;
+        }
+        lgindex::put_u32(all, static_cast<uint32_t>(rec.size()));
+        all.append(rec);
+        ++n_written;
+      }
+    } else {
+      for (size_t i = 1; i < attributes.size(); ++i) {
+        index_record_int(i, all);
+      }
+      n_written = n_live;
+    }
+
+    auto tmp = absl::StrCat(index_file, ".tmp");
+    int  fd2 = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd2 < 0 || !write_all(fd2, all)) {
+      Lgraph::error("graph_library::clean_library could not write graph_library index {}", tmp);
+    } else {
+      rename(tmp.c_str(), index_file.c_str());
+      index_bytes   = all.size();
+      index_records = n_written;
+      index_torn    = false;  // index_shared stays, attributes still miss the other process records
+    }
+    if (fd2 >= 0) {
+      close(fd2);
+    }
+  } else {
+    lseek(fd, 0, SEEK_END);
+    if (!write_all(fd, journal)) {
+      Lgraph::error("graph_library::clean_library could not append to graph_library index {}", index_file);
+    }
+    index_bytes = file_sz + journal.size();
+    index_records += n_records;
+  }
+
+  flock(fd, LOCK_UN);
+  close(fd);
 
   graph_library_clean = true;
 }
 
+
 Graph_library *Graph_library::instance_int(std::string_view path) {
   auto it1 = Graph_library::global_instances.find(path);
   if (likely(it1 != Graph_library::global_instances.end())) {
@@ -262,19 +461,88 @@ Sub_node *Graph_library::create_sub_int(std::string_view name, std::string_view
 }
 
 Sub_node *Graph_library::ref_or_create_sub(std::string_view name, std::string_view source) {
-  Lg_type_id lgid;
+  auto lgid = find_lgid(name);
+  if (lgid) {
+    return sub_nodes[lgid];
+  }
+
+  absl::WriterMutexLock guard(&lgs_mutex);
+  lgid = get_lgid_int(name);  // another thread may have added it since find_lgid
+  if (!lgid) {
+    lgid = add_name_int(name, source);
+  }
+
+  I(lgid);
+  return sub_nodes[lgid];
+}
 
+Lg_type_id Graph_library::find_lgid(std::string_view name) const {
+  // The snapshot may be freed once name_readers is released, keep what the slow path needs
+  bool     has_snapshot = false;
+  uint64_t version      = 0;
+  uint64_t remaps       = 0;
+  size_t   published    = 0;
+
+  name_readers.fetch_add(1, std::memory_order_seq_cst);  // before the load, pairs with reclaim_names_int
+  const auto *snapshot = name_snapshot.load(std::memory_order_seq_cst);
+  if (snapshot) {
+    const auto it = snapshot->name2id.find(name);
+    if (it != snapshot->name2id.end() && name_remaps.load(std::memory_order_acquire) == snapshot->remaps) {
+      const Lg_type_id lgid = it->second;
+      name_readers.fetch_sub(1, std::memory_order_release);
+      return lgid;
+    }
+    has_snapshot = true;
+    version      = snapshot->version;
+    remaps       = snapshot->remaps;
+    published    = snapshot->name2id.size();
+  }
+  name_readers.fetch_sub(1, std::memory_order_release);
+
+  // Republish once the misses paid for the copy: enough new names, or as many misses as names in the snapshot
+  static constexpr size_t min_slow_hits = 64;
+
+  Lg_type_id lgid;
+  bool       publish = false;
   {
     absl::ReaderMutexLock guard(&lgs_mutex);
     lgid = get_lgid_int(name);
-    if (lgid) {
-      return sub_nodes[lgid];
+    if (lgid && (!has_snapshot || version != name2id_version)) {
+      const auto hits = ++name_slow_hits;
+      const bool paid = name2id.size() >= published + published / 8 || hits >= published || name_remaps != remaps;
+      publish         = hits >= min_slow_hits && paid;
     }
   }
-  lgid = add_name(name, source);  // This acquires a WriterMutexLock
 
-  I(lgid);
-  return sub_nodes[lgid];
+  if (publish) {
+    absl::WriterMutexLock guard(&lgs_mutex);
+    const auto *current = name_snapshot.load(std::memory_order_relaxed);
+    if (current == nullptr || current->version != name2id_version) {  // not published by another reader in between
+      publish_names_int();
+    }
+  }
+
+  return lgid;
+}
+
+void Graph_library::publish_names_int() const {
+  auto copy = std::make_unique<Name_snapshot>(name2id, name2id_version, name_remaps.load(std::memory_order_relaxed));
+  name_snapshot.store(copy.get(), std::memory_order_seq_cst);
+  name_snapshots.emplace_back(std::move(copy));
+  name_slow_hits = 0;
+
+  reclaim_names_int();
+}
+
+// A reader increments name_readers before it loads name_snapshot. With no reader in flight after the store of the
+// current copy, any later reader can only load the current copy, so the retired ones can go. Otherwise they wait for
+// the next publish or reload.
+void Graph_library::reclaim_names_int() const {
+  if (name_readers.load(std::memory_order_seq_cst) != 0) {
+    return;
+  }
+  const auto *current = name_snapshot.load(std::memory_order_relaxed);
+  std::erase_if(name_snapshots, [current](const std::unique_ptr<Name_snapshot> &s) { return s.get() != current; });
 }
 
 Sub_node *Graph_library::ref_sub_int(Lg_type_id lgid) {
@@ -315,6 +583,7 @@ Lg_type_id Graph_library::add_name_int(std::string_view name, std::string_view s
   I(name2id.find(name) == name2id.end());
   I(id);
   name2id[name] = id;
+  ++name2id_version;
 
   return id;
 }
@@ -333,6 +602,8 @@ bool Graph_library::rename_name_int(std::string_view orig, std::string_view dest
     expunge_int(dest);
   }
 
+  name_remaps.fetch_add(1, std::memory_order_release);  // before any change, the snapshots stop answering
+  ++name2id_version;
   name2id.erase(it);
   I(name2id.find(orig) == name2id.end());
 
@@ -361,22 +632,135 @@ void Graph_library::reload_int() {
   I(graph_library_clean);
 
   max_next_version = 1;
-  std::ifstream graph_list;
-
-  // FIXME: BEGIN DELETE THIS and replace with json reload
-
-  liberty_list.emplace_back("fake_bad.lib");  // FIXME
-  sdc_list.emplace_back("fake_bad.sdc");      // FIXME
-  spef_list.emplace_back("fake_bad.spef");    // FIXME
   {
+    name_remaps.fetch_add(1, std::memory_order_release);
+    name_snapshot.store(nullptr, std::memory_order_seq_cst);
+    reclaim_names_int();  // copies still in use by a reader stay in name_snapshots
+    name_slow_hits = 0;
+    ++name2id_version;
     name2id.clear();
     attributes.resize(1);                 // 0 is not a valid ID
     sub_nodes.resize(1, new Sub_node());  // 0 is not a valid ID
+    synced_hash.clear();
+    index_bytes   = 0;
+    index_records = 0;
+    index_torn    = false;
+    index_shared  = false;
+  }
+
+  if (reload_index_int()) {
+    return;
   }
+
   if (access(library_file.c_str(), F_OK) == -1) {
     mkdir(path.c_str(), 0755);  // At least make sure directory exists for future
     return;
   }
+  reload_json_int();  // lgdb from before the binary index, the next sync writes the index
+}
+
+void Graph_library::reload_entry_int(uint64_t id) {
+  if (id >= attributes.size()) {
+    attributes.resize(id + 1);
+
+    // FIXME->sh: wiered bug that the two pointer, sub_nodes[1] and sub_nodes[2], will pollute each other when using resize (size,
+    // initial value) ??
+    //           to avoid such bug, I create Sub_node() pointers and emplace_back them one by one.
+    // sub_nodes.resize(id + 1, new Sub_node());
+    auto increase_size = id - sub_nodes.size() + 1;
+    if (increase_size > 0) {
+      for (std::string::size_type i = 0; i < increase_size; i++) {
+        auto ptr = new Sub_node();
+        sub_nodes.emplace_back(ptr);
+      }
+    }
+  }
+}
+
+bool Graph_library::reload_index_int() {
+  int fd = open_index_int(O_RDONLY, LOCK_SH);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat st;
+  fstat(fd, &st);
+  size_t sz = st.st_size;
+  if (sz < index_magic.size()) {
+    close(fd);
+    index_torn = sz != 0;  // rewrite it on the next sync
+    return false;
+  }
+
+  auto *base = static_cast<const char *>(mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0));
+  flock(fd, LOCK_UN);
+  close(fd);
+  if (base == MAP_FAILED) {
+    Lgraph::error("graph_library::reload could not mmap {}", index_file);
+    return false;
+  }
+
+  std::string_view data(base, sz);
+  if (data.substr(0, index_magic.size()) != index_magic) {
+    munmap(const_cast<char *>(base), sz);
+    Lgraph::warn("graph_library::reload {} is not a graph library index, it will be rewritten", index_file);
+    index_torn = true;
+    return false;
+  }
+  data.remove_prefix(index_magic.size());
+
+  std::vector<std::string_view> last;
+  index_records = split_index_records(data, last);
+  index_torn    = !data.empty();  // crash in the middle of an append, the next sync compacts it
+  index_bytes = sz;
+
+  synced_hash.resize(last.size(), 0);
+  for (size_t id = 1; id < last.size(); ++id) {
+    auto rec = last[id];
+    if (rec.empty()) {
+      continue;
+    }
+    reload_entry_int(id);
+
+    synced_hash[id] = lh::woothash64(rec.data(), rec.size());  // same as clean_library_int
+
+    lgindex::get_u32(rec);  // lgid
+    auto version = lgindex::get_u64(rec);
+    if (version == 0) {
+      recycled_id.insert(id);
+      continue;
+    }
+
+    auto entry = rec;
+    if (!lgindex::skip_str(entry) || !sub_nodes[id]->from_binary(entry) || sub_nodes[id]->is_invalid()
+        || sub_nodes[id]->get_lgid() != id) {
+      // Corrupt record: drop the entry (lgid recycled) and rewrite the index on the next sync
+      Lgraph::warn("graph_library::reload {} has a corrupt record for lgid {}, dropped", index_file, id);
+      sub_nodes[id]->expunge();
+      synced_hash[id] = 0;
+      recycled_id.insert(id);
+      index_torn = true;
+      continue;
+    }
+    auto source = lgindex::get_str(rec);
+
+    if (max_next_version < version) {
+      max_next_version = version;
+    }
+
+    attributes[id].source  = source;
+    attributes[id].version = version;
+
+    // NOTE: must use attributes to keep the string in memory
+    name2id[sub_nodes[id]->get_name()] = id;
+  }
+
+  munmap(const_cast<char *>(base), sz);
+
+  return true;
+}
+
+void Graph_library::reload_json_int() {
   FILE *pFile = fopen(library_file.c_str(), "rb");
   if (pFile == 0) {
     Lgraph::error("graph_library::reload could not open graph {} file", library_file);
@@ -408,21 +792,7 @@ void Graph_library::reload_int() {
 
     uint64_t id = lg_entry["lgid"].GetUint64();
 
-    if (id >= attributes.size()) {
-      attributes.resize(id + 1);
-
-      // FIXME->sh: wiered bug that the two pointer, sub_nodes[1] and sub_nodes[2], will pollute each other when using resize (size,
-      // initial value) ??
-      //           to avoid such bug, I create Sub_node() pointers and emplace_back them one by one.
-      // sub_nodes.resize(id + 1, new Sub_node());
-      auto increase_size = id - sub_nodes.size() + 1;
-      if (increase_size > 0) {
-        for (std::string::size_type i = 0; i < increase_size; i++) {
-          auto ptr = new Sub_node();
-          sub_nodes.emplace_back(ptr);
-        }
-      }
-    }
+    reload_entry_int(id);
 
     auto version = lg_entry["version"].GetUint64();
     if (version != 0) {
@@ -485,53 +855,172 @@ Lgraph *Graph_library::create_lgraph_int(std::string_view name, std::string_view
 }
 
 Lgraph *Graph_library::do_pending_load_int(Lg_id_t lgid) {
-  auto  name = get_name_int(lgid);
-  auto &attr = attributes[lgid];
-
-  auto hif = Hif_read::open(absl::StrCat(path, "/", name));
-  if (hif == nullptr) {
-    attr.lg            = nullptr;
-    attr.tried_to_load = true;
-    return nullptr;
+  // Called out of lgs_mutex once the caller claimed the load (attr.loading)
+  std::string name;
+  {
+    absl::ReaderMutexLock guard(&lgs_mutex);
+    I(attributes[lgid].loading);
+    name = get_name_int(lgid);
   }
 
-  auto *lg = new Lgraph(path, name, lgid, this, "");
+  TRACE_EVENT("lgraph", nullptr, [&name](perfetto::EventContext ctx) { ctx.event()->set_name("lgraph_load:" + name); });
 
-  lg->load(hif);
+  Lgraph *lg  = nullptr;
+  auto    hif = Hif_read::open(absl::StrCat(path, "/", name));
+  if (hif != nullptr) {
+    lg = new Lgraph(path, name, lgid, this, "");
+    lg->load(hif);
+  }
+
+  absl::WriterMutexLock guard(&lgs_mutex);  // wakes up any thread waiting for this lgid
 
+  auto &attr         = attributes[lgid];
   attr.tried_to_load = true;
+  attr.loading       = false;
   attr.lg            = lg;
 
   return lg;
 }
 
+bool Graph_library::claim_load_int(Lg_id_t lgid) {
+  I(attributes.size() > lgid);
+
+  auto &attr = attributes[lgid];
+  if (attr.tried_to_load || attr.lg || attr.loading) {
+    return false;
+  }
+  attr.loading = true;
+  return true;
+}
+
+void Graph_library::prefetch_sub_int(Lgraph *lg, std::atomic<size_t> *loaded) {
+  std::vector<Lg_id_t> claimed;
+  {
+    absl::WriterMutexLock guard(&lgs_mutex);
+    for (const auto &ent : lg->get_down_class_map()) {
+      if (claim_load_int(ent.first)) {
+        claimed.emplace_back(ent.first);
+      }
+    }
+  }
+
+  for (auto lgid : claimed) {
+    thread_pool.add([this, lgid, loaded]() -> void {
+      auto *sub_lg = do_pending_load_int(lgid);
+      TRACE_COUNTER("lgraph", "lgraph_loaded", ++(*loaded));
+      if (sub_lg) {
+        prefetch_sub_int(sub_lg, loaded);
+      }
+    });
+  }
+}
+
+void Graph_library::prefetch_hier(Lgraph *lg) {
+  TRACE_EVENT("lgraph", "lgraph_prefetch_hier");
+
+  std::atomic<size_t> loaded{0};
+  prefetch_sub_int(lg, &loaded);
+  thread_pool.wait_all();
+}
+
+uint64_t Graph_library::get_structural_hash(Lgraph *lg) {
+  const auto lgid  = lg->get_lgid();
+  const auto epoch = lg->get_mutation_epoch();
+  {
+    absl::ReaderMutexLock guard(&lgs_mutex);
+    I(attributes.size() > lgid);
+    const auto &attr = attributes[lgid];
+    if (attr.hashed_lg == lg && attr.hashed_epoch == epoch) {
+      return attr.structural_hash;
+    }
+  }
+
+  auto h = lg->compute_structural_hash();  // out of the lock, it walks the whole graph
+
+  absl::WriterMutexLock guard(&lgs_mutex);
+
+  auto &attr           = attributes[lgid];
+  attr.hashed_lg       = lg;
+  attr.hashed_epoch    = epoch;
+  attr.structural_hash = h;
+
+  return h;
+}
+
+absl::flat_hash_map<Lg_id_t, Lg_id_t> Graph_library::dedup_structural(absl::Span<Lgraph *const> tops) {
+  TRACE_EVENT("lgraph", "lgraph_dedup_structural");
+
+  absl::flat_hash_map<Lg_id_t, Lg_id_t>                remap;  // duplicate -> kept
+  absl::flat_hash_map<uint64_t, std::vector<Lgraph *>> kept;   // structural hash -> kept Lgraphs
+  absl::flat_hash_set<Lgraph *>                        visited;
+
+  auto visit = [&](Lgraph *lg) {
+    if (!visited.insert(lg).second) {
+      return;  // shared by several tops
+    }
+
+    // The subs were visited first, point the instances to the kept copies before hashing this one
+    std::vector<std::pair<Node, Lg_id_t>> rewire;
+    lg->each_local_sub_fast([&remap, &rewire](Node &node, Lg_type_id sub_lgid) {
+      const auto it = remap.find(sub_lgid.value);
+      if (it != remap.end()) {
+        rewire.emplace_back(node, it->second);
+      }
+    });
+    for (auto &[node, lgid] : rewire) {
+      node.set_type_sub(lgid);
+    }
+
+    auto &bucket = kept[lg->get_structural_hash()];
+    for (auto *orig : bucket) {
+      if (orig->is_structurally_equal(lg)) {
+        remap.emplace(lg->get_lgid(), orig->get_lgid());
+        return;
+      }
+    }
+    bucket.emplace_back(lg);
+  };
+
+  for (auto *top : tops) {
+    top->each_hier_unique_sub_bottom_up(visit);
+  }
+
+  return remap;
+}
+
 Lgraph *Graph_library::open_or_create_lgraph(std::string_view name, std::string_view source) {
-  Lgraph *lg = nullptr;
-  bool    pending_load;
+  Lgraph    *lg = nullptr;
+  bool       pending_load;
+  Lg_type_id lgid;
   {
     absl::WriterMutexLock guard(&lgs_mutex);
     // std::lock_guard<std::mutex> guard(lgs_mutex);
     std::tie(lg, pending_load) = open_or_create_lgraph_int(name, source);
+    lgid                       = get_lgid_int(name);
   }
   if (pending_load) {  // out of the lock because it can be slow and call graph library
     I(lg == nullptr);
-    auto lgid = get_lgid_int(name);
-    return do_pending_load_int(lgid);
+    lg = do_pending_load_int(lgid);
+    if (lg == nullptr) {  // not in disk, create it
+      absl::WriterMutexLock guard(&lgs_mutex);
+      lg = create_lgraph_int(name, source);
+    }
   }
   return lg;
 }
 
 Lgraph *Graph_library::open_lgraph(std::string_view name, std::string_view source) {
-  Lgraph *lg = nullptr;
-  bool    pending_load;
+  Lgraph    *lg = nullptr;
+  bool       pending_load;
+  Lg_type_id lgid;
   {
     absl::WriterMutexLock guard(&lgs_mutex);
     // std::lock_guard<std::mutex> guard(lgs_mutex);
     std::tie(lg, pending_load) = open_lgraph_int(name, source);
+    lgid                       = get_lgid_int(name);
   }
   if (pending_load) {  // out of the lock because it can be slow and call graph library
     I(lg == nullptr);
-    auto lgid = get_lgid_int(name);
     return do_pending_load_int(lgid);
   }
   return lg;
@@ -555,6 +1044,14 @@ Lgraph *Graph_library::open_lgraph(Lg_id_t lgid) {
 std::pair<Lgraph *, bool> Graph_library::open_lgraph_int(Lg_id_t lgid) {
   I(attributes.size() > lgid);
 
+  if (attributes[lgid].loading) {  // another thread (prefetch) is loading it, wait for it
+    struct Pending {
+      const Graph_library *lib;
+      Lg_id_t              lgid;
+    } pending{this, lgid};
+    lgs_mutex.Await(absl::Condition(+[](Pending *p) -> bool { return !p->lib->attributes[p->lgid].loading; }, &pending));
+  }
+
   const auto &attr = attributes[lgid];
   if (attr.is_blackbox()) {
     return {nullptr, false};  // already tried to open and failed
@@ -563,7 +1060,10 @@ std::pair<Lgraph *, bool> Graph_library::open_lgraph_int(Lg_id_t lgid) {
     return {attr.lg, false};
   }
 
-  return {nullptr, true};
+  auto claimed = claim_load_int(lgid);
+  I(claimed);
+
+  return {nullptr, true};  // caller must call do_pending_load_int
 }
 
 std::pair<Lgraph *, bool> Graph_library::open_lgraph_int(std::string_view name, std::string_view source) {
@@ -577,15 +1077,17 @@ std::pair<Lgraph *, bool> Graph_library::open_lgraph_int(std::string_view name,
 
 std::pair<Lgraph *, bool> Graph_library::open_or_create_lgraph_int(std::string_view name, std::string_view source) {
   auto [lg, pending_load] = open_lgraph_int(name, source);
-  if (lg) {
+  if (lg || pending_load) {
     return {lg, pending_load};
   }
-  I(!pending_load);
 
   return {create_lgraph_int(name, source), false};
 }
 
-Graph_library::Graph_library(std::string_view _path) : path(_path), library_file(absl::StrCat(path, "/", "graph_library.json")) {
+Graph_library::Graph_library(std::string_view _path)
+    : path(_path)
+    , library_file(absl::StrCat(path, "/", "graph_library.json"))
+    , index_file(absl::StrCat(path, "/", "graph_library.idx")) {
   graph_library_clean = true;
   reload_int();
 }
@@ -706,6 +1208,7 @@ void Graph_library::unregister_int(Lgraph *lg) {
   I(attributes.size() > (size_t)lgid);
   attributes[lgid].lg            = nullptr;
   attributes[lgid].tried_to_load = false;
+  attributes[lgid].hashed_lg     = nullptr;
 
   if (sub_nodes[lgid]->is_invalid()) {
     expunge_int(lg->get_name());
@@ -1,12 +1,16 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -28,18 +32,94 @@ protected:
   // inline static std::mutex lgs_mutex;
   mutable absl::Mutex lgs_mutex;
 
+  // Append only storage for attributes and sub_nodes. Elements never move when it grows, so the lock free readers
+  // (try_ref_lgraph, ref_sub, get_sub, get_name) can index it while a writer appends under lgs_mutex.
+  template <typename T>
+  class Stable_vector {
+  public:
+    Stable_vector()                                 = default;
+    Stable_vector(const Stable_vector &)            = delete;
+    Stable_vector &operator=(const Stable_vector &) = delete;
+    ~Stable_vector() {
+      for (auto &chunk : chunks) {
+        delete[] chunk.load(std::memory_order_relaxed);
+      }
+    }
+
+    [[nodiscard]] size_t size() const { return n_elems.load(std::memory_order_acquire); }
+
+    [[nodiscard]] T       &operator[](size_t pos) { return slot(pos); }
+    [[nodiscard]] const T &operator[](size_t pos) const { return slot(pos); }
+
+    template <typename... Args>
+    void emplace_back(Args &&...args) {
+      const auto pos  = n_elems.load(std::memory_order_relaxed);
+      alloc_slot(pos) = T(std::forward<Args>(args)...);
+      n_elems.store(pos + 1, std::memory_order_release);
+    }
+
+    void resize(size_t n, const T &value = T()) {
+      auto pos = n_elems.load(std::memory_order_relaxed);
+      for (; pos < n; ++pos) {
+        alloc_slot(pos) = value;
+      }
+      for (auto i = n; i < pos; ++i) {  // shrink: the chunks stay, entries go back to default
+        slot(i) = T();
+      }
+      n_elems.store(n, std::memory_order_release);
+    }
+
+  private:
+    static constexpr size_t first_bits = 6;  // 1st chunk has 64 entries, each next chunk doubles
+    static constexpr size_t max_chunks = 32;
+
+    std::array<std::atomic<T *>, max_chunks> chunks{};
+    std::atomic<size_t>                      n_elems{0};
+
+    [[nodiscard]] static std::pair<size_t, size_t> locate(size_t pos) {
+      const auto   v   = pos + (size_t{1} << first_bits);
+      const size_t top = std::bit_width(v) - 1;
+      return {top - first_bits, v - (size_t{1} << top)};
+    }
+
+    [[nodiscard]] T &slot(size_t pos) const {
+      const auto [chunk, offset] = locate(pos);
+      return chunks[chunk].load(std::memory_order_acquire)[offset];
+    }
+
+    [[nodiscard]] T &alloc_slot(size_t pos) {
+      const auto [chunk, offset] = locate(pos);
+      auto *data                 = chunks[chunk].load(std::memory_order_relaxed);
+      if (data == nullptr) {
+        data = new T[size_t{1} << (chunk + first_bits)]();
+        chunks[chunk].store(data, std::memory_order_release);
+      }
+      return data[offset];
+    }
+  };
+
   struct Graph_attributes {
     bool        tried_to_load;
+    bool        loading;  // claimed by a thread that is loading it (out of lgs_mutex)
     Lgraph     *lg;
     std::string source;  // File were this module came from. If file updated (all the associated Lgraphs must be deleted). If empty,
                          // it ies not present (blackbox)
     Lg_type_id version;  // In which sequence order were the graphs last modified
+
+    const Lgraph *hashed_lg;  // structural_hash is valid for this Lgraph at hashed_epoch (mutation epoch)
+    uint64_t      hashed_epoch;
+    uint64_t      structural_hash;
+
     Graph_attributes() { expunge(); }
     void expunge() {
-      tried_to_load = false;
-      lg            = nullptr;
-      version       = 0;
-      source        = "-";
+      tried_to_load   = false;
+      loading         = false;
+      lg              = nullptr;
+      version         = 0;
+      source          = "-";
+      hashed_lg       = nullptr;
+      hashed_epoch    = 0;
+      structural_hash = 0;
     }
     [[nodiscard]] bool is_blackbox() const { return tried_to_load && lg == nullptr; }
   };
@@ -58,13 +138,32 @@ protected:
   using Recycled_id      = absl::flat_hash_set<uint64_t>;
 
   const std::string path;
-  const std::string library_file;
+  const std::string library_file;  // json export (also read for lgdbs without index_file)
+  const std::string index_file;    // binary index: magic + append-only records, compacted lazily
+
+  static constexpr std::string_view index_magic = "LGLIBIX1";
 
   // Begin protected for MT
-  Name2id                       name2id;      // WR protect on add entries, RD protect any access
-  Recycled_id                   recycled_id;  // WR protect on add entries, RD protect any access
-  std::vector<Graph_attributes> attributes;   // WR protect on add entries, RD protect any access
-  std::vector<Sub_node *>       sub_nodes;    // WR protect on add entries, RD protect any access
+  Name2id                         name2id;      // WR protect on add entries, RD protect any access
+  Recycled_id                     recycled_id;  // WR protect on add entries, RD protect any access
+  Stable_vector<Graph_attributes> attributes;   // WR protect on add entries, RD by lgid without lock
+  Stable_vector<Sub_node *>       sub_nodes;    // WR protect on add entries, RD by lgid without lock
+
+  // Lock free name lookups: readers only touch an immutable copy of name2id. A hit is used while no existing name was
+  // remapped (rename, reload) since the copy; names added later miss and go to lgs_mutex. Readers that keep missing
+  // republish the copy, only if name2id changed. Replaced copies are freed once no reader is in flight (name_readers
+  // counts the readers between loading name_snapshot and their last access to it).
+  struct Name_snapshot {
+    Name2id  name2id;
+    uint64_t version;  // name2id_version when copied
+    uint64_t remaps;   // name_remaps when copied
+  };
+  uint64_t                                             name2id_version = 0;  // WR protect, bumped on any name2id change
+  std::atomic<uint64_t>                                name_remaps{0};       // bumped when an existing name may change id
+  mutable std::atomic<const Name_snapshot *>           name_snapshot{nullptr};
+  mutable std::atomic<uint32_t>                        name_readers{0};
+  mutable std::vector<std::unique_ptr<Name_snapshot>> name_snapshots;  // WR protect, current copy plus retired ones
+  mutable std::atomic<size_t>                          name_slow_hits{0};
 
   static Global_instances global_instances;  // WR protect on add entries, RD protect any access
   // End protect for MT
@@ -72,11 +171,23 @@ protected:
   std::atomic<uint32_t> max_next_version;     // Atomic, no need to lock for this
   bool                  graph_library_clean;  // No need to worry, atomic, no need to protect
 
+  std::vector<uint64_t> synced_hash;    // per lgid, hash of the last index record written or read
+  size_t                index_bytes;    // index_file size after the last reload/sync from this process
+  size_t                index_records;  // records in index_file (live entries + journal)
+  bool                  index_torn;     // partial record at the end (compact on next sync)
+  bool                  index_shared;   // another process appended records (compaction merges the file records)
+
   Graph_library() { max_next_version = 1; }
 
   explicit Graph_library(std::string_view _path);
 
   void clean_library_int();
+  void export_json_int(std::string_view file) const;
+  void index_record_int(size_t id, std::string &out) const;
+  int  open_index_int(int flags, int lock_op) const;
+  bool reload_index_int();
+  void reload_json_int();
+  void reload_entry_int(uint64_t id);
 
   ~Graph_library() = default;
 
@@ -130,6 +241,10 @@ protected:
 
   [[nodiscard]] bool has_name_int(std::string_view name) const { return name2id.find(name) != name2id.end(); }
 
+  [[nodiscard]] Lg_type_id find_lgid(std::string_view name) const;  // get_lgid_int without lgs_mutex held
+  void                     publish_names_int() const;
+  void                     reclaim_names_int() const;
+
   static Graph_library *instance_int(std::string_view path);
 
   void        unregister_int(Lgraph *lg);
@@ -147,6 +262,8 @@ protected:
   [[nodiscard]] Lgraph                   *ref_or_create_lgraph_int(std::string_view name, std::string_view source);
   [[nodiscard]] Lgraph                   *create_lgraph_int(std::string_view name, std::string_view source);
   [[nodiscard]] Lgraph                   *do_pending_load_int(Lg_id_t lgid);
+  [[nodiscard]] bool                      claim_load_int(Lg_id_t lgid);
+  void                                    prefetch_sub_int(Lgraph *lg, std::atomic<size_t> *loaded);
 
 public:
   Graph_library(const Graph_library &s)           = delete;
@@ -157,11 +274,7 @@ public:
     return exists_int(lgid);
   }
 
-  [[nodiscard]] bool exists(std::string_view name) const {
-    absl::ReaderMutexLock guard(&lgs_mutex);
-    // std::lock_guard<std::mutex> guard(lgs_mutex);
-    return exists_int(name);
-  }
+  [[nodiscard]] bool exists(std::string_view name) const { return find_lgid(name) != 0; }
 
   [[nodiscard]] Lgraph *try_ref_lgraph(const Lg_type_id lgid) const {
     // WARNING: This is a frequent case to build netlists (designed to not require lock)
@@ -169,9 +282,8 @@ public:
     return try_ref_lgraph_int(lgid);
   }
   [[nodiscard]] Lgraph *try_ref_lgraph(std::string_view name) const {
-    absl::ReaderMutexLock guard(&lgs_mutex);
-    // std::lock_guard<std::mutex> guard(lgs_mutex);
-    return try_ref_lgraph_int(name);
+    const auto lgid = find_lgid(name);
+    return lgid ? try_ref_lgraph_int(lgid) : nullptr;
   }
 
   // max_version can be used to detect the latest updated lgraphs since the
@@ -200,17 +312,9 @@ public:
     return get_sub_int(lgid);
   }
 
-  [[nodiscard]] Sub_node *ref_sub(std::string_view name) {
-    absl::ReaderMutexLock guard(&lgs_mutex);
-    // std::lock_guard<std::mutex> guard(lgs_mutex);
-    return ref_sub_int(get_lgid_int(name));
-  }
+  [[nodiscard]] Sub_node *ref_sub(std::string_view name) { return ref_sub_int(find_lgid(name)); }
 
-  [[nodiscard]] const Sub_node &get_sub(std::string_view name) const {
-    absl::ReaderMutexLock guard(&lgs_mutex);
-    // std::lock_guard<std::mutex> guard(lgs_mutex);
-    return get_sub_int(get_lgid_int(name));
-  }
+  [[nodiscard]] const Sub_node &get_sub(std::string_view name) const { return get_sub_int(find_lgid(name)); }
 
   Lg_type_id add_name(std::string_view name, std::string_view source) {
     absl::WriterMutexLock guard(&lgs_mutex);
@@ -230,11 +334,7 @@ public:
     return get_name_int(lgid);
   }
 
-  [[nodiscard]] Lg_type_id get_lgid(std::string_view name) const {
-    absl::ReaderMutexLock guard(&lgs_mutex);
-    // std::lock_guard<std::mutex> guard(lgs_mutex);
-    return get_lgid_int(name);
-  }
+  [[nodiscard]] Lg_type_id get_lgid(std::string_view name) const { return find_lgid(name); }
 
   [[nodiscard]] std::string_view get_source(Lg_type_id lgid) const {
     absl::ReaderMutexLock guard(&lgs_mutex);
@@ -260,11 +360,7 @@ public:
     return get_version_int(lgid);
   }
 
-  [[nodiscard]] bool has_name(std::string_view name) const {
-    absl::ReaderMutexLock guard(&lgs_mutex);
-    // std::lock_guard<std::mutex> guard(lgs_mutex);
-    return has_name_int(name);
-  }
+  [[nodiscard]] bool has_name(std::string_view name) const { return find_lgid(name) != 0; }
 
   // TODO: Change to Graph_library &instance...
   [[nodiscard]] static Graph_library *instance(std::string_view path) {
@@ -295,6 +391,17 @@ public:
   [[nodiscard]] Lgraph *open_lgraph(std::string_view name, std::string_view source);
   [[nodiscard]] Lgraph *open_lgraph(Lg_id_t lgid);
 
+  // Load in parallel (thread_pool) all the Lgraphs reachable from lg that are not loaded yet
+  void prefetch_hier(Lgraph *lg);
+
+  // Lgraph::get_structural_hash, a full rehash of lg when its mutation epoch moved since the last call
+  [[nodiscard]] uint64_t get_structural_hash(Lgraph *lg);
+
+  // Merge the structurally identical Lgraphs below tops (bottom up, so parameterizations that become equal once
+  // their subs are merged also match). The instances of a duplicate are rewired to the first equal Lgraph visited.
+  // Returns the duplicate to kept lgid map (tops can be duplicates too, nothing instantiates them).
+  absl::flat_hash_map<Lg_id_t, Lg_id_t> dedup_structural(absl::Span<Lgraph *const> tops);
+
   [[nodiscard]] Lgraph *open_lgraph(std::string_view source) {
     auto name = str_tools::get_str_after_last_if_exists(source, '/');
 
@@ -343,6 +450,11 @@ public:
   [[nodiscard]] absl::Span<const Tech_layer> get_layer() const { return absl::MakeSpan(layer_list); };
   [[nodiscard]] absl::Span<const Tech_via>   get_via() const { return absl::MakeSpan(via_list); };
 
+  void export_json() const {  // graph_library.json, for tools/humans (the library itself uses the binary index)
+    absl::ReaderMutexLock guard(&lgs_mutex);
+    export_json_int(library_file);
+  }
+
   void each_sub(const std::function<void(Lg_type_id lgid, std::string_view name)> &f1) const;
   void each_sub(std::string_view match, const std::function<void(Lg_type_id lgid, std::string_view name)> &f1) const;
 
@@ -0,0 +1,64 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Encoding helpers for the binary graph library index (graph_library.idx).
+// Values are stored in host byte order (the lgdb is not meant to move across
+// endianness). The get_* advance the view, callers check the sizes first
+// (skip/skip_str are the bounds checked way to do it).
+namespace lgindex {
+
+inline void put_u8(std::string &out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+
+inline void put_u16(std::string &out, uint16_t v) { out.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+
+inline void put_u32(std::string &out, uint32_t v) { out.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+
+inline void put_u64(std::string &out, uint64_t v) { out.append(reinterpret_cast<const char *>(&v), sizeof(v)); }
+
+inline void put_str(std::string &out, std::string_view s) {
+  put_u32(out, static_cast<uint32_t>(s.size()));
+  out.append(s);
+}
+
+template <typename T>
+inline T get(std::string_view &in) {
+  T v;
+  std::memcpy(&v, in.data(), sizeof(T));
+  in.remove_prefix(sizeof(T));
+  return v;
+}
+
+inline uint8_t  get_u8(std::string_view &in) { return get<uint8_t>(in); }
+inline uint16_t get_u16(std::string_view &in) { return get<uint16_t>(in); }
+inline uint32_t get_u32(std::string_view &in) { return get<uint32_t>(in); }
+inline uint64_t get_u64(std::string_view &in) { return get<uint64_t>(in); }
+
+inline std::string_view get_str(std::string_view &in) {
+  auto sz  = get_u32(in);
+  auto str = in.substr(0, sz);
+  in.remove_prefix(sz);
+  return str;
+}
+
+// Bounds checked: false (view left as is or partially consumed) if in is too short
+inline bool skip(std::string_view &in, size_t n) {
+  if (in.size() < n) {
+    return false;
+  }
+  in.remove_prefix(n);
+  return true;
+}
+
+inline bool skip_str(std::string_view &in) {
+  if (in.size() < sizeof(uint32_t)) {
+    return false;
+  }
+  return skip(in, get_u32(in));
+}
+
+}  // namespace lgindex
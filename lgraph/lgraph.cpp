@@ -4,6 +4,7 @@
 
 #include <dirent.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <format>
 #include <fstream>
@@ -255,6 +256,8 @@ void Lgraph::load(const std::shared_ptr<Hif_read> hif) {
       p.first.connect_driver(dpin);
     }
   }
+
+  mark_clean();  // same as the save file
 }
 
 Lgraph::~Lgraph() { library->unregister(this); }
@@ -1085,6 +1088,7 @@ int Lgraph::get_num_inp_edges(const Node_pin &pin) const {
 }
 
 void Lgraph::del_pin(const Node_pin &pin) {
+  mark_dirty();
   if (pin.is_graph_io()) {
     ref_self_sub_node()->del_pin(pin.get_pid());
     return;
@@ -1102,6 +1106,7 @@ void Lgraph::del_pin(const Node_pin &pin) {
 }
 
 void Lgraph::del_node(const Node &node) {
+  mark_dirty();
   auto idx2 = node.get_nid();
   I(node_internal.size() > idx2);
 
@@ -1246,6 +1251,7 @@ void Lgraph::try_del_node_int(Index_id last_idx, Index_id idx) {
 }
 
 bool Lgraph::del_edge_driver_int(const Node_pin &dpin, const Node_pin &spin) {
+  mark_dirty();
   // WARNING: The edge can be anywhere from get_node().nid to end BUT more
   // likely to find it early starting from idx. Start from idx, and go back to
   // start (nid) again once at the end. If idx again, then it is not anywhere.
@@ -1316,6 +1322,7 @@ bool Lgraph::del_edge_driver_int(const Node_pin &dpin, const Node_pin &spin) {
 }
 
 bool Lgraph::del_edge_sink_int(const Node_pin &dpin, const Node_pin &spin) {
+  mark_dirty();
   // WARNING: The edge can be anywhere from get_node().nid to end BUT more
   // likely to find it early starting from idx. Start from idx, and go back to
   // start (nid) again once at the end. If idx again, then it is not anywhere.
@@ -1497,7 +1504,10 @@ Node Lgraph::create_node_sub(std::string_view sub_name) {
 
 const Sub_node &Lgraph::get_self_sub_node() const { return library->get_sub(get_lgid()); }
 
-Sub_node *Lgraph::ref_self_sub_node() { return library->ref_sub(get_lgid()); }
+Sub_node *Lgraph::ref_self_sub_node() {
+  mark_dirty();  // IOs are saved with the graph
+  return library->ref_sub(get_lgid());
+}
 
 void Lgraph::trace_back2driver(Node_pin_iterator &xiter, const Node_pin &dpin, const Node_pin &spin) {
   I(dpin.is_hierarchical());
@@ -1569,12 +1579,16 @@ Bwd_edge_iterator Lgraph::backward(bool visit_sub) { return Bwd_edge_iterator(th
 Fast_edge_iterator Lgraph::fast(bool visit_sub) { return Fast_edge_iterator(this, visit_sub); }
 
 void Lgraph::save(std::string filename) {
+  bool save_file = filename.empty();
+  if (save_file) {
+    filename = get_save_filename();
+    if (!is_dirty() && access(filename.c_str(), F_OK) == 0) {
+      return;  // not modified since the last load/save
+    }
+  }
 #ifndef NDEBUG
   std::print("lgraph save: {}, size: {}\n", name, node_internal.size());
 #endif
-  if (filename == "") {
-    filename = get_save_filename();
-  }
 
   auto wr = Hif_write::create(filename, "lgraph", Lgraph::version);
   if (wr == nullptr) {
@@ -1702,6 +1716,10 @@ void Lgraph::save(std::string filename) {
   if (!n.io.empty()) {
     wr->add(n);
   }
+
+  if (save_file) {
+    mark_clean();
+  }
 }
 
 void Lgraph::dump(bool hier) {
@@ -25,12 +25,15 @@ protected:
   friend class Bwd_edge_iterator;
   friend class Fast_edge_iterator;
   friend class Graph_library;
+  friend class Hier_scheduler;
 
   // Memoize tables that provide hints (not certainty because add/del operations)
   std::array<Index_id, 16> memoize_const_hint;
 
   Hierarchy htree;
 
+  uint64_t last_visit_ns = 0;  // runtime of the last bottom-up parallel visit (scheduling cost hint), 0 if never visited
+
   void setup_hierarchy_down(Lgraph *sub_lg, Hierarchy_index parent_hidx);
   void setup_hierarchy_for_traversal();
 
@@ -162,17 +165,9 @@ protected:
 
   void each_hier_unique_sub_bottom_up_int(std::set<Lg_type_id> &visited, const std::function<void(Lgraph *lg_sub)> &fn);
 
-  using Parent_map_type = absl::node_hash_map<Lgraph *, std::vector<Lgraph *>>;
-  using Pending_map     = absl::flat_hash_map<Lgraph *, int>;
-
-  void bottom_up_visit_wrap(const std::function<void(Lgraph *lg_sub)> *fn, Pending_map *pending_map,
-                            const Parent_map_type *parent_map);
-
-  void bottom_up_visit_step(Pending_map &pending_map, Parent_map_type &parent_map, absl::flat_hash_set<Lgraph *> &leafs_set,
-                            std::vector<Lgraph *> &leafs);
-
-  void clear_int();  // same as clear but when called by graph_library to avoid locks
-  void load(const std::shared_ptr<Hif_read> hif);
+  void     clear_int();  // same as clear but when called by graph_library to avoid locks
+  uint64_t compute_structural_hash();  // lgraph_structural.cpp, cached by Graph_library::get_structural_hash
+  void     load(const std::shared_ptr<Hif_read> hif);
 
 public:
   Lgraph()               = delete;
@@ -245,6 +240,12 @@ public:
   [[nodiscard]] bool has_graph_input(std::string_view name) const;
   [[nodiscard]] bool has_graph_output(std::string_view name) const;
 
+  // Node id independent hash of the netlist (IOs, cell types, consts, luts, sub lgids, pids, bits). Cached in the
+  // Graph_library per mutation epoch: any edit makes the next call rehash the whole graph (not only the edited nodes).
+  // A hash match still needs is_structurally_equal to confirm.
+  [[nodiscard]] uint64_t get_structural_hash();
+  [[nodiscard]] bool     is_structurally_equal(Lgraph *other);
+
   // Iterators defined in the lgraph_each.cpp
 
   void each_pin(const Node_pin &dpin, const std::function<bool(Index_id idx)> &f1) const;
@@ -260,6 +261,9 @@ public:
   void each_hier_unique_sub_bottom_up(const std::function<void(Lgraph *lg_sub)> &fn);
 
   void each_hier_unique_sub_bottom_up_parallel2(const std::function<void(Lgraph *lg_sub)> &fn);
+  // stage i of a module waits for stage i of its subs and stage i-1 of itself, so different modules overlap stages
+  // (e.g: cprop -> bitwidth -> cgen)
+  void each_hier_unique_sub_bottom_up_pipelined(const std::vector<std::function<void(Lgraph *lg_sub)>> &stages);
 
   template <typename FN>
   void each_local_sub_fast(const FN f1) {
@@ -21,6 +21,7 @@ void Lgraph_attributes::clear() {
   node_pin_name_map.clear();
   node_pin_name_rmap.clear();
   node_pin_delay_map.clear();
+  node_pin_corner_delay_map.clear();
   node_pin_unsigned_map.clear();
 
   node_name_map.clear();
@@ -33,6 +34,7 @@ void Lgraph_attributes::clear() {
 }
 
 void Lgraph_attributes::set_type(Index_id nid, const Ntype_op op) {
+  mark_dirty();
   I(node_internal[nid].is_master_root());
 
   auto type = node_internal[nid].get_type();
@@ -60,6 +62,10 @@ bool Lgraph_attributes::is_type_const(Index_id nid) const {
 }
 
 void Lgraph_attributes::set_type_sub(Index_id nid, Lg_type_id subgraphid) {
+  mark_dirty();
+  if (node_internal[nid].get_type() == Ntype_op::Sub) {
+    set_type(nid, Ntype_op::Sub);  // retarget: drop the old subid_map entry and down_class_map count
+  }
   subid_map.insert_or_assign(Node::Compact_class(nid), subgraphid.value);
 
   auto it = down_class_map.find(subgraphid);
@@ -120,6 +126,7 @@ Sub_node *Lgraph_attributes::ref_type_sub_node(std::string_view sub_name) {
 }
 
 void Lgraph_attributes::set_type_lut(Index_id nid, const Lconst &lutid) {
+  mark_dirty();
   node_internal[nid].set_type(Ntype_op::LUT);
 
   lut_map.insert_or_assign(Node::Compact_class(nid), lutid.serialize());
@@ -142,6 +149,7 @@ Lconst Lgraph_attributes::get_type_const(Index_id nid) const {
 }
 
 void Lgraph_attributes::set_type_const(Index_id nid, const Lconst &value) {
+  mark_dirty();
   const_map.insert_or_assign(Node::Compact_class(nid), value.serialize());
 
   auto *ptr = &node_internal[nid];
@@ -36,22 +36,38 @@ public:
   using Node_pin_name_map  = absl::flat_hash_map<Node_pin::Compact_class_driver, std::string>;
   using Node_pin_name_rmap = absl::flat_hash_map<std::string, Node_pin::Compact_class_driver>;
   [[nodiscard]] const Node_pin_name_map &get_node_pin_name_map() const { return node_pin_name_map; };
-  [[nodiscard]] Node_pin_name_map       *ref_node_pin_name_map() { return &node_pin_name_map; };
+  [[nodiscard]] Node_pin_name_map       *ref_node_pin_name_map() {
+    mark_dirty();  // saved attribute
+    return &node_pin_name_map;
+  };
 
   [[nodiscard]] const Node_pin_name_rmap &get_node_pin_name_rmap() const { return node_pin_name_rmap; };
-  [[nodiscard]] Node_pin_name_rmap       *ref_node_pin_name_rmap() { return &node_pin_name_rmap; };
+  [[nodiscard]] Node_pin_name_rmap       *ref_node_pin_name_rmap() {
+    mark_dirty();  // saved attribute
+    return &node_pin_name_rmap;
+  };
 
   using Node_pin_delay_map = absl::flat_hash_map<Node_pin::Compact_driver, float>;
   [[nodiscard]] const Node_pin_delay_map &get_node_pin_delay_map() const { return node_pin_delay_map; };
   [[nodiscard]] Node_pin_delay_map       *ref_node_pin_delay_map() { return &node_pin_delay_map; };
 
+  using Node_pin_corner_delay_map = std::vector<Node_pin_delay_map>;  // per timing corner (node_pin_delay_map is the worst)
+  [[nodiscard]] const Node_pin_corner_delay_map &get_node_pin_corner_delay_map() const { return node_pin_corner_delay_map; };
+  [[nodiscard]] Node_pin_corner_delay_map       *ref_node_pin_corner_delay_map() { return &node_pin_corner_delay_map; };
+
   using Node_pin_unsigned_map = absl::flat_hash_set<Node_pin::Compact_driver>;
   [[nodiscard]] const Node_pin_unsigned_map &get_node_pin_unsigned_map() const { return node_pin_unsigned_map; };
-  [[nodiscard]] Node_pin_unsigned_map       *ref_node_pin_unsigned_map() { return &node_pin_unsigned_map; };
+  [[nodiscard]] Node_pin_unsigned_map       *ref_node_pin_unsigned_map() {
+    mark_dirty();  // not saved, but the emitted code (and the epoch users) depend on it
+    return &node_pin_unsigned_map;
+  };
 
   using Node_name_map = absl::flat_hash_map<Node::Compact_class, std::string>;
   [[nodiscard]] const Node_name_map &get_node_name_map() const { return node_name_map; };
-  [[nodiscard]] Node_name_map       *ref_node_name_map() { return &node_name_map; };
+  [[nodiscard]] Node_name_map       *ref_node_name_map() {
+    mark_dirty();  // not saved, but the emitted code (and the epoch users) depend on it
+    return &node_name_map;
+  };
 
   using Node_color_map = absl::flat_hash_map<Node::Compact_class, int>;
   [[nodiscard]] const Node_color_map &get_node_color_map() const { return node_color_map; };
@@ -63,11 +79,17 @@ public:
 
   using Node_loc_map = absl::flat_hash_map<Node::Compact_class, std::pair<uint64_t, uint64_t>>;  // pos1 and pos2 from LN
   [[nodiscard]] const Node_loc_map &get_node_loc_map() const { return node_loc_map; };
-  [[nodiscard]] Node_loc_map       *ref_node_loc_map() { return &node_loc_map; };
+  [[nodiscard]] Node_loc_map       *ref_node_loc_map() {
+    mark_dirty();  // saved attribute
+    return &node_loc_map;
+  };
 
   using Node_source_map = absl::flat_hash_map<Node::Compact_class, std::string>;  // source file name from LN
   [[nodiscard]] const Node_source_map &get_node_source_map() const { return node_source_map; };
-  [[nodiscard]] Node_source_map       *ref_node_source_map() { return &node_source_map; };
+  [[nodiscard]] Node_source_map       *ref_node_source_map() {
+    mark_dirty();  // saved attribute
+    return &node_source_map;
+  };
 
   void dump_source_map() const;
 
@@ -81,11 +103,12 @@ protected:
 
   Node_lut_map lut_map;
 
-  Node_pin_offset_map   node_pin_offset_map;
-  Node_pin_name_map     node_pin_name_map;
-  Node_pin_name_rmap    node_pin_name_rmap;
-  Node_pin_delay_map    node_pin_delay_map;
-  Node_pin_unsigned_map node_pin_unsigned_map;
+  Node_pin_offset_map       node_pin_offset_map;
+  Node_pin_name_map         node_pin_name_map;
+  Node_pin_name_rmap        node_pin_name_rmap;
+  Node_pin_delay_map        node_pin_delay_map;
+  Node_pin_corner_delay_map node_pin_corner_delay_map;
+  Node_pin_unsigned_map     node_pin_unsigned_map;
 
   Node_name_map   node_name_map;
   Node_color_map  node_color_map;
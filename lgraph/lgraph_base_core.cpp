@@ -42,11 +42,14 @@ Lgraph_base_core::Lgraph_base_core(std::string_view _path, std::string_view _nam
     , name(_name)
     , unique_name(absl::StrCat(_path, "/", str_tools::to_s(_lgid.value)))
     , long_name(absl::StrCat("lgraph_", _name))
-    , lgid(_lgid) {
+    , lgid(_lgid)
+    , mutation_epoch(1)
+    , saved_epoch(0) {
   assert(lgid);
 }
 
 void Lgraph_base_core::clear() {
+  mark_dirty();
   // whenever we clean, we unlock
   auto lock = absl::StrCat(path, "/", std::to_string(lgid), ".lock");
   unlink(lock.c_str());
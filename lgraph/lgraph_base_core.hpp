@@ -62,6 +62,9 @@ protected:
   const std::string long_name;
   const Lg_type_id  lgid;
 
+  uint64_t mutation_epoch;  // bumped by any change to the state that save() persists
+  uint64_t saved_epoch;     // mutation_epoch when the graph last matched its save file
+
   explicit Lgraph_base_core(std::string_view _path, std::string_view _name, Lg_type_id _lgid);
   virtual ~Lgraph_base_core() = default;
 
@@ -78,4 +81,9 @@ public:
   [[nodiscard]] std::string      get_save_filename() const { return absl::StrCat(path, "/", name); }
 
   [[nodiscard]] const Lg_type_id get_lgid() const { return lgid; }
+
+  void                   mark_dirty() { ++mutation_epoch; }
+  void                   mark_clean() { saved_epoch = mutation_epoch; }
+  [[nodiscard]] bool     is_dirty() const { return mutation_epoch != saved_epoch; }
+  [[nodiscard]] uint64_t get_mutation_epoch() const { return mutation_epoch; }
 };
@@ -1,6 +1,11 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
-#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <tuple>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
@@ -222,69 +227,171 @@ void Lgraph::each_hier_unique_sub_bottom_up(const std::function<void(Lgraph *lg_
   fn(this);  // itself
 }
 
-void Lgraph::bottom_up_visit_wrap(const std::function<void(Lgraph *lg_sub)> *fn, Pending_map *pending_map,
-                                  const Parent_map_type *parent_map) {
-  (*fn)(this);
+// Bottom-up scheduler over the unique hierarchy DAG. A task is a (module, stage) pair that waits for the same stage of
+// all the subs and for the previous stage of the module. Ready tasks run longest remaining path first (critical path of
+// the hierarchy), with the module cost from its last measured visit, or its node count when never measured.
+class Hier_scheduler {
+public:
+  using Stage_fn = std::function<void(Lgraph *lg_sub)>;
 
-  const auto it = parent_map->find(this);
-  if (it == parent_map->end()) {
-    return;
+  Hier_scheduler(Lgraph *top, const std::vector<Stage_fn> &_stages) : stages(_stages) {
+    add_module(top);
+    setup_priority();
   }
 
-  for (auto *parent_lg : it->second) {
-    auto it2 = pending_map->find(parent_lg);
-    I(it2 != pending_map->end());
-    // WARNING: NASTY cast to atomic because map does not allow to have an atomic as 2nd entry
-    int n_pending = atomic_fetch_sub_explicit((std::atomic<int> *)(&it2->second), 1, std::memory_order_relaxed);
-    if (n_pending == 1) {
-      I(it2->second == 0);
-#ifdef NO_BOTTOM_UP_PARALLEL
-      parent_lg->bottom_up_visit_wrap(fn, pending_map, parent_map);
-#else
-      thread_pool.add(&Lgraph::bottom_up_visit_wrap, parent_lg, fn, pending_map, parent_map);
-#endif
+  void run() {
+    for (auto i = 0u; i < mods.size(); ++i) {
+      if (pending[task_pos(i, 0)] == 0) {
+        ready.emplace(priority[task_pos(i, 0)], i, 0);
+      }
     }
-  }
-}
+    spawn(ready.size());
+    thread_pool.wait_all();
 
-void Lgraph::bottom_up_visit_step(Pending_map &pending_map, Parent_map_type &parent_map, absl::flat_hash_set<Lgraph *> &leafs_set,
-                                  std::vector<Lgraph *> &leafs) {
-  bool leaf = true;
-  for (const auto &ent : get_down_class_map()) {
-    auto *down_lg = ref_library()->open_lgraph(Lg_type_id(ent.first));
-    if (down_lg != nullptr && !down_lg->is_empty()) {
-      leaf = false;
-      parent_map[down_lg].emplace_back(this);
-      pending_map[this]++;
-      down_lg->bottom_up_visit_step(pending_map, parent_map, leafs_set, leafs);
+    for (auto &mod : mods) {
+      mod.lg->last_visit_ns = mod.measured_ns;
     }
   }
 
-  if (leaf) {
-    auto it = leafs_set.insert(this);
-    if (it.second) {
-      leafs.emplace_back(this);
+private:
+  struct Module {
+    Lgraph               *lg;
+    std::vector<uint32_t> parents;
+    uint32_t              n_subs      = 0;
+    uint64_t              measured_ns = 0;
+  };
+  using Task = std::tuple<uint64_t, uint32_t, uint32_t>;  // priority, module, stage
+
+  const std::vector<Stage_fn>             &stages;
+  std::vector<Module>                      mods;  // subs before parents
+  absl::flat_hash_map<Lgraph *, uint32_t> lg2mod;
+  std::vector<uint64_t>                    priority;  // per task
+  std::vector<uint32_t>                    pending;   // per task, WR protect by ready_mutex
+
+  std::mutex               ready_mutex;
+  std::priority_queue<Task> ready;
+
+  [[nodiscard]] size_t task_pos(uint32_t mod, uint32_t stage) const { return mod * stages.size() + stage; }
+
+  uint32_t add_module(Lgraph *lg) {
+    const auto it = lg2mod.find(lg);
+    if (it != lg2mod.end()) {
+      return it->second;
+    }
+
+    std::vector<uint32_t> subs;
+    for (const auto &ent : lg->get_down_class_map()) {
+      auto *down_lg = lg->ref_library()->open_lgraph(Lg_type_id(ent.first));
+      if (down_lg != nullptr && !down_lg->is_empty()) {
+        subs.emplace_back(add_module(down_lg));
+      }
     }
+
+    const uint32_t pos = mods.size();
+    lg2mod.emplace(lg, pos);
+    mods.emplace_back(lg);
+    mods.back().n_subs = subs.size();
+    for (auto sub : subs) {
+      mods[sub].parents.emplace_back(pos);
+    }
+    return pos;
   }
-}
 
-void Lgraph::each_hier_unique_sub_bottom_up_parallel2(const std::function<void(Lgraph *lg_sub)> &fn) {
-  Pending_map     pending_map;
-  Parent_map_type parent_map;
+  void setup_priority() {
+    // Scale node counts to ns with the modules already measured
+    uint64_t total_ns    = 0;
+    uint64_t total_nodes = 0;
+    for (const auto &mod : mods) {
+      if (mod.lg->last_visit_ns) {
+        total_ns += mod.lg->last_visit_ns;
+        total_nodes += mod.lg->node_internal.size();
+      }
+    }
+    const double ns_per_node = total_nodes ? static_cast<double>(total_ns) / total_nodes : 1.0;
+
+    priority.resize(mods.size() * stages.size());
+    pending.resize(mods.size() * stages.size());
+    for (auto i = static_cast<uint32_t>(mods.size()); i-- > 0;) {  // parents first
+      const auto &mod  = mods[i];
+      uint64_t    cost = mod.lg->last_visit_ns;
+      if (cost == 0) {
+        cost = static_cast<uint64_t>(ns_per_node * mod.lg->node_internal.size());
+      }
+      cost = cost / stages.size() + 1;
 
-  absl::flat_hash_set<Lgraph *> leafs_set;
-  std::vector<Lgraph *>         leafs;
+      for (auto s = static_cast<uint32_t>(stages.size()); s-- > 0;) {
+        uint64_t after = 0;  // longest path that this task releases
+        if (s + 1 < stages.size()) {
+          after = priority[task_pos(i, s + 1)];
+        }
+        for (auto parent : mod.parents) {
+          after = std::max(after, priority[task_pos(parent, s)]);
+        }
+        priority[task_pos(i, s)] = cost + after;
+        pending[task_pos(i, s)]  = mod.n_subs + (s ? 1 : 0);
+      }
+    }
+  }
 
-  bottom_up_visit_step(pending_map, parent_map, leafs_set, leafs);  // single-thread
+  void release(uint32_t mod, uint32_t stage, size_t &n_ready) {  // ready_mutex held
+    const auto pos = task_pos(mod, stage);
+    I(pending[pos] > 0);
+    if (--pending[pos] == 0) {
+      ready.emplace(priority[pos], mod, stage);
+      ++n_ready;
+    }
+  }
 
-  if (!leafs.empty()) {
-    for (auto *lg : leafs) {
+  void spawn(size_t n) {
+    // One token per ready task. A token runs the highest priority ready task, not the one that released it.
+    for (auto i = 0u; i < n; ++i) {
 #ifdef NO_BOTTOM_UP_PARALLEL
-      lg->bottom_up_visit_wrap(&fn, &pending_map, &parent_map);
+      run_one();
 #else
-      thread_pool.add(&Lgraph::bottom_up_visit_wrap, lg, &fn, &pending_map, &parent_map);
+      thread_pool.add(&Hier_scheduler::run_one, this);
 #endif
     }
-    thread_pool.wait_all();
   }
+
+  void run_one() {
+    uint32_t mod;
+    uint32_t stage;
+    {
+      std::lock_guard<std::mutex> guard(ready_mutex);
+      I(!ready.empty());
+      std::tie(std::ignore, mod, stage) = ready.top();
+      ready.pop();
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    stages[stage](mods[mod].lg);
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    size_t n_ready = 0;
+    {
+      std::lock_guard<std::mutex> guard(ready_mutex);
+      mods[mod].measured_ns += ns;
+      if (stage + 1 < stages.size()) {
+        release(mod, stage + 1, n_ready);
+      }
+      for (auto parent : mods[mod].parents) {
+        release(parent, stage, n_ready);
+      }
+    }
+    spawn(n_ready);
+  }
+};
+
+void Lgraph::each_hier_unique_sub_bottom_up_parallel2(const std::function<void(Lgraph *lg_sub)> &fn) {
+  const std::vector<Hier_scheduler::Stage_fn> stages{fn};
+  Hier_scheduler                              sched(this, stages);
+  sched.run();
+}
+
+void Lgraph::each_hier_unique_sub_bottom_up_pipelined(const std::vector<std::function<void(Lgraph *lg_sub)>> &stages) {
+  if (stages.empty()) {
+    return;
+  }
+  Hier_scheduler sched(this, stages);
+  sched.run();
 }
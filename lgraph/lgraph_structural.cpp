@@ -0,0 +1,265 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "node.hpp"
+#include "node_pin.hpp"
+#include "perf_tracing.hpp"
+#include "sub_node.hpp"
+#include "woothash.hpp"
+
+// Structural hash: Weisfeiler-Lehman like refinement over the netlist. Each node starts with a label from its own
+// attributes (type, const, lut, sub lgid) and each round folds in the sorted (sink pid, driver label, driver pid,
+// bits) of its inputs. The result does not depend on node ids, creation order, or wire names.
+//
+// There is no per-node update: the rounds spread a change structural_rounds levels forward, and the lgraph only keeps
+// a mutation epoch (no list of edited nodes), so finding the affected nodes would walk all the edges anyway. Edits pay
+// a full rehash on the next get_structural_hash; untouched lgraphs are served from the Graph_library cache.
+
+namespace {
+
+constexpr int      structural_rounds = 4;
+constexpr uint32_t input_pos         = std::numeric_limits<uint32_t>::max();  // driver is the graph input node
+constexpr uint64_t input_label       = 0x9e3779b97f4a7c15ULL;
+constexpr uint64_t output_label      = 0xc2b2ae3d27d4eb4fULL;
+
+inline uint64_t mix(uint64_t a, uint64_t b) {
+  uint64_t v[2] = {a, b};
+  return lh::woothash64(v, sizeof(v));
+}
+
+class Structural_view {
+public:
+  struct Edge {
+    uint32_t driver;  // position in nodes, or input_pos
+    Port_ID  sink_pid;
+    Port_ID  driver_pid;
+    Bits_t   driver_bits;
+    bool     driver_unsign;
+  };
+  using IO_key = std::tuple<std::string, bool, Port_ID, Port_ID, Bits_t>;  // name, input, pos, pid, bits
+
+  std::vector<Node>     nodes;  // fast() order, graph output node last
+  std::vector<uint32_t> edge_start;
+  std::vector<Edge>     edges;
+  std::vector<uint64_t> label;
+  std::vector<IO_key>   ios;
+  uint64_t              io_hash;
+  uint64_t              graph_hash;
+
+  explicit Structural_view(Lgraph *lg) {
+    absl::flat_hash_map<uint32_t, uint32_t> nid2pos;  // nid -> position in nodes
+    for (auto node : lg->fast()) {
+      nid2pos.emplace(node.get_nid().value, nodes.size());
+      nodes.emplace_back(node);
+    }
+    auto out_node = lg->get_graph_output_node();
+    nid2pos.emplace(out_node.get_nid().value, nodes.size());
+    nodes.emplace_back(out_node);
+
+    edge_start.reserve(nodes.size() + 1);
+    for (const auto &node : nodes) {
+      edge_start.emplace_back(edges.size());
+      for (const auto &e : node.inp_edges()) {
+        auto driver = input_pos;
+        if (!e.driver.is_graph_input()) {
+          const auto it = nid2pos.find(e.driver.get_node().get_nid().value);
+          I(it != nid2pos.end());
+          driver = it->second;
+        }
+        edges.emplace_back(driver, e.sink.get_pid(), e.driver.get_pid(), e.driver.get_bits(), e.driver.is_unsign());
+      }
+    }
+    edge_start.emplace_back(edges.size());
+
+    for (const auto &io_pin : lg->get_self_sub_node().get_io_pins()) {
+      if (io_pin.is_invalid()) {
+        continue;
+      }
+      Bits_t bits = 0;
+      if (io_pin.is_input() && lg->has_graph_input(io_pin.name)) {
+        bits = lg->get_graph_input(io_pin.name).get_bits();
+      } else if (!io_pin.is_input() && lg->has_graph_output(io_pin.name)) {
+        bits = lg->get_graph_output(io_pin.name).get_bits();
+      }
+      ios.emplace_back(io_pin.name, io_pin.is_input(), io_pin.graph_io_pos, io_pin.get_instance_pid(), bits);
+    }
+    std::sort(ios.begin(), ios.end());
+
+    io_hash = 0;
+    for (const auto &[name, input, pos, pid, bits] : ios) {
+      uint64_t h = lh::woothash64(name.data(), name.size());
+      h          = mix(h, (static_cast<uint64_t>(pos) << 33) | (static_cast<uint64_t>(pid) << 1) | (input ? 1 : 0));
+      io_hash    = mix(io_hash, mix(h, bits));
+    }
+
+    label.resize(nodes.size());
+    for (auto pos = 0u; pos < nodes.size(); ++pos) {
+      label[pos] = local_label(nodes[pos]);
+    }
+
+    std::vector<uint64_t> next(nodes.size());
+    std::vector<uint64_t> keys;
+    for (int round = 0; round < structural_rounds; ++round) {
+      for (auto pos = 0u; pos < nodes.size(); ++pos) {
+        keys.clear();
+        for (auto i = edge_start[pos]; i < edge_start[pos + 1]; ++i) {
+          keys.emplace_back(edge_key(edges[i]));
+        }
+        std::sort(keys.begin(), keys.end());
+        next[pos] = lh::woothash64(keys.data(), keys.size() * sizeof(uint64_t), label[pos]);
+      }
+      label.swap(next);
+    }
+
+    keys = label;
+    std::sort(keys.begin(), keys.end());
+    graph_hash = lh::woothash64(keys.data(), keys.size() * sizeof(uint64_t), io_hash);
+  }
+
+  [[nodiscard]] uint64_t driver_label(const Edge &e) const { return e.driver == input_pos ? input_label : label[e.driver]; }
+
+  [[nodiscard]] uint64_t edge_key(const Edge &e) const {
+    auto pins = (static_cast<uint64_t>(e.sink_pid) << 32) | e.driver_pid;
+    auto bits = (static_cast<uint64_t>(e.driver_bits) << 1) | (e.driver_unsign ? 1 : 0);
+    return mix(mix(pins, bits), driver_label(e));
+  }
+
+  // Inputs of nodes[pos] in a canonical order (ties between equal labels keep an arbitrary order)
+  [[nodiscard]] std::vector<const Edge *> sorted_inputs(uint32_t pos) const {
+    std::vector<const Edge *> inputs;
+    for (auto i = edge_start[pos]; i < edge_start[pos + 1]; ++i) {
+      inputs.emplace_back(&edges[i]);
+    }
+    std::sort(inputs.begin(), inputs.end(), [this](const Edge *a, const Edge *b) {
+      return std::make_tuple(a->sink_pid, driver_label(*a), a->driver_pid)
+             < std::make_tuple(b->sink_pid, driver_label(*b), b->driver_pid);
+    });
+    return inputs;
+  }
+
+  static uint64_t local_label(const Node &node) {
+    if (node.is_graph_output()) {
+      return output_label;
+    }
+    auto op = node.get_type_op();
+    auto h  = static_cast<uint64_t>(op);
+    if (op == Ntype_op::Const) {
+      h = mix(h, node.get_type_const().hash());
+    } else if (op == Ntype_op::Sub) {
+      h = mix(h, node.get_type_sub().value);
+    } else if (op == Ntype_op::LUT) {
+      h = mix(h, node.get_type_lut().hash());
+    }
+    return h;
+  }
+
+  static bool same_local(const Node &a, const Node &b) {
+    if (a.is_graph_output() || b.is_graph_output()) {
+      return a.is_graph_output() && b.is_graph_output();
+    }
+    auto op = a.get_type_op();
+    if (op != b.get_type_op()) {
+      return false;
+    }
+    if (op == Ntype_op::Const) {
+      return a.get_type_const() == b.get_type_const();
+    }
+    if (op == Ntype_op::Sub) {
+      return a.get_type_sub() == b.get_type_sub();
+    }
+    if (op == Ntype_op::LUT) {
+      return a.get_type_lut() == b.get_type_lut();
+    }
+    return true;
+  }
+};
+
+}  // namespace
+
+uint64_t Lgraph::compute_structural_hash() {
+  TRACE_EVENT("lgraph", "lgraph_structural_hash");
+
+  Structural_view view(this);
+  return view.graph_hash;
+}
+
+uint64_t Lgraph::get_structural_hash() { return ref_library()->get_structural_hash(this); }
+
+bool Lgraph::is_structurally_equal(Lgraph *other) {
+  if (other == this) {
+    return true;
+  }
+  if (get_structural_hash() != other->get_structural_hash()) {
+    return false;
+  }
+
+  TRACE_EVENT("lgraph", "lgraph_structural_equal");
+
+  const Structural_view va(this);
+  const Structural_view vb(other);
+  if (va.ios != vb.ios || va.nodes.size() != vb.nodes.size() || va.edges.size() != vb.edges.size()) {
+    return false;
+  }
+
+  // Lockstep walk back from the graph outputs. The mapping between both graphs must stay a bijection.
+  std::vector<uint32_t> a2b(va.nodes.size(), input_pos);
+  std::vector<uint32_t> b2a(vb.nodes.size(), input_pos);
+  std::vector<std::pair<uint32_t, uint32_t>> pending;
+
+  size_t n_mapped = 0;
+  auto   map_pair = [&](uint32_t pa, uint32_t pb) {
+    if (a2b[pa] != input_pos || b2a[pb] != input_pos) {
+      return a2b[pa] == pb && b2a[pb] == pa;
+    }
+    a2b[pa] = pb;
+    b2a[pb] = pa;
+    ++n_mapped;
+    pending.emplace_back(pa, pb);
+    return true;
+  };
+
+  map_pair(va.nodes.size() - 1, vb.nodes.size() - 1);  // graph output nodes
+
+  while (!pending.empty()) {
+    auto [pa, pb] = pending.back();
+    pending.pop_back();
+
+    if (va.label[pa] != vb.label[pb] || !Structural_view::same_local(va.nodes[pa], vb.nodes[pb])) {
+      return false;
+    }
+
+    auto ia = va.sorted_inputs(pa);
+    auto ib = vb.sorted_inputs(pb);
+    if (ia.size() != ib.size()) {
+      return false;
+    }
+    for (auto i = 0u; i < ia.size(); ++i) {
+      const auto &ea = *ia[i];
+      const auto &eb = *ib[i];
+      if (ea.sink_pid != eb.sink_pid || ea.driver_pid != eb.driver_pid || ea.driver_bits != eb.driver_bits
+          || ea.driver_unsign != eb.driver_unsign) {
+        return false;
+      }
+      if (ea.driver == input_pos || eb.driver == input_pos) {
+        if (ea.driver != eb.driver) {
+          return false;
+        }
+        continue;
+      }
+      if (!map_pair(ea.driver, eb.driver)) {
+        return false;
+      }
+    }
+  }
+
+  // Logic not reachable from the outputs is not matched (conservative: the graphs are not merged)
+  return n_mapped == va.nodes.size();
+}
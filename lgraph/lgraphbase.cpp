@@ -45,6 +45,7 @@ void Lgraph_Base::clear() {
 }
 
 void Lgraph_Base::emplace_back() {
+  mark_dirty();
   Node_internal xx;
   node_internal.emplace_back(xx);
 
@@ -468,6 +469,7 @@ Index_id Lgraph_Base::get_space_output_pin(const Index_id start_nid, const Port_
 }
 
 void Lgraph_Base::add_edge_int(const Index_id dst_idx, const Port_ID inp_pid, Index_id src_idx, Port_ID dst_pid) {
+  mark_dirty();
   // Do not point to intermediate nodes which can be remapped, just root nodes
 
   // node_internal.ref_lock();
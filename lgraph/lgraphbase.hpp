@@ -56,6 +56,7 @@ protected:
 
   void set_bits(Index_id idx, uint32_t bits) {
     I(idx < node_internal.size());
+    mark_dirty();
     // node_internal.ref_lock();
     node_internal[idx].set_bits(bits);
     // node_internal.ref_unlock();
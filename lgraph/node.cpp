@@ -314,7 +314,9 @@ Node_pin Node::setup_sink_pin_raw(Port_ID pid) {
   if (is_type_sub()) {
     Lg_type_id  sub_lgid = current_g->get_type_sub(nid);
     const auto &sub      = current_g->get_library().get_sub(sub_lgid);
-    I(sub.has_instance_pin(pid));
+    if (pid != 0) {  // "$" is not a Sub_node io, and it can be set up while another thread fills the sub ios
+      I(sub.has_instance_pin(pid));
+    }
   } else {
     I(Ntype::has_sink(get_type_op(), pid));
   }
@@ -564,9 +566,9 @@ std::string_view Node::get_hier_name() const {
 std::string Node::get_or_create_name() const {
   auto root_name = get_hier_name();
 
-  auto      *ref = current_g->ref_node_name_map();
-  const auto it  = ref->find(get_compact_class());
-  if (it != ref->end()) {
+  const auto &ref = current_g->get_node_name_map();
+  const auto  it  = ref.find(get_compact_class());
+  if (it != ref.end()) {
     return absl::StrCat(root_name, ",", it->second);
   }
 
@@ -594,10 +596,10 @@ std::string Node::debug_name() const {
   }
   I(current_g);
 
-  auto       *ref = current_g->ref_node_name_map();
+  const auto &ref = current_g->get_node_name_map();
   std::string name;
-  const auto  it = ref->find(get_compact_class());
-  if (it != ref->end()) {
+  const auto  it = ref.find(get_compact_class());
+  if (it != ref.end()) {
     name = it->second;
   }
 
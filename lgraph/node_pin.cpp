@@ -313,7 +313,34 @@ float Node_pin::get_delay() const {
   return it->second;
 }
 
-void Node_pin::del_delay() { top_g->ref_node_pin_delay_map()->erase(get_compact_driver()); }
+void Node_pin::del_delay() {
+  const auto cd = get_compact_driver();
+  top_g->ref_node_pin_delay_map()->erase(cd);
+  for (auto &corner_map : *top_g->ref_node_pin_corner_delay_map()) {
+    corner_map.erase(cd);
+  }
+}
+
+void Node_pin::set_corner_delay(size_t corner, float val) {
+  auto *ptr = top_g->ref_node_pin_corner_delay_map();
+  if (ptr->size() <= corner) {
+    ptr->resize(corner + 1);
+  }
+  (*ptr)[corner].insert_or_assign(get_compact_driver(), val);
+}
+
+bool Node_pin::has_corner_delay(size_t corner) const {
+  const auto &ptr = top_g->get_node_pin_corner_delay_map();
+  return corner < ptr.size() && ptr[corner].contains(get_compact_driver());
+}
+
+float Node_pin::get_corner_delay(size_t corner) const {
+  const auto &ptr = top_g->get_node_pin_corner_delay_map();
+  I(corner < ptr.size());
+  const auto it = ptr[corner].find(get_compact_driver());
+  I(it != ptr[corner].end());
+  return it->second;
+}
 
 void Node_pin::set_name(std::string_view wname) {
   I(wname.size());  // empty names not allowed
@@ -455,7 +482,7 @@ std::string Node_pin::get_wire_name() const {
     root_name = top_g->ref_htree()->get_name(hidx);
   }
 
-  const auto *ref = current_g->ref_node_pin_name_map();
+  const auto *ref = &current_g->get_node_pin_name_map();
   const auto  it  = ref->find(get_compact_class_driver());
   if (it != ref->end()) {
     if (root_name.empty()) {
@@ -498,8 +525,9 @@ std::string Node_pin::get_name() const {
 bool Node_pin::has_name() const { return current_g->get_node_pin_name_map().contains(get_compact_class_driver()); }
 
 Node_pin Node_pin::find_driver_pin(Lgraph *top, std::string_view wname) {
-  auto *ref  = top->ref_node_pin_name_map();
-  auto *rref = top->ref_node_pin_name_rmap();
+  // Not ref_node_pin_name_map(): the lazy delete of stale names does not change the saved graph (no mark_dirty)
+  auto *ref  = &top->node_pin_name_map;
+  auto *rref = &top->node_pin_name_rmap;
   {
     const auto it = rref->find(wname);
     if (it != rref->end()) {
@@ -421,10 +421,14 @@ public:
   [[nodiscard]] std::string     get_pin_name() const;
 
   void                set_delay(float val);
-  void                del_delay();
+  void                del_delay();  // all the corners too
   [[nodiscard]] float get_delay() const;
   [[nodiscard]] bool  has_delay() const;
 
+  void                set_corner_delay(size_t corner, float val);
+  [[nodiscard]] float get_corner_delay(size_t corner) const;
+  [[nodiscard]] bool  has_corner_delay(size_t corner) const;
+
   void set_size(const Node_pin &dpin);  // set size and sign
 
   [[nodiscard]] Bits_t get_bits() const;
@@ -4,6 +4,8 @@
 
 #include <print>
 
+#include "lgindex.hpp"
+
 void Sub_node::copy_from(std::string_view new_name, Lg_type_id new_lgid, const Sub_node &sub) {
   name                   = new_name;
   lgid                   = new_lgid;
@@ -109,27 +111,92 @@ void Sub_node::from_json(const rapidjson::Value &entry) {
 
     size_t bits = io_pin["bits"].GetUint();
 
-    auto io_name     = io_pin["name"].GetString();
-    name2id[io_name] = instance_pid;
-    if (io_pins.size() <= instance_pid) {
-      io_pins.resize(instance_pid + 1);
-    }
+    load_pin_int(io_pin["name"].GetString(), dir, pid, instance_pid, bits);
+  }
+
+  std::sort(deleted.begin(), deleted.end(), std::greater<>());
+}
+
+void Sub_node::load_pin_int(std::string_view io_name, Direction dir, Port_ID graph_pos, size_t instance_pid, Bits_t bits) {
+  name2id[io_name] = instance_pid;
+  if (io_pins.size() <= instance_pid) {
+    io_pins.resize(instance_pid + 1);
+  }
+
+  io_pins[instance_pid].name         = io_name;
+  io_pins[instance_pid].dir          = dir;
+  io_pins[instance_pid].graph_io_pos = graph_pos;
+  io_pins[instance_pid].bits         = bits;
+
+  if (io_pins[instance_pid].is_invalid()) {
+    deleted.emplace_back(instance_pid);
+  }
+
+  if (graph_pos != Port_invalid) {
+    map_pin_int(instance_pid, graph_pos);
+  }
+}
 
-    io_pins[instance_pid].name         = io_name;
-    io_pins[instance_pid].dir          = dir;
-    io_pins[instance_pid].graph_io_pos = pid;
-    io_pins[instance_pid].bits         = bits;
+void Sub_node::to_binary(std::string &out) const {
+  lgindex::put_u32(out, lgid);
+  lgindex::put_str(out, name);
+  lgindex::put_u8(out, loop_last);
+  lgindex::put_u8(out, loop_first);
+
+  lgindex::put_u32(out, io_pins.empty() ? 0 : io_pins.size() - 1);
+  for (size_t pos = 1; pos < io_pins.size(); ++pos) {  // No id ZERO
+    const auto &pin = io_pins[pos];
+    lgindex::put_str(out, pin.name);
+    lgindex::put_u16(out, pin.graph_io_pos);
+    lgindex::put_u32(out, static_cast<uint32_t>(pin.bits));
+    lgindex::put_u8(out, static_cast<uint8_t>(pin.dir));
+  }
+}
 
-    if (io_pins[instance_pid].is_invalid()) {
-      deleted.emplace_back(instance_pid);
+bool Sub_node::from_binary(std::string_view in) {
+  {
+    // Check every length against the record before decoding
+    auto chk = in;
+    if (!lgindex::skip(chk, sizeof(uint32_t)) || !lgindex::skip_str(chk) || !lgindex::skip(chk, 2 * sizeof(uint8_t))
+        || chk.size() < sizeof(uint32_t)) {
+      return false;
     }
+    constexpr size_t pin_sz = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t);  // name size, pos, bits, dir
 
-    if (pid != Port_invalid) {
-      map_pin_int(instance_pid, pid);
+    auto n_pins = lgindex::get_u32(chk);
+    if (n_pins > chk.size() / pin_sz) {
+      return false;
+    }
+    for (size_t i = 0; i < n_pins; ++i) {
+      if (!lgindex::skip_str(chk) || !lgindex::skip(chk, pin_sz - sizeof(uint32_t))) {
+        return false;
+      }
+    }
+    if (!chk.empty()) {
+      return false;
     }
   }
 
+  lgid       = lgindex::get_u32(in);
+  name       = lgindex::get_str(in);
+  loop_last  = lgindex::get_u8(in);
+  loop_first = lgindex::get_u8(in);
+
+  io_pins.resize(1);  // No id ZERO
+
+  auto n_pins = lgindex::get_u32(in);
+  for (size_t instance_pid = 1; instance_pid <= n_pins; ++instance_pid) {
+    auto io_name   = lgindex::get_str(in);
+    auto graph_pos = lgindex::get_u16(in);
+    auto bits      = static_cast<Bits_t>(lgindex::get_u32(in));
+    auto dir       = static_cast<Direction>(lgindex::get_u8(in));
+
+    load_pin_int(io_name, dir, graph_pos, instance_pid, bits);
+  }
+
   std::sort(deleted.begin(), deleted.end(), std::greater<>());
+
+  return true;
 }
 
 /* LCOV_EXCL_START */
@@ -86,6 +86,8 @@ private:
     graph_pos2instance_pid[graph_pos] = instance_pid;
   }
 
+  void load_pin_int(std::string_view io_name, Direction dir, Port_ID graph_pos, size_t instance_pid, Bits_t bits);
+
 public:
   Sub_node() { expunge(); }
 
@@ -97,6 +99,11 @@ public:
   void to_json(rapidjson::PrettyWriter<rapidjson::StringBuffer> &writer) const;
   void from_json(const rapidjson::Value &entry);
 
+  // Binary encoding used by the graph_library.idx (same contents as the json).
+  // from_binary returns false, without changing the node, on a corrupt record.
+  void               to_binary(std::string &out) const;
+  [[nodiscard]] bool from_binary(std::string_view in);
+
   void reset_pins() {
     clear_io_pins();
     io_pins.clear();    // WARNING: Do NOT remove mappings, just port id. (allows to reload designs)
@@ -0,0 +1,217 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include "graph_library.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "lgindex.hpp"
+#include "sub_node.hpp"
+
+// Reach the protected internals from the tests (member pointers named through a derived class)
+class Graph_library_access : public Graph_library {
+public:
+  template <typename T>
+  using Stable_vector = Graph_library::Stable_vector<T>;
+
+  static void reload(Graph_library *lib) { (lib->*(&Graph_library_access::reload_int))(); }
+  static std::string index_path(Graph_library *lib) { return lib->*(&Graph_library_access::index_file); }
+};
+
+// Index record as another process (or a corrupt disk) would leave it: [u32 size][u32 lgid][u64 version][body]
+static void append_index_record(const std::string &file, uint32_t lgid, uint64_t version, std::string_view body) {
+  std::string rec;
+  lgindex::put_u32(rec, static_cast<uint32_t>(sizeof(uint32_t) + sizeof(uint64_t) + body.size()));
+  lgindex::put_u32(rec, lgid);
+  lgindex::put_u64(rec, version);
+  rec.append(body);
+
+  std::ofstream fs(file, std::ios::app | std::ios::binary);
+  fs << rec;
+}
+
+TEST(Graph_library_test, stable_vector_chunks) {
+  Graph_library_access::Stable_vector<int> vec;
+
+  EXPECT_EQ(vec.size(), 0);
+  for (int i = 0; i < 200; ++i) {
+    vec.emplace_back(i);
+  }
+  ASSERT_EQ(vec.size(), 200);
+
+  for (auto pos : {0, 62, 63, 64, 65, 191, 192, 193, 199}) {  // 1st chunk is 64 entries, 2nd 128
+    EXPECT_EQ(vec[pos], pos);
+  }
+
+  const int *addr63 = &vec[63];
+  const int *addr64 = &vec[64];
+  for (int i = 200; i < 5000; ++i) {
+    vec.emplace_back(i);
+  }
+  EXPECT_EQ(addr63, &vec[63]);  // never moves on growth
+  EXPECT_EQ(addr64, &vec[64]);
+  EXPECT_EQ(vec[4999], 4999);
+
+  vec.resize(1);  // shrink as reload does
+  EXPECT_EQ(vec.size(), 1);
+  EXPECT_EQ(vec[0], 0);
+
+  vec.resize(193, 7);
+  EXPECT_EQ(vec.size(), 193);
+  EXPECT_EQ(vec[63], 7);  // entries come back with the new value, not the old one
+  EXPECT_EQ(vec[192], 7);
+  EXPECT_EQ(addr63, &vec[63]);
+}
+
+TEST(Graph_library_test, names_across_reload) {
+  auto *lib = Graph_library::instance("lgdb_graph_library_test_reload");
+
+  std::vector<Lg_type_id> ids;
+  for (int i = 0; i < 192; ++i) {
+    ids.emplace_back(lib->add_name(absl::StrCat("mod_", i), "-"));
+  }
+  for (int round = 0; round < 2; ++round) {  // 2nd round uses the published snapshot
+    for (int i = 0; i < 192; ++i) {
+      for (int j = 0; j < 64; ++j) {
+        EXPECT_EQ(lib->get_lgid(absl::StrCat("mod_", i)), ids[i]);
+      }
+    }
+  }
+
+  EXPECT_TRUE(lib->rename_name("mod_3", "mod_3_renamed"));
+  EXPECT_FALSE(lib->has_name("mod_3"));
+  EXPECT_EQ(lib->get_lgid("mod_3_renamed"), ids[3]);
+  EXPECT_EQ(lib->get_name(ids[3]), "mod_3_renamed");
+
+  Graph_library::sync_all();
+  Graph_library_access::reload(lib);  // shrinks attributes/sub_nodes and reads them back
+
+  EXPECT_FALSE(lib->has_name("mod_3"));
+  EXPECT_EQ(lib->get_lgid("mod_3_renamed"), ids[3]);
+  for (int i = 0; i < 192; ++i) {
+    if (i == 3) {
+      continue;
+    }
+    const auto name = absl::StrCat("mod_", i);
+    EXPECT_EQ(lib->get_lgid(name), ids[i]);
+    EXPECT_EQ(lib->get_name(ids[i]), name);
+  }
+}
+
+TEST(Graph_library_test, concurrent_lookups) {
+  auto *lib = Graph_library::instance("lgdb_graph_library_test_mt");
+
+  constexpr int n_stable  = 100;
+  constexpr int n_writes  = 2000;
+  constexpr int n_readers = 4;
+
+  std::vector<Lg_type_id> stable_ids;
+  for (int i = 0; i < n_stable; ++i) {
+    stable_ids.emplace_back(lib->add_name(absl::StrCat("stable_", i), "-"));
+  }
+
+  std::atomic<bool> done{false};
+  std::thread       writer([lib, &done]() {
+    for (int i = 0; i < n_writes; ++i) {
+      lib->add_name(absl::StrCat("w_", i), "-");
+      if (i % 16 == 0) {
+        lib->rename_name(absl::StrCat("w_", i), absl::StrCat("w_", i, "_renamed"));
+      }
+    }
+    done = true;
+  });
+
+  std::vector<std::vector<Sub_node *>> created(n_readers);
+  std::vector<std::thread>             readers;
+  for (int t = 0; t < n_readers; ++t) {
+    readers.emplace_back([lib, t, &done, &stable_ids, &created]() {
+      int iter = 0;
+      while (!done || iter < 256) {
+        const auto i = iter % n_stable;
+        EXPECT_EQ(lib->get_lgid(absl::StrCat("stable_", i)), stable_ids[i]);
+        if (iter < 256) {
+          created[t].emplace_back(lib->ref_or_create_sub(absl::StrCat("created_", iter)));
+        }
+        ++iter;
+      }
+    });
+  }
+
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  for (int t = 1; t < n_readers; ++t) {
+    EXPECT_EQ(created[t], created[0]);  // same name, same sub, never added twice
+  }
+  for (int i = 0; i < n_writes; ++i) {
+    const auto name = i % 16 ? absl::StrCat("w_", i) : absl::StrCat("w_", i, "_renamed");
+    const auto lgid = lib->get_lgid(name);
+    EXPECT_NE(lgid, 0);
+    EXPECT_EQ(lib->get_name(lgid), name);
+  }
+}
+
+TEST(Graph_library_test, corrupt_index_record) {
+  auto *lib  = Graph_library::instance("lgdb_graph_library_test_corrupt");
+  auto  good = lib->add_name("good", "-");
+  Graph_library::sync_all();
+
+  const auto file = Graph_library_access::index_path(lib);
+
+  std::string body;
+  lgindex::put_str(body, "-");  // source
+  lgindex::put_u32(body, 40);   // lgid
+  lgindex::put_str(body, "bad_pins");
+  lgindex::put_u8(body, 0);
+  lgindex::put_u8(body, 0);
+  lgindex::put_u32(body, 1u << 30);  // far more pins than the record holds
+  append_index_record(file, 40, 7, body);
+
+  std::string bad_source;
+  lgindex::put_u32(bad_source, 1u << 20);  // source string past the record end
+  append_index_record(file, 41, 8, bad_source);
+
+  Graph_library_access::reload(lib);
+  EXPECT_EQ(lib->get_lgid("good"), good);
+  EXPECT_FALSE(lib->has_name("bad_pins"));
+
+  Graph_library::sync_all();  // the corrupt records are compacted away
+  Graph_library_access::reload(lib);
+  EXPECT_EQ(lib->get_lgid("good"), good);
+  EXPECT_FALSE(lib->has_name("bad_pins"));
+}
+
+TEST(Graph_library_test, shared_torn_index) {
+  auto *lib   = Graph_library::instance("lgdb_graph_library_test_shared");
+  auto  local = lib->add_name("local_1", "-");
+  Graph_library::sync_all();
+
+  const auto file = Graph_library_access::index_path(lib);
+
+  // Another process appends an entry and crashes in the middle of the next one
+  Sub_node other;
+  other.reset("other", 50);
+  std::string body;
+  lgindex::put_str(body, "-");
+  other.to_binary(body);
+  append_index_record(file, 50, 9, body);
+  {
+    std::ofstream fs(file, std::ios::app | std::ios::binary);
+    fs << '\x40';  // partial record size
+  }
+
+  auto local2 = lib->add_name("local_2", "-");
+  Graph_library::sync_all();  // must compact (an append after the torn tail is lost) and keep "other"
+
+  Graph_library_access::reload(lib);
+  EXPECT_EQ(lib->get_lgid("local_1"), local);
+  EXPECT_EQ(lib->get_lgid("local_2"), local2);
+  EXPECT_EQ(lib->get_lgid("other"), 50);
+}
@@ -2,6 +2,7 @@
 
 #include <format>
 #include <iostream>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -407,3 +408,41 @@ TEST_F(Setup_graphs_test, each_unique_hier_sub_parallel) {
     return true;  // continue
   });
 }
+
+TEST_F(Setup_graphs_test, each_unique_hier_sub_pipelined) {
+  constexpr int n_stages = 3;
+
+  std::mutex                                  done_mutex;
+  absl::flat_hash_map<Lg_type_id::type, int> done;  // lgid -> stages completed
+
+  auto check_stage = [&done_mutex, &done](int stage, Lgraph *lg) {
+    std::lock_guard<std::mutex> guard(done_mutex);
+
+    EXPECT_EQ(done[lg->get_lgid()], stage);  // previous stage of the same module, no double visits
+
+    lg->each_local_unique_sub_fast([&done, stage](Lgraph *sub_lg) -> bool {
+      if (!sub_lg->is_empty()) {
+        EXPECT_GT(done[sub_lg->get_lgid()], stage);  // same stage of the sub already done
+      }
+      return true;  // continue
+    });
+
+    done[lg->get_lgid()] = stage + 1;
+  };
+
+  std::vector<std::function<void(Lgraph *)>> stages;
+  for (int i = 0; i < n_stages; ++i) {
+    stages.emplace_back([&check_stage, i](Lgraph *lg) { check_stage(i, lg); });
+  }
+
+  top->each_hier_unique_sub_bottom_up_pipelined(stages);
+
+  EXPECT_EQ(done[top->get_lgid()], n_stages);
+  for (const auto &[lgid, n] : done) {
+    EXPECT_EQ(n, n_stages);
+  }
+
+  done.clear();
+  top->each_hier_unique_sub_bottom_up_pipelined(stages);  // 2nd run is scheduled with the measured costs
+  EXPECT_EQ(done[top->get_lgid()], n_stages);
+}
@@ -2,6 +2,9 @@
 
 #include "lgraph.hpp"
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <string>
 #include <vector>
 
@@ -248,3 +251,183 @@ TEST_F(Setup_lgraph, add_remove_inputs) {
   });
   EXPECT_EQ(conta, posused.size());
 }
+
+TEST_F(Setup_lgraph, save_only_dirty) {
+  std::string lgdb("lgdb_lgraph_dirty_test");
+
+  file_utils::clean_dir(lgdb);
+
+  auto *lib = Graph_library::instance(lgdb);
+
+  Lgraph *lg1 = lib->create_lgraph("lg1", "file1.xxx");
+  EXPECT_TRUE(lg1->is_dirty());
+
+  add_input(lg1, "inp_a");
+  add_output(lg1, "out_b");
+
+  lg1->save();
+  EXPECT_FALSE(lg1->is_dirty());
+
+  check_ios(lg1);  // read only
+  EXPECT_FALSE(Node_pin::find_driver_pin(lg1, "inp_a").is_invalid());
+  EXPECT_FALSE(lg1->is_dirty());
+
+  lg1->save();  // nothing to do
+  EXPECT_FALSE(lg1->is_dirty());
+
+  auto node = lg1->create_node(Ntype_op::Sum, 8);
+  EXPECT_TRUE(lg1->is_dirty());
+  lg1->save();
+  EXPECT_FALSE(lg1->is_dirty());
+
+  node.get_driver_pin().set_name("sum_y");
+  EXPECT_TRUE(lg1->is_dirty());
+  lg1->save();
+  EXPECT_FALSE(lg1->is_dirty());
+
+  node.get_driver_pin().set_bits(4);
+  EXPECT_TRUE(lg1->is_dirty());
+  lg1->save();
+
+  // Not saved, but cgen/opentimer key their caches on the mutation epoch
+  auto epoch = lg1->get_mutation_epoch();
+  node.get_driver_pin().set_unsign();
+  EXPECT_NE(lg1->get_mutation_epoch(), epoch);
+
+  epoch = lg1->get_mutation_epoch();
+  node.set_name("sum_node");
+  EXPECT_NE(lg1->get_mutation_epoch(), epoch);
+}
+
+TEST_F(Setup_lgraph, library_index) {
+  std::string lgdb("lgdb_library_index_test");
+
+  file_utils::clean_dir(lgdb);
+
+  auto *lib = Graph_library::instance(lgdb);
+
+  for (int i = 0; i < 50; ++i) {
+    auto *lg = lib->create_lgraph(std::string("mod_") + std::to_string(i), "file1.xxx");
+    lg->add_graph_input("a", 1, i + 1);
+    lg->add_graph_output("z", 2, 3);
+  }
+  lib->sync();
+
+  auto index_size = [&lgdb]() -> off_t {
+    struct stat st;
+    if (stat((lgdb + "/graph_library.idx").c_str(), &st) != 0) {
+      return -1;
+    }
+    return st.st_size;
+  };
+  auto sz1 = index_size();
+  EXPECT_GT(sz1, 0);
+
+  lib->sync();  // nothing changed
+  EXPECT_EQ(index_size(), sz1);
+
+  auto *extra = lib->create_lgraph("mod_extra", "file2.xxx");
+  EXPECT_NE(extra, nullptr);
+  lib->sync();  // only the new entry is appended
+  auto sz2 = index_size();
+  EXPECT_GT(sz2, sz1);
+  EXPECT_LT(sz2, sz1 + 256);
+
+  auto lgid7 = lib->get_lgid("mod_7");
+  lib->reload();
+  EXPECT_EQ(lib->get_lgid("mod_7"), lgid7);
+  EXPECT_TRUE(lib->get_sub(lgid7).has_pin("a"));
+  EXPECT_TRUE(lib->get_sub(lgid7).has_pin("z"));
+  EXPECT_NE(lib->get_lgid("mod_extra"), 0);
+
+  lib->export_json();
+  EXPECT_EQ(access((lgdb + "/graph_library.json").c_str(), F_OK), 0);
+}
+
+TEST_F(Setup_lgraph, structural_dedup) {
+  std::string lgdb("lgdb_structural_dedup_test");
+
+  file_utils::clean_dir(lgdb);
+
+  auto *lib = Graph_library::instance(lgdb);
+
+  // z = (a + b) op a, the Sum/op creation order changes the node ids but not the structure
+  auto create_leaf = [lib](std::string_view name, Ntype_op op, bool sum_first) {
+    auto *lg = lib->create_lgraph(name, "-");
+    auto  a  = lg->add_graph_input("a", 1, 8);
+    auto  b  = lg->add_graph_input("b", 2, 8);
+    auto  z  = lg->add_graph_output("z", 3, 8);
+
+    Node sum;
+    Node other;
+    if (sum_first) {
+      sum   = lg->create_node(Ntype_op::Sum, 8);
+      other = lg->create_node(op, 8);
+    } else {
+      other = lg->create_node(op, 8);
+      sum   = lg->create_node(Ntype_op::Sum, 8);
+    }
+    sum.setup_sink_pin("A").connect_driver(a);
+    sum.setup_sink_pin("A").connect_driver(b);
+    other.setup_sink_pin().connect_driver(sum.setup_driver_pin());
+    other.setup_sink_pin().connect_driver(a);
+    z.connect_driver(other.setup_driver_pin());
+    return lg;
+  };
+
+  auto create_mid = [lib](std::string_view name, Lgraph *leaf) {
+    auto *lg  = lib->create_lgraph(name, "-");
+    auto  sub = lg->create_node_sub(leaf->get_lgid());
+    sub.setup_sink_pin("a").connect_driver(lg->add_graph_input("a", 1, 8));
+    sub.setup_sink_pin("b").connect_driver(lg->add_graph_input("b", 2, 8));
+    lg->add_graph_output("z", 3, 8).connect_driver(sub.setup_driver_pin("z"));
+    return lg;
+  };
+
+  auto *leaf_p1 = create_leaf("leaf_p1", Ntype_op::And, true);
+  auto *leaf_p2 = create_leaf("leaf_p2", Ntype_op::And, false);
+  auto *leaf_p3 = create_leaf("leaf_p3", Ntype_op::Or, true);
+
+  EXPECT_EQ(leaf_p1->get_structural_hash(), leaf_p2->get_structural_hash());
+  EXPECT_NE(leaf_p1->get_structural_hash(), leaf_p3->get_structural_hash());
+  EXPECT_TRUE(leaf_p1->is_structurally_equal(leaf_p2));
+  EXPECT_FALSE(leaf_p1->is_structurally_equal(leaf_p3));
+
+  auto *mid_1 = create_mid("mid_1", leaf_p1);
+  auto *mid_2 = create_mid("mid_2", leaf_p2);
+  auto *mid_3 = create_mid("mid_3", leaf_p3);
+  EXPECT_NE(mid_1->get_structural_hash(), mid_2->get_structural_hash());  // different sub lgids
+
+  auto *top = lib->create_lgraph("dedup_top", "-");
+  top->add_graph_input("a", 1, 8);
+  top->add_graph_input("b", 2, 8);
+  Port_ID pos = 3;
+  for (auto *mid : {mid_1, mid_2, mid_3}) {
+    auto sub = top->create_node_sub(mid->get_lgid());
+    sub.setup_sink_pin("a").connect_driver(top->get_graph_input("a"));
+    sub.setup_sink_pin("b").connect_driver(top->get_graph_input("b"));
+    top->add_graph_output(std::string("z") + std::to_string(pos), pos, 8).connect_driver(sub.setup_driver_pin("z"));
+    ++pos;
+  }
+
+  auto remap = lib->dedup_structural(absl::MakeSpan(&top, 1));
+  EXPECT_EQ(remap.size(), 2);  // one of the leaf_p1/leaf_p2 and one of the mid_1/mid_2 pairs
+
+  auto kept = [&remap](Lgraph *lg) -> Lg_id_t {
+    auto it = remap.find(lg->get_lgid());
+    return it == remap.end() ? lg->get_lgid().value : it->second;
+  };
+  EXPECT_EQ(kept(leaf_p1), kept(leaf_p2));
+  EXPECT_EQ(kept(mid_1), kept(mid_2));
+  EXPECT_FALSE(remap.contains(leaf_p3->get_lgid()));
+  EXPECT_FALSE(remap.contains(mid_3->get_lgid()));
+
+  EXPECT_EQ(top->get_down_class_map().size(), 2);  // one of mid_1/mid_2 and mid_3
+  EXPECT_EQ(mid_1->get_structural_hash(), mid_2->get_structural_hash());
+
+  // Cached until the next edit
+  auto h3 = leaf_p3->get_structural_hash();
+  EXPECT_EQ(leaf_p3->get_structural_hash(), h3);
+  leaf_p3->create_node(Ntype_op::Xor, 8);
+  EXPECT_NE(leaf_p3->get_structural_hash(), h3);
+}
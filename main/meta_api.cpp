@@ -34,6 +34,7 @@ void Meta_api::open(Eprp_var &var) {
       Main_api::warn("lgraph.open lgraph {} is empty!", name);
     }
     if (hier != "false" && hier != "0") {
+      lib->prefetch_hier(lg);  // parallel load, the traversal below just finds them open
       lg->each_hier_unique_sub_bottom_up([&var](Lgraph *g) { var.add(g); });
     }
     var.add(lg);
@@ -99,6 +100,18 @@ void Meta_api::copy(Eprp_var &var) {
   glibrary->copy_lgraph(name, dest);
 }
 
+void Meta_api::library_json(Eprp_var &var) {
+  auto path = var.get("path");
+
+  auto *library = Graph_library::instance(path);
+  if (library == nullptr) {
+    Main_api::error("lgraph.library_json could not open {} path", path);
+    return;
+  }
+
+  library->export_json();
+}
+
 void Meta_api::match(Eprp_var &var) {
   auto path  = var.get("path");
   auto match = var.get("match");
@@ -285,4 +298,10 @@ void Meta_api::setup(Eprp &eprp) {
   m11.add_label_required("dest", "lgraph destination name");
 
   eprp.register_method(m11);
+
+  //---------------------
+  Eprp_method m12("lgraph.library_json", "export the graph library index as graph_library.json", &Meta_api::library_json);
+  m12.add_label_optional("path", "lgraph path", "lgdb");
+
+  eprp.register_method(m12);
 }
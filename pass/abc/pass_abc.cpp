@@ -9,10 +9,37 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <memory>
+#include <vector>
+
 #include "abc_cell.hpp"
 #include "lgraph.hpp"
+#include "perf_tracing.hpp"
+#include "thread_pool.hpp"
 
 Abc_Frame_t *Pass_abc::pAbc = 0;
+std::string  Pass_abc::loaded_lib;
+std::mutex   Pass_abc::abc_mutex;
+
+// generic library used when no liberty_file is given (parsed from memory)
+static constexpr std::string_view generic_genlib
+    = "GATE ZERO    1 Y=CONST0;\n"
+      "GATE ONE     1 Y=CONST1;\n"
+      "GATE BUF    1 Y=A;                  PIN * NONINV  1 999 1 0 1 0\n"
+      "GATE NOT    2 Y=!A;                 PIN * INV     1 999 1 0 1 0\n"
+      "GATE AND    4 Y=A*B;                PIN * NONINV  1 999 1 0 1 0\n"
+      "GATE NAND   4 Y=!(A*B);             PIN * INV     1 999 1 0 1 0\n"
+      "GATE OR     4 Y=A+B;                PIN * NONINV  1 999 1 0 1 0\n"
+      "GATE NOR    4 Y=!(A+B);             PIN * INV     1 999 1 0 1 0\n"
+      "GATE XOR    8 Y=(A*!B)+(!A*B);      PIN * UNKNOWN 1 999 1 0 1 0\n"
+      "GATE XNOR   8 Y=(A*B)+(!A*!B);      PIN * UNKNOWN 1 999 1 0 1 0\n"
+      "GATE ANDNOT 4 Y=A*!B;               PIN * UNKNOWN 1 999 1 0 1 0\n"
+      "GATE ORNOT  4 Y=A+!B;               PIN * UNKNOWN 1 999 1 0 1 0\n"
+      "GATE AOI3   6 Y=!((A*B)+C);         PIN * INV     1 999 1 0 1 0\n"
+      "GATE OAI3   6 Y=!((A+B)*C);         PIN * INV     1 999 1 0 1 0\n"
+      "GATE AOI4   8 Y=!((A*B)+(C*D));     PIN * INV     1 999 1 0 1 0\n"
+      "GATE OAI4   8 Y=!((A+B)*(C+D));     PIN * INV     1 999 1 0 1 0\n"
+      "GATE MUX    4 Y=(A*B)+(S*B)+(!S*A); PIN * UNKNOWN 1 999 1 0 1 0\n";
 
 void setup_pass_abc() {
   Pass_abc p;
@@ -31,15 +58,35 @@ void Pass_abc::tmap(Eprp_var &var) {
 }
 
 void Pass_abc::optimize(Eprp_var &var) {
-  Pass_abc pass;
-
-  pass.opack.liberty_file = var.get("liberty_file");
-  pass.opack.blif_file    = var.get("blif_file");
-  pass.opack.odir         = var.get("odir");
-  pass.opack.verbose      = var.get("verbose") == "true";
+  TRACE_EVENT("pass", "ABC_optimize");
 
+  // One worker per module, but only the lgraph walk (find_cell_conn) runs in
+  // parallel. ABC has a single global frame and library, so synthesis, mapping
+  // and the lgraph creation run one module at a time under abc_mutex.
+  std::vector<std::unique_ptr<Pass_abc>> workers;
   for (const auto &l : var.lgs) {
-    Lgraph *lg = pass.regen(l);
+    auto &pass = workers.emplace_back(std::make_unique<Pass_abc>());
+
+    pass->opack.liberty_file = var.get("liberty_file");
+    pass->opack.blif_file    = var.get("blif_file");
+    pass->opack.odir         = var.get("odir");
+    pass->opack.verbose      = var.get("verbose") == "true";
+
+    if (!pass->setup_techmap(l)) {
+      Pass::error("pass_abc.optimize: supports techmap graphs only");
+    }
+  }
+
+  for (auto i = 0u; i < var.lgs.size(); ++i) {
+    thread_pool.add([pass = workers[i].get(), lg = var.lgs[i]]() -> void { pass->prepare(lg); });
+  }
+  thread_pool.wait_all();
+
+  std::vector<Lgraph *> mapped;
+  for (auto i = 0u; i < workers.size(); ++i) {
+    mapped.emplace_back(workers[i]->regen(var.lgs[i]));
+  }
+  for (auto *lg : mapped) {
     var.add(lg);
   }
 }
@@ -50,7 +97,7 @@ void Pass_abc::setup() {
   m1.add_label_optional("verbose", "verbose output true|false", "false");
   m1.add_label_optional("liberty_file", "liberty file for synthesis");
   m1.add_label_optional("blif_file", "generate a blif file for debugging");
-  m1.add_label_optional("odir", "output directory for blif for debugging", ".");
+  m1.add_label_optional("odir", "output directory for the abc _post/_map blif/verilog dumps (none if empty)", "");
 
   register_pass(m1);
 
@@ -64,7 +111,6 @@ void Pass_abc::setup() {
 Pass_abc::Pass_abc()
     : Pass("abc")
     , cmd_mapping("map;print_stats")
-    , cmd_readlib("read_library stdcells.genlib")
     , cmd_synthesis("print_stats;cleanup;strash;ifraig;iresyn;dc2;strash;print_stats;") {
   graph_info = new graph_topology;
 }
@@ -75,16 +121,23 @@ void Pass_abc::trans(Lgraph *lg) {
   lg->sync();  // sync because Tech Library is loaded
 }
 
+void Pass_abc::prepare(const Lgraph *lg) {
+  TRACE_EVENT("pass", "ABC_prepare");
+  find_cell_conn(lg);
+}
+
+// setup_techmap and prepare must be called before
 Lgraph *Pass_abc::regen(const Lgraph *lg) {
-  if (!setup_techmap(lg)) {
-    Pass::error("pass_abc.regen: supports techmap graphs only");
-    return 0;
-  }
+  std::lock_guard<std::mutex> guard(abc_mutex);
+  TRACE_EVENT("pass", "ABC_regen");
 
-  find_cell_conn(lg);
   std::string source{lg->get_library().get_source(lg->get_lgid())};
   Lgraph     *mapped = lg->ref_library()->create_lgraph(absl::StrCat(lg->get_name(), "_mapped"), source);
-  from_abc(mapped, lg, to_abc(lg));
+
+  auto *pNtk = to_abc(lg);
+  from_abc(mapped, lg, pNtk);  // straight from the mapped network, no blif round trip
+  Abc_NtkDelete(pNtk);
+
   mapped->sync();
   if (opack.verbose) {
     mapped->print_stats();
@@ -623,9 +676,8 @@ bool Pass_abc::setup_techmap(const Lgraph *g) {
  * description: feed to abc for comb synthesis and mapping
  ***********************************************************************/
 Abc_Ntk_t *Pass_abc::to_abc(const Lgraph *g) {
-  Abc_Start();
-
   if (pAbc == 0) {
+    Abc_Start();
     pAbc = Abc_FrameGetGlobalFrame();
   }
   Abc_Ntk_t *pAig = Abc_NtkAlloc(ABC_NTK_NETLIST, ABC_FUNC_AIG, 1);
@@ -644,41 +696,36 @@ Abc_Ntk_t *Pass_abc::to_abc(const Lgraph *g) {
   pAig             = Abc_NtkToLogic(pTemp);
   Abc_FrameClearVerifStatus(pAbc);
   Abc_FrameSetCurrentNetwork(pAbc, pAig);
-  if (!opack.liberty_file.empty()) {
-    std::string cmd_read_lib = std::format("read_lib -w {}", opack.liberty_file);
-
-    if (Cmd_CommandExecute(pAbc, cmd_read_lib.c_str())) {
-      Pass::error("Pass_abc.to_abc: Cannot execute read_lib command {}", cmd_read_lib);
-    }
-  } else {
-    gen_generic_lib("stdcells.genlib");
-    Cmd_CommandExecute(pAbc, cmd_readlib.c_str());
-  }
+  load_library();
 
   const std::string &path_name = opack.odir;
-  struct stat        output_status;
-  stat(path_name.c_str(), &output_status);
-
-  if (!(output_status.st_mode & S_IFDIR)) {
-    mkdir(path_name.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+  if (!path_name.empty()) {
+    struct stat output_status;
+    if (stat(path_name.c_str(), &output_status) != 0 || !(output_status.st_mode & S_IFDIR)) {
+      mkdir(path_name.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
+    }
   }
 
   if (Cmd_CommandExecute(pAbc, cmd_synthesis.c_str())) {
     Pass::error("Pass_abc.to_abc: Cannot execute synthesis command {}", cmd_synthesis);
   }
 
-  std::string cmd_write_blif1 = std::format("write_blif {0}/{1}_post.blif;write_verilog {0}/{1}_post.v;", path_name, g->get_name());
-  if (Cmd_CommandExecute(pAbc, cmd_write_blif1.c_str())) {
-    Pass::error("Pass_abc.to_abc: Cannot execute write_blif command {}", cmd_write_blif1);
+  if (!path_name.empty()) {
+    std::string cmd_write_blif1 = std::format("write_blif {0}/{1}_post.blif;write_verilog {0}/{1}_post.v;", path_name, g->get_name());
+    if (Cmd_CommandExecute(pAbc, cmd_write_blif1.c_str())) {
+      Pass::error("Pass_abc.to_abc: Cannot execute write_blif command {}", cmd_write_blif1);
+    }
   }
 
   if (Cmd_CommandExecute(pAbc, cmd_mapping.c_str())) {
     Pass::error("Pass_abc.to_abc: Cannot execute mapping command {}", cmd_mapping);
   }
 
-  std::string cmd_write_blif2 = std::format("write_blif {0}/{1}_map.blif;write_verilog {0}/{1}_map.v", path_name, g->get_name());
-  if (Cmd_CommandExecute(pAbc, cmd_write_blif2.c_str())) {
-    Pass::error("Pass_abc.to_abc: Cannot execute mapping command {}", cmd_write_blif2);
+  if (!path_name.empty()) {
+    std::string cmd_write_blif2 = std::format("write_blif {0}/{1}_map.blif;write_verilog {0}/{1}_map.v", path_name, g->get_name());
+    if (Cmd_CommandExecute(pAbc, cmd_write_blif2.c_str())) {
+      Pass::error("Pass_abc.to_abc: Cannot execute mapping command {}", cmd_write_blif2);
+    }
   }
 
   assert(pAbc != nullptr);
@@ -693,8 +740,6 @@ Abc_Ntk_t *Pass_abc::to_abc(const Lgraph *g) {
     Abc_NtkToAig(pNtkMapped);
   }
 
-  remove("stdcells.genlib");
-
   return pNtkMapped;
 }
 
@@ -1420,28 +1465,28 @@ void Pass_abc::conn_clock(const Lgraph *g, Abc_Ntk_t *pAig) {
   }
 }
 
-void Pass_abc::gen_generic_lib(const std::string &buffer) const {
-  FILE *f = fopen(buffer.c_str(), "wt");
-  if (f == NULL) {
-    Pass::error("Opening {} for writing failed: {}", buffer.c_str(), strerror(errno));
+// The library stays loaded in the ABC frame across modules and pass calls,
+// it is only read again when a different liberty_file is requested.
+void Pass_abc::load_library() const {
+  const auto &lib_name = opack.liberty_file.empty() ? std::string("generic") : opack.liberty_file;
+  if (lib_name == loaded_lib) {
+    return;
+  }
+
+  if (!opack.liberty_file.empty()) {
+    std::string cmd_read_lib = std::format("read_lib -w {}", opack.liberty_file);
+
+    if (Cmd_CommandExecute(pAbc, cmd_read_lib.c_str())) {
+      Pass::error("Pass_abc.load_library: Cannot execute read_lib command {}", cmd_read_lib);
+    }
+  } else {
+    std::string buffer{generic_genlib};
+    auto       *lib = Mio_LibraryRead((char *)"stdcells.genlib", buffer.data(), nullptr, 0, 0);
+    if (lib == nullptr) {
+      Pass::error("Pass_abc.load_library: could not parse the generic genlib");
+    }
+    Mio_UpdateGenlib(lib);
   }
 
-  fprintf(f, "GATE ZERO    1 Y=CONST0;\n");
-  fprintf(f, "GATE ONE     1 Y=CONST1;\n");
-  fprintf(f, "GATE BUF    1 Y=A;                  PIN * NONINV  1 999 1 0 1 0\n");
-  fprintf(f, "GATE NOT    2 Y=!A;                 PIN * INV     1 999 1 0 1 0\n");
-  fprintf(f, "GATE AND    4 Y=A*B;                PIN * NONINV  1 999 1 0 1 0\n");
-  fprintf(f, "GATE NAND   4 Y=!(A*B);             PIN * INV     1 999 1 0 1 0\n");
-  fprintf(f, "GATE OR     4 Y=A+B;                PIN * NONINV  1 999 1 0 1 0\n");
-  fprintf(f, "GATE NOR    4 Y=!(A+B);             PIN * INV     1 999 1 0 1 0\n");
-  fprintf(f, "GATE XOR    8 Y=(A*!B)+(!A*B);      PIN * UNKNOWN 1 999 1 0 1 0\n");
-  fprintf(f, "GATE XNOR   8 Y=(A*B)+(!A*!B);      PIN * UNKNOWN 1 999 1 0 1 0\n");
-  fprintf(f, "GATE ANDNOT 4 Y=A*!B;               PIN * UNKNOWN 1 999 1 0 1 0\n");
-  fprintf(f, "GATE ORNOT  4 Y=A+!B;               PIN * UNKNOWN 1 999 1 0 1 0\n");
-  fprintf(f, "GATE AOI3   6 Y=!((A*B)+C);         PIN * INV     1 999 1 0 1 0\n");
-  fprintf(f, "GATE OAI3   6 Y=!((A+B)*C);         PIN * INV     1 999 1 0 1 0\n");
-  fprintf(f, "GATE AOI4   8 Y=!((A*B)+(C*D));     PIN * INV     1 999 1 0 1 0\n");
-  fprintf(f, "GATE OAI4   8 Y=!((A+B)*(C+D));     PIN * INV     1 999 1 0 1 0\n");
-  fprintf(f, "GATE MUX    4 Y=(A*B)+(S*B)+(!S*A); PIN * UNKNOWN 1 999 1 0 1 0\n");
-  fclose(f);
+  loaded_lib = lib_name;
 }
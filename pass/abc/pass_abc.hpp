@@ -4,6 +4,7 @@
 //
 #pragma once
 
+#include <mutex>
 #include <string>
 
 #include "absl/container/flat_hash_map.h"
@@ -23,27 +24,28 @@ class Pass_abc : public Pass {
 protected:
   class Pass_abc_options {
   public:
-    Pass_abc_options() {
-      verbose = false;
-      odir    = ".";
-    };
+    Pass_abc_options() { verbose = false; };
 
     std::string liberty_file;
     std::string blif_file;
-    std::string odir;
+    std::string odir;  // empty: no _post/_map dumps
     bool        verbose;
   };
   Pass_abc_options opack;
 
+  // ABC keeps a single global frame. The frame and the loaded library live
+  // for the whole process, and every ABC command goes through abc_mutex.
   static Abc_Frame_t *pAbc;
+  static std::string  loaded_lib;
+  static std::mutex   abc_mutex;
 
   const std::string cmd_mapping;
-  const std::string cmd_readlib;
   const std::string cmd_synthesis;
 
   static void tmap(Eprp_var &var);
   static void optimize(Eprp_var &var);
 
+  void    prepare(const Lgraph *lg);
   Lgraph *regen(const Lgraph *lg);
   void    trans(Lgraph *lg);
   void    dump_blif(const Lgraph *g, const std::string &filename);
@@ -290,5 +292,5 @@ private:
 
   void write_src_info(const Lgraph *g, const Pass_abc::index_offset &inp, std::ofstream &fs);
 
-  void gen_generic_lib(const std::string &buffer) const;
+  void load_library() const;
 };
@@ -2,6 +2,11 @@
 
 #include "lcompiler.hpp"
 
+#include <exception>
+#include <mutex>
+
+#include "absl/container/flat_hash_set.h"
+
 // FIXME: todo: the top should always specified so that the bottom-up mechanism works
 
 Lcompiler::Lcompiler(std::string_view _path, std::string_view _odir, std::string_view _top, bool _gviz)
@@ -9,13 +14,49 @@ Lcompiler::Lcompiler(std::string_view _path, std::string_view _odir, std::string
 
 void Lcompiler::do_prp_lnast2lgraph(const std::vector<std::shared_ptr<Lnast>> &lnasts) {
   TRACE_EVENT("pass", "lnast_ssa + lnast_tolg");
+
+  // 1st: create all the module lgraphs (lgids and Sub_nodes) before lowering. Instances of these modules then only
+  // look up the library, and no task touches an lgraph that another task is creating.
+  std::vector<Lgraph *>            module_lgs;
+  absl::flat_hash_set<std::string> module_names;
+  module_lgs.reserve(lnasts.size());
   for (const auto &ln : lnasts) {
-    thread_pool.add(&Lcompiler::prp_thread_ln2lg, this, ln);
+    auto mod_name = ln->get_top_module_name();
+    if (!module_names.emplace(mod_name).second) {
+      Pass::error("lnast_tolg: module {} defined more than once", mod_name);
+    }
+    module_lgs.emplace_back(Lnast_tolg::create_lgraph(ln, mod_name, path));
+  }
+
+  // 2nd: lower the bodies in parallel. Each task fills its own slot (merged in lnast order). A Pass::error in a task
+  // is kept and rethrown once all the tasks are done (an exception must not leave a pool thread).
+  std::vector<std::vector<Lgraph *>> task_lgs(lnasts.size());
+  std::mutex                         error_mutex;
+  std::exception_ptr                 error;
+  for (size_t i = 0; i < lnasts.size(); ++i) {
+    thread_pool.add([this, &lnasts, &module_lgs, &task_lgs, &error_mutex, &error, i]() -> void {
+      try {
+        task_lgs[i] = prp_thread_ln2lg(lnasts[i], module_lgs[i]);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    });
   }
   thread_pool.wait_all();
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  for (const auto &local_lgs : task_lgs) {
+    lgs.insert(lgs.end(), local_lgs.begin(), local_lgs.end());
+  }
 }
 
-void Lcompiler::prp_thread_ln2lg(const std::shared_ptr<Lnast> &ln) {
+std::vector<Lgraph *> Lcompiler::prp_thread_ln2lg(const std::shared_ptr<Lnast> &ln, Lgraph *lg) {
   gviz == true ? gv.do_from_lnast(ln, "raw") : void();
   ln->ssa_trans();
   gviz == true ? gv.do_from_lnast(ln) : void();
@@ -23,21 +64,15 @@ void Lcompiler::prp_thread_ln2lg(const std::shared_ptr<Lnast> &ln) {
   auto mod_name = ln->get_top_module_name();
   Lnast_tolg ln2lg(mod_name, path);
   const auto top_stmts = ln->get_first_child(lh::Tree_index::root());
-  auto local_lgs = ln2lg.do_tolg(ln, top_stmts);
+  auto local_lgs = ln2lg.do_tolg(ln, top_stmts, lg);
 
   if (gviz) {
-    for (const auto &lg : local_lgs) {
-      gv.do_from_lgraph(lg, "raw");
+    for (const auto &local_lg : local_lgs) {
+      gv.do_from_lgraph(local_lg, "raw");
     }
   }
 
-  std::lock_guard<std::mutex> guard(lgs_mutex);  // guarding Lcompiler::lgs
-  for (auto *lg : local_lgs) {
-    lgs.emplace_back(lg);
-  }
-  // auto tp = std::chrono::system_clock::now();
-  // auto tp2 = std::chrono::system_clock::now();
-  // std::print("Yo2 {}, mod_name:{}\n", (tp2-tp).count(), mod_name);
+  return local_lgs;
 }
 
 void Lcompiler::do_prp_local_cprop_bitwidth() {
@@ -1,7 +1,6 @@
 // This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
-#include <mutex>
 #include <vector>
 
 #include "absl/container/node_hash_map.h"
@@ -28,7 +27,6 @@ private:
   void setup_maps();
 
 protected:
-  std::mutex            lgs_mutex;
   std::vector<Lgraph *> lgs;
 
 public:
@@ -37,7 +35,7 @@ public:
   void do_prp_lnast2lgraph(const std::vector<std::shared_ptr<Lnast>> &);
   void do_prp_local_cprop_bitwidth();
   void do_prp_global_bitwidth_inference();
-  void prp_thread_ln2lg(const std::shared_ptr<Lnast> &lnast);
+  std::vector<Lgraph *> prp_thread_ln2lg(const std::shared_ptr<Lnast> &lnast, Lgraph *lg);
 
   std::string_view             get_top() const { return top; };
   const std::vector<Lgraph *> &get_lgraphs() const { return lgs; }
@@ -21,6 +21,7 @@
 #define TEST1 1
 #define TEST2 1
 #define TEST3 1
+#define TEST4 1
 
 class Label_acyclic_test : public ::testing::Test {
 public:
@@ -290,6 +291,86 @@ TEST_F(Label_acyclic_test, essent_test) {
 
 #endif
 
+#if TEST4
+TEST_F(Label_acyclic_test, parallel_matches_serial) {
+  auto   *lib     = Graph_library::instance("lgdb");
+  Lgraph *d_graph = lib->create_lgraph("d_graph", "-");
+  ASSERT_NE(d_graph, nullptr);
+
+  // a few xor chains with shared fanouts (partition roots) between them
+  auto                  graph_inp_A = d_graph->add_graph_input("a_graph_in", 1, 10);
+  std::vector<Node_pin> drivers     = {graph_inp_A};
+  Lrand<size_t>         rnd;
+  for (int i = 0; i < 200; ++i) {
+    auto xor_node = d_graph->create_node(Ntype_op::Xor, 10);
+    auto spin     = xor_node.setup_sink_pin();
+    d_graph->add_edge(drivers[rnd.max(drivers.size())], spin);
+    d_graph->add_edge(drivers[rnd.max(drivers.size())], spin);
+    drivers.emplace_back(xor_node.setup_driver_pin());
+  }
+  d_graph->add_graph_output("y_graph_out", 3, 10).connect_driver(drivers.back());
+
+  auto colors = [&](bool merge_en, bool parallel) {
+    Label_acyclic labeler(false, false, 1, merge_en, parallel);
+    labeler.label(d_graph);
+
+    absl::flat_hash_map<Node::Compact, int> color;
+    for (const auto &n : d_graph->fast()) {
+      color[n.get_compact()] = n.get_color();
+    }
+    return color;
+  };
+
+  // Without merges both modes build the same partitions (the IDs may differ)
+  auto serial   = colors(false, false);
+  auto parallel = colors(false, true);
+  ASSERT_EQ(serial.size(), parallel.size());
+  absl::flat_hash_map<int, int> serial2parallel;
+  for (const auto &[nc, col] : serial) {
+    auto it = serial2parallel.try_emplace(col, parallel[nc]).first;
+    EXPECT_EQ(it->second, parallel[nc]);
+  }
+
+  // With merges, the partition graph must stay acyclic
+  auto merged = colors(true, true);
+
+  absl::flat_hash_map<int, absl::flat_hash_set<int>> part_out;
+  absl::flat_hash_map<int, int>                      n_inc;
+  for (const auto &n : d_graph->fast()) {
+    auto to = merged[n.get_compact()];
+    n_inc.try_emplace(to, 0);
+    for (const auto &e : n.inp_edges()) {
+      if (e.driver.is_graph_input()) {
+        continue;
+      }
+      auto from = merged[e.driver.get_node().get_compact()];
+      if (from != to && part_out[from].insert(to).second) {
+        ++n_inc[to];
+      }
+    }
+  }
+
+  std::vector<int> ready;
+  for (const auto &[pid, n] : n_inc) {
+    if (n == 0) {
+      ready.emplace_back(pid);
+    }
+  }
+  size_t n_sorted = 0;
+  while (!ready.empty()) {
+    auto pid = ready.back();
+    ready.pop_back();
+    ++n_sorted;
+    for (auto to : part_out[pid]) {
+      if (--n_inc[to] == 0) {
+        ready.emplace_back(to);
+      }
+    }
+  }
+  EXPECT_EQ(n_sorted, n_inc.size());
+}
+#endif
+
 #ifdef RUN
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -2,6 +2,11 @@
 
 #include "label_acyclic.hpp"
 
+#include <algorithm>
+
+#include "perf_tracing.hpp"
+#include "thread_pool.hpp"
+
 // #include "pass.hpp"
 
 #define G_DEBUG           0  // toggle for gather_inou debug print
@@ -12,7 +17,8 @@
 #define CHANGE_NODE_NAMES 0
 
 // Constructor for Label_acyclic
-Label_acyclic::Label_acyclic(bool _v, bool _h, uint8_t _c, bool _m) : verbose(_v), hier(_h), merge_en(_m), cutoff(_c) {
+Label_acyclic::Label_acyclic(bool _v, bool _h, uint8_t _c, bool _m, bool _p)
+    : verbose(_v), hier(_h), merge_en(_m), parallel(_p), cutoff(_c) {
   part_id = 1;
 }
 
@@ -492,6 +498,304 @@ void Label_acyclic::merge_partitions_one_parent() {
   }
 }
 
+/* * * * * * *
+ Parallel mode. Same roots and fanout-free growth as the serial passes, but on
+ dense tables: the graph is read once into a compact numbering (CSR of the
+ drivers), roots are ordered by topological level and grown concurrently
+ (atomic claim of each node), and the merges only happen when they keep the
+ partition (quotient) graph acyclic.
+ * * * * * * */
+static constexpr size_t acyclic_chunk = 1024;  // nodes or roots per thread_pool task
+
+int Label_acyclic::get_idx(const Node &n) const {
+  size_t h   = n.get_hidx() + 1;  // non_hierarchical is -1
+  size_t nid = n.get_nid();
+  if (h >= node2idx.size() || nid >= node2idx[h].size()) {
+    return -1;
+  }
+  return node2idx[h][nid];
+}
+
+void Label_acyclic::build_compact(Lgraph *g) {
+  TRACE_EVENT("pass", "LABEL_acyclic_compact");
+
+  node2idx.clear();
+  idx2node.clear();
+  for (auto n : g->forward(hier)) {  // forward order is a topological order (flops cut the loops)
+    if (n.get_type_op() == Ntype_op::Const || n.get_type_op() == Ntype_op::IO) {
+      continue;
+    }
+    size_t h   = n.get_hidx() + 1;
+    size_t nid = n.get_nid();
+    if (h >= node2idx.size()) {
+      node2idx.resize(h + 1);
+    }
+    if (nid >= node2idx[h].size()) {
+      node2idx[h].resize(nid + 1, -1);
+    }
+    node2idx[h][nid] = idx2node.size();
+    idx2node.emplace_back(n.get_compact());
+  }
+
+  const auto n_nodes = idx2node.size();
+  pred_start.clear();
+  preds.clear();
+  seeds.clear();
+  pred_start.reserve(n_nodes + 1);
+  level.assign(n_nodes, 0);
+
+  for (size_t idx = 0; idx < n_nodes; ++idx) {
+    pred_start.emplace_back(preds.size());
+
+    Node n(g, idx2node[idx]);
+    for (auto &e : n.inp_edges()) {
+      auto pidx = get_idx(e.driver.get_node());
+      if (pidx < 0 || static_cast<size_t>(pidx) == idx) {
+        continue;
+      }
+      preds.emplace_back(pidx);
+      if (static_cast<size_t>(pidx) < idx) {
+        level[idx] = std::max(level[idx], level[pidx] + 1);
+      }
+    }
+
+    // Same potential roots as gather_roots
+    auto n_out = n.get_num_out_edges();
+    if (n_out != 1) {
+      seeds.emplace_back(idx);
+    } else {
+      for (const auto &oe : n.out_edges()) {
+        if (oe.sink.get_node().get_type_op() == Ntype_op::IO) {
+          seeds.emplace_back(idx);
+        }
+      }
+    }
+  }
+  pred_start.emplace_back(preds.size());
+}
+
+void Label_acyclic::seed_parallel() {
+  // Deepest levels (closer to the outputs) first, ties in forward order. Keeps the Partition IDs deterministic.
+  std::stable_sort(seeds.begin(), seeds.end(), [this](int a, int b) { return level[a] > level[b]; });
+
+  owner = std::vector<std::atomic<int>>(idx2node.size());
+  for (size_t i = 0; i < seeds.size(); ++i) {
+    owner[seeds[i]].store(i + 1, std::memory_order_relaxed);
+  }
+}
+
+void Label_acyclic::grow_parallel() {
+  TRACE_EVENT("pass", "LABEL_acyclic_grow");
+
+  for (size_t start = 0; start < seeds.size(); start += acyclic_chunk) {
+    thread_pool.add([this, start]() {
+      std::vector<int> pending;
+      const auto       end = std::min(seeds.size(), start + acyclic_chunk);
+      for (auto i = start; i < end; ++i) {
+        const int pid = i + 1;
+        pending.emplace_back(seeds[i]);
+        while (!pending.empty()) {
+          auto idx = pending.back();
+          pending.pop_back();
+          for (auto j = pred_start[idx]; j < pred_start[idx + 1]; ++j) {
+            auto pidx     = preds[j];
+            int  expected = 0;  // roots are claimed before the growth starts
+            if (owner[pidx].compare_exchange_strong(expected, pid, std::memory_order_relaxed)) {
+              pending.emplace_back(pidx);
+            }
+          }
+        }
+      }
+    });
+  }
+  thread_pool.wait_all();
+}
+
+void Label_acyclic::gather_quotient() {
+  TRACE_EVENT("pass", "LABEL_acyclic_quotient");
+
+  const auto n_parts = seeds.size() + 1;  // Partition ID 0 is unclaimed
+
+  // Edges between partitions, gathered per chunk of nodes
+  const auto                                    n_chunks = (idx2node.size() + acyclic_chunk - 1) / acyclic_chunk;
+  std::vector<std::vector<std::pair<int, int>>> chunk_edges(n_chunks);
+  for (size_t c = 0; c < n_chunks; ++c) {
+    thread_pool.add([this, c, &chunk_edges]() {
+      auto      &edges = chunk_edges[c];
+      const auto end   = std::min(idx2node.size(), (c + 1) * acyclic_chunk);
+      for (auto idx = c * acyclic_chunk; idx < end; ++idx) {
+        auto to = owner[idx].load(std::memory_order_relaxed);
+        if (to == 0) {
+          continue;
+        }
+        for (auto j = pred_start[idx]; j < pred_start[idx + 1]; ++j) {
+          auto from = owner[preds[j]].load(std::memory_order_relaxed);
+          if (from != 0 && from != to) {
+            edges.emplace_back(to, from);
+          }
+        }
+      }
+      std::sort(edges.begin(), edges.end());
+      edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    });
+  }
+  thread_pool.wait_all();
+
+  part_inc.assign(n_parts, {});
+  for (const auto &edges : chunk_edges) {
+    for (const auto &[to, from] : edges) {
+      part_inc[to].emplace_back(from);
+    }
+  }
+
+  std::vector<int>              n_pending(n_parts, 0);
+  std::vector<std::vector<int>> part_out(n_parts);
+  for (size_t pid = 1; pid < n_parts; ++pid) {
+    auto &inc = part_inc[pid];
+    std::sort(inc.begin(), inc.end());
+    inc.erase(std::unique(inc.begin(), inc.end()), inc.end());
+    n_pending[pid] = inc.size();
+    for (auto from : inc) {
+      part_out[from].emplace_back(pid);
+    }
+  }
+
+  part_size.assign(n_parts, 0);
+  for (const auto &o : owner) {
+    ++part_size[o.load(std::memory_order_relaxed)];
+  }
+
+  // Kahn on the quotient graph. Partitions in (or after) a loop keep level -1 and are not merged
+  part_level.assign(n_parts, -1);
+  std::vector<int> ready;
+  for (size_t pid = 1; pid < n_parts; ++pid) {
+    if (n_pending[pid] == 0) {
+      part_level[pid] = 0;
+      ready.emplace_back(pid);
+    }
+  }
+  while (!ready.empty()) {
+    auto pid = ready.back();
+    ready.pop_back();
+    for (auto to : part_out[pid]) {
+      part_level[to] = std::max(part_level[to], part_level[pid] + 1);
+      if (--n_pending[to] == 0) {
+        ready.emplace_back(to);
+      }
+    }
+  }
+}
+
+int Label_acyclic::find_part(int pid) {
+  while (part_up[pid] != pid) {
+    part_up[pid] = part_up[part_up[pid]];
+    pid          = part_up[pid];
+  }
+  return pid;
+}
+
+void Label_acyclic::merge_parts(int merge_from, int merge_into) {
+  part_up[merge_from] = merge_into;
+  part_size[merge_into] += part_size[merge_from];
+  auto &inc = part_inc[merge_into];
+  inc.insert(inc.end(), part_inc[merge_from].begin(), part_inc[merge_from].end());
+  part_inc[merge_from].clear();
+}
+
+void Label_acyclic::merge_parallel() {
+  TRACE_EVENT("pass", "LABEL_acyclic_merge");
+
+  const auto n_parts = part_inc.size();
+  part_up.resize(n_parts);
+  for (size_t pid = 0; pid < n_parts; ++pid) {
+    part_up[pid] = pid;
+  }
+
+  // Same parents (as merge_partitions_same_parents). Only at the same quotient level: there is no path between
+  // them, so the merge can not close a loop.
+  absl::flat_hash_map<std::vector<int>, int> same_parents;  // <level + Incoming Partition IDs, Partition ID>
+  for (size_t pid = 1; pid < n_parts; ++pid) {
+    if (part_level[pid] < 0 || part_inc[pid].empty()) {
+      continue;
+    }
+    std::vector<int> key;
+    key.reserve(part_inc[pid].size() + 1);
+    key.emplace_back(part_level[pid]);
+    key.insert(key.end(), part_inc[pid].begin(), part_inc[pid].end());
+
+    auto [it, inserted] = same_parents.try_emplace(std::move(key), pid);
+    if (inserted) {
+      continue;
+    }
+    auto into = it->second;
+    if (part_size[into] <= cutoff || part_size[pid] <= cutoff) {
+      merge_parts(pid, into);
+    }
+  }
+
+  // One parent (as merge_partitions_one_parent). All the inputs come from the parent, so any path from the parent
+  // into the partition is the direct edge, and the merge can not close a loop either.
+  std::vector<int> order;
+  for (size_t pid = 1; pid < n_parts; ++pid) {
+    if (part_level[pid] >= 0) {
+      order.emplace_back(pid);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return part_level[a] < part_level[b]; });
+
+  for (auto pid : order) {
+    if (find_part(pid) != pid) {
+      continue;
+    }
+    int  parent     = -1;
+    bool one_parent = true;
+    for (auto from : part_inc[pid]) {
+      auto root = find_part(from);
+      if (root == pid) {
+        continue;
+      }
+      if (parent >= 0 && parent != root) {
+        one_parent = false;
+        break;
+      }
+      parent = root;
+    }
+    if (one_parent && parent > 0 && part_level[parent] >= 0) {
+      merge_parts(pid, parent);
+    }
+  }
+}
+
+void Label_acyclic::label_parallel(Lgraph *g) {
+  TRACE_EVENT("pass", "LABEL_acyclic_parallel");
+
+  build_compact(g);
+  seed_parallel();
+  grow_parallel();
+
+  part_up.clear();
+  if (merge_en) {
+    gather_quotient();
+    merge_parallel();
+  }
+
+  for (auto n : g->fast(hier)) {
+    auto idx = get_idx(n);
+    if (idx < 0) {
+      n.set_color(NO_COLOR);
+      continue;
+    }
+    int pid = owner[idx].load(std::memory_order_relaxed);
+    if (pid != 0 && !part_up.empty()) {
+      pid = find_part(pid);
+    }
+    n.set_color(pid);
+#if CHANGE_NODE_NAMES
+    n.set_name(std::string(std::format("ACYCPART{}", pid)));
+#endif
+  }
+}
+
 // dump()
 void Label_acyclic::dump(Lgraph *g) const {
   std::cout << "---- Label_acyclic dump ----\n";
@@ -548,6 +852,14 @@ void Label_acyclic::label(Lgraph *g) {
   }
   g->ref_node_color_map()->clear();
 
+  if (parallel) {
+    label_parallel(g);
+    if (verbose) {
+      dump(g);
+    }
+    return;
+  }
+
   gather_roots(g);
   grow_partitions(g);
   gather_inou(g);
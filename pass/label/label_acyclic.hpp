@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include "cell.hpp"
@@ -18,6 +19,7 @@ private:
   const bool verbose;
   const bool hier;
   const bool merge_en;
+  const bool parallel;
   uint8_t    cutoff;  // currently not being used
   uint8_t    part_id;
 
@@ -53,8 +55,32 @@ private:
   void merge_partitions_same_parents();
   void merge_partitions_one_parent();
 
+  // Parallel mode: dense tables indexed by a compact node numbering (forward order)
+  std::vector<std::vector<int>> node2idx;    // [hidx + 1][nid] -> compact index, -1 for Const/IO
+  std::vector<Node::Compact>    idx2node;    // <compact index, Node>
+  std::vector<size_t>           pred_start;  // CSR, drivers of idx are preds[pred_start[idx]..pred_start[idx + 1])
+  std::vector<int>              preds;
+  std::vector<int>              level;       // topological level (loops through flops are cut)
+  std::vector<std::atomic<int>> owner;       // <compact index, Partition ID>, 0 unclaimed
+  std::vector<int>              seeds;       // partition roots, Partition ID is the position + 1
+  std::vector<int>              part_size;   // <Partition ID, Nodes in Partition>
+  std::vector<int>              part_level;  // <Partition ID, level in the quotient graph>, -1 if in a loop
+  std::vector<std::vector<int>> part_inc;    // <Partition ID, Incoming Partition IDs>
+  std::vector<int>              part_up;     // union-find of merged partitions
+
+  [[nodiscard]] int get_idx(const Node &n) const;
+  int               find_part(int pid);
+  void              merge_parts(int merge_from, int merge_into);
+
+  void build_compact(Lgraph *g);
+  void seed_parallel();
+  void grow_parallel();
+  void gather_quotient();
+  void merge_parallel();
+  void label_parallel(Lgraph *g);
+
 public:
   void label(Lgraph *g);
-  Label_acyclic(bool _v, bool _h, uint8_t _c, bool _m);
+  Label_acyclic(bool _v, bool _h, uint8_t _c, bool _m, bool _p = false);
   void dump(Lgraph *g) const;
 };
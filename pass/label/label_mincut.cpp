@@ -2,15 +2,15 @@
 
 #include "label_mincut.hpp"
 
+#include <algorithm>
+
 #include "algorithms/global_mincut/algorithms.h"
 #include "algorithms/global_mincut/minimum_cut.h"
 #include "common/configuration.h"
 #include "common/definitions.h"
 #include "data_structure/graph_access.h"
 #include "data_structure/mutable_graph.h"
-#include "io/graph_io.h"
 #include "tools/random_functions.h"
-#include "tools/string.h"
 #include "tools/timer.h"
 
 // #define M_DEBUG 1
@@ -23,19 +23,37 @@ typedef std::shared_ptr<mutable_graph> GraphPtr;
  * * * * * * * * */
 Label_mincut::Label_mincut(bool _v, bool _h, int _i, int _s, std::string_view _a)
     : verbose(_v), hier(_h), iters(_i), seed(_s), alg(_a) {
-  node_id     = 0;
-  num_nodes   = 0;
-  num_edges   = 0;
-  base_path   = "lgdb/";          // assuming things are run from livehd/
-  metis_name  = "mincut.metis";   // file name for metis graph file
-  result_name = "mincut.result";  // where the output goes
+  num_nodes = 0;
+  num_edges = 0;
+}
+
+int Label_mincut::get_id(const Node &n) const {
+  size_t h   = n.get_hidx() + 1;  // non_hierarchical is -1
+  size_t nid = n.get_nid();
+  if (h >= node2id.size() || nid >= node2id[h].size()) {
+    return -1;
+  }
+  return node2id[h][nid];
+}
+
+void Label_mincut::set_id(const Node &n, int id) {
+  size_t h   = n.get_hidx() + 1;
+  size_t nid = n.get_nid();
+  if (h >= node2id.size()) {
+    node2id.resize(h + 1);
+  }
+  if (nid >= node2id[h].size()) {
+    node2id[h].resize(nid + 1, -1);
+  }
+  node2id[h][nid] = id;
 }
 
 /* * * * * * * * *
  * This function will populate id2node and node2id
  * * * * * * * * */
 void Label_mincut::gather_ids(Lgraph *g) {
-  node_id = 0;                       // ensure reset
+  node2id.clear();
+  id2node.clear();
   for (auto n : g->forward(hier)) {  // forward iteration for order
     if (n.get_type_op() == Ntype_op::IO) {
       continue;
@@ -43,102 +61,85 @@ void Label_mincut::gather_ids(Lgraph *g) {
     if (n.get_type_op() == Ntype_op::Const) {
       continue;
     }
-    node2id[n.get_compact()] = node_id;
-    id2node[node_id]         = n.get_compact();
-    node_id++;
+    set_id(n, id2node.size());
+    id2node.emplace_back(n.get_compact());
   }
-  num_nodes = node_id;
+  num_nodes = id2node.size();
 }
 
 /* * * * * * * * *
- * This function will populate id2neighs
+ * This function will populate the neighbors (CSR)
  * * * * * * * * */
 void Label_mincut::gather_neighs(Lgraph *g) {
-  for (auto &it : id2node) {
-    auto curr_id   = it.first;
-    auto curr_node = it.second;
+  neigh_start.clear();
+  neighs.clear();
+  neigh_start.reserve(num_nodes + 1);
 
-    Node tmp_n(g, curr_node);
+  for (size_t curr_id = 0; curr_id < num_nodes; ++curr_id) {
+    neigh_start.emplace_back(neighs.size());
 
-    if (tmp_n.get_type_op() == Ntype_op::Const) {
-      continue;
-    }
-    // gather the sinks
+    Node tmp_n(g, id2node[curr_id]);
+
+    // gather the sinks and the drivers (IO and Const nodes have no VieCut id)
     for (auto &e : tmp_n.out_edges()) {
-      auto spin        = e.sink;
-      auto dpin        = e.driver;
-      auto snode       = spin.get_node();
-      auto dnode       = dpin.get_node();
-      auto outgoing_id = node2id[snode.get_compact()];
-      auto this_id     = node2id[dnode.get_compact()];
-
-      if (snode.get_type_op() == Ntype_op::Const) {
-        continue;
-      }
-      if (snode.get_type_op() != Ntype_op::IO) {
-        if ((curr_id != outgoing_id) && (curr_id == this_id)) {
-          id2neighs[curr_id].insert(outgoing_id);
-          num_edges++;
-        }
+      auto outgoing_id = get_id(e.sink.get_node());
+      if (outgoing_id >= 0 && static_cast<size_t>(outgoing_id) != curr_id) {
+        neighs.emplace_back(outgoing_id);
       }
     }
-
-    // gather the drivers
     for (auto &e : tmp_n.inp_edges()) {
-      auto spin        = e.sink;
-      auto dpin        = e.driver;
-      auto snode       = spin.get_node();
-      auto dnode       = dpin.get_node();
-      auto incoming_id = node2id[dnode.get_compact()];
-      auto this_id     = node2id[snode.get_compact()];
-
-      if (dnode.get_type_op() == Ntype_op::Const) {
-        continue;
-      }
-      if (dnode.get_type_op() != Ntype_op::IO) {
-        if ((curr_id != incoming_id) && (curr_id == this_id)) {
-          id2neighs[curr_id].insert(incoming_id);
-        }
+      auto incoming_id = get_id(e.driver.get_node());
+      if (incoming_id >= 0 && static_cast<size_t>(incoming_id) != curr_id) {
+        neighs.emplace_back(incoming_id);
       }
     }
-  }  // END of for loop going through all nodes
+
+    auto first = neighs.begin() + neigh_start.back();
+    std::sort(first, neighs.end());
+    neighs.erase(std::unique(first, neighs.end()), neighs.end());
+  }
+  neigh_start.emplace_back(neighs.size());
+
+  num_edges = neighs.size() / 2;  // each undirected edge is in both neighbor lists
 }
 
 /* * * * * * * * *
- * This function generates a metis graph file from Lgraph
- *   creates metis graph file with at base_path + metis_name
+ * Builds the VieCut graph directly from the Lgraph (same graph that the METIS file used to have)
  * * * * * * * * */
-void Label_mincut::lg_to_metis(Lgraph *g) {
+GraphPtr Label_mincut::lg_to_viecut(Lgraph *g) {
   gather_ids(g);
   gather_neighs(g);
 
-  std::ofstream out_file(base_path + metis_name);  // file create
-  out_file << std::format(" {} {} 0\n", num_nodes, num_edges);
-
-  for (int i = 0; i < num_nodes; i++) {
-    auto neighs = id2neighs[i];
-    for (auto &it : neighs) {
-      out_file << std::format(" {}", it);
+  auto G = std::make_shared<mutable_graph>();
+  G->start_construction(num_nodes, 2 * num_edges);
+  for (size_t i = 0; i < num_nodes; ++i) {
+    auto node = G->new_node();
+    G->setPartitionIndex(node, 0);
+  }
+  for (size_t i = 0; i < num_nodes; ++i) {
+    for (auto j = neigh_start[i]; j < neigh_start[i + 1]; ++j) {
+      if (static_cast<size_t>(neighs[j]) > i) {
+        G->new_edge(i, neighs[j], 1);
+      }
     }
-    out_file << "\n";
   }
+  G->finish_construction();
+  G->computeDegrees();
 
-  out_file.close();
+  return G;
 }
 
 /* * * * * * * * *
  * All code borrowed from VieCut/app/mincut.cpp
  * * * * * * * * */
-void Label_mincut::viecut_cut(std::string inp_metis_path, std::string out_path) {
+void Label_mincut::viecut_cut(const GraphPtr &G) {
   size_t num_iterations = iters;
   // size_t num_iterations = 3;
   auto cfg = configuration::getConfig();
 
-  cfg->graph_filename = inp_metis_path;
-  cfg->algorithm      = std::string(alg);
+  cfg->algorithm = std::string(alg);
   // cfg->algorithm = "cactus";
-  cfg->output_path             = out_path;
-  cfg->save_cut                = true;
+  cfg->save_cut                = true;  // leaves the partition in G (getNodeInCut)
   cfg->find_lowest_conductance = true;
   cfg->seed                    = seed;
   // cfg->seed = 12;
@@ -149,9 +150,6 @@ void Label_mincut::viecut_cut(std::string inp_metis_path, std::string out_path)
 
   std::vector<int> numthreads;
   timer            t;
-  timer            tdegs;
-
-  GraphPtr G = graph_io::readGraphWeighted<mutable_graph>(cfg->graph_filename);
 
   if (numthreads.empty()) {
     numthreads.emplace_back(1);
@@ -167,63 +165,39 @@ void Label_mincut::viecut_cut(std::string inp_metis_path, std::string out_path)
       t.restart();
 #ifdef M_DEBUG
       EdgeWeight cut;
-      // number of specified edges mismatch
-      // due to discarding of self loops
       cut = mc->perform_minimum_cut(G);
 #else
       mc->perform_minimum_cut(G);
 #endif
 
-      if (cfg->output_path != "") {
-        if (cfg->save_cut) {
-          graph_io::writeCut(G, cfg->output_path);
-        }
-      }
-
-      std::string graphname  = string::basename(cfg->graph_filename);
-      std::string algprint   = cfg->algorithm;
-      std::string queue_type = cfg->pq;
-
+#ifdef M_DEBUG
+      std::string algprint = cfg->algorithm;
       if (cfg->disable_limiting) {
         algprint += "-unlimited";
       }
 
-#ifdef M_DEBUG
       NodeID n = G->number_of_nodes();
       EdgeID m = G->number_of_edges();
-      std::cout << "RESULT:\n algo=" << algprint << "\n queue=" << queue_type << "\n graph=" << graphname
-                << "\n time=" << t.elapsed() << "\n cut=" << cut << "\n n=" << n << "\n m=" << m / 2 << "\n processes=" << numthread
-                << "\n edge_select=" << cfg->edge_selection << "\n seed=" << cfg->seed << std::endl;
+      std::cout << "RESULT:\n algo=" << algprint << "\n queue=" << cfg->pq << "\n time=" << t.elapsed() << "\n cut=" << cut
+                << "\n n=" << n << "\n m=" << m / 2 << "\n processes=" << numthread << "\n edge_select=" << cfg->edge_selection
+                << "\n seed=" << cfg->seed << std::endl;
 #endif
     }
   }
 }
 
 /* * * * * * * * *
- * Labels lg based on a result file generated from VieCut and fills id2color
+ * Fills id2color from the cut left in the VieCut graph
  * * * * * * * * */
-void Label_mincut::viecut_label(std::string result_path) {
-  struct stat buff;
-  if (stat(result_path.c_str(), &buff) != 0) {
-    std::print("viecut result file, {}, does no exist inside {}\n", result_name, base_path);
-    return;
-  }
-  std::ifstream in_file(result_path);
-  std::string   one_line;
-  int           line_tracker = 0;
-  if (in_file.is_open()) {
-    while (in_file) {
-      std::getline(in_file, one_line);
-      if (one_line.size() == 0) {
-        continue;
-      }
-      auto curr_node = id2node[line_tracker++];
-      // Add one to avoid 0 as a color
-      auto t_col            = str_tools::to_i(one_line);
-      node2color[curr_node] = (t_col == NO_COLOR) ? (t_col + 1) : (t_col);
+void Label_mincut::viecut_label(const GraphPtr &G) {
+  id2color.assign(num_nodes, NO_COLOR);
+  for (NodeID node : G->nodes()) {
+    if (node >= num_nodes) {
+      break;
     }
+    // Add one to avoid 0 as a color
+    id2color[node] = (G->getNodeInCut(node) ? 1 : 0) + 1;
   }
-  in_file.close();
 }
 
 /* * * * * * * * *
@@ -233,39 +207,25 @@ void Label_mincut::dump(Lgraph *g) {
   std::cout << "---- Label MinCut Dump ----\n";
   std::print("Num Nodes: {}, Num Edges: {}\n", num_nodes, num_edges);
   std::cout << "=== id2node ===\n";
-  for (auto &it : id2node) {
-    auto curr_id = it.first;
-    Node tmp_n(g, it.second);
-    auto curr_node = tmp_n.debug_name();
-    std::print("  ID: {}, Node: {}\n", curr_id, curr_node);
-  }
-
-  std::cout << "=== node2id ===\n";
-  for (auto &it : node2id) {
-    auto curr_id = it.second;
-    Node tmp_n(g, it.first);
-    auto curr_node = tmp_n.debug_name();
-    std::print("  Node: {}, ID: {}\n", curr_id, curr_node);
+  for (size_t curr_id = 0; curr_id < id2node.size(); ++curr_id) {
+    Node tmp_n(g, id2node[curr_id]);
+    std::print("  ID: {}, Node: {}\n", curr_id, tmp_n.debug_name());
   }
 
   std::cout << "=== id2neighs ===\n";
-  for (auto &it : id2neighs) {
-    auto curr_id = it.first;
+  for (size_t curr_id = 0; curr_id + 1 < neigh_start.size(); ++curr_id) {
     Node tmp_n(g, id2node[curr_id]);
-    auto curr_node = tmp_n.debug_name();
-    auto neighbors = it.second;  // IntSet
-    std::print("  Node: {}, ID: {}\n", curr_node, curr_id);
-    for (auto &n : neighbors) {
-      std::print("  {}", n);
+    std::print("  Node: {}, ID: {}\n", tmp_n.debug_name(), curr_id);
+    for (auto j = neigh_start[curr_id]; j < neigh_start[curr_id + 1]; ++j) {
+      std::print("  {}", neighs[j]);
     }
     std::cout << "\n";
   }
 
   std::cout << "=== node2color ===\n";
-  for (auto &it : node2color) {
-    Node tmp_n(g, it.first);
-    auto curr_col = it.second;
-    std::print("  Node: {}, Color: {}\n", tmp_n.debug_name(), curr_col);
+  for (size_t curr_id = 0; curr_id < id2color.size(); ++curr_id) {
+    Node tmp_n(g, id2node[curr_id]);
+    std::print("  Node: {}, Color: {}\n", tmp_n.debug_name(), id2color[curr_id]);
   }
 
   std::cout << "---- fin ----\n";
@@ -280,19 +240,13 @@ void Label_mincut::label(Lgraph *g) {
   }
   g->ref_node_color_map()->clear();
 
-  std::string metis_location  = base_path + metis_name;
-  std::string result_location = base_path + result_name;
-  lg_to_metis(g);
-  viecut_cut(metis_location, result_location);
-  viecut_label(result_location);
+  auto G = lg_to_viecut(g);
+  viecut_cut(G);
+  viecut_label(G);
 
   for (auto n : g->fast(hier)) {
-    auto nc = n.get_compact();
-    if (node2color.contains(nc)) {
-      n.set_color(node2color[nc]);
-    } else {
-      n.set_color(NO_COLOR);
-    }
+    auto id = get_id(n);
+    n.set_color(id >= 0 ? id2color[id] : NO_COLOR);
   }
 
   if (verbose) {
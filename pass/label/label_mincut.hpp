@@ -2,8 +2,7 @@
 
 #pragma once
 
-#include <sys/stat.h>
-
+#include <memory>
 #include <vector>
 
 #include "cell.hpp"
@@ -15,6 +14,8 @@
 
 #define NO_COLOR 0
 
+class mutable_graph;
+
 class Label_mincut {
 private:
   const bool  verbose;
@@ -23,27 +24,25 @@ private:
   int         seed;
   std::string alg;
 
-  uint8_t node_id;
-  uint8_t num_nodes;
-  uint8_t num_edges;
-
-  std::string base_path;
-  std::string metis_name;
-  std::string result_name;
+  size_t num_nodes;
+  size_t num_edges;
 
-  using IntSet = absl::flat_hash_set<int>;
+  // Dense tables, the VieCut graph is built in memory from them (no METIS file round trip)
+  std::vector<std::vector<int>> node2id;      // [hidx + 1][nid] -> VieCut id, -1 when not in the VieCut graph
+  std::vector<Node::Compact>    id2node;      // <VieCut id, Node>
+  std::vector<size_t>           neigh_start;  // CSR, neighbors of id are neighs[neigh_start[id]..neigh_start[id + 1])
+  std::vector<int>              neighs;       // VieCut id of Neighbors
+  std::vector<int>              id2color;     // <VieCut id, corresponding color>
 
-  absl::flat_hash_map<Node::Compact, int> node2id;     // <Node, VieCut id>
-  absl::flat_hash_map<int, Node::Compact> id2node;     // <VieCut id, Node>
-  absl::flat_hash_map<int, IntSet>        id2neighs;   // <VieCut id, VieCut id of Neighbors>
-  absl::flat_hash_map<Node::Compact, int> node2color;  // <Node, corresponding color>
+  [[nodiscard]] int get_id(const Node &n) const;
+  void              set_id(const Node &n, int id);
 
   void gather_ids(Lgraph *g);
   void gather_neighs(Lgraph *g);
 
-  void lg_to_metis(Lgraph *g);
-  void viecut_cut(std::string inp_metis_path, std::string out_path);
-  void viecut_label(std::string result_path);
+  std::shared_ptr<mutable_graph> lg_to_viecut(Lgraph *g);
+  void                           viecut_cut(const std::shared_ptr<mutable_graph> &G);
+  void                           viecut_label(const std::shared_ptr<mutable_graph> &G);
 
 public:
   void label(Lgraph *g);
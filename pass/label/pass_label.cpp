@@ -45,6 +45,7 @@ void Pass_label::setup() {
   m3.add_label_optional("hier", "hierarchical traversal/labeling", "false");
   m3.add_label_optional("cutoff", "small partition node count cutoff", "1");
   m3.add_label_optional("merge", "enables merging of acyclic partitions", "false");
+  m3.add_label_optional("parallel", "multi-threaded partitioning (dense tables, acyclic merges only)", "false");
   m3.add_label_optional("verbose", "verbose statistics and information", "false");
   register_pass(m3);
 }
@@ -91,7 +92,13 @@ void Pass_label::label_acyclic(Eprp_var &var) {
     merge_en = true;
   }
 
-  Label_acyclic p(pp.verbose, pp.hier, cutoff, merge_en);
+  auto parallel_txt = var.get("parallel");
+  bool parallel     = false;
+  if (parallel_txt != "false" && parallel_txt != "0") {
+    parallel = true;
+  }
+
+  Label_acyclic p(pp.verbose, pp.hier, cutoff, merge_en, parallel);
 
   for (const auto &l : var.lgs) {
     p.label(l);
@@ -16,26 +16,36 @@ Lnast_tolg::Lnast_tolg(std::string_view _module_name, std::string_view _path) :
   tuple_assign_str = "tuple_assign";
 }
 
-std::vector<Lgraph *> Lnast_tolg::do_tolg(const std::shared_ptr<Lnast> &ln, const Lnast_nid &top_stmts) {
+Lgraph *Lnast_tolg::create_lgraph(const std::shared_ptr<Lnast> &ln, std::string_view mod_name, std::string_view lg_path) {
+  auto src = ln->get_source();
+  if (src.empty()) {
+    src = "-";
+  }
+
+  auto *lib = Graph_library::instance(lg_path);
+  if (lib == nullptr) {
+    Pass::error("lnast_tolg: unable to open graph_library {}", lg_path);
+    return nullptr;
+  }
+  return lib->create_lgraph(mod_name, src);
+}
+
+std::vector<Lgraph *> Lnast_tolg::do_tolg(const std::shared_ptr<Lnast> &ln, const Lnast_nid &top_stmts, Lgraph *lg) {
   TRACE_EVENT("pass", nullptr, [&ln](perfetto::EventContext ctx) {
     std::string converted_str{(char)('A' + (trace_module_cnt++ % 25))};
     ctx.event()->set_name(converted_str + std::string{ln->get_top_module_name()});
   });
 
-  lnast    = ln;
-  auto src = ln->get_source();
-  if (src.empty()) {
-    src = "-";
-  }
+  lnast = ln;
 
   std::vector<Lgraph *> lgs;
 
-  auto *lib = Graph_library::instance(path);
-  if (lib == nullptr) {
-    Pass::error("lnast_tolg: unable to open graph_library {}", path);
-    return lgs;
+  if (lg == nullptr) {
+    lg = create_lgraph(ln, module_name, path);
+    if (lg == nullptr) {
+      return lgs;
+    }
   }
-  auto *lg = lib->create_lgraph(module_name, src);
 
   name2dpin["$"] = lg->get_graph_input("$");
   I(!lg->get_graph_input("$").is_invalid());
@@ -15,7 +15,10 @@
 class Lnast_tolg {
 public:
   explicit Lnast_tolg(std::string_view _module_name, std::string_view _path);
-  std::vector<Lgraph *> do_tolg(const std::shared_ptr<Lnast> &ln, const Lnast_nid &top_stmts);
+  // lg is the (empty) module Lgraph when already created with create_lgraph, otherwise do_tolg creates it
+  std::vector<Lgraph *> do_tolg(const std::shared_ptr<Lnast> &ln, const Lnast_nid &top_stmts, Lgraph *lg = nullptr);
+
+  static Lgraph *create_lgraph(const std::shared_ptr<Lnast> &ln, std::string_view mod_name, std::string_view lg_path);
 
 private:
   std::shared_ptr<Lnast> lnast;
@@ -46,6 +46,10 @@ def writeNetList(fname, rData):
 
 def createGraphJsonDict():
 
+    # lgdb keeps the library in a binary index, ask lgshell for the json export
+    lgshell = os.environ.get('LGSHELL', './bazel-bin/main/lgshell')
+    subprocess.run([lgshell, "lgraph.library_json path:lgdb"], check=True)
+
     graph_json_file = open(os.getcwd() + '/lgdb/graph_library.json','r')
 
     lgdb_data = json.load(graph_json_file)
@@ -13,6 +13,7 @@
 
 #include <format>
 #include <iostream>
+#include <string>
 #include <mockturtle/algorithms/node_resynthesis.hpp>
 #include <mockturtle/algorithms/node_resynthesis/akers.hpp>
 #include <mockturtle/algorithms/node_resynthesis/direct.hpp>
@@ -21,14 +22,36 @@
 // FIXME: exact needs percy package in WORKSPACE
 // #include <mockturtle/algorithms/node_resynthesis/exact.hpp>
 
+#include "perf_tracing.hpp"
+#include "str_tools.hpp"
+#include "thread_pool.hpp"
+
 static Pass_plugin sample("pass_mockturtle", Pass_mockturtle::setup);
 
 void Pass_mockturtle::setup() {
   Eprp_method m1("pass.mockturtle", "pass a lgraph using mockturtle", &Pass_mockturtle::work);
 
+  m1.add_label_optional("lut_size", "LUT inputs (cut size) for the mapping", "4");
+  m1.add_label_optional("max_group_nodes", "max lgraph nodes per resynthesized group, 0 for unbounded", "2048");
+
   register_pass(m1);
 }
 
+Pass_mockturtle::Pass_mockturtle(const Eprp_var &var) : Pass("pass.mockturtle", var) {
+  // Parsed signed first, a negative value would wrap in the uint32_t fields
+  const auto lut   = var.get("lut_size");
+  const auto group = var.get("max_group_nodes");
+  if (!str_tools::is_i(lut) || str_tools::to_i(lut) < 2) {
+    error("pass.mockturtle lut_size:{} must be 2 or more", lut);
+  }
+  if (!str_tools::is_i(group) || str_tools::to_i(group) < 0) {
+    error("pass.mockturtle max_group_nodes:{} must be positive (0 for unbounded)", group);
+  }
+
+  lut_size        = str_tools::to_i(lut);
+  max_group_nodes = str_tools::to_i(group);
+}
+
 void Pass_mockturtle::work(Eprp_var &var) {
   Pass_mockturtle pass(var);
 
@@ -40,6 +63,10 @@ void Pass_mockturtle::work(Eprp_var &var) {
 void Pass_mockturtle::do_work(Lgraph *g) {
   // LGBench b("pass.mockturtle");
 
+  TRACE_EVENT("pass", nullptr, [g](perfetto::EventContext ctx) {
+    ctx.event()->set_name("MOCKTURTLE_" + std::string(g->get_name()));
+  });
+
   std::cout << "Partitioning...\n";
   if (!lg_partition(g)) {
     std::cout << "There is no node to be lutified!\n";
@@ -66,6 +93,8 @@ void Pass_mockturtle::do_work(Lgraph *g) {
   node2gid.clear();
   gid2mt.clear();
   gid2klut.clear();
+  gid2bdinp_edges.clear();
+  gid2bdout_edges.clear();
   bdinp_edges.clear();
   bdout_edges.clear();
   edge2mt_sigs.clear();
@@ -76,8 +105,12 @@ void Pass_mockturtle::do_work(Lgraph *g) {
   gid_pi2sink_node_lg_pid.clear();
 }
 
+// Groups never share an edge: a node fed by two groups, or by a group
+// already at max_group_nodes, is not lutified and stays as a seam between
+// groups. This keeps the groups independent for the parallel resynthesis.
 bool Pass_mockturtle::lg_partition(Lgraph *g) {
-  unsigned int new_group_id = 0;
+  unsigned int          new_group_id = 0;
+  std::vector<uint32_t> group_size;
 
   for (const auto &node : g->forward()) {
     if (node2gid.find(node.get_compact()) != node2gid.end()) {
@@ -87,16 +120,10 @@ bool Pass_mockturtle::lg_partition(Lgraph *g) {
       continue;
     }
 
-    std::print("Node identifier:{}\n", node.debug_name());
-    int propagate_id = -1;
+    int  propagate_id = -1;
+    bool seam         = false;
     for (const auto &inp_edge : node.inp_edges()) {
       auto peer_driver_node = inp_edge.driver.get_node();
-      std::print("peer_driver_node:{}\n", peer_driver_node.debug_name());
-
-      // all combinational linked to graph input should be in the same group
-      if (peer_driver_node == g->get_graph_input_node()) {
-        propagate_id = 0;
-      }
 
       // sh:fixme:should we set Pickup_Op as eligible cell? if not, the Pickup will be the new group isolator...
       if (!eligible_cell_op(peer_driver_node)) {
@@ -104,19 +131,29 @@ bool Pass_mockturtle::lg_partition(Lgraph *g) {
       }
 
       auto it = node2gid.find(peer_driver_node.get_compact());
-      if (it != node2gid.end()) {
-        // GI((propagate_id>=0), (it->second == propagate_id));
-        propagate_id = it->second;
-      } else {
-        I(false);  // impossible for g->forward()
+      if (it == node2gid.end()) {
+        continue;  // the driver is a seam, it isolates like a non-eligible cell
       }
+      if (propagate_id >= 0 && it->second != static_cast<unsigned int>(propagate_id)) {
+        seam = true;
+        break;
+      }
+      propagate_id = it->second;
+    }
+
+    if (seam) {
+      continue;
     }
 
     if (propagate_id < 0) {
       propagate_id = new_group_id++;
+      group_size.emplace_back(0);
+    } else if (max_group_nodes && group_size[propagate_id] >= max_group_nodes) {
+      continue;
     }
 
     node2gid[node.get_compact()] = propagate_id;
+    ++group_size[propagate_id];
   }
 
   return !node2gid.empty();
@@ -808,132 +845,150 @@ void Pass_mockturtle::create_mockturtle_network(Lgraph *g) {
   }
 }
 
+// Each group is resynthesized and mapped on its own thread. All the shared
+// tables get their entries here, so the tasks only update their own values.
 void Pass_mockturtle::convert_mockturtle_to_KLUT() {
   for (const auto &gid2mt_iter : gid2mt) {
-    const unsigned int             group_id = gid2mt_iter.first;
-    const mockturtle::mig_network &mt_ntk   = gid2mt_iter.second;
+    gid2klut[gid2mt_iter.first];
+    gid2bdinp_edges[gid2mt_iter.first];
+    gid2bdout_edges[gid2mt_iter.first];
+  }
 
-    // mapping the po driving signal between original mig and the synthsized one
-    std::vector<mockturtle::mig_network::signal>                                          mig_pos_drivers_original;
-    std::vector<mockturtle::mig_network::signal>                                          mig_pos_drivers_synth;
-    absl::flat_hash_map<mockturtle::mig_network::signal, mockturtle::mig_network::signal> mig_synth_po_sigs_map;
+  for (const auto &inp_edge : bdinp_edges) {
+    const auto group_id = edge2mt_sigs[inp_edge].gid;
+    gid2bdinp_edges[group_id].emplace_back(inp_edge);
+    edge2klut_inp_sigs[inp_edge].gid = group_id;
+  }
 
-    mt_ntk.foreach_po([&](const auto &n) { mig_pos_drivers_original.emplace_back(n); });
+  for (const auto &out_edge : bdout_edges) {
+    const auto group_id = edge2mt_sigs[out_edge].gid;
+    gid2bdout_edges[group_id].emplace_back(out_edge);
+    edge2klut_out_sigs[out_edge].gid = group_id;
+  }
+
+  for (const auto &gid2mt_iter : gid2mt) {
+    thread_pool.add([this, group_id = gid2mt_iter.first]() -> void { convert_group_to_KLUT(group_id); });
+  }
+  thread_pool.wait_all();
+}
+
+void Pass_mockturtle::convert_group_to_KLUT(unsigned int group_id) {
+  TRACE_EVENT("pass", nullptr, [group_id](perfetto::EventContext ctx) {
+    ctx.event()->set_name("MOCKTURTLE_group_" + std::to_string(group_id));
+  });
+
+  const mockturtle::mig_network &mt_ntk = gid2mt.at(group_id);
+
+  // mapping the po driving signal between original mig and the synthsized one
+  std::vector<mockturtle::mig_network::signal>                                          mig_pos_drivers_original;
+  std::vector<mockturtle::mig_network::signal>                                          mig_pos_drivers_synth;
+  absl::flat_hash_map<mockturtle::mig_network::signal, mockturtle::mig_network::signal> mig_synth_po_sigs_map;
+
+  mt_ntk.foreach_po([&](const auto &n) { mig_pos_drivers_original.emplace_back(n); });
 
 #if 1
-    auto net0 = mt_ntk;
+  auto net0 = mt_ntk;
 
-    // net0 = mockturtle::cleanup_dangling(net0);
+  // net0 = mockturtle::cleanup_dangling(net0);
 
-    mockturtle::refactoring_params rf_ps;
-    rf_ps.max_pis = 4;
-    mockturtle::mig_npn_resynthesis resyn1;
-    mockturtle::refactoring(net0, resyn1, rf_ps);
-    net0 = mockturtle::cleanup_dangling(net0);
+  mockturtle::refactoring_params rf_ps;
+  rf_ps.max_pis = 4;
+  mockturtle::mig_npn_resynthesis resyn1;
+  mockturtle::refactoring(net0, resyn1, rf_ps);
+  net0 = mockturtle::cleanup_dangling(net0);
 
-    mockturtle::akers_resynthesis<mockturtle::mig_network> resyn2;
-    const auto mig = mockturtle::node_resynthesis<mockturtle::mig_network>(net0, resyn2);
-    net0           = mockturtle::cleanup_dangling(net0);
+  mockturtle::akers_resynthesis<mockturtle::mig_network> resyn2;
+  const auto mig = mockturtle::node_resynthesis<mockturtle::mig_network>(net0, resyn2);
+  net0           = mockturtle::cleanup_dangling(net0);
 
-    mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{net0};
+  mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{net0};
 
 #else
-    mockturtle::mig_network cleaned_mt_ntk = cleanup_dangling(mt_ntk);
+  mockturtle::mig_network cleaned_mt_ntk = cleanup_dangling(mt_ntk);
 
-    mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{cleaned_mt_ntk};  // todo:might not suit for xag
+  mockturtle::mapping_view<mockturtle::mig_network, true> mapped_mig{cleaned_mt_ntk};  // todo:might not suit for xag
 #endif
-    mockturtle::lut_mapping_params ps;
-    ps.cut_enumeration_ps.cut_size = LUT_input_bits;
-    mockturtle::lut_mapping<mockturtle::mapping_view<mockturtle::mig_network, true>, true>(mapped_mig, ps);
-    mockturtle::klut_network klut_ntk = *mockturtle::collapse_mapped_network<mockturtle::klut_network>(mapped_mig);
-    write_bench(mapped_mig, std::cout);
-    std::cout << "----------------------\n";
-    write_bench(klut_ntk, std::cout);
+  mockturtle::lut_mapping_params ps;
+  ps.cut_enumeration_ps.cut_size = lut_size;
+  mockturtle::lut_mapping<mockturtle::mapping_view<mockturtle::mig_network, true>, true>(mapped_mig, ps);
+  mockturtle::klut_network klut_ntk = *mockturtle::collapse_mapped_network<mockturtle::klut_network>(mapped_mig);
 
 #ifndef NDEBUG
-    // equivalence checking using miter
-    const auto miter  = *mockturtle::miter<mockturtle::klut_network>(mapped_mig, klut_ntk);
-    const auto result = *mockturtle::equivalence_checking(miter);
-    if (result) {
-      std::cout << "mig->klut is equivalent!!\n";
-    }
-    I(result);
+  // equivalence checking using miter
+  const auto miter  = *mockturtle::miter<mockturtle::klut_network>(mapped_mig, klut_ntk);
+  const auto result = *mockturtle::equivalence_checking(miter);
+  if (result) {
+    std::cout << "mig->klut is equivalent!!\n";
+  }
+  I(result);
 #endif
 
-    // mapping the po driving signal and pi node between original mig and the synthsized one
-    mt_ntk.foreach_po([&](const auto &n) { mig_pos_drivers_synth.emplace_back(n); });
+  // mapping the po driving signal and pi node between original mig and the synthsized one
+  mt_ntk.foreach_po([&](const auto &n) { mig_pos_drivers_synth.emplace_back(n); });
 
-    for (unsigned long int i = 0; i < mig_pos_drivers_original.size(); i++) {
-      mig_synth_po_sigs_map[mig_pos_drivers_original[i]] = mig_pos_drivers_synth[i];
-    }
+  for (unsigned long int i = 0; i < mig_pos_drivers_original.size(); i++) {
+    mig_synth_po_sigs_map[mig_pos_drivers_original[i]] = mig_pos_drivers_synth[i];
+  }
 
-    // after po driver mapping, change the lgraph edge2mt_sigs mapping accordingly
-    // note: no need to handle bdinp_edges mapping as the pis has node representation, won't be changed by synth.
-    for (const auto &out_edge : bdout_edges) {
-      for (auto &itr : edge2mt_sigs[out_edge].signals) {
-        itr = mig_synth_po_sigs_map[itr];
-      }
+  // after po driver mapping, change the lgraph edge2mt_sigs mapping accordingly
+  // note: no need to handle bdinp_edges mapping as the pis has node representation, won't be changed by synth.
+  for (const auto &out_edge : gid2bdout_edges.at(group_id)) {
+    for (auto &itr : edge2mt_sigs.at(out_edge).signals) {
+      itr = mig_synth_po_sigs_map[itr];
     }
+  }
 
-    gid2klut[group_id] = klut_ntk;
-    // mapping mig IO signal to klut IO signal
-    I(mt_ntk.num_pis() == klut_ntk.num_pis() && mt_ntk.num_pos() == klut_ntk.num_pos());
-
-    std::vector<mockturtle::mig_network::node>    mig_inps;
-    std::vector<mockturtle::mig_network::signal>  mig_outs;
-    std::vector<mockturtle::klut_network::node>   klut_inps;
-    std::vector<mockturtle::klut_network::signal> klut_outs;
-    mt_ntk.foreach_pi([&](const auto &n) { mig_inps.emplace_back(n); });
-    mt_ntk.foreach_po([&](const auto &n) { mig_outs.emplace_back(n); });
-
-    klut_ntk.foreach_pi([&](const auto &n) { klut_inps.emplace_back(n); });
-    klut_ntk.foreach_po([&](const auto &n) { klut_outs.emplace_back(n); });
-
-    absl::flat_hash_map<mockturtle::mig_network::node, mockturtle::klut_network::node>     mig_pi2klut_pi;
-    absl::flat_hash_map<mockturtle::mig_network::signal, mockturtle::klut_network::signal> mig_po2klut_po;
-    auto                                                                                   mig_inp_iter  = mig_inps.begin();
-    auto                                                                                   klut_inp_iter = klut_inps.begin();
-    while (mig_inp_iter != mig_inps.end()) {
-      mig_pi2klut_pi[*mig_inp_iter] = *klut_inp_iter;
-      std::print("Mockturtle Input({}) -> KLUT Input({})\n",
-                 mt_ntk.node_to_index(*mig_inp_iter),
-                 klut_ntk.node_to_index(*klut_inp_iter));
-      mig_inp_iter++;
-      klut_inp_iter++;
-    }
+  gid2klut.at(group_id) = klut_ntk;
+  // mapping mig IO signal to klut IO signal
+  I(mt_ntk.num_pis() == klut_ntk.num_pis() && mt_ntk.num_pos() == klut_ntk.num_pos());
+
+  std::vector<mockturtle::mig_network::node>    mig_inps;
+  std::vector<mockturtle::mig_network::signal>  mig_outs;
+  std::vector<mockturtle::klut_network::node>   klut_inps;
+  std::vector<mockturtle::klut_network::signal> klut_outs;
+  mt_ntk.foreach_pi([&](const auto &n) { mig_inps.emplace_back(n); });
+  mt_ntk.foreach_po([&](const auto &n) { mig_outs.emplace_back(n); });
+
+  klut_ntk.foreach_pi([&](const auto &n) { klut_inps.emplace_back(n); });
+  klut_ntk.foreach_po([&](const auto &n) { klut_outs.emplace_back(n); });
+
+  absl::flat_hash_map<mockturtle::mig_network::node, mockturtle::klut_network::node>     mig_pi2klut_pi;
+  absl::flat_hash_map<mockturtle::mig_network::signal, mockturtle::klut_network::signal> mig_po2klut_po;
+  auto                                                                                   mig_inp_iter  = mig_inps.begin();
+  auto                                                                                   klut_inp_iter = klut_inps.begin();
+  while (mig_inp_iter != mig_inps.end()) {
+    mig_pi2klut_pi[*mig_inp_iter] = *klut_inp_iter;
+    mig_inp_iter++;
+    klut_inp_iter++;
+  }
 
-    auto mig_out_iter  = mig_outs.begin();
-    auto klut_out_iter = klut_outs.begin();
-    while (mig_out_iter != mig_outs.end()) {
-      mig_po2klut_po[*mig_out_iter] = *klut_out_iter;
-      std::print("Mockturtle Output({}) -> KLUT Output({})\n",
-                 mt_ntk.node_to_index(mt_ntk.get_node(*mig_out_iter)),
-                 klut_ntk.node_to_index(klut_ntk.get_node(*klut_out_iter)));
-      mig_out_iter++;
-      klut_out_iter++;
-    }
+  auto mig_out_iter  = mig_outs.begin();
+  auto klut_out_iter = klut_outs.begin();
+  while (mig_out_iter != mig_outs.end()) {
+    mig_po2klut_po[*mig_out_iter] = *klut_out_iter;
+    mig_out_iter++;
+    klut_out_iter++;
+  }
 
-    for (const auto &inp_edge : bdinp_edges) {
-      I(klut_ntk.size() > 0);
-      edge2klut_inp_sigs[inp_edge].gid = group_id;
-      for (const auto &itr_mig_sig : edge2mt_sigs[inp_edge].signals) {
-        I(std::find(mig_inps.begin(), mig_inps.end(), mt_ntk.get_node(itr_mig_sig)) != mig_inps.end());
-        edge2klut_inp_sigs[inp_edge].signals.emplace_back(mig_pi2klut_pi[mt_ntk.get_node(itr_mig_sig)]);
-      }
+  for (const auto &inp_edge : gid2bdinp_edges.at(group_id)) {
+    I(klut_ntk.size() > 0);
+    auto &klut_sigs = edge2klut_inp_sigs.at(inp_edge);
+    for (const auto &itr_mig_sig : edge2mt_sigs.at(inp_edge).signals) {
+      I(std::find(mig_inps.begin(), mig_inps.end(), mt_ntk.get_node(itr_mig_sig)) != mig_inps.end());
+      klut_sigs.signals.emplace_back(mig_pi2klut_pi[mt_ntk.get_node(itr_mig_sig)]);
     }
+  }
 
-    for (const auto &out_edge : bdout_edges) {
-      I(klut_ntk.size() > 0);
-      edge2klut_out_sigs[out_edge].gid = group_id;
-      for (const auto &itr_mig_sig : edge2mt_sigs[out_edge].signals) {
-        I(std::find(mig_outs.begin(), mig_outs.end(), itr_mig_sig) != mig_outs.end());
-        edge2klut_out_sigs[out_edge].signals.emplace_back(mig_po2klut_po[(itr_mig_sig)]);
-        // edge2klut_out_sigs[out_edge].signals.emplace_back(mig_po2klut_po[*mig_outs.begin()]);
-      }
+  for (const auto &out_edge : gid2bdout_edges.at(group_id)) {
+    I(klut_ntk.size() > 0);
+    auto &klut_sigs = edge2klut_out_sigs.at(out_edge);
+    for (const auto &itr_mig_sig : edge2mt_sigs.at(out_edge).signals) {
+      I(std::find(mig_outs.begin(), mig_outs.end(), itr_mig_sig) != mig_outs.end());
+      klut_sigs.signals.emplace_back(mig_po2klut_po[(itr_mig_sig)]);
     }
-
-    std::cout << "finished.\n\n";
   }
+
+  std::print("gid:{} mapped to {} LUTs\n", group_id, klut_ntk.num_gates());
 }
 
 void Pass_mockturtle::create_lutified_lgraph(Lgraph *old_lg) {
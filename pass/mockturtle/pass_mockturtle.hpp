@@ -64,11 +64,16 @@ class Pass_mockturtle : public Pass {
 protected:
   static void work(Eprp_var &var);
 
+  uint32_t lut_size;         // cut size for the LUT mapping
+  uint32_t max_group_nodes;  // bound on lg nodes per group (0 unbounded)
+
   std::vector<XEdge> bdinp_edges, bdout_edges;  // boundary_input/output_edges
   // absl::flat_hash_set<XEdge> bdinp_edges, bdout_edges;//boundary_input/output_edges
   absl::flat_hash_map<Node::Compact, unsigned int>            node2gid;  // gid == group id, nodes in node2gid should be lutified
   absl::flat_hash_map<unsigned int, mockturtle_network>       gid2mt;
   absl::flat_hash_map<unsigned int, mockturtle::klut_network> gid2klut;
+  absl::flat_hash_map<unsigned int, std::vector<XEdge>>       gid2bdinp_edges;
+  absl::flat_hash_map<unsigned int, std::vector<XEdge>>       gid2bdout_edges;
   absl::flat_hash_map<XEdge, Ntk_sigs<mockturtle_network::signal>>
       edge2mt_sigs;  // lg<->mig, including all boundary i/o and "internal" wires
   absl::flat_hash_map<XEdge, Ntk_sigs<mockturtle::klut_network::signal>>
@@ -83,6 +88,7 @@ protected:
   bool lg_partition(Lgraph *);
   void create_mockturtle_network(Lgraph *);
   void convert_mockturtle_to_KLUT();
+  void convert_group_to_KLUT(unsigned int group_id);
   void create_lutified_lgraph(Lgraph *);
 
   void connect_complemented_signal(Lgraph *, Node_pin &, Node_pin &, const mockturtle::klut_network &,
@@ -231,7 +237,7 @@ protected:
   void do_work(Lgraph *g);
 
 public:
-  Pass_mockturtle(const Eprp_var &var) : Pass("pass.mockturtle", var) {};
+  Pass_mockturtle(const Eprp_var &var);
 
   static void setup();
 };
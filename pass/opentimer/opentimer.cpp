@@ -1,23 +1,70 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 
+#include <algorithm>
+#include <filesystem>
+#include <format>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "pass_opentimer.hpp"
 #include "pin_tracker.hpp"
 #include "str_tools.hpp"
+#include "thread_pool.hpp"
+#include "woothash.hpp"
 
 // WARNING: opentimer has a nasty "define has_member" that overlaps with perfetto methods
 #undef has_member
 #include "perf_tracing.hpp"
 
+absl::flat_hash_map<std::string, std::unique_ptr<Pass_opentimer::Ot_session>> Pass_opentimer::sessions;
+
+uint32_t Pass_opentimer::Ot_session::intern(std::string_view name) {
+  auto it = name2id.find(name);
+  if (it != name2id.end()) {
+    return it->second;
+  }
+
+  uint32_t id = names.size();
+  names.emplace_back(name);
+  name2id.emplace(name, id);
+  return id;
+}
+
+uint32_t Pass_opentimer::Ot_session::intern_bit(uint32_t id, int pos) {
+  const auto key = (static_cast<uint64_t>(id) << 32) | static_cast<uint32_t>(pos);
+
+  auto it = bit2id.find(key);
+  if (it != bit2id.end()) {
+    return it->second;
+  }
+
+  auto bit_id = intern(absl::StrCat(names[id], ".", str_tools::to_s(pos)));
+  bit2id.emplace(key, bit_id);
+  return bit_id;
+}
+
+uint32_t Pass_opentimer::Ot_session::intern_pin(uint32_t instance, std::string_view pin_name) {
+  const auto key = (static_cast<uint64_t>(instance) << 32) | intern(pin_name);
+
+  auto it = pin2id.find(key);
+  if (it != pin2id.end()) {
+    return it->second;
+  }
+
+  auto pin_id = intern(absl::StrCat(names[instance], ":", pin_name));
+  pin2id.emplace(key, pin_id);
+  return pin_id;
+}
+
 void Pass_opentimer::time_work(Eprp_var &var) {
   Pass_opentimer pass(var);
 
   TRACE_EVENT("pass", "OPENTIMER_work");
 
   for (const auto &g : var.lgs) {
-    pass.build_circuit(g);  // Task2: Traverse the lgraph and build the equivalent circuit (No dependencies) | Status: 50% done
-    pass.read_sdc_spef();
+    pass.update_circuit(g);  // Full build on the first call, then only the lgraph changes
     pass.compute_timing(g);  // Task4: Compute Timing | Status: 100% done
     pass.populate_table(g);  // Task5: Traverse the lgraph and populate the tables | Status: 0% done
   }
@@ -28,50 +75,48 @@ void Pass_opentimer::power_work(Eprp_var &var) {
 
   TRACE_EVENT("pass", "OPENTIMER_work");
 
-  // FIXME: build_circuit can overlap with read_vcd (thread_pool task)
   for (const auto &g : var.lgs) {
-    pass.build_circuit(g);
-    pass.read_sdc_spef();
-    pass.read_vcd();
-    pass.compute_power(g);
+    pass.update_circuit(g);
+    pass.compute_power();  // reads the VCDs in the corner tasks
   }
 }
 
 // TODO: The IO pins have a separate name. Can we avoid this just for them?
-std::string Pass_opentimer::get_driver_net_name(const Node_pin &dpin) const {
+uint32_t Pass_opentimer::get_driver_net(const Node_pin &dpin) {
   auto it = overwrite_dpin2net.find(dpin.get_compact_driver());
   if (it != overwrite_dpin2net.end()) {
     return it->second;
   }
 
-  return dpin.get_wire_name();
+  return session->intern(dpin.get_wire_name());
 }
 
-void Pass_opentimer::read_vcd() {
-  vcd_list.resize(vcd_file_list.size());
+// Each corner accumulates its own power, so it has its own Vcd_power per file. Called from the corner task: the
+// files are mmapped read only, so the corners share the same page cache pages and only redo the max time scan.
+bool Pass_opentimer::read_vcd(size_t c, std::string &failed) {
+  auto &corner_vcd = vcd_list[c];
+  corner_vcd.resize(vcd_file_list.size());
 
   for (auto i = 0u; i < vcd_file_list.size(); ++i) {
-    const auto &f = vcd_file_list[i];
-
-    bool ok = vcd_list[i].open(f);  // FIXME: multithread?
-    if (!ok) {
-      Pass::error("could not read vcd {} file", f);
+    if (!corner_vcd[i].open(vcd_file_list[i])) {
+      failed = vcd_file_list[i];
+      return false;
     }
-    // vcd_list[i].dump();
   }
+  return true;
 }
 
 // SDC and SPEF must be read after the circuit is created
-void Pass_opentimer::read_sdc_spef() {
-  for (const auto &f : sdc_file_list) {
-    read_sdc(f);
+void Pass_opentimer::read_sdc_spef(ot::Timer &timer, const Ot_corner &corner) {
+  for (const auto &f : corner.sdc_file_list) {
+    read_sdc(timer, f);
   }
-  for (const auto &f : spef_file_list) {
+  for (const auto &f : corner.spef_file_list) {
     timer.read_spef(f);
   }
 }
 
-void Pass_opentimer::set_input_delays(const std::string &pname) {
+void Pass_opentimer::set_input_delays(ot::Timer &timer, const std::string &pname) {
   timer.set_at(pname, ot::MIN, ot::FALL, 0.0);
   timer.set_at(pname, ot::MIN, ot::RISE, 0.0);
   timer.set_at(pname, ot::MAX, ot::FALL, 0.0);
@@ -83,56 +128,239 @@ void Pass_opentimer::set_input_delays(const std::string &pname) {
   timer.set_slew(pname, ot::MIN, ot::RISE, 0.0);
 }
 
-void Pass_opentimer::set_output_delays(const std::string &pname) {
+void Pass_opentimer::set_output_delays(ot::Timer &timer, const std::string &pname) {
   timer.set_rat(pname, ot::MIN, ot::FALL, 0.0);
   timer.set_rat(pname, ot::MIN, ot::RISE, 0.0);
   timer.set_rat(pname, ot::MAX, ot::FALL, 0.0);
   timer.set_rat(pname, ot::MAX, ot::RISE, 0.0);
 }
 
-void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circuit
+void Pass_opentimer::open_timers() {
+  session->timers.clear();
+  session->files   = corner_files;
+  session->circuit = Ot_circuit();
+
+  for (const auto &corner : corners) {
+    auto &timer = *session->timers.emplace_back(std::make_unique<ot::Timer>());
+
+    for (auto i = 0u; i < corner.lib_file_list.size(); ++i) {
+      std::print("opentimer using liberty file '{}'\n", corner.lib_file_list[i]);
+      if (i == 0) {
+        timer.read_celllib(corner.lib_file_list[i]);
+      } else {
+        timer.read_celllib(corner.lib_file_list[i], ot::MIN);
+      }
+    }
+  }
+}
+
+// build_circuit walks the whole hierarchy and reads the Sub_node IOs (graph IO names, instance pin names). Those live
+// in the library, so a ref_sub() edit or a change in a child lgraph does not bump the epoch of the top lgraph.
+static uint64_t hier_signature(Lgraph *top) {
+  auto *library = top->ref_library();
+
+  uint64_t sig = 0;
+  auto     mix = [&sig](const void *data, size_t sz) { sig = lh::woothash64(data, sz, sig); };
+
+  auto mix_sub = [&mix](const Sub_node &sub) {
+    for (const auto &io : sub.get_io_pins()) {
+      const uint64_t v[] = {static_cast<uint64_t>(io.dir), io.graph_io_pos, io.instance_pid, static_cast<uint64_t>(io.bits)};
+      mix(v, sizeof(v));
+      mix(io.name.data(), io.name.size());
+    }
+  };
+
+  absl::flat_hash_set<Lg_type_id::type> visited{top->get_lgid().value};
+  std::vector<Lgraph *>                 pending{top};
+  while (!pending.empty()) {
+    auto *g = pending.back();
+    pending.pop_back();
+
+    const uint64_t v[] = {g->get_lgid().value, g->get_mutation_epoch(), reinterpret_cast<uintptr_t>(g)};
+    mix(v, sizeof(v));
+    mix_sub(g->get_self_sub_node());
+
+    for (const auto &ent : g->get_down_class_map()) {
+      const Lg_type_id lgid(ent.first);
+      if (!visited.insert(lgid.value).second) {
+        continue;
+      }
+      if (!library->exists(lgid)) {
+        continue;
+      }
+      mix_sub(library->get_sub(lgid));  // also black boxes (no lgraph)
+
+      auto *sub_lg = library->try_ref_lgraph(lgid);
+      if (sub_lg) {
+        pending.emplace_back(sub_lg);
+      }
+    }
+  }
+
+  return sig;
+}
+
+void Pass_opentimer::update_circuit(Lgraph *g) {
+  TRACE_EVENT("pass", "OPENTIMER_update_circuit");
+
+  auto &ses = sessions[absl::StrCat(g->get_path(), ":", g->get_lgid().value)];
+  if (!ses) {
+    ses = std::make_unique<Ot_session>();
+  }
+  session = ses.get();
+
+  const auto sig = hier_signature(g);
+
+  bool fresh = session->timers.empty() || session->files != corner_files;
+  if (!fresh && session->lg == g && session->epoch == g->get_mutation_epoch() && session->signature == sig) {
+    return;  // no lgraph in the hierarchy (nor its IOs) modified since the last call
+  }
+
+  Ot_circuit next;
+  build_circuit(g, next);
+
+  // OpenTimer can not remove primary inputs/outputs
+  if (!fresh && (next.inputs != session->circuit.inputs || next.outputs != session->circuit.outputs)) {
+    fresh = true;
+  }
+
+  if (fresh) {
+    open_timers();
+  }
+
+  // OpenTimer only queues the edits, the corners do the work in their own update_timing
+  for (auto c = 0u; c < corners.size(); ++c) {
+    auto &timer = *session->timers[c];
+    apply_delta(timer, session->circuit, next);
+
+    if (fresh) {
+      // Set all the inputs/outputs to zero by default
+      for (auto id : next.inputs) {
+        set_input_delays(timer, session->get_name(id));
+      }
+      for (auto id : next.outputs) {
+        set_output_delays(timer, session->get_name(id));
+      }
+      read_sdc_spef(timer, corners[c]);
+    }
+  }
+
+  session->circuit   = std::move(next);
+  session->lg        = g;
+  session->epoch     = g->get_mutation_epoch();
+  session->signature = sig;
+}
+
+void Pass_opentimer::apply_delta(ot::Timer &timer, const Ot_circuit &prev, const Ot_circuit &next) const {
+  TRACE_EVENT("pass", "OPENTIMER_apply_delta");
+
+  const auto &names = session->names;
+
+  for (auto id : next.inputs) {
+    if (!prev.inputs.contains(id)) {
+      timer.insert_primary_input(names[id]);
+    }
+  }
+  for (auto id : next.outputs) {
+    if (!prev.outputs.contains(id)) {
+      timer.insert_primary_output(names[id]);
+    }
+  }
+  for (auto id : next.nets) {
+    if (!prev.nets.contains(id)) {
+      timer.insert_net(names[id]);
+    }
+  }
+
+  auto find_pin = [](const Ot_gate &gate, uint32_t pin) -> const std::pair<uint32_t, uint32_t> * {
+    for (const auto &p : gate.pins) {
+      if (p.first == pin) {
+        return &p;
+      }
+    }
+    return nullptr;
+  };
+
+  for (const auto &[instance, gate] : prev.gates) {
+    auto it = next.gates.find(instance);
+    if (it == next.gates.end() || it->second.cell != gate.cell) {
+      timer.remove_gate(names[instance]);
+      continue;
+    }
+    for (const auto &[pin, net] : gate.pins) {
+      const auto *np = find_pin(it->second, pin);
+      if (np == nullptr || np->second != net) {
+        timer.disconnect_pin(names[pin]);
+      }
+    }
+  }
+
+  for (const auto &[instance, gate] : next.gates) {
+    auto it       = prev.gates.find(instance);
+    bool new_gate = it == prev.gates.end() || it->second.cell != gate.cell;
+    if (new_gate) {
+      timer.insert_gate(names[instance], names[gate.cell]);
+    }
+    for (const auto &[pin, net] : gate.pins) {
+      const auto *pp = new_gate ? nullptr : find_pin(it->second, pin);
+      if (pp == nullptr || pp->second != net) {
+        timer.connect_pin(names[pin], names[net]);
+      }
+    }
+  }
+
+  // Last, once no pin is connected to them
+  for (auto id : prev.nets) {
+    if (!next.nets.contains(id)) {
+      timer.remove_net(names[id]);
+    }
+  }
+}
+
+void Pass_opentimer::build_circuit(Lgraph *g, Ot_circuit &cir) {
   TRACE_EVENT("pass", "OPENTIMER_build_circuit");
 
   overwrite_dpin2net.clear();
 
 #if 1
-  Pin_tracker<std::string> pin_tracker("zero");
+  Pin_tracker<uint32_t> pin_tracker(session->intern("zero"));
 #else
-  auto                     zero_dpin = g->create_node_const(0).get_driver_pin();
-  Pin_tracker<std::string> pin_tracker(zero_dpin.get_wire_name());
-  overwrite_dpin2net.insert_or_assign(zero_dpin.get_compact_driver(), zero_dpin.get_wire_name());
+  auto                  zero_dpin = g->create_node_const(0).get_driver_pin();
+  auto                  zero_id   = session->intern(zero_dpin.get_wire_name());
+  Pin_tracker<uint32_t> pin_tracker(zero_id);
+  overwrite_dpin2net.insert_or_assign(zero_dpin.get_compact_driver(), zero_id);
 #endif
 
-  g->each_graph_input([this, &pin_tracker](const Node_pin &pin) {
-    std::string driver_name(pin.get_hierarchical().get_wire_name());  // OT needs std::string, not string_view support
+  g->each_graph_input([this, &cir, &pin_tracker](const Node_pin &pin) {
+    auto driver_id = session->intern(pin.get_hierarchical().get_wire_name());
 
-    // std::print("OT: top input:{} bits:{}\n", driver_name, pin.get_bits());
-    timer.insert_primary_input(driver_name);
-    timer.insert_net(driver_name);
+    // std::print("OT: top input:{} bits:{}\n", session->get_name(driver_id), pin.get_bits());
+    cir.inputs.insert(driver_id);
+    cir.nets.insert(driver_id);
     for (auto i = 1; i < pin.get_bits(); ++i) {
-      auto bus_bit_name = absl::StrCat(driver_name, ".", str_tools::to_s(i));
-      timer.insert_primary_input(bus_bit_name);
-      timer.insert_net(bus_bit_name);
+      auto bus_bit_id = session->intern_bit(driver_id, i);
+      cir.inputs.insert(bus_bit_id);
+      cir.nets.insert(bus_bit_id);
     }
-    pin_tracker.add_input(driver_name, pin.get_bits());
+    pin_tracker.add_input(driver_id, pin.get_bits());
   });
 
-  g->each_graph_output([this](const Node_pin &pin) {
+  g->each_graph_output([this, &cir](const Node_pin &pin) {
     auto driver_dpin = pin.change_to_sink_from_graph_out_driver().get_driver_pin().get_hierarchical();
-    if (!driver_dpin.is_invalid()) {                 // It could be disconnected
-      std::string driver_name(pin.get_wire_name());  // OT needs std::string, not string_view support
+    if (!driver_dpin.is_invalid()) {  // It could be disconnected
+      auto driver_id = session->intern(pin.get_wire_name());
 
-      // std::print("OT: top output:{} bits:{}\n", driver_name, pin.get_bits());
+      // std::print("OT: top output:{} bits:{}\n", session->get_name(driver_id), pin.get_bits());
 
-      timer.insert_primary_output(driver_name);
-      timer.insert_net(driver_name);
+      cir.outputs.insert(driver_id);
+      cir.nets.insert(driver_id);
       for (auto i = 1; i < driver_dpin.get_bits(); ++i) {
-        auto bus_bit_name = absl::StrCat(driver_name, ".", str_tools::to_s(i));
-        timer.insert_primary_output(bus_bit_name);
-        timer.insert_net(bus_bit_name);
+        auto bus_bit_id = session->intern_bit(driver_id, i);
+        cir.outputs.insert(bus_bit_id);
+        cir.nets.insert(bus_bit_id);
       }
       // WARNING: not good if the same dpin is connected to multiple outputs (legal) but inclear how to do in opentimer
-      overwrite_dpin2net.insert_or_assign(driver_dpin.get_compact_driver(), driver_name);
+      overwrite_dpin2net.insert_or_assign(driver_dpin.get_compact_driver(), driver_id);
     }
   });
 
@@ -145,7 +373,7 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
 
     bool root_track = Ntype::is_pin_trackable(op);
     if (root_track) {
-      auto wname = node.get_driver_pin().get_wire_name();
+      auto wname = session->intern(node.get_driver_pin().get_wire_name());
       if (op == Ntype_op::Set_mask) {
         auto a_dpin     = node.get_sink_pin_driver("a");
         auto mask_dpin  = node.get_sink_pin_driver("mask");
@@ -161,7 +389,11 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
           return;
         }
         auto mask_const = mask_dpin.get_type_const();
-        pin_tracker.add_set_mask(wname, a_dpin.get_wire_name(), a_dpin.get_bits(), mask_const, value_dpin.get_wire_name());
+        pin_tracker.add_set_mask(wname,
+                                 session->intern(a_dpin.get_wire_name()),
+                                 a_dpin.get_bits(),
+                                 mask_const,
+                                 session->intern(value_dpin.get_wire_name()));
       } else if (op == Ntype_op::Get_mask) {
         auto a_dpin    = node.get_sink_pin_driver("a");
         auto mask_dpin = node.get_sink_pin_driver("mask");
@@ -176,7 +408,7 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
           return;
         }
         auto mask_const = mask_dpin.get_type_const();
-        pin_tracker.add_get_mask(wname, a_dpin.get_wire_name(), a_dpin.get_bits(), mask_const);
+        pin_tracker.add_get_mask(wname, session->intern(a_dpin.get_wire_name()), a_dpin.get_bits(), mask_const);
       } else if (op == Ntype_op::SRA) {
         auto a_dpin = node.get_sink_pin_driver("a");
         auto b_dpin = node.get_sink_pin_driver("b");
@@ -191,7 +423,7 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
           return;
         }
         auto b_const = b_dpin.get_type_const();
-        pin_tracker.add_sra(wname, a_dpin.get_wire_name(), a_dpin.get_bits(), b_const);
+        pin_tracker.add_sra(wname, session->intern(a_dpin.get_wire_name()), a_dpin.get_bits(), b_const);
       } else if (op == Ntype_op::Sext) {
         auto a_dpin = node.get_sink_pin_driver("a");
         auto b_dpin = node.get_sink_pin_driver("b");
@@ -206,7 +438,7 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
           return;
         }
         auto b_const = b_dpin.get_type_const();
-        pin_tracker.add_sext(wname, a_dpin.get_wire_name(), a_dpin.get_bits(), b_const);
+        pin_tracker.add_sext(wname, session->intern(a_dpin.get_wire_name()), a_dpin.get_bits(), b_const);
       } else if (op == Ntype_op::SHL) {
         auto a_dpin = node.get_sink_pin_driver("a");
         if (a_dpin.is_invalid()) {
@@ -225,11 +457,11 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
             return;
           }
           auto b_const = e.driver.get_type_const();
-          pin_tracker.add_shl(wname, a_dpin.get_wire_name(), a_dpin.get_bits(), b_const);
+          pin_tracker.add_shl(wname, session->intern(a_dpin.get_wire_name()), a_dpin.get_bits(), b_const);
         }
       } else if (op == Ntype_op::Or) {
         for (auto e : node.inp_edges()) {
-          pin_tracker.add_or(wname, e.driver.get_wire_name());
+          pin_tracker.add_or(wname, session->intern(e.driver.get_wire_name()));
         }
       } else if (op == Ntype_op::And) {
         auto     a_mask = Lconst(-1);
@@ -247,7 +479,7 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
           }
         }
         if (!a_dpin.is_invalid()) {
-          pin_tracker.add_and(wname, a_dpin.get_wire_name(), a_mask);
+          pin_tracker.add_and(wname, session->intern(a_dpin.get_wire_name()), a_mask);
         }
       } else {
         node.dump();
@@ -263,7 +495,7 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
         I(!root_track);
         continue;
       }
-      auto wname = dpin.get_wire_name();
+      auto wname = session->intern(dpin.get_wire_name());
 
       if (root_track) {
         const auto &pv = pin_tracker.get_pin_vector(wname);
@@ -275,15 +507,14 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
           }
 
           if (pv[0].pos) {
-            auto bus_bit_name = absl::StrCat(pv[0].id, ".", str_tools::to_s(pv[0].pos));
-            overwrite_dpin2net.insert_or_assign(dpin_cd, bus_bit_name);
+            overwrite_dpin2net.insert_or_assign(dpin_cd, session->intern_bit(pv[0].id, pv[0].pos));
           } else {
             overwrite_dpin2net.insert_or_assign(dpin_cd, pv[0].id);
           }
         }
       } else {
-        // std::print("OT: wname:{}\n", wname);
-        timer.insert_net(wname);
+        // std::print("OT: wname:{}\n", session->get_name(wname));
+        cir.nets.insert(wname);
       }
     }
   }
@@ -293,7 +524,7 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
   pin_tracker.dump();
   for(auto &&it:overwrite_dpin2net) {
     auto dpin = Node_pin(g, it.first);
-    std::print("node:{} pin:{} goes to {}\n", dpin.get_node().get_or_create_name(), dpin.get_wire_name(), it.second);
+    std::print("node:{} pin:{} goes to {}\n", dpin.get_node().get_or_create_name(), dpin.get_wire_name(), session->get_name(it.second));
   }
 #endif
 
@@ -315,17 +546,17 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
       return;
     }
 
-    auto       &sub_node      = node.get_type_sub_node();
-    auto        instance_name = node.get_or_create_name();
-    std::string type_name{sub_node.get_name()};  // OT needs std::string
+    auto &sub_node    = node.get_type_sub_node();
+    auto  instance_id = session->intern(node.get_or_create_name());
 
-    timer.insert_gate(instance_name, type_name);
+    auto &gate = cir.gates[instance_id];
+    gate.cell  = session->intern(sub_node.get_name());
 
     // setup driver pins and nets
     for (const auto &dpin : node.out_connected_pins()) {
-      auto pin_name  = absl::StrCat(instance_name, ":", dpin.get_pin_name());
-      auto wire_name = get_driver_net_name(dpin);
-      timer.connect_pin(pin_name, wire_name);
+      auto pin_id = session->intern_pin(instance_id, dpin.get_pin_name());
+      gate.pins.emplace_back(pin_id, get_driver_net(dpin));
+      cir.outs.emplace_back(dpin.get_compact_driver(), pin_id);
     }
 
     // connect input pins
@@ -334,42 +565,52 @@ void Pass_opentimer::build_circuit(Lgraph *g) {  // Enhance this for build_circu
       // 2bits because a signal can be signed case
       I(!(e.driver.is_graph_input() && e.driver.get_bits() > 2));
 
-      // I(get_driver_net_name(e.driver) == e.driver.get_wire_name());
-      auto wire_name = get_driver_net_name(e.driver);
-      auto pin_name  = absl::StrCat(instance_name, ":", e.sink.get_pin_name());
-
-      timer.connect_pin(pin_name, wire_name);
+      auto pin_id = session->intern_pin(instance_id, e.sink.get_pin_name());
+      gate.pins.emplace_back(pin_id, get_driver_net(e.driver));
     }
   }
+}
 
-  // Set all the inputs/outputs to zero by default
-  g->each_graph_input([this](Node_pin &dpin) {
-    auto pname = dpin.get_name();
+void Pass_opentimer::compute_timing(Lgraph *g) {  // Expand this method to compute timing information
+  TRACE_EVENT("pass", "OPENTIMER_compute_timing");
 
-    set_input_delays(pname);
-    for (auto i = 1; i < dpin.get_bits(); ++i) {
-      auto bus_bit_name = absl::StrCat(pname, ".", str_tools::to_s(i));
-      set_input_delays(bus_bit_name);
-    }
-  });
+  const auto &outs     = session->circuit.outs;
+  const auto  n_corner = session->timers.size();
 
-  g->each_graph_output([this](Node_pin &dpin) {
-    auto pname = dpin.get_name();
+  // One worker per corner. The lgraph is only updated once all the corners finish
+  std::vector<std::vector<float>> corner_delay(n_corner);
+  for (auto c = 0u; c < n_corner; ++c) {
+    thread_pool.add([this, c, &outs, &corner_delay]() {
+      TRACE_EVENT("pass", "OPENTIMER_corner_timing");
 
-    set_output_delays(pname);
-    for (auto i = 1; i < dpin.get_bits(); ++i) {
-      auto bus_bit_name = absl::StrCat(pname, ".", str_tools::to_s(i));
-      set_output_delays(bus_bit_name);
-    }
-  });
-}
+      auto &timer = *session->timers[c];
+      timer.update_timing();
 
-void Pass_opentimer::compute_timing(Lgraph *g) {  // Expand this method to compute timing information
-  TRACE_EVENT("pass", "OPENTIMER_compute_timing");
+      const auto &pins  = timer.pins();
+      auto       &delay = corner_delay[c];
+      delay.resize(outs.size(), 0.0);
+      for (auto i = 0u; i < outs.size(); ++i) {
+        auto it = pins.find(session->get_name(outs[i].second));
+        if (it == pins.end()) {
+          continue;
+        }
 
-  timer.update_timing();
+        auto at_f = it->second.at(ot::MAX, ot::FALL);
+        auto at_r = it->second.at(ot::MAX, ot::RISE);
+        if (at_f) {
+          delay[i] = *at_f;
+        }
+        if (at_r && *at_r > delay[i]) {
+          delay[i] = *at_r;
+        }
+      }
+    });
+  }
+  thread_pool.wait_all();
 
 #if 0
+  auto &timer = *session->timers[0];
+
   auto num_gates = timer.num_gates();
   std::print("Number of gates {}\n", num_gates);
 
@@ -393,55 +634,48 @@ void Pass_opentimer::compute_timing(Lgraph *g) {  // Expand this method to compu
   // timer.dump_graph(std::cout);
 #endif
 
-  max_delay = 0;
-  std::string max_pin;
-
-  const auto &pins = timer.pins();
-
-  for (const auto node : g->fast(true)) {
-    auto op = node.get_type_op();
-    if (op != Ntype_op::Sub) {
-      continue;
-    }
-
-    auto       &sub_node      = node.get_type_sub_node();
-    auto        instance_name = node.get_or_create_name();
-    std::string type_name{sub_node.get_name()};  // OT needs std::string
+  // node_pin_delay_map keeps the worst corner, the per corner maps are only for multi-corner runs
+  g->ref_node_pin_corner_delay_map()->clear();
 
-    // timer.insert_gate(instance_name, type_name);
+  max_delay = 0;
+  std::string        max_pin;
+  std::vector<float> corner_max(n_corner, 0.0);
 
-    // setup driver pins and nets
-    for (auto &dpin : node.out_connected_pins()) {
-      auto pin_name = absl::StrCat(instance_name, ":", dpin.get_pin_name());
+  for (auto i = 0u; i < outs.size(); ++i) {
+    const auto &[dpin_cd, pin_id] = outs[i];
+    Node_pin dpin(g, dpin_cd);
 
-      auto it = pins.find(pin_name);
-      if (it == pins.end()) {
+    float delay = 0.0;
+    for (auto c = 0u; c < n_corner; ++c) {
+      auto corner_pin_delay = corner_delay[c][i];
+      if (corner_pin_delay <= 0) {
         continue;
       }
-
-      auto at_f = it->second.at(ot::MAX, ot::FALL);
-      auto at_r = it->second.at(ot::MAX, ot::RISE);
-
-      float delay = 0.0;
-      if (at_f) {
-        delay = *at_f;
-      }
-      if (at_r && *at_r > delay) {
-        delay = *at_r;
+      if (n_corner > 1) {
+        dpin.set_corner_delay(c, corner_pin_delay);
       }
-      if (delay > 0) {
-        dpin.set_delay(delay);
+      corner_max[c] = std::max(corner_max[c], corner_pin_delay);
+      delay         = std::max(delay, corner_pin_delay);
+    }
 
-        // auto wire_name = get_driver_net_name(dpin);
-        // std::print(" pin {} {} wname:{}\n", pin_name, delay, wire_name);
+    if (delay > 0) {
+      dpin.set_delay(delay);
 
-        if (delay > max_delay) {
-          max_delay = delay;
-          max_pin   = pin_name;
-        }
-      } else {
-        dpin.del_delay();
+      // auto wire_name = session->get_name(get_driver_net(dpin));
+      // std::print(" pin {} {} wname:{}\n", session->get_name(pin_id), delay, wire_name);
+
+      if (delay > max_delay) {
+        max_delay = delay;
+        max_pin   = session->get_name(pin_id);
       }
+    } else {
+      dpin.del_delay();
+    }
+  }
+
+  if (n_corner > 1) {
+    for (auto c = 0u; c < n_corner; ++c) {
+      std::print("corner:{} slowest delay:{}\n", c, corner_max[c]);
     }
   }
 
@@ -455,85 +689,133 @@ void Pass_opentimer::compute_timing(Lgraph *g) {  // Expand this method to compu
   }
 }
 
-void Pass_opentimer::compute_power(Lgraph *g) {  // Expand this method to compute timing information
+void Pass_opentimer::compute_power() {  // Expand this method to compute timing information
   TRACE_EVENT("pass", "OPENTIMER_compute_power");
 
-  timer.update_timing();
+  struct Corner_power {
+    double      total_cap  = 0;
+    double      total_ipwr = 0;
+    float       voltage    = 1;
+    std::string odir;
+    std::string log;         // per pin report, printed once all the corners finish
+    std::string vcd_failed;  // VCD file that could not be opened
+  };
+
+  const auto                n_corner = session->timers.size();
+  std::vector<Corner_power> power(n_corner);
+  for (auto c = 0u; c < n_corner; ++c) {
+    power[c].odir = odir;
+    if (n_corner > 1) {  // same trace file names in each corner
+      power[c].odir = absl::StrCat(odir, "/corner", c);
+      std::error_code ec;
+      std::filesystem::create_directories(power[c].odir, ec);
+      if (ec) {
+        Pass::error("pass.opentimer.power could not create {} directory", power[c].odir);
+      }
+    }
+  }
 
-  const auto &gates = timer.gates();
+  vcd_list.clear();
+  vcd_list.resize(n_corner);
 
-  double total_cap  = 0;
-  double total_ipwr = 0;
+  for (auto c = 0u; c < n_corner; ++c) {
+    thread_pool.add([this, c, &power]() {
+      TRACE_EVENT("pass", "OPENTIMER_corner_power");
 
-  float voltage = 1;
-  auto  x       = timer.cell_voltage();
-  if (x) {
-    voltage = *x;
-  }
+      auto &timer = *session->timers[c];
+      auto &cp    = power[c];
 
-  const auto lib        = timer.celllib(ot::MIN);
-  double     cap_unit   = timer.capacitance_unit()->value();
-  double     timeunit   = timer.time_unit()->value();
-  double     power_unit = timer.power_unit()->value();
+      if (!read_vcd(c, cp.vcd_failed)) {
+        return;
+      }
 
-  for (auto &pvcd : vcd_list) {
-    pvcd.set_timescale(timeunit);  // In case that VCD dump does not have it
-  }
-  std::cout << "================================\n";
-  for (const auto node : g->fast(true)) {
-    auto op = node.get_type_op();
-    if (op != Ntype_op::Sub) {
-      continue;
-    }
+      timer.update_timing();
 
-    auto instance_name = node.get_or_create_name();
+      const auto &gates = timer.gates();
 
-    auto it2 = gates.find(instance_name);
-    if (it2 == gates.end()) {
-      node.dump();
-      std::print("WEIRD. Where is the gate? named {}\n", instance_name);
-    }
+      auto x = timer.cell_voltage();
+      if (x) {
+        cp.voltage = *x;
+      }
+
+      double cap_unit   = timer.capacitance_unit()->value();
+      double timeunit   = timer.time_unit()->value();
+      double power_unit = timer.power_unit()->value();
+
+      for (auto &pvcd : vcd_list[c]) {
+        pvcd.set_timescale(timeunit);  // In case that VCD dump does not have it
+      }
+
+      for (const auto &it : session->circuit.gates) {
+        const auto &instance_name = session->get_name(it.first);
+
+        auto it2 = gates.find(instance_name);
+        if (it2 == gates.end()) {
+          cp.log += std::format("WEIRD. Where is the gate? named {}\n", instance_name);
+          continue;
+        }
+
+        for (const auto *pin : it2->second.pins()) {
+          auto [cap, ipwr] = pin->power();
 
-    for (const auto *pin : it2->second.pins()) {
-      auto [cap, ipwr] = pin->power();
+          // cap / 2 because only charge consumes dynamic power
+          cap *= static_cast<float>(freq * power_unit * 0.5 * cp.voltage * cp.voltage * cap_unit / timeunit);
+          ipwr *= static_cast<float>(freq * power_unit * cap_unit / timeunit);
 
-      // cap / 2 because only charge consumes dynamic power
-      cap *= static_cast<float>(freq * power_unit * 0.5 * voltage * voltage * cap_unit / timeunit);
-      ipwr *= static_cast<float>(freq * power_unit * cap_unit / timeunit);
+          cp.total_cap += cap;
+          cp.total_ipwr += ipwr;
 
-      total_cap += cap;
-      total_ipwr += ipwr;
+          // WARNING: Replace last , for :
+          // -OpenTimer use as pin name: "whatever":"pin"
+          // -Power_vcd uses "whatever","pin"
+          std::string pin_name{pin->name()};
+          auto        last_comma_pos = pin_name.rfind(':');
+          I(last_comma_pos != std::string::npos);
+          pin_name[last_comma_pos] = ',';
 
-      // WARNING: Replace last , for :
-      // -OpenTimer use as pin name: "whatever":"pin"
-      // -Power_vcd uses "whatever","pin"
-      std::string pin_name{pin->name()};
-      auto        last_comma_pos = pin_name.rfind(':');
-      I(last_comma_pos != std::string::npos);
-      pin_name[last_comma_pos] = ',';
+          for (auto &pvcd : vcd_list[c]) {
+            // pvcd.add(pin_name, ipwr );
+            // pvcd.add(pin_name, cap);
+            pvcd.add(pin_name, ipwr + cap);
+          }
 
-      for (auto &pvcd : vcd_list) {
-        // pvcd.add(pin_name, ipwr );
-        // pvcd.add(pin_name, cap);
-        pvcd.add(pin_name, ipwr + cap);
+          cp.log += std::format("iname:{} pin:{} ipwr:{} cap:{}\n", instance_name, pin_name, ipwr, cap);
+        }
       }
 
-      std::print("iname:{} pin:{} ipwr:{} cap:{}\n", instance_name, pin_name, ipwr, cap);
-    }
+      for (auto &pvcd : vcd_list[c]) {
+        pvcd.compute(cp.odir);
+      }
+    });
   }
+  thread_pool.wait_all();
 
-  std::cout << "================================\n";
-  for (auto &pvcd : vcd_list) {
-    pvcd.compute(odir);
-    std::print("AVG power:{} for {}\n", pvcd.get_power_average(), pvcd.get_filename());
+  for (const auto &cp : power) {
+    if (!cp.vcd_failed.empty()) {
+      Pass::error("could not read vcd {} file", cp.vcd_failed);
+    }
   }
 
-  std::print("TOTAL power:{} DYNAMIC power:{} INTERNAL power:{} W voltage:{} V freq={}MHz\n",
-             total_cap + total_ipwr,
-             total_cap,
-             total_ipwr,
-             voltage,
-             freq / 1e6);
+  for (auto c = 0u; c < n_corner; ++c) {
+    const auto &cp = power[c];
+
+    std::cout << "================================\n";
+    std::cout << cp.log;
+    std::cout << "================================\n";
+    if (n_corner > 1) {
+      std::print("corner:{} odir:{}\n", c, cp.odir);
+    }
+    for (const auto &pvcd : vcd_list[c]) {
+      std::print("AVG power:{} for {}\n", pvcd.get_power_average(), pvcd.get_filename());
+    }
+
+    std::print("TOTAL power:{} DYNAMIC power:{} INTERNAL power:{} W voltage:{} V freq={}MHz\n",
+               cp.total_cap + cp.total_ipwr,
+               cp.total_cap,
+               cp.total_ipwr,
+               cp.voltage,
+               freq / 1e6);
+  }
 }
 
 void Pass_opentimer::populate_table(Lgraph *lg) {
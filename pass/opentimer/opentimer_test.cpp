@@ -0,0 +1,197 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <fstream>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "pass_opentimer.hpp"
+
+class Opentimer_access : public Pass_opentimer {
+public:
+  using Sessions = decltype(sessions);
+
+  Opentimer_access(const Eprp_var &var) : Pass_opentimer(var) {}
+
+  void run(Lgraph *g) {
+    update_circuit(g);
+    compute_timing(g);
+  }
+
+  [[nodiscard]] const ot::Timer *timer() const { return session->timers[0].get(); }
+
+  static void drop_sessions() { sessions.clear(); }
+  static void swap_sessions(Sessions &other) { sessions.swap(other); }
+};
+
+class Opentimer_test : public ::testing::Test {
+protected:
+  static constexpr std::string_view lib_file = "pass/opentimer/tests/osu018_stdcells.lib";
+  static constexpr std::string_view sdc_file = "lgdb_opentimer_test/delay.sdc";
+
+  Lgraph *g = nullptr;
+
+  // a, b, c -> NAND2 -> INV -> NAND2 -> INV -> NOR2 -> o (a small chain, so every edit moves some arrival time)
+  void SetUp() override {
+    auto *lib = Graph_library::instance("lgdb_opentimer_test");
+
+    add_cell(lib, "INVX1", {"A"});
+    add_cell(lib, "NAND2X1", {"A", "B"});
+    add_cell(lib, "NOR2X1", {"A", "B"});
+    add_cell(lib, "BUFX2", {"A"});
+
+    g = lib->create_lgraph("ot_chain", "-");
+    ASSERT_NE(g, nullptr);
+
+    auto a = g->add_graph_input("a", 1, 1);
+    auto b = g->add_graph_input("b", 2, 1);
+    auto c = g->add_graph_input("c", 3, 1);
+    auto o = g->add_graph_output("o", 4, 1);
+
+    auto n1 = gate("NAND2X1", "n1", {a, b});
+    auto i1 = gate("INVX1", "i1", {n1});
+    auto n2 = gate("NAND2X1", "n2", {i1, c});
+    auto i2 = gate("INVX1", "i2", {n2});
+    auto r1 = gate("NOR2X1", "r1", {i2, a});
+    g->add_edge(r1, o);
+
+    write_sdc("set_input_delay 0.5 [get_ports a]\n");
+  }
+
+  void TearDown() override {
+    Opentimer_access::drop_sessions();
+    g->clear();
+  }
+
+  static void add_cell(Graph_library *lib, std::string_view name, const std::vector<std::string_view> &inputs) {
+    auto *sub = lib->ref_or_create_sub(name);
+    if (sub->has_pin("Y")) {
+      return;
+    }
+    for (auto in : inputs) {
+      sub->add_input_pin(in);
+    }
+    sub->add_output_pin("Y");
+  }
+
+  Node_pin gate(std::string_view cell, std::string_view name, const std::vector<Node_pin> &drivers) {
+    static const std::vector<std::string_view> pins = {"A", "B"};
+
+    auto node = g->create_node_sub(cell);
+    node.set_name(name);
+    for (auto i = 0u; i < drivers.size(); ++i) {
+      g->add_edge(drivers[i], node.setup_sink_pin(pins[i]));
+    }
+    auto dpin = node.setup_driver_pin("Y");
+    dpin.set_name(absl::StrCat(name, "_y"));
+    return dpin;
+  }
+
+  Node find(std::string_view name) const {
+    for (auto node : g->fast()) {
+      if (node.has_name() && node.get_name() == name) {
+        return node;
+      }
+    }
+    return Node();
+  }
+
+  static void write_sdc(std::string_view txt) { std::ofstream(std::string(sdc_file), std::ios::trunc) << txt; }
+
+  static Eprp_var var() {
+    return Eprp_var(Eprp_var::Eprp_dict{
+        {"files", absl::StrCat(lib_file, ",", sdc_file)},
+        {"path", "lgdb_opentimer_test"},
+    });
+  }
+
+  absl::flat_hash_map<std::string, float> arrival_times() const {
+    absl::flat_hash_map<std::string, float> at;
+    for (auto node : g->fast()) {
+      for (const auto &dpin : node.out_connected_pins()) {
+        if (dpin.has_delay()) {
+          at.emplace(dpin.get_wire_name(), dpin.get_delay());
+        }
+      }
+    }
+    return at;
+  }
+
+  // Times the current lgraph with a new session (all the timers built from scratch). The incremental session is put
+  // aside meanwhile, and restored afterwards.
+  absl::flat_hash_map<std::string, float> fresh_arrival_times() {
+    Opentimer_access::Sessions saved;
+    Opentimer_access::swap_sessions(saved);
+    {
+      Opentimer_access pass(var());
+      pass.run(g);
+    }
+    auto at = arrival_times();
+    Opentimer_access::swap_sessions(saved);
+    return at;
+  }
+};
+
+TEST_F(Opentimer_test, incremental_matches_fresh) {
+  Opentimer_access pass(var());
+  pass.run(g);
+  const auto *timer = pass.timer();
+  const auto  first = arrival_times();
+  ASSERT_FALSE(first.empty());
+  EXPECT_EQ(first, fresh_arrival_times());
+
+  auto check_edit = [&](std::string_view what) {
+    pass.run(g);
+    EXPECT_EQ(pass.timer(), timer) << what << " rebuilt the timer instead of applying the delta";
+    const auto incremental = arrival_times();
+    EXPECT_EQ(incremental, fresh_arrival_times()) << what;
+  };
+
+  // Add a node: a buffer between i1 and n2
+  auto i1_y = find("i1").get_driver_pin("Y");
+  auto n2_a = find("n2").setup_sink_pin("A");
+  auto buf  = g->create_node_sub("BUFX2");
+  buf.set_name("b1");
+  auto b1_y = buf.setup_driver_pin("Y");
+  b1_y.set_name("b1_y");
+  i1_y.del_sink(n2_a);
+  g->add_edge(i1_y, buf.setup_sink_pin("A"));
+  g->add_edge(b1_y, n2_a);
+  check_edit("add node");
+
+  // Move an edge: r1.B now reads c instead of a
+  auto r1_b = find("r1").setup_sink_pin("B");
+  auto a    = g->get_graph_input("a");
+  a.del_sink(r1_b);
+  g->add_edge(g->get_graph_input("c"), r1_b);
+  check_edit("move edge");
+
+  // Delete a node: drop the buffer again
+  buf = find("b1");
+  g->add_edge(i1_y, n2_a);
+  buf.del_node();
+  check_edit("delete node");
+
+  // Change bits: a 2 bit input adds the b.1 primary input, so this one goes through the full rebuild
+  g->get_graph_input("b").set_bits(2);
+  pass.run(g);
+  EXPECT_EQ(arrival_times(), fresh_arrival_times()) << "change bits";
+}
+
+TEST_F(Opentimer_test, edited_sdc_rebuilds_the_timers) {
+  {
+    Opentimer_access pass(var());
+    pass.run(g);
+  }
+  const auto before = arrival_times();
+
+  write_sdc("set_input_delay 2.25 [get_ports a]\n");
+
+  Opentimer_access pass(var());  // same files label, the stamp of the sdc changed
+  pass.run(g);
+  const auto after = arrival_times();
+  EXPECT_NE(before, after);
+  EXPECT_EQ(after, fresh_arrival_times());
+}
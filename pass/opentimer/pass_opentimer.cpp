@@ -2,21 +2,36 @@
 
 #include "pass_opentimer.hpp"
 
+#include <filesystem>
 #include <format>
 #include <fstream>
 #include <iostream>
 #include <string>
 
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "str_tools.hpp"
 
 static Pass_plugin sample("pass_opentimer", Pass_opentimer::setup);
 
+// Size and mtime of a timing file, part of the session key so that editing a liberty/sdc/spef file rebuilds the timers
+static std::string file_stamp(const std::string &f) {
+  std::error_code ec;
+  const auto      mtime = std::filesystem::last_write_time(f, ec);
+  if (ec) {
+    return absl::StrCat(f, "@?");
+  }
+  const auto size = std::filesystem::file_size(f, ec);
+  return absl::StrCat(f, "@", mtime.time_since_epoch().count(), ":", ec ? 0 : size);
+}
+
 void Pass_opentimer::setup() {
   Eprp_method m1("pass.opentimer", "timing analysis on lgraph", &Pass_opentimer::time_work);
   m1.add_label_required("files", "Liberty, spef, sdc file[s] for timing");
   m1.add_label_optional("margin", "% arrival time marging (0-100)", "0");
+  m1.add_label_optional("corners", "';' separated liberty,sdc,spef files per timing corner (files are shared)", "");
 
   register_pass(m1);
 
@@ -24,28 +39,33 @@ void Pass_opentimer::setup() {
   m2.add_label_required("files", "Liberty, spef, sdc file[s] for timing");
   m2.add_label_optional("odir", "output directory", ".");
   m2.add_label_optional("freq", "frequency (Hz)", "1e9");
+  m2.add_label_optional("corners", "';' separated liberty,sdc,spef files per timing corner (files are shared)", "");
 
   register_pass(m2);
 }
 
 Pass_opentimer::Pass_opentimer(const Eprp_var &var) : Pass("pass.opentimer", var) {
-  auto n_lib_read = 0;
+  Ot_corner shared;  // files for all the corners
 
-  for (const auto f : absl::StrSplit(files, ',')) {
+  auto add_corner_file = [](Ot_corner &corner, std::string_view f) {
     if (str_tools::ends_with(f, ".lib")) {
-      std::print("opentimer using liberty file '{}'\n", f);
-      if (n_lib_read == 0) {
-        timer.read_celllib(f);
-      } else {
-        timer.read_celllib(f, ot::MIN);
-      }
-      n_lib_read++;
+      corner.lib_file_list.emplace_back(f);
     } else if (str_tools::ends_with(f, ".spef")) {
-      spef_file_list.emplace_back(f);
-    } else if (str_tools::ends_with(f, ".vcd")) {
-      vcd_file_list.emplace_back(f);
+      corner.spef_file_list.emplace_back(f);
     } else if (str_tools::ends_with(f, ".sdc")) {
-      sdc_file_list.emplace_back(f);
+      corner.sdc_file_list.emplace_back(f);
+    } else {
+      return false;
+    }
+    return true;
+  };
+
+  for (const auto f : absl::StrSplit(files, ',')) {
+    if (add_corner_file(shared, f)) {
+      continue;
+    }
+    if (str_tools::ends_with(f, ".vcd")) {
+      vcd_file_list.emplace_back(f);
     } else if (str_tools::ends_with(f, ".v")) {    // Nothing to do
     } else if (str_tools::ends_with(f, ".prp")) {  // Nothing to do
     } else {
@@ -53,8 +73,35 @@ Pass_opentimer::Pass_opentimer(const Eprp_var &var) : Pass("pass.opentimer", var
     }
   }
 
-  if (n_lib_read > 2) {
-    Pass::error("pass.opentime only supports 1 or 2 liberty (max/min) files not {}", files);
+  std::string corners_txt;
+  if (var.has_label("corners")) {
+    corners_txt = var.get("corners");
+  }
+  for (const auto c : absl::StrSplit(corners_txt, ';', absl::SkipWhitespace())) {
+    auto &corner = corners.emplace_back(shared);
+    for (const auto f : absl::StrSplit(c, ',', absl::SkipWhitespace())) {
+      if (!add_corner_file(corner, f)) {
+        Pass::error("pass.opentimer corner '{}' only accepts liberty, sdc, and spef files not '{}'", c, f);
+      }
+    }
+  }
+  if (corners.empty()) {
+    corners.emplace_back(std::move(shared));
+  }
+  corner_files = absl::StrCat(files, ";", corners_txt);
+  for (const auto &corner : corners) {
+    for (const auto *list : {&corner.lib_file_list, &corner.sdc_file_list, &corner.spef_file_list}) {
+      for (const auto &f : *list) {
+        absl::StrAppend(&corner_files, ";", file_stamp(f));
+      }
+    }
+  }
+
+  for (const auto &corner : corners) {
+    if (corner.lib_file_list.size() > 2) {
+      Pass::error("pass.opentime only supports 1 or 2 liberty (max/min) files per corner not {}",
+                  absl::StrJoin(corner.lib_file_list, ","));
+    }
   }
 
   margin = 0;
@@ -78,7 +125,7 @@ Pass_opentimer::Pass_opentimer(const Eprp_var &var) : Pass("pass.opentimer", var
   margin_delay = 0;
 }
 
-void Pass_opentimer::read_sdc(std::string_view sdc_file) {
+void Pass_opentimer::read_sdc(ot::Timer &timer, std::string_view sdc_file) {
   std::ifstream file(std::string{sdc_file});
   if (!file.is_open()) {
     Pass::error("pass.opentimer could not open sdc:{}", sdc_file);
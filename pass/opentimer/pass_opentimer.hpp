@@ -1,6 +1,10 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <memory>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "node_pin.hpp"
 #include "ot/timer/timer.hpp"
 #include "pass.hpp"
@@ -8,9 +12,53 @@
 
 class Pass_opentimer : public Pass {
 protected:
-  absl::flat_hash_map<Node_pin::Compact_driver, std::string> overwrite_dpin2net;
+  // OpenTimer view of an lgraph. All the names are interned ids (Ot_session::get_name)
+  struct Ot_gate {
+    uint32_t                                   cell;
+    std::vector<std::pair<uint32_t, uint32_t>> pins;  // "instance:pin" -> net
+  };
+  struct Ot_circuit {
+    absl::flat_hash_set<uint32_t>                              inputs;
+    absl::flat_hash_set<uint32_t>                              outputs;
+    absl::flat_hash_set<uint32_t>                              nets;
+    absl::flat_hash_map<uint32_t, Ot_gate>                     gates;  // instance -> gate
+    std::vector<std::pair<Node_pin::Compact_driver, uint32_t>> outs;   // gate driver pin -> "instance:pin"
+  };
+
+  // Liberty/sdc/spef files for one timing corner
+  struct Ot_corner {
+    std::vector<std::string> lib_file_list;
+    std::vector<std::string> sdc_file_list;
+    std::vector<std::string> spef_file_list;
+  };
+
+  // Timers kept across pass calls for each lgraph (one per corner, all share the circuit). Once built, a call only
+  // applies the gates/nets that changed since the last one, and OpenTimer update_timing retimes just the modified part.
+  struct Ot_session {
+    std::vector<std::unique_ptr<ot::Timer>> timers;
+    std::string                             files;  // timers built with these liberty/sdc/spef files (and mtimes) and corners
+    Lgraph                                 *lg        = nullptr;
+    uint64_t                                epoch     = 0;  // lg mutation epoch when the circuit was last synced
+    uint64_t                                signature = 0;  // sub lgraph epochs and library IOs of the whole hierarchy
+    Ot_circuit                              circuit;
+
+    std::vector<std::string>                   names;
+    absl::flat_hash_map<std::string, uint32_t> name2id;
+    absl::flat_hash_map<uint64_t, uint32_t>    bit2id;  // (name, bus bit) -> "name.bit"
+    absl::flat_hash_map<uint64_t, uint32_t>    pin2id;  // (instance, pin) -> "instance:pin"
+
+    uint32_t intern(std::string_view name);
+    uint32_t intern_bit(uint32_t id, int pos);
+    uint32_t intern_pin(uint32_t instance, std::string_view pin_name);
 
-  ot::Timer timer;
+    [[nodiscard]] const std::string &get_name(uint32_t id) const { return names[id]; }
+  };
+
+  static absl::flat_hash_map<std::string, std::unique_ptr<Ot_session>> sessions;  // lgdb:lgid -> session
+
+  Ot_session *session = nullptr;
+
+  absl::flat_hash_map<Node_pin::Compact_driver, uint32_t> overwrite_dpin2net;
 
   int    margin;  // % margin to mark nodes
   double freq;
@@ -19,10 +67,10 @@ protected:
   float       max_delay;     // slowest arrival time (delay) on the circuit
   float       margin_delay;  // time delay to mark any slower cell for criticality
 
-  std::vector<std::string> sdc_file_list;
-  std::vector<std::string> spef_file_list;
-  std::vector<std::string> vcd_file_list;
-  std::vector<Vcd_power>   vcd_list;
+  std::string                         corner_files;  // files, corners label, and timing file stamps (session key)
+  std::vector<Ot_corner>              corners;
+  std::vector<std::string>            vcd_file_list;
+  std::vector<std::vector<Vcd_power>> vcd_list;  // [corner][vcd file]
 
   static void liberty_open(Eprp_var &var);
   static void time_work(Eprp_var &var);
@@ -30,19 +78,23 @@ protected:
 
   void read_files();
 
-  void set_input_delays(const std::string &pname);
-  void set_output_delays(const std::string &pname);
-  void build_circuit(Lgraph *lg);
+  static void set_input_delays(ot::Timer &timer, const std::string &pname);
+  static void set_output_delays(ot::Timer &timer, const std::string &pname);
+  static void read_sdc(ot::Timer &timer, std::string_view sdc_file);
+
+  void open_timers();
+  void update_circuit(Lgraph *lg);
+  void build_circuit(Lgraph *lg, Ot_circuit &cir);
+  void apply_delta(ot::Timer &timer, const Ot_circuit &prev, const Ot_circuit &next) const;
 
-  void read_vcd();
-  void read_sdc_spef();
-  void read_sdc(std::string_view sdc_file);
+  bool read_vcd(size_t c, std::string &failed);
+  void read_sdc_spef(ot::Timer &timer, const Ot_corner &corner);
   void compute_timing(Lgraph *lg);
-  void compute_power(Lgraph *lg);
+  void compute_power();
   void populate_table(Lgraph *lg);
 
-  std::string get_driver_net_name(const Node_pin &dpin) const;
-  void        backpath_set_color(Node &node, int color);
+  uint32_t get_driver_net(const Node_pin &dpin);
+  void     backpath_set_color(Node &node, int color);
 
 public:
   Pass_opentimer(const Eprp_var &var);
@@ -2,15 +2,25 @@
 
 #include "pass_submatch.hpp"
 
+#include <algorithm>
 #include <format>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <queue>
+#include <span>
 #include <string>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "graph_library.hpp"
 #include "lgedgeiter.hpp"
 #include "lgraph.hpp"
 #include "node.hpp"
 #include "node_pin.hpp"
+#include "perf_tracing.hpp"
+#include "thread_pool.hpp"
 #include "waterhash.hpp"
 #include "woothash.hpp"
 
@@ -18,8 +28,14 @@ static Pass_plugin sample("pass_submatch", pass_submatch::setup);
 
 void pass_submatch::setup() {
   Eprp_method m1("pass.submatch", "Find identical subgraphs", &pass_submatch::work);
+  m1.add_label_optional("depth", "max depth of the matched trees", "15");
+  m1.add_label_optional("persist", "save the node hashes with the lgraph, a rerun only rehashes the changed cones", "false");
 
   register_pass(m1);
+
+  Eprp_method m2("pass.dedup", "Merge structurally identical modules (same Lgraph structural hash) into one", &pass_submatch::dedup);
+
+  register_pass(m2);
 }
 
 pass_submatch::pass_submatch(const Eprp_var &var) : Pass("pass.submatch", var) {}
@@ -29,14 +45,17 @@ void pass_submatch::do_work(Lgraph *g) {
   find_subs(g);
 }
 
-uint32_t pass_submatch::submatch_depth = 15;
+uint32_t pass_submatch::submatch_depth   = 15;
+bool     pass_submatch::submatch_persist = false;
 
 void pass_submatch::work(Eprp_var &var) {
+  TRACE_EVENT("pass", "PASS_submatch");
   pass_submatch p(var);
 
   if (var.dict.count("depth")) {
     submatch_depth = str_tools::to_i(var.dict["depth"]);
   }
+  submatch_persist = var.get("persist") == "true";
 
   for (const auto &g : var.lgs) {
     std::print("finding subgraphs for graph {}...\n", g->get_name());
@@ -44,6 +63,32 @@ void pass_submatch::work(Eprp_var &var) {
   }
 }
 
+void pass_submatch::dedup(Eprp_var &var) {
+  TRACE_EVENT("pass", "PASS_dedup");
+  pass_submatch p(var);
+
+  absl::flat_hash_map<Graph_library *, std::vector<Lgraph *>> tops;
+  for (auto *lg : var.lgs) {
+    tops[lg->ref_library()].emplace_back(lg);
+  }
+
+  absl::flat_hash_set<Lgraph *> dup_tops;
+  for (auto &[lib, lgs] : tops) {
+    const auto remap = lib->dedup_structural(lgs);
+    for (const auto &[dup, kept] : remap) {
+      std::print("dedup: {} is identical to {}\n", lib->get_name(dup), lib->get_name(kept));
+    }
+    for (auto *lg : lgs) {
+      if (remap.contains(lg->get_lgid())) {
+        dup_tops.insert(lg);
+      }
+    }
+  }
+
+  // The downstream passes only see the kept tops (the duplicated subs are no longer instantiated)
+  std::erase_if(var.lgs, [&dup_tops](Lgraph *lg) { return dup_tops.contains(lg); });
+}
+
 uint64_t pass_submatch::hash_mffc_root(Node n) { return hash_node(n); }
 
 uint64_t pass_submatch::hash_mffc_node(Node n_driver, uint64_t h_sink, Port_ID pid) {
@@ -198,6 +243,206 @@ void pass_submatch::find_mffc_group(Lgraph *g) {
   }
 }
 
+static constexpr uint64_t depth_memo_magic = 0x4c48'5355'424d'0001ULL;  // file tag + version
+static constexpr size_t   depth_hash_chunk = 256;                        // nodes per thread_pool task
+
+bool pass_submatch::Depth_memo::save(const std::string &fname) const {
+  std::ofstream of(fname, std::ios::binary | std::ios::trunc);
+
+  std::vector<uint64_t> nids(signature.size());
+  for (const auto &[nid, pos] : nid2pos) {
+    nids[pos] = nid;
+  }
+
+  const uint64_t header[3] = {depth_memo_magic, depth, signature.size()};
+  of.write(reinterpret_cast<const char *>(header), sizeof(header));
+  of.write(reinterpret_cast<const char *>(nids.data()), nids.size() * sizeof(uint64_t));
+  of.write(reinterpret_cast<const char *>(signature.data()), signature.size() * sizeof(uint64_t));
+  of.write(reinterpret_cast<const char *>(n_hashes.data()), n_hashes.size() * sizeof(uint32_t));
+  of.write(reinterpret_cast<const char *>(hashes.data()), hashes.size() * sizeof(uint64_t));
+
+  return of.good();
+}
+
+bool pass_submatch::Depth_memo::load(const std::string &fname) {
+  std::ifstream ifs(fname, std::ios::binary | std::ios::ate);
+  if (!ifs.good()) {
+    return false;
+  }
+  const uint64_t file_sz = ifs.tellg();
+  ifs.seekg(0);
+
+  uint64_t header[3];
+  ifs.read(reinterpret_cast<char *>(header), sizeof(header));
+  if (!ifs.good() || header[0] != depth_memo_magic || header[1] == 0 || header[1] > 1024) {
+    return false;
+  }
+
+  // The node count must match the file size (a corrupt count fails here, not in the allocations below)
+  const auto     n_nodes = header[2];
+  const uint64_t node_sz = 2 * sizeof(uint64_t) + sizeof(uint32_t) + header[1] * sizeof(uint64_t);
+  if (n_nodes > (file_sz - sizeof(header)) / node_sz || sizeof(header) + n_nodes * node_sz != file_sz) {
+    return false;
+  }
+
+  std::vector<uint64_t> nids(n_nodes);
+  depth = header[1];
+  signature.resize(n_nodes);
+  n_hashes.resize(n_nodes);
+  hashes.resize(n_nodes * depth);
+  ifs.read(reinterpret_cast<char *>(nids.data()), nids.size() * sizeof(uint64_t));
+  ifs.read(reinterpret_cast<char *>(signature.data()), signature.size() * sizeof(uint64_t));
+  ifs.read(reinterpret_cast<char *>(n_hashes.data()), n_hashes.size() * sizeof(uint32_t));
+  ifs.read(reinterpret_cast<char *>(hashes.data()), hashes.size() * sizeof(uint64_t));
+  if (!ifs.good() || std::any_of(n_hashes.begin(), n_hashes.end(), [this](uint32_t n) { return n > depth; })) {
+    *this = Depth_memo();
+    return false;
+  }
+
+  nid2pos.clear();
+  for (auto pos = 0u; pos < n_nodes; ++pos) {
+    nid2pos.emplace(nids[pos], pos);
+  }
+  return true;
+}
+
+// A node only sees the depth hashes of the drivers placed before it in the sorted order (later drivers, loops, are
+// leaves), so nodes are hashed in levels over those drivers, each level in parallel. A node keeps the hashes of the
+// previous run when its signature and all those drivers are unchanged.
+void pass_submatch::compute_depth_hashes(Lgraph *g, const std::vector<Node::Compact> &sorted, Depth_memo &memo) {
+  TRACE_EVENT("pass", "submatch_depth_hashes");
+
+  static constexpr uint32_t no_driver = std::numeric_limits<uint32_t>::max();
+
+  struct Input {
+    uint32_t driver;  // position in sorted, or no_driver (leaf)
+    Port_ID  pid;
+  };
+
+  const uint32_t n_nodes = sorted.size();
+
+  Depth_memo next;
+  next.depth = submatch_depth;
+  next.nid2pos.reserve(n_nodes);
+  for (auto i = 0u; i < n_nodes; ++i) {
+    next.nid2pos.emplace(sorted[i].get_nid().value, i);
+  }
+
+  std::vector<uint64_t> type(n_nodes);
+  std::vector<uint32_t> level(n_nodes);
+  std::vector<uint32_t> inp_start;
+  std::vector<Input>    inputs;
+  std::vector<uint64_t> sig;
+  uint32_t              max_level = 0;
+
+  next.signature.resize(n_nodes);
+  inp_start.reserve(n_nodes + 1);
+  for (auto i = 0u; i < n_nodes; ++i) {
+    auto node = Node(g, sorted[i]);
+    type[i]   = static_cast<uint64_t>(node.get_type_op());
+    inp_start.emplace_back(inputs.size());
+
+    sig.assign(1, type[i]);
+    for (auto e : node.inp_edges()) {
+      const auto drv_nid = e.driver.get_node().get_nid().value;
+      const auto it      = next.nid2pos.find(drv_nid);
+      auto       driver  = no_driver;
+      if (it != next.nid2pos.end() && it->second <= i) {
+        driver = it->second;
+        if (driver < i) {
+          level[i] = std::max(level[i], level[driver] + 1);
+        }
+      }
+      inputs.emplace_back(driver, e.sink.get_pid());
+
+      const uint64_t kind = driver == no_driver ? 0 : (driver == i ? 2 : 1);
+      sig.emplace_back(driver == no_driver ? 0 : drv_nid);
+      sig.emplace_back((static_cast<uint64_t>(e.sink.get_pid()) << 2) | kind);
+    }
+    next.signature[i] = lh::woothash64(sig.data(), sig.size() * sizeof(uint64_t));
+    max_level         = std::max(max_level, level[i]);
+  }
+  inp_start.emplace_back(inputs.size());
+
+  std::vector<std::vector<uint32_t>> waves(n_nodes ? max_level + 1 : 0);
+  for (auto i = 0u; i < n_nodes; ++i) {
+    waves[level[i]].emplace_back(i);
+  }
+
+  next.n_hashes.resize(n_nodes);
+  next.hashes.resize(static_cast<size_t>(n_nodes) * submatch_depth);
+  std::vector<uint8_t> clean(n_nodes);  // same hashes as in memo (no vector<bool>, written from several threads)
+
+  const bool reuse = memo.depth == submatch_depth;
+
+  auto hash_depths = [&](uint32_t i) {
+    const auto *inp_begin = &inputs[inp_start[i]];
+    const auto *inp_end   = inp_begin + (inp_start[i + 1] - inp_start[i]);
+    auto       *out       = &next.hashes[static_cast<size_t>(i) * submatch_depth];
+
+    if (reuse) {
+      const auto it = memo.nid2pos.find(sorted[i].get_nid().value);
+      bool       ok = it != memo.nid2pos.end() && memo.signature[it->second] == next.signature[i];
+      for (const auto *in = inp_begin; ok && in != inp_end; ++in) {
+        ok = in->driver == no_driver || in->driver == i || clean[in->driver];
+      }
+      if (ok) {
+        const auto *prev = &memo.hashes[static_cast<size_t>(it->second) * submatch_depth];
+        next.n_hashes[i] = memo.n_hashes[it->second];
+        std::copy(prev, prev + next.n_hashes[i], out);
+        clean[i] = 1;
+        return;
+      }
+    }
+
+    std::vector<uint64_t> i_hash;
+    for (size_t depth = 0; depth < submatch_depth; ++depth) {
+      size_t max_depth = 0;
+      i_hash.clear();
+      for (const auto *in = inp_begin; in != inp_end; ++in) {
+        if (in->driver == no_driver || depth == 0) {
+          i_hash.emplace_back(in->pid);
+        } else {
+          const auto subtree_depth = std::min<size_t>(next.n_hashes[in->driver], depth);  // self loop: the depths done so far
+          i_hash.emplace_back(next.hashes[static_cast<size_t>(in->driver) * submatch_depth + subtree_depth - 1] ^ in->pid);
+          max_depth = std::max(subtree_depth, max_depth);
+        }
+      }
+      if (depth != max_depth) {
+        break;
+      }
+      std::sort(i_hash.begin(), i_hash.end());
+      uint64_t h       = lh::woothash64(i_hash.data(), i_hash.size() * 8);
+      h                = lh::waterhash(&type[i], 4, h & 0xFFFF);
+      out[depth]       = h;
+      next.n_hashes[i] = depth + 1;
+    }
+  };
+
+  for (const auto &wave : waves) {
+    if (wave.size() <= depth_hash_chunk) {
+      for (auto i : wave) {
+        hash_depths(i);
+      }
+      continue;
+    }
+    for (size_t start = 0; start < wave.size(); start += depth_hash_chunk) {
+      const auto end = std::min(start + depth_hash_chunk, wave.size());
+      thread_pool.add([&hash_depths, &wave, start, end]() {
+        for (auto k = start; k < end; ++k) {
+          hash_depths(wave[k]);
+        }
+      });
+    }
+    thread_pool.wait_all();
+  }
+
+  const auto n_clean = std::count(clean.begin(), clean.end(), 1);
+  std::print("rehashed {} of {} nodes ({} levels)\n", n_nodes - n_clean, n_nodes, waves.size());
+
+  memo = std::move(next);
+}
+
 void pass_submatch::find_subs(Lgraph *g) {
   // Topological Sort
   std::cout << "1 - Topological Sort\n";
@@ -233,44 +478,32 @@ void pass_submatch::find_subs(Lgraph *g) {
   // (2) Depth - (Hash <-> Node) Map : Query equivalence trees with given depths
   // Time/Space Complexity = O(V x DEPTH)
   std::cout << "2 - Construct Depth Map\n";
-  absl::flat_hash_map<Node::Compact, std::vector<uint64_t>>              node2depth_hash;
+  const auto memo_name = std::string(g->get_unique_name());
+  auto      &memo      = depth_memos[memo_name];
+  if (memo.nid2pos.empty() && submatch_persist) {
+    memo.load(absl::StrCat(memo_name, ".submatch"));
+  }
+  compute_depth_hashes(g, sorted_compact_nodes, memo);
+  if (submatch_persist && !memo.save(absl::StrCat(memo_name, ".submatch"))) {
+    Pass::warn("pass.submatch: could not save {}.submatch", memo_name);
+  }
+
+  auto depth_hashes = [&memo](const Node &node) -> std::span<const uint64_t> {
+    const auto it = memo.nid2pos.find(node.get_nid().value);
+    if (it == memo.nid2pos.end()) {
+      return {};
+    }
+    return {&memo.hashes[static_cast<size_t>(it->second) * memo.depth], memo.n_hashes[it->second]};
+  };
+
   std::vector<absl::flat_hash_map<uint64_t, std::vector<Node::Compact>>> depth_hash2node;
   for (const auto &compact_node : sorted_compact_nodes) {
-    auto node = Node(g, compact_node);
-    for (size_t depth = 0; depth < submatch_depth; ++depth) {
-      size_t                max_depth = 0;
-      std::vector<uint64_t> i_hash;
-      for (auto e : node.inp_edges()) {
-        auto it = node2depth_hash.find(e.driver.get_node().get_compact());
-        if (it == node2depth_hash.end() || depth == 0) {
-          i_hash.emplace_back(e.sink.get_pid());
-        } else {
-          auto subtree_depth = std::min(it->second.size(), depth);
-          i_hash.emplace_back(it->second[subtree_depth - 1] ^ e.sink.get_pid());
-          max_depth = std::max(subtree_depth, max_depth);
-        }
-      }
-      if (depth != max_depth) {
-        break;
-      }
-      std::sort(i_hash.begin(), i_hash.end());
-      uint64_t h = lh::woothash64(i_hash.data(), i_hash.size() * 8);
-      uint64_t n = static_cast<uint64_t>(node.get_type_op());
-      h          = lh::waterhash(&n, 4, h & 0xFFFF);
-      if (depth == 0) {
-        node2depth_hash[node.get_compact()].clear();
-      }
-      node2depth_hash[node.get_compact()].emplace_back(h);
-
+    const auto hashes = depth_hashes(Node(g, compact_node));
+    for (size_t depth = 0; depth < hashes.size(); ++depth) {
       if (depth_hash2node.size() <= depth) {
         depth_hash2node.emplace_back(absl::flat_hash_map<uint64_t, std::vector<Node::Compact>>());
       }
-      if (depth_hash2node[depth].count(h)) {
-        depth_hash2node[depth][h].emplace_back(node.get_compact());
-      } else {
-        depth_hash2node[depth][h].clear();
-        depth_hash2node[depth][h].emplace_back(node.get_compact());
-      }
+      depth_hash2node[depth][hashes[depth]].emplace_back(compact_node);
     }
   }
 
@@ -305,10 +538,11 @@ void pass_submatch::find_subs(Lgraph *g) {
       if (!has_output) {
         break;
       }
-      if (node2depth_hash[node.get_compact()].size() < height) {
+      const auto hashes = depth_hashes(node);
+      if (hashes.size() < height) {
         break;
       }
-      h ^= node2depth_hash[node.get_compact()][height - 1];
+      h ^= hashes[height - 1];
       h = lh::waterhash(&h, 4, pid & 0xFFFF);
       node2height_hash[compact_node].emplace_back(Root_hash(node.get_compact(), h));
 
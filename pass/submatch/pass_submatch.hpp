@@ -1,11 +1,31 @@
 //  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
 #pragma once
 
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "node.hpp"
 #include "pass.hpp"
 
 class pass_submatch : public Pass {
 protected:
   static uint32_t submatch_depth;
+  static bool     submatch_persist;
+
+  // Depth hashes of find_subs, dense by position in the sorted node order (submatch_depth slots per node). Kept between
+  // runs, and saved next to the lgraph with persist:true, so a rerun only rehashes the cones that changed.
+  struct Depth_memo {
+    uint32_t                                depth = 0;
+    absl::flat_hash_map<uint64_t, uint32_t> nid2pos;
+    std::vector<uint64_t>                   signature;  // type, pids and drivers of the node (what its hashes depend on)
+    std::vector<uint32_t>                   n_hashes;
+    std::vector<uint64_t>                   hashes;
+
+    bool save(const std::string &fname) const;
+    bool load(const std::string &fname);
+  };
+  inline static absl::flat_hash_map<std::string, Depth_memo> depth_memos;  // lgraph unique name -> last run
 
   uint64_t hash_mffc_root(Node n);
   uint64_t hash_mffc_node(Node n_driver, uint64_t hash_sink, Port_ID pid);
@@ -16,12 +36,15 @@ protected:
 
   void find_mffc_group(Lgraph *g);
 
+  void compute_depth_hashes(Lgraph *g, const std::vector<Node::Compact> &sorted, Depth_memo &memo);
+
   void find_subs(Lgraph *g);
 
   void do_work(Lgraph *g);
 
 public:
   static void work(Eprp_var &var);
+  static void dedup(Eprp_var &var);
 
   pass_submatch(const Eprp_var &var);
 
@@ -0,0 +1,183 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "gtest/gtest.h"
+#include "lgedgeiter.hpp"
+#include "lgraph.hpp"
+#include "pass_submatch.hpp"
+#include "waterhash.hpp"
+#include "woothash.hpp"
+
+class Submatch_access : public pass_submatch {
+public:
+  using pass_submatch::Depth_memo;
+
+  Submatch_access(uint32_t depth) : pass_submatch(Eprp_var()) { submatch_depth = depth; }
+
+  void compute(Lgraph *g, const std::vector<Node::Compact> &sorted, Depth_memo &memo) { compute_depth_hashes(g, sorted, memo); }
+};
+
+class Submatch_test : public ::testing::Test {
+protected:
+  static constexpr uint32_t depth = 6;
+
+  Lgraph           *g = nullptr;
+  std::vector<Node> levels;  // last level built, the next one reads from it
+
+  // Layers of Sum/Xor/And nodes, wide enough for the hashing levels to be split across thread_pool tasks
+  void SetUp() override {
+    auto *lib = Graph_library::instance("lgdb_submatch_test");
+    g         = lib->create_lgraph("submatch_levels", "-");
+    ASSERT_NE(g, nullptr);
+
+    auto a = g->add_graph_input("a", 1, 8);
+    auto b = g->add_graph_input("b", 2, 8);
+
+    std::vector<Node_pin> prev{a, b};
+    for (int level = 0; level < 8; ++level) {
+      std::vector<Node_pin> next;
+      for (int i = 0; i < 700; ++i) {
+        const Ntype_op op   = i % 3 == 0 ? Ntype_op::Sum : (i % 3 == 1 ? Ntype_op::Xor : Ntype_op::And);
+        auto           node = g->create_node(op, 8);
+        auto           spin = node.setup_sink_pin("A");
+        g->add_edge(prev[(i * 7) % prev.size()], spin);
+        g->add_edge(prev[(i * 13 + 1) % prev.size()], op == Ntype_op::Sum ? node.setup_sink_pin("B") : spin);
+        next.emplace_back(node.setup_driver_pin());
+      }
+      prev = std::move(next);
+    }
+
+    auto out = g->add_graph_output("o", 3, 8);
+    for (const auto &dpin : prev) {
+      g->add_edge(dpin, out);
+    }
+  }
+
+  void TearDown() override { g->clear(); }
+
+  std::vector<Node::Compact> sorted() const {
+    std::vector<Node::Compact> v;
+    for (auto node : g->forward()) {
+      v.emplace_back(node.get_compact());
+    }
+    return v;
+  }
+
+  // One node at a time in sorted order, as find_subs did before the levelled hashing
+  static std::vector<std::vector<uint64_t>> serial_hashes(Lgraph *lg, const std::vector<Node::Compact> &sorted) {
+    absl::flat_hash_map<uint64_t, uint32_t> pos;
+    for (auto i = 0u; i < sorted.size(); ++i) {
+      pos.emplace(sorted[i].get_nid().value, i);
+    }
+
+    std::vector<std::vector<uint64_t>> out(sorted.size());
+    for (auto i = 0u; i < sorted.size(); ++i) {
+      auto     node = Node(lg, sorted[i]);
+      uint64_t type = static_cast<uint64_t>(node.get_type_op());
+
+      std::vector<uint64_t> i_hash;
+      for (size_t d = 0; d < depth; ++d) {
+        size_t max_depth = 0;
+        i_hash.clear();
+        for (auto e : node.inp_edges()) {
+          const auto it  = pos.find(e.driver.get_node().get_nid().value);
+          const auto pid = static_cast<uint64_t>(e.sink.get_pid());
+          if (it == pos.end() || it->second > i || d == 0) {
+            i_hash.emplace_back(pid);
+          } else {
+            const auto sub = std::min<size_t>(out[it->second].size(), d);
+            i_hash.emplace_back(out[it->second][sub - 1] ^ pid);
+            max_depth = std::max(sub, max_depth);
+          }
+        }
+        if (d != max_depth) {
+          break;
+        }
+        std::sort(i_hash.begin(), i_hash.end());
+        uint64_t h = lh::woothash64(i_hash.data(), i_hash.size() * 8);
+        h          = lh::waterhash(&type, 4, h & 0xFFFF);
+        out[i].emplace_back(h);
+      }
+    }
+    return out;
+  }
+
+  static void check_same(const Submatch_access::Depth_memo &memo, const std::vector<Node::Compact> &sorted,
+                         const std::vector<std::vector<uint64_t>> &expected) {
+    ASSERT_EQ(memo.n_hashes.size(), sorted.size());
+    for (auto i = 0u; i < sorted.size(); ++i) {
+      const auto it = memo.nid2pos.find(sorted[i].get_nid().value);
+      ASSERT_NE(it, memo.nid2pos.end());
+      ASSERT_EQ(memo.n_hashes[it->second], expected[i].size());
+      for (auto d = 0u; d < expected[i].size(); ++d) {
+        EXPECT_EQ(memo.hashes[static_cast<size_t>(it->second) * memo.depth + d], expected[i][d]);
+      }
+    }
+  }
+};
+
+TEST_F(Submatch_test, levelled_and_reused_match_serial) {
+  Submatch_access             pass(depth);
+  Submatch_access::Depth_memo memo;
+
+  auto order = sorted();
+  pass.compute(g, order, memo);
+  check_same(memo, order, serial_hashes(g, order));
+
+  // Small edit: one more input in a node of the third level, the rest of the memo is reused
+  auto node = Node(g, order[2 * 700 + 5]);
+  auto inv  = g->create_node(Ntype_op::Not, 8);
+  g->add_edge(order[10].get_node(g).get_driver_pin(), inv.setup_sink_pin());
+  g->add_edge(inv.setup_driver_pin(), node.setup_sink_pin("A"));
+
+  order = sorted();
+  pass.compute(g, order, memo);
+  const auto expected = serial_hashes(g, order);
+  check_same(memo, order, expected);
+
+  Submatch_access::Depth_memo fresh;
+  pass.compute(g, order, fresh);
+  check_same(fresh, order, expected);
+}
+
+TEST_F(Submatch_test, load_rejects_corrupt_files) {
+  Submatch_access             pass(depth);
+  Submatch_access::Depth_memo memo;
+  pass.compute(g, sorted(), memo);
+
+  const std::string fname = "lgdb_submatch_test/levels.submatch";
+  ASSERT_TRUE(memo.save(fname));
+
+  Submatch_access::Depth_memo loaded;
+  ASSERT_TRUE(loaded.load(fname));
+  EXPECT_EQ(loaded.nid2pos, memo.nid2pos);
+  EXPECT_EQ(loaded.hashes, memo.hashes);
+
+  std::ifstream      in(fname, std::ios::binary);
+  const std::string  good((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  auto               write = [&fname](const std::string &data) { std::ofstream(fname, std::ios::binary | std::ios::trunc) << data; };
+  constexpr uint64_t huge  = 1ULL << 60;
+
+  // Node count far beyond the file size (would not fit in memory)
+  auto bad = good;
+  bad.replace(16, sizeof(huge), reinterpret_cast<const char *>(&huge), sizeof(huge));
+  write(bad);
+  EXPECT_FALSE(loaded.load(fname));
+
+  // Truncated
+  write(good.substr(0, good.size() - 8));
+  EXPECT_FALSE(loaded.load(fname));
+
+  // More hashes than the depth for the first node
+  bad                = good;
+  const uint32_t too = depth + 1;
+  const auto     n   = memo.n_hashes.size();
+  bad.replace(24 + n * 16, sizeof(too), reinterpret_cast<const char *>(&too), sizeof(too));
+  write(bad);
+  EXPECT_FALSE(loaded.load(fname));
+  EXPECT_TRUE(loaded.nid2pos.empty());
+}
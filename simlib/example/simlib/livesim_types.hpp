@@ -3,5 +3,9 @@
 #include <array>
 
 #include "simlib_signature.hpp"
+#ifdef SIMLIB_LANES
+#include "simlib_lanes.hpp"
+#else
 #include "sint.hpp"
 #include "uint.hpp"
+#endif
@@ -0,0 +1,389 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+// Bit-parallel multi-stimulus values. A Simlib_lanes<w> holds the same signal
+// for 64 independent simulations ("lanes"), stored bit-sliced: slice b has bit
+// b of every lane. Logic ops are one word op per bit, add/compare are
+// bit-serial over the width, and a mux becomes a blend with the select mask.
+//
+// Build the stage code with -DSIMLIB_LANES and include this header instead of
+// uint.hpp so that UInt<w> maps to Simlib_lanes<w>. Control flow can not
+// depend on a signal (the lanes may disagree), so stages must use mux()
+// instead of if/?: on signals and mem_read()/mem_write() instead of indexing
+// memories with as_single_word(). Only hand-written stages are supported: the
+// code generator and the example/simlib stages branch on signals and build in
+// scalar mode only (core/tests/simlib_lanes_bench.cpp has a stage that builds
+// in both modes).
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+
+inline std::mt19937_64 simlib_lanes_rng(14);
+
+// Lane dumped by to_string_binary() (VCD tracing). Select a different lane to
+// demux the waveform of one stimulus.
+inline int simlib_trace_lane = 0;
+
+template <int w_>
+class Simlib_lanes {
+private:
+  constexpr static int cmax(int wa, int wb) { return wa > wb ? wa : wb; }
+
+public:
+  static constexpr int nlanes = 64;
+  using Mask                  = uint64_t;
+
+  static_assert(w_ > 0, "Simlib_lanes needs a positive width");
+
+  constexpr Simlib_lanes() : s_{} {}
+
+  // Broadcast the same constant to all the lanes
+  constexpr Simlib_lanes(uint64_t v) : s_{} {
+    for (int b = 0; b < w_ && b < 64; ++b) {
+      s_[b] = ((v >> b) & 1) ? ~Mask(0) : 0;
+    }
+  }
+
+  template <int other_w>
+  constexpr explicit Simlib_lanes(const Simlib_lanes<other_w> &other) : s_{} {
+    static_assert(other_w <= w_, "Can't copy construct from wider Simlib_lanes");
+    for (int b = 0; b < other_w; ++b) {
+      s_[b] = other.s_[b];
+    }
+  }
+
+  // Per-lane access (stimulus setup, waveform and assertion demux)
+  uint64_t lane(int l) const {
+    static_assert(w_ <= 64, "lane() only supports up to 64 bits");
+    uint64_t v = 0;
+    for (int b = 0; b < w_; ++b) {
+      v |= ((s_[b] >> l) & 1) << b;
+    }
+    return v;
+  }
+
+  void set_lane(int l, uint64_t v) {
+    const Mask m = Mask(1) << l;
+    for (int b = 0; b < w_ && b < 64; ++b) {
+      s_[b] = ((v >> b) & 1) ? (s_[b] | m) : (s_[b] & ~m);
+    }
+  }
+
+  // Each slice is 64 random bits, so every lane gets an independent value
+  void rand_init() {
+    for (int b = 0; b < w_; ++b) {
+      s_[b] = simlib_lanes_rng();
+    }
+  }
+
+  Mask mask() const {
+    static_assert(w_ == 1, "mask only for 1 bit values");
+    return s_[0];
+  }
+  bool any() const { return orr().s_[0] != 0; }
+  bool all() const { return orr().s_[0] == ~Mask(0); }
+
+  constexpr explicit operator bool() const {
+    static_assert(w_ == 0, "Simlib_lanes can not branch on a signal, use mux() or any()/all()");
+    return false;
+  }
+
+  template <int out_w>
+  Simlib_lanes<cmax(w_, out_w)> pad() const {
+    return Simlib_lanes<cmax(w_, out_w)>(*this);
+  }
+
+  template <int other_w>
+  Simlib_lanes<w_ + other_w> cat(const Simlib_lanes<other_w> &other) const {
+    Simlib_lanes<w_ + other_w> r;
+    for (int b = 0; b < other_w; ++b) {
+      r.s_[b] = other.s_[b];
+    }
+    for (int b = 0; b < w_; ++b) {
+      r.s_[other_w + b] = s_[b];
+    }
+    return r;
+  }
+
+  template <int hi, int lo>
+  Simlib_lanes<hi - lo + 1> bits() const {
+    static_assert(hi < w_, "Bit extract hi bigger than width");
+    static_assert(hi >= lo, "Bit extract lo > hi");
+    static_assert(lo >= 0, "Bit extract lo is negative");
+    Simlib_lanes<hi - lo + 1> r;
+    for (int b = lo; b <= hi; ++b) {
+      r.s_[b - lo] = s_[b];
+    }
+    return r;
+  }
+
+  template <int hi>
+  Simlib_lanes<1> bit() const {
+    return bits<hi, hi>();
+  }
+
+  template <int n>
+  Simlib_lanes<n> head() const {
+    static_assert(n <= w_, "Head n must be <= width");
+    return bits<w_ - 1, w_ - n>();
+  }
+
+  template <int n>
+  Simlib_lanes<w_ - n> tail() const {
+    static_assert(n < w_, "Tail n must be < width");
+    return bits<w_ - n - 1, 0>();
+  }
+
+  template <int shamt>
+  Simlib_lanes<w_ + shamt> shl() const {
+    if constexpr (shamt == 0) {
+      return *this;
+    } else {
+      return cat(Simlib_lanes<shamt>(0));
+    }
+  }
+
+  template <int shamt>
+  Simlib_lanes<w_> shlw() const {
+    return shl<shamt>().template tail<shamt>();
+  }
+
+  template <int shamt>
+  Simlib_lanes<w_ - shamt> shr() const {
+    return bits<w_ - 1, shamt>();
+  }
+
+  Simlib_lanes<w_> operator~() const {
+    Simlib_lanes<w_> r;
+    for (int b = 0; b < w_; ++b) {
+      r.s_[b] = ~s_[b];
+    }
+    return r;
+  }
+  Simlib_lanes<w_> operator!() const { return ~*this; }
+
+  Simlib_lanes<w_> operator&(const Simlib_lanes<w_> &o) const {
+    Simlib_lanes<w_> r;
+    for (int b = 0; b < w_; ++b) {
+      r.s_[b] = s_[b] & o.s_[b];
+    }
+    return r;
+  }
+
+  Simlib_lanes<w_> operator|(const Simlib_lanes<w_> &o) const {
+    Simlib_lanes<w_> r;
+    for (int b = 0; b < w_; ++b) {
+      r.s_[b] = s_[b] | o.s_[b];
+    }
+    return r;
+  }
+
+  Simlib_lanes<w_> operator^(const Simlib_lanes<w_> &o) const {
+    Simlib_lanes<w_> r;
+    for (int b = 0; b < w_; ++b) {
+      r.s_[b] = s_[b] ^ o.s_[b];
+    }
+    return r;
+  }
+
+  Simlib_lanes<1> orr() const {
+    Mask m = 0;
+    for (int b = 0; b < w_; ++b) {
+      m |= s_[b];
+    }
+    return from_mask(m);
+  }
+
+  Simlib_lanes<1> andr() const {
+    Mask m = ~Mask(0);
+    for (int b = 0; b < w_; ++b) {
+      m &= s_[b];
+    }
+    return from_mask(m);
+  }
+
+  Simlib_lanes<1> xorr() const {
+    Mask m = 0;
+    for (int b = 0; b < w_; ++b) {
+      m ^= s_[b];
+    }
+    return from_mask(m);
+  }
+
+  Simlib_lanes<w_> addw(const Simlib_lanes<w_> &o) const {
+    Simlib_lanes<w_> r;
+    add_sub<false>(o, r);
+    return r;
+  }
+
+  // Wrapping subtract (UInt::subw returns SInt, lanes mode has no SInt)
+  Simlib_lanes<w_> subw(const Simlib_lanes<w_> &o) const {
+    Simlib_lanes<w_> r;
+    add_sub<true>(o, r);
+    return r;
+  }
+
+  Simlib_lanes<w_ + 1> operator+(const Simlib_lanes<w_> &o) const {
+    Simlib_lanes<w_ + 1> r;
+    r.s_[w_] = add_sub<false>(o, r);
+    return r;
+  }
+
+  Simlib_lanes<1> operator==(const Simlib_lanes<w_> &o) const {
+    Mask eq = ~Mask(0);
+    for (int b = 0; b < w_; ++b) {
+      eq &= ~(s_[b] ^ o.s_[b]);
+    }
+    return from_mask(eq);
+  }
+  Simlib_lanes<1> operator!=(const Simlib_lanes<w_> &o) const { return ~(*this == o); }
+
+  Simlib_lanes<1> operator<(const Simlib_lanes<w_> &o) const {
+    Mask lt = 0;
+    Mask eq = ~Mask(0);
+    for (int b = w_ - 1; b >= 0; --b) {
+      lt |= eq & ~s_[b] & o.s_[b];
+      eq &= ~(s_[b] ^ o.s_[b]);
+    }
+    return from_mask(lt);
+  }
+  Simlib_lanes<1> operator>(const Simlib_lanes<w_> &o) const { return o < *this; }
+  Simlib_lanes<1> operator<=(const Simlib_lanes<w_> &o) const { return ~(o < *this); }
+  Simlib_lanes<1> operator>=(const Simlib_lanes<w_> &o) const { return ~(*this < o); }
+
+  // Packed dump of the trace lane for vcd::VCDWriter::change_value
+  static constexpr int bit_width = w_;
+
+  void to_words(uint64_t *dst) const {
+    for (int i = 0; i < (w_ + 63) / 64; ++i) {
+      dst[i] = 0;
+    }
+    for (int b = 0; b < w_; ++b) {
+      dst[b / 64] |= ((s_[b] >> simlib_trace_lane) & 1) << (b % 64);
+    }
+  }
+
+  std::string to_string_binary() const { return to_string_binary(simlib_trace_lane); }
+
+  std::string to_string_binary(int l) const {
+    std::string str;
+    if (w_ > 1) {
+      str.push_back('b');
+    }
+    bool top_zeroes = w_ > 1;
+    for (int b = w_ - 1; b >= 0; --b) {
+      bool v = (s_[b] >> l) & 1;
+      if (top_zeroes && !v && b != 0) {
+        continue;
+      }
+      top_zeroes = false;
+      str.push_back(v ? '1' : '0');
+    }
+    return str;
+  }
+
+private:
+  static Simlib_lanes<1> from_mask(Mask m) {
+    Simlib_lanes<1> r;
+    r.s_[0] = m;
+    return r;
+  }
+
+  // Lanes holding the value v
+  Mask lanes_equal(uint64_t v) const {
+    static_assert(w_ <= 64, "lanes_equal only supports up to 64 bits");
+    Mask m = ~Mask(0);
+    for (int b = 0; b < w_; ++b) {
+      m &= ((v >> b) & 1) ? s_[b] : ~s_[b];
+    }
+    return m;
+  }
+
+  // Lanes in m take the value of o
+  void blend(const Simlib_lanes<w_> &o, Mask m) {
+    for (int b = 0; b < w_; ++b) {
+      s_[b] = (o.s_[b] & m) | (s_[b] & ~m);
+    }
+  }
+
+  // Bit-serial ripple carry over the slices, 64 lanes per word op. Writes
+  // the low w_ bits into r and returns the per-lane carry out.
+  template <bool subtract, int out_w>
+  Mask add_sub(const Simlib_lanes<w_> &o, Simlib_lanes<out_w> &r) const {
+    Mask carry = subtract ? ~Mask(0) : 0;
+    for (int b = 0; b < w_; ++b) {
+      Mask x  = s_[b];
+      Mask y  = subtract ? ~o.s_[b] : o.s_[b];
+      Mask xy = x ^ y;
+      r.s_[b] = xy ^ carry;
+      carry   = (x & y) | (carry & xy);
+    }
+    return carry;
+  }
+
+  // s_[b] has bit b of all the lanes
+  std::array<Mask, w_> s_;
+
+  template <int other_w>
+  friend class Simlib_lanes;
+
+  template <int w>
+  friend Simlib_lanes<w> mux(const Simlib_lanes<1> &sel, const Simlib_lanes<w> &t, const Simlib_lanes<w> &f);
+
+  template <int w, int aw, size_t N>
+  friend Simlib_lanes<w> mem_read(const std::array<Simlib_lanes<w>, N> &mem, const Simlib_lanes<aw> &addr);
+
+  template <int w, int aw, size_t N>
+  friend void mem_write(std::array<Simlib_lanes<w>, N> &mem, const Simlib_lanes<aw> &addr, const Simlib_lanes<w> &data,
+                        const Simlib_lanes<1> &enable);
+};
+
+// Per-lane select: lanes with sel==1 take t, the rest take f
+template <int w>
+Simlib_lanes<w> mux(const Simlib_lanes<1> &sel, const Simlib_lanes<w> &t, const Simlib_lanes<w> &f) {
+  const uint64_t  m = sel.s_[0];
+  Simlib_lanes<w> r;
+  for (int b = 0; b < w; ++b) {
+    r.s_[b] = (t.s_[b] & m) | (f.s_[b] & ~m);
+  }
+  return r;
+}
+
+// Memories keep one Simlib_lanes entry per address (lane-sliced, like any
+// other value). Each lane may address a different entry, so an access takes
+// one blend per distinct address among the lanes: a single word op per bit
+// when all the lanes agree, at most 64 blends when they all differ.
+template <int w, int aw, size_t N>
+Simlib_lanes<w> mem_read(const std::array<Simlib_lanes<w>, N> &mem, const Simlib_lanes<aw> &addr) {
+  Simlib_lanes<w> r;
+  uint64_t        pending = ~uint64_t(0);
+  while (pending) {
+    const uint64_t a     = addr.lane(__builtin_ctzll(pending));
+    const uint64_t match = addr.lanes_equal(a) & pending;
+    r.blend(mem[a % N], match);
+    pending &= ~match;
+  }
+  return r;
+}
+
+template <int w, int aw, size_t N>
+void mem_write(std::array<Simlib_lanes<w>, N> &mem, const Simlib_lanes<aw> &addr, const Simlib_lanes<w> &data,
+               const Simlib_lanes<1> &enable) {
+  uint64_t pending = enable.mask();
+  while (pending) {
+    const uint64_t a     = addr.lane(__builtin_ctzll(pending));
+    const uint64_t match = addr.lanes_equal(a) & pending;
+    mem[a % N].blend(data, match);
+    pending &= ~match;
+  }
+}
+
+// Assertion demux: returns the lanes where cond is false (0 if all passed)
+inline uint64_t simlib_lanes_failed(const Simlib_lanes<1> &cond) { return ~cond.mask(); }
+
+#ifdef SIMLIB_LANES
+template <int w_>
+using UInt = Simlib_lanes<w_>;
+#endif
@@ -11,6 +11,8 @@
 #include <string>
 #include <type_traits>
 
+#include "uint_kernels.hpp"
+
 // Internal RNG
 namespace {
 std::mt19937_64 rng64(14);
@@ -295,24 +297,36 @@ public:
 
   UInt<w_> operator&(const UInt<w_> &other) const {
     UInt<w_> result;
-    for (int i = 0; i < n_; i++) {
-      result.words_[i] = words_[i] & other.words_[i];
+    if constexpr (is_wide) {
+      simlib_kernel::bitop<n_, simlib_kernel::Bitop::And>(result.words_.data(), words_.data(), other.words_.data());
+    } else {
+      for (int i = 0; i < n_; i++) {
+        result.words_[i] = words_[i] & other.words_[i];
+      }
     }
     return result;
   }
 
   UInt<w_> operator|(const UInt<w_> &other) const {
     UInt<w_> result;
-    for (int i = 0; i < n_; i++) {
-      result.words_[i] = words_[i] | other.words_[i];
+    if constexpr (is_wide) {
+      simlib_kernel::bitop<n_, simlib_kernel::Bitop::Or>(result.words_.data(), words_.data(), other.words_.data());
+    } else {
+      for (int i = 0; i < n_; i++) {
+        result.words_[i] = words_[i] | other.words_[i];
+      }
     }
     return result;
   }
 
   UInt<w_> operator^(const UInt<w_> &other) const {
     UInt<w_> result;
-    for (int i = 0; i < n_; i++) {
-      result.words_[i] = words_[i] ^ other.words_[i];
+    if constexpr (is_wide) {
+      simlib_kernel::bitop<n_, simlib_kernel::Bitop::Xor>(result.words_.data(), words_.data(), other.words_.data());
+    } else {
+      for (int i = 0; i < n_; i++) {
+        result.words_[i] = words_[i] ^ other.words_[i];
+      }
     }
     return result;
   }
@@ -398,7 +412,11 @@ public:
   template <int other_w>
   UInt<w_> operator>>(const UInt<other_w> &other) const {
     UInt<w_> result(0);
-    uint64_t dshamt    = other.as_single_word();
+    uint64_t dshamt = other.as_single_word();
+    if constexpr (is_wide) {
+      simlib_kernel::shr<n_, n_>(result.words_.data(), words_.data(), dshamt);
+      return result;
+    }
     uint64_t word_down = word_index(dshamt);
     uint64_t bits_down = dshamt % kWordSize;
     for (uint64_t i = word_down; i < n_; i++) {
@@ -413,9 +431,13 @@ public:
   template <int other_w>
   UInt<w_ + (1 << other_w) - 1> operator<<(const UInt<other_w> &other) const {
     UInt<w_ + (1 << other_w) - 1> result(0);
-    uint64_t                      dshamt  = other.as_single_word();
-    uint64_t                      word_up = word_index(dshamt);
-    uint64_t                      bits_up = dshamt % kWordSize;
+    uint64_t                      dshamt = other.as_single_word();
+    if constexpr (is_wide) {
+      simlib_kernel::shl<decltype(result)::NW, n_>(result.words_.data(), words_.data(), dshamt);
+      return result;
+    }
+    uint64_t word_up = word_index(dshamt);
+    uint64_t bits_up = dshamt % kWordSize;
     for (uint64_t i = 0; i < n_; i++) {
       result.words_[i + word_up] |= words_[i] << bits_up;
       if ((bits_up != 0) && (dshamt + w_ > kWordSize) && (i + word_up + 1 < result.NW)) {
@@ -429,7 +451,12 @@ public:
   UInt<w_> dshlw(const UInt<other_w> &other) const {
     // return operator<<(other).template bits<w_-1,0>();
     UInt<w_> result(0);
-    uint64_t dshamt  = other.as_single_word();
+    uint64_t dshamt = other.as_single_word();
+    if constexpr (is_wide) {
+      simlib_kernel::shl<n_, n_>(result.words_.data(), words_.data(), dshamt);
+      result.mask_top_unused();
+      return result;
+    }
     uint64_t word_up = word_index(dshamt);
     uint64_t bits_up = dshamt % kWordSize;
     for (uint64_t i = 0; i + word_up < n_; i++) {
@@ -443,6 +470,11 @@ public:
   }
 
   constexpr UInt<1> operator<=(const UInt<w_> &other) const {
+    if constexpr (is_wide) {
+      if (!__builtin_is_constant_evaluated()) {
+        return UInt<1>(simlib_kernel::cmp<n_>(words_.data(), other.words_.data()) <= 0);
+      }
+    }
     for (int i = n_ - 1; i >= 0; i--) {
       if (words_[i] < other.words_[i]) {
         return UInt<1>(1);
@@ -455,6 +487,9 @@ public:
   }
 
   UInt<1> operator>=(const UInt<w_> &other) const {
+    if constexpr (is_wide) {
+      return UInt<1>(simlib_kernel::cmp<n_>(words_.data(), other.words_.data()) >= 0);
+    }
     for (int i = n_ - 1; i >= 0; i--) {
       if (words_[i] > other.words_[i]) {
         return UInt<1>(1);
@@ -474,6 +509,11 @@ public:
             int other_n = (other_w <= 8) ? 1 : (other_w + 64 - 1) / 64>
   constexpr UInt<1> operator==(const UInt<other_w> &other) const {
     constexpr auto min_words = cmin(n_, other_n);
+    if constexpr (is_wide && n_ == other_n) {
+      if (!__builtin_is_constant_evaluated()) {
+        return UInt<1>(simlib_kernel::eq<n_>(words_.data(), other.words_.data()));
+      }
+    }
     for (int i = 0; i < min_words; ++i) {
       if (words_[i] != other.words_[i]) {
         return UInt<1>(0);
@@ -518,6 +558,15 @@ public:
     return words_[0];
   }
 
+  // Packed dump for vcd::VCDWriter::change_value: bit i in dst[i / 64]
+  static constexpr int bit_width = w_;
+
+  void to_words(uint64_t *dst) const {
+    for (int word = 0; word < n_; word++) {
+      dst[word] = words_[word];
+    }
+  }
+
   std::string to_string_binary() const {
     constexpr std::string_view nibble_to_str[] = {"0000",
                                                   "0001",
@@ -682,6 +731,9 @@ private:
 
   constexpr static int bits_in_top_word_ = w_ % WW == 0 ? WW : w_ % WW;
 
+  // Multi-limb values go through the simlib_kernel (SIMD when available)
+  constexpr static bool is_wide = std::is_same<word_t, uint64_t>::value && n_ > 1;
+
   // Friend Access
   template <int other_w, typename other_word_t, int other_n>
   friend class UInt;
@@ -711,11 +763,25 @@ private:
   template <int out_w, bool subtract>
   constexpr UInt<out_w> core_add_sub(const UInt<w_> &other) const {
     UInt<out_w> result;
-    uint64_t    carry = subtract;
+    if constexpr (is_wide) {
+      if (!__builtin_is_constant_evaluated()) {
+        uint64_t carry = simlib_kernel::add_sub<n_, subtract>(result.words_.data(), words_.data(), other.words_.data());
+        if constexpr (!subtract && UInt<out_w>::NW > n_) {
+          result.words_[n_] = carry;
+        }
+        return result;
+      }
+    }
+    uint64_t carry = subtract;
     for (int i = 0; i < n_; i++) {
       uint64_t operand = subtract ? ~other.words_[i] : other.words_[i];
-      result.words_[i] = words_[i] + operand + carry;
-      carry            = result.words_[i] < operand ? 1 : 0;
+      uint64_t sum     = words_[i] + operand;
+      uint64_t r       = sum + carry;
+      result.words_[i] = r;
+      carry            = (sum < operand) | (r < sum);  // operand all ones plus a carry in wraps back to words_[i]
+    }
+    if constexpr (!subtract && UInt<out_w>::NW > n_) {
+      result.words_[n_] = carry;
     }
     return result;
   }
@@ -0,0 +1,436 @@
+//  This file is distributed under the BSD 3-Clause License. See LICENSE for details.
+#pragma once
+
+// Multi-limb kernels for the wide UInt/SInt types. Each kernel works over N
+// uint64_t limbs (little endian: limb 0 is the LSB). The scalar namespace is
+// the portable reference; the dispatch functions pick an AVX2/AVX-512 variant
+// at compile time when the width is large enough to fill a vector register.
+//
+// Define SIMLIB_NO_SIMD to force the portable path.
+
+#include <cstdint>
+
+#if !defined(SIMLIB_NO_SIMD) && (defined(__AVX2__) || defined(__AVX512F__))
+#include <immintrin.h>
+#endif
+
+namespace simlib_kernel {
+
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX512F__)
+constexpr bool has_avx512 = true;
+#else
+constexpr bool has_avx512 = false;
+#endif
+
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+constexpr bool has_avx2 = true;
+#else
+constexpr bool has_avx2 = false;
+#endif
+
+// Minimum number of limbs before a SIMD kernel is used (below this the
+// scalar loop is as fast and avoids the lane shuffles)
+constexpr int avx2_min_limbs     = 4;   // 256 bits
+constexpr int avx2_add_min_limbs = 16;  // emulated unsigned compares only pay off from 1024 bits
+constexpr int avx2_shf_min_limbs = 8;   // head/tail limbs go scalar, so short values gain nothing
+constexpr int avx512_min_limbs   = 8;   // 512 bits
+
+enum class Bitop { And, Or, Xor };
+
+namespace scalar {
+
+// r = a + b (+1 if subtract with b inverted). Returns the carry out.
+template <int N, bool subtract>
+inline uint64_t add_sub(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+  unsigned long long carry = subtract;
+  for (int i = 0; i < N; ++i) {
+    uint64_t           operand = subtract ? ~b[i] : b[i];
+    unsigned long long s1;
+    unsigned long long s2;
+    bool               c1 = __builtin_uaddll_overflow(a[i], operand, &s1);
+    bool               c2 = __builtin_uaddll_overflow(s1, carry, &s2);
+    r[i]                  = s2;
+    carry                 = c1 | c2;
+  }
+  return carry;
+}
+
+template <int N, Bitop op>
+inline void bitop(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+  for (int i = 0; i < N; ++i) {
+    if constexpr (op == Bitop::And) {
+      r[i] = a[i] & b[i];
+    } else if constexpr (op == Bitop::Or) {
+      r[i] = a[i] | b[i];
+    } else {
+      r[i] = a[i] ^ b[i];
+    }
+  }
+}
+
+template <int N>
+inline void bitnot(uint64_t *r, const uint64_t *a) {
+  for (int i = 0; i < N; ++i) {
+    r[i] = ~a[i];
+  }
+}
+
+// Returns <0, 0, >0 like memcmp but for unsigned multi-limb values
+template <int N>
+inline int cmp(const uint64_t *a, const uint64_t *b) {
+  for (int i = N - 1; i >= 0; --i) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+template <int N>
+inline bool eq(const uint64_t *a, const uint64_t *b) {
+  uint64_t diff = 0;
+  for (int i = 0; i < N; ++i) {
+    diff |= a[i] ^ b[i];
+  }
+  return diff == 0;
+}
+
+// Limb i of a[0..N) >> (64 * word_down + bits_down), with src = i + word_down
+template <int N>
+inline uint64_t shr_limb(const uint64_t *a, uint64_t src, uint64_t bits_down) {
+  uint64_t v = src < static_cast<uint64_t>(N) ? a[src] >> bits_down : 0;
+  if (bits_down != 0 && src + 1 < static_cast<uint64_t>(N)) {
+    v |= a[src + 1] << (64 - bits_down);
+  }
+  return v;
+}
+
+// Limb i of a[0..N) << (64 * word_up + bits_up)
+template <int N>
+inline uint64_t shl_limb(const uint64_t *a, int i, uint64_t word_up, uint64_t bits_up) {
+  if (static_cast<uint64_t>(i) < word_up) {
+    return 0;
+  }
+  uint64_t src = i - word_up;
+  uint64_t v   = src < static_cast<uint64_t>(N) ? a[src] << bits_up : 0;
+  if (bits_up != 0 && src >= 1 && src - 1 < static_cast<uint64_t>(N)) {
+    v |= a[src - 1] >> (64 - bits_up);
+  }
+  return v;
+}
+
+// r[0..NR) = a[0..N) >> shamt (logical)
+template <int NR, int N>
+inline void shr(uint64_t *r, const uint64_t *a, uint64_t shamt) {
+  for (int i = 0; i < NR; ++i) {
+    r[i] = shr_limb<N>(a, i + shamt / 64, shamt % 64);
+  }
+}
+
+// r[0..NR) = a[0..N) << shamt, truncated to NR limbs
+template <int NR, int N>
+inline void shl(uint64_t *r, const uint64_t *a, uint64_t shamt) {
+  for (int i = 0; i < NR; ++i) {
+    r[i] = shl_limb<N>(a, i, shamt / 64, shamt % 64);
+  }
+}
+
+}  // namespace scalar
+
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX512F__)
+namespace avx512 {
+
+// 8 limbs per step. Per-lane sums are computed in parallel; the carry chain
+// is resolved on the mask registers: generate (g) lanes overflow, propagate
+// (p) lanes are all ones, and ((g << 1 | cin) + p) ^ p yields the lanes that
+// receive a carry. Bit 8 of the mask sum is the carry out of the block.
+template <int N, bool subtract>
+inline uint64_t add_sub(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 8 == 0);
+  const __m512i ones  = _mm512_set1_epi64(-1);
+  unsigned      carry = subtract;
+  for (int i = 0; i < N; i += 8) {
+    __m512i va = _mm512_loadu_si512(a + i);
+    __m512i vb = _mm512_loadu_si512(b + i);
+    if constexpr (subtract) {
+      vb = _mm512_xor_si512(vb, ones);
+    }
+    __m512i  s = _mm512_add_epi64(va, vb);
+    unsigned g = _mm512_cmplt_epu64_mask(s, va);
+    unsigned p = _mm512_cmpeq_epi64_mask(s, ones);
+    unsigned c = ((g << 1) | carry) + p;
+    carry      = c >> 8;
+    c          = (c ^ p) & 0xFF;
+    s          = _mm512_mask_sub_epi64(s, static_cast<__mmask8>(c), s, ones);  // s - (-1) == s + 1
+    _mm512_storeu_si512(r + i, s);
+  }
+  return carry;
+}
+
+template <int N, Bitop op>
+inline void bitop(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 8 == 0);
+  for (int i = 0; i < N; i += 8) {
+    __m512i va = _mm512_loadu_si512(a + i);
+    __m512i vb = _mm512_loadu_si512(b + i);
+    __m512i vr;
+    if constexpr (op == Bitop::And) {
+      vr = _mm512_and_si512(va, vb);
+    } else if constexpr (op == Bitop::Or) {
+      vr = _mm512_or_si512(va, vb);
+    } else {
+      vr = _mm512_xor_si512(va, vb);
+    }
+    _mm512_storeu_si512(r + i, vr);
+  }
+}
+
+template <int N>
+inline int cmp(const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 8 == 0);
+  for (int i = N - 8; i >= 0; i -= 8) {
+    __m512i  va = _mm512_loadu_si512(a + i);
+    __m512i  vb = _mm512_loadu_si512(b + i);
+    unsigned ne = _mm512_cmpneq_epu64_mask(va, vb);
+    if (ne) {
+      int top = 31 - __builtin_clz(ne);
+      return a[i + top] < b[i + top] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+template <int N>
+inline bool eq(const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 8 == 0);
+  for (int i = 0; i < N; i += 8) {
+    if (_mm512_cmpneq_epu64_mask(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace avx512
+#endif
+
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+namespace avx2 {
+
+// AVX2 has no unsigned 64-bit compare, so the overflow test flips the sign
+// bit and uses the signed compare. The carry chain uses the same
+// generate/propagate trick as the AVX-512 kernel on a 4-bit movemask.
+template <int N, bool subtract>
+inline uint64_t add_sub(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 4 == 0);
+  const __m256i ones  = _mm256_set1_epi64x(-1);
+  const __m256i sign  = _mm256_set1_epi64x(static_cast<int64_t>(0x8000000000000000ULL));
+  unsigned      carry = subtract;
+  for (int i = 0; i < N; i += 4) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    if constexpr (subtract) {
+      vb = _mm256_xor_si256(vb, ones);
+    }
+    __m256i  s  = _mm256_add_epi64(va, vb);
+    __m256i  lt = _mm256_cmpgt_epi64(_mm256_xor_si256(va, sign), _mm256_xor_si256(s, sign));
+    unsigned g  = _mm256_movemask_pd(_mm256_castsi256_pd(lt));
+    unsigned p  = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(s, ones)));
+    unsigned c  = ((g << 1) | carry) + p;
+    carry       = c >> 4;
+    c           = (c ^ p) & 0xF;
+    // Expand the 4-bit carry mask to lanes of -1 and subtract (adds one)
+    const __m256i lane_bit = _mm256_set_epi64x(8, 4, 2, 1);
+    __m256i       cmask    = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(c), lane_bit), lane_bit);
+    s                      = _mm256_sub_epi64(s, cmask);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), s);
+  }
+  return carry;
+}
+
+template <int N, Bitop op>
+inline void bitop(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 4 == 0);
+  for (int i = 0; i < N; i += 4) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    __m256i vr;
+    if constexpr (op == Bitop::And) {
+      vr = _mm256_and_si256(va, vb);
+    } else if constexpr (op == Bitop::Or) {
+      vr = _mm256_or_si256(va, vb);
+    } else {
+      vr = _mm256_xor_si256(va, vb);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), vr);
+  }
+}
+
+template <int N>
+inline int cmp(const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 4 == 0);
+  for (int i = N - 4; i >= 0; i -= 4) {
+    __m256i  va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i  vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    unsigned eq = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(va, vb)));
+    unsigned ne = ~eq & 0xF;
+    if (ne) {
+      int top = 31 - __builtin_clz(ne);
+      return a[i + top] < b[i + top] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+template <int N>
+inline bool eq(const uint64_t *a, const uint64_t *b) {
+  static_assert(N % 4 == 0);
+  __m256i diff = _mm256_setzero_si256();
+  for (int i = 0; i < N; i += 4) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    diff       = _mm256_or_si256(diff, _mm256_xor_si256(va, vb));
+  }
+  return _mm256_testz_si256(diff, diff);
+}
+
+// Funnel shifts: each output lane combines two neighbouring input lanes, read
+// in place with unaligned loads. Lanes that would read past either end of the
+// input fall back to the scalar limb helpers.
+template <int NR, int N>
+inline void shr(uint64_t *r, const uint64_t *a, uint64_t shamt) {
+  const uint64_t word_down = shamt / 64;
+  const uint64_t bits_down = shamt % 64;
+  const __m128i  lo        = _mm_cvtsi64_si128(bits_down);
+  const __m128i  hi        = _mm_cvtsi64_si128(64 - bits_down);  // shift by 64 yields 0, as needed
+  int            i         = 0;
+  for (; i + 4 <= NR && word_down + i + 5 <= static_cast<uint64_t>(N); i += 4) {
+    __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + word_down + i));
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + word_down + i + 1));
+    __m256i vr = _mm256_or_si256(_mm256_srl_epi64(v0, lo), _mm256_sll_epi64(v1, hi));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), vr);
+  }
+  for (; i < NR; ++i) {
+    r[i] = scalar::shr_limb<N>(a, i + word_down, bits_down);
+  }
+}
+
+template <int NR, int N>
+inline void shl(uint64_t *r, const uint64_t *a, uint64_t shamt) {
+  const uint64_t word_up = shamt / 64;
+  const uint64_t bits_up = shamt % 64;
+  const __m128i  lo      = _mm_cvtsi64_si128(bits_up);
+  const __m128i  hi      = _mm_cvtsi64_si128(64 - bits_up);
+  int            i       = 0;
+  // Head: output limbs whose lower neighbour is below a[0]
+  for (; i < NR && static_cast<uint64_t>(i) <= word_up; ++i) {
+    r[i] = scalar::shl_limb<N>(a, i, word_up, bits_up);
+  }
+  for (; i + 4 <= NR && i - word_up + 4 <= static_cast<uint64_t>(N); i += 4) {
+    const uint64_t *src = a + (i - word_up);
+    __m256i         v0  = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    __m256i         v1  = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src - 1));
+    __m256i         vr  = _mm256_or_si256(_mm256_sll_epi64(v0, lo), _mm256_srl_epi64(v1, hi));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(r + i), vr);
+  }
+  for (; i < NR; ++i) {
+    r[i] = scalar::shl_limb<N>(a, i, word_up, bits_up);
+  }
+}
+
+}  // namespace avx2
+#endif
+
+// Dispatch. Widths that are not a multiple of the vector length use the
+// scalar kernel (the top limbs are rarely worth a masked tail).
+
+template <int N, bool subtract>
+inline uint64_t add_sub(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX512F__)
+  if constexpr (N >= avx512_min_limbs && N % 8 == 0) {
+    return avx512::add_sub<N, subtract>(r, a, b);
+  }
+#endif
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+  if constexpr (N >= avx2_add_min_limbs && N % 4 == 0) {
+    return avx2::add_sub<N, subtract>(r, a, b);
+  }
+#endif
+  return scalar::add_sub<N, subtract>(r, a, b);
+}
+
+template <int N, Bitop op>
+inline void bitop(uint64_t *r, const uint64_t *a, const uint64_t *b) {
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX512F__)
+  if constexpr (N >= avx512_min_limbs && N % 8 == 0) {
+    avx512::bitop<N, op>(r, a, b);
+    return;
+  }
+#endif
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+  if constexpr (N >= avx2_min_limbs && N % 4 == 0) {
+    avx2::bitop<N, op>(r, a, b);
+    return;
+  }
+#endif
+  scalar::bitop<N, op>(r, a, b);
+}
+
+template <int N>
+inline void bitnot(uint64_t *r, const uint64_t *a) {
+  scalar::bitnot<N>(r, a);  // trivially vectorized by the compiler
+}
+
+template <int N>
+inline int cmp(const uint64_t *a, const uint64_t *b) {
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX512F__)
+  if constexpr (N >= avx512_min_limbs && N % 8 == 0) {
+    return avx512::cmp<N>(a, b);
+  }
+#endif
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+  if constexpr (N >= avx2_min_limbs && N % 4 == 0) {
+    return avx2::cmp<N>(a, b);
+  }
+#endif
+  return scalar::cmp<N>(a, b);
+}
+
+template <int N>
+inline bool eq(const uint64_t *a, const uint64_t *b) {
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX512F__)
+  if constexpr (N >= avx512_min_limbs && N % 8 == 0) {
+    return avx512::eq<N>(a, b);
+  }
+#endif
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+  if constexpr (N >= avx2_min_limbs && N % 4 == 0) {
+    return avx2::eq<N>(a, b);
+  }
+#endif
+  return scalar::eq<N>(a, b);
+}
+
+template <int NR, int N>
+inline void shr(uint64_t *r, const uint64_t *a, uint64_t shamt) {
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+  if constexpr (NR >= avx2_shf_min_limbs) {
+    avx2::shr<NR, N>(r, a, shamt);
+    return;
+  }
+#endif
+  scalar::shr<NR, N>(r, a, shamt);
+}
+
+template <int NR, int N>
+inline void shl(uint64_t *r, const uint64_t *a, uint64_t shamt) {
+#if !defined(SIMLIB_NO_SIMD) && defined(__AVX2__)
+  if constexpr (NR >= avx2_shf_min_limbs) {
+    avx2::shl<NR, N>(r, a, shamt);
+    return;
+  }
+#endif
+  scalar::shl<NR, N>(r, a, shamt);
+}
+
+}  // namespace simlib_kernel
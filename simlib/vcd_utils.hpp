@@ -1,5 +1,6 @@
 // This file is distributed under the LICENSE.vcd-writer License. See LICENSE for details.
 #pragma once
+#include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <cstring>
@@ -73,6 +74,103 @@ void replace_new_lines(std::string &str, const std::string &sub) {
   }
 }
 
+// -----------------------------
+// Block compression for OutputFormat::block. A greedy LZ77 with a 4 byte hash
+// table: VCD text is very repetitive (identifiers, timestamps, values), so this
+// gets most of the gain without an external compression library. Each
+// sequence is varint(literal_len) literals varint(match_len) varint(offset),
+// a zero match_len ends the block.
+const char block_magic[8] = {'S', 'I', 'M', 'L', 'I', 'B', 'Z', '1'};
+
+static void put_varint(std::string &out, size_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<char>(v));
+}
+
+static size_t get_varint(const char *&p, const char *end) {
+  size_t v     = 0;
+  int    shift = 0;
+  while (p < end) {
+    auto c = static_cast<unsigned char>(*p++);
+    v |= static_cast<size_t>(c & 0x7F) << shift;
+    if (!(c & 0x80)) {
+      break;
+    }
+    shift += 7;
+  }
+  return v;
+}
+
+void lz_compress(const char *src, size_t len, std::string &out) {
+  constexpr int    hash_bits = 14;
+  constexpr size_t min_match = 4;
+
+  std::vector<uint32_t> table(1 << hash_bits, 0);  // position + 1, 0 is empty
+
+  auto hash = [](const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return (v * 2654435761u) >> (32 - hash_bits);
+  };
+
+  size_t lit = 0;
+  size_t i   = 0;
+  while (i + min_match <= len) {
+    auto   h    = hash(src + i);
+    size_t cand = table[h];
+    table[h]    = static_cast<uint32_t>(i + 1);
+    if (cand == 0 || memcmp(src + cand - 1, src + i, min_match) != 0) {
+      ++i;
+      continue;
+    }
+    --cand;
+    size_t mlen = min_match;
+    while (i + mlen < len && src[cand + mlen] == src[i + mlen]) {
+      ++mlen;
+    }
+    put_varint(out, i - lit);
+    out.append(src + lit, i - lit);
+    put_varint(out, mlen);
+    put_varint(out, i - cand);
+    for (size_t end = std::min(i + mlen, len - min_match + 1), j = i + 1; j < end; ++j) {
+      table[hash(src + j)] = static_cast<uint32_t>(j + 1);
+    }
+    i += mlen;
+    lit = i;
+  }
+  put_varint(out, len - lit);
+  out.append(src + lit, len - lit);
+  put_varint(out, 0);
+}
+
+void lz_decompress(const char *src, size_t len, std::string &out) {
+  const char *p   = src;
+  const char *end = src + len;
+  while (p < end) {
+    size_t lit = get_varint(p, end);
+    if (lit > static_cast<size_t>(end - p)) {
+      return;
+    }
+    out.append(p, lit);
+    p += lit;
+    size_t mlen = get_varint(p, end);
+    if (mlen == 0) {
+      return;
+    }
+    size_t off = get_varint(p, end);
+    if (off == 0 || off > out.size()) {
+      return;
+    }
+    size_t from = out.size() - off;
+    for (size_t k = 0; k < mlen; ++k) {  // may overlap the bytes being appended
+      out.push_back(out[from + k]);
+    }
+  }
+}
+
 // -----------------------------
 }  // namespace utils
 }  // namespace vcd
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 #include "vcd_utils.hpp"
 
@@ -75,6 +76,12 @@ protected:
   ScopePtr     scope;  // pointer to scope string
   std::string  ident;  // internal ID used in VCD output stream
 
+  // last value: packed binary, or text for real/string/x/z values
+  std::vector<uint64_t> bits;
+  std::string           text;
+  bool                  has_value = false;
+  bool                  is_text   = false;
+
   //! string representation of variable types
   static const std::string var_types[];
 
@@ -163,17 +170,21 @@ struct VarSearch {
 };
 
 // -----------------------------
-VCDWriter::VCDWriter(const std::string &_filename, HeadPtr &&_header, unsigned init_timestamp)
+VCDWriter::VCDWriter(const std::string &_filename, HeadPtr &&_header, unsigned init_timestamp, OutputFormat _format)
     : timestamp(init_timestamp)
     , header((_header) ? std::move(_header) : makeVCDHeader())
+    , format(_format)
     , filename(_filename)
     , scope_sep(".")
     , scope_def_type(ScopeType::module)
     , closed(false)
     , dumping(true)
     , registering(true)
+    , time_pending(false)
     , next_var_id(0)
-    , search(std::make_shared<VarSearch>(ScopeType::module)) {
+    , search(std::make_shared<VarSearch>(ScopeType::module))
+    , worker_busy(false)
+    , worker_stop(false) {
   if (!header) {
     throw VCDTypeException{"Invalid pointer to header"};
   }
@@ -182,6 +193,25 @@ VCDWriter::VCDWriter(const std::string &_filename, HeadPtr &&_header, unsigned i
   if (!ofile) {
     throw VCDTypeException{utils::format("Can't open file '%s' for writing", filename.c_str())};
   }
+  if (format == OutputFormat::block) {
+    fwrite(utils::block_magic, 1, sizeof(utils::block_magic), ofile);
+  }
+
+  cur_chunk.reserve(chunk_words);
+  worker = std::thread(&VCDWriter::worker_loop, this);
+}
+
+VCDWriter::~VCDWriter() {
+  if (!closed) {
+    flush();
+  }
+  {
+    std::lock_guard<std::mutex> lock(chunk_mutex);
+    worker_stop = true;
+  }
+  chunk_ready.notify_all();
+  worker.join();
+  fclose(ofile);
 }
 
 // -----------------------------
@@ -385,56 +415,299 @@ VarPtr VCDWriter::register_passed_var(const std::string &scope, const std::strin
   return pvar;
 }
 // -----------------------------
-bool VCDWriter::change(const VarPtr &var, const VarValue &value, bool reg) {
+// Binary values ("b0101", "0", "1") are kept packed; anything else (x/z,
+// reals, strings) is kept as text.
+static bool parse_binary(const std::string &value, unsigned size, std::vector<uint64_t> &bits) {
+  std::fill(bits.begin(), bits.end(), 0);
+  size_t beg = value.size() > 1 && value[0] == 'b' ? 1 : 0;
+  size_t end = value.size();
+  while (end > beg && value[end - 1] == ' ') {
+    --end;
+  }
+  if (beg != 0 && end == beg) {
+    return false;
+  }
+  for (size_t i = beg; i < end; ++i) {
+    size_t bit = end - 1 - i;
+    char   c   = value[i];
+    if (c != '0' && c != '1') {
+      return false;
+    }
+    if (c == '1' && bit < size) {
+      bits[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+  }
+  return true;
+}
+
+static void append_binary(std::string &out, const uint64_t *bits, unsigned size) {
+  if (size == 1) {
+    out.push_back((bits[0] & 1) ? '1' : '0');
+    return;
+  }
+  out.push_back('b');
+  int msb = size - 1;
+  while (msb > 0 && !((bits[msb / 64] >> (msb % 64)) & 1)) {
+    --msb;
+  }
+  for (int i = msb; i >= 0; --i) {
+    out.push_back(((bits[i / 64] >> (i % 64)) & 1) ? '1' : '0');
+  }
+}
+
+bool VCDWriter::check_timestamp(const VCDVariable *var) {
   if (global_timestamp < timestamp) {
     throw VCDPhaseException{utils::format("Out of order value change var '%s'", var->name.c_str())};
   } else if (closed) {
     throw VCDPhaseException{"Cannot change value after close()"};
   }
 
+  if (global_timestamp > timestamp) {
+    if (registering) {
+      finalize_registration();
+    }
+    timestamp    = global_timestamp;
+    time_pending = dumping;
+  }
+
+  return dumping && !registering;
+}
+
+bool VCDWriter::change(const VarPtr &var, const VarValue &value, bool reg) {
   if (!var) {
     throw VCDTypeException{"Invalid VCDVariable"};
   }
+  // initial values go to $dumpvars at the writer timestamp, registering does not advance the time
+  bool dump = !reg && check_timestamp(var.get());
 
-  std::string change_value = (value.size() ? value : ('b' + std::string(var->size, VCDValues::ZERO) + ' '));
-  //    std::string change_value = var->change_record(value);
+  if (!var->has_value) {
+    if (!reg) {
+      throw VCDTypeException{utils::format("VCDVariable '%s' do not registered", var->name.c_str())};
+    }
+    var->bits.resize((std::max(var->size, 1u) + 63) / 64);
+    vars_prevs.emplace_back(var.get());  // registering: inserted for the first time
+  }
 
-  if (global_timestamp > timestamp) {
-    if (registering) {
-      finalize_registration();
+  std::vector<uint64_t> packed(var->bits.size());
+  if (parse_binary(value, var->size, packed)) {
+    if (var->has_value && !var->is_text && packed == var->bits) {
+      return false;
     }
-    if (dumping) {
-      fprintf(ofile, "#%d\n", global_timestamp);
+    var->bits.swap(packed);
+    var->is_text   = false;
+    var->has_value = true;
+    if (dump) {
+      push_record(var.get(), var->bits.data(), var->bits.size(), 0);
     }
-    timestamp = global_timestamp;
+    return true;
+  }
+
+  if (var->has_value && var->is_text && var->text == value) {
+    return false;
+  }
+  var->text      = value;
+  var->is_text   = true;
+  var->has_value = true;
+  if (dump) {
+    std::vector<uint64_t> payload((value.size() + 7) / 8);
+    memcpy(payload.data(), value.data(), value.size());
+    push_record(var.get(), payload.data(), payload.size(), value.size());
+  }
+  return true;
+}
+
+bool VCDWriter::change_bits(const VarPtr &var, const uint64_t *words) { return change_bits(var, words, var->bits.size()); }
+
+bool VCDWriter::change_bits(const VarPtr &var, const uint64_t *words, size_t n_words) {
+  bool dump = check_timestamp(var.get());
+
+  if (!var->has_value) {
+    throw VCDTypeException{utils::format("VCDVariable '%s' do not registered", var->name.c_str())};
+  }
+
+  const size_t   nwords = var->bits.size();
+  const unsigned top    = var->size % 64;
+  const uint64_t mask   = top ? (uint64_t(1) << top) - 1 : ~uint64_t(0);
+
+  bool same = !var->is_text;
+  for (size_t i = 0; i < nwords; ++i) {
+    uint64_t w = i < n_words ? words[i] : 0;
+    w          = i + 1 == nwords ? w & mask : w;
+    same       = same && w == var->bits[i];
+    var->bits[i] = w;
+  }
+  if (same) {
+    return false;
+  }
+  var->is_text = false;
+
+  if (dump) {
+    push_record(var.get(), var->bits.data(), nwords, 0);
   }
+  return true;
+}
 
-  // if value changed
-  if (vars_prevs.find(var)
-      != vars_prevs.end())  // not entered in 1st entry @ main:544 //vars_prev is unordered_map of (varptr, str) pairs
+void VCDWriter::push_record(const VCDVariable *var, const uint64_t *payload, size_t payload_words, uint64_t str_len) {
+  if (time_pending) {
+    cur_chunk.push_back(0);
+    cur_chunk.push_back(timestamp);
+    time_pending = false;
+  }
+  cur_chunk.push_back(reinterpret_cast<uint64_t>(var));
+  cur_chunk.push_back(str_len);
+  cur_chunk.insert(cur_chunk.end(), payload, payload + payload_words);
+
+  if (cur_chunk.size() >= chunk_words) {
+    submit_chunk();
+  }
+}
+
+void VCDWriter::submit_chunk() {
+  if (cur_chunk.empty()) {
+    return;
+  }
   {
-    if (vars_prevs[var] == change_value) {
-      return false;
+    std::unique_lock<std::mutex> lock(chunk_mutex);
+    chunk_done.wait(lock, [this] { return full_chunks.size() < max_chunks; });
+    full_chunks.emplace_back(std::move(cur_chunk));
+    if (free_chunks.empty()) {
+      cur_chunk = Chunk();
+      cur_chunk.reserve(chunk_words);
+    } else {
+      cur_chunk = std::move(free_chunks.back());
+      free_chunks.pop_back();
+    }
+  }
+  chunk_ready.notify_one();
+}
+
+void VCDWriter::drain() {
+  submit_chunk();
+  std::unique_lock<std::mutex> lock(chunk_mutex);
+  chunk_done.wait(lock, [this] { return full_chunks.empty() && !worker_busy; });
+}
+
+void VCDWriter::worker_loop() {
+  while (true) {
+    Chunk chunk;
+    {
+      std::unique_lock<std::mutex> lock(chunk_mutex);
+      chunk_ready.wait(lock, [this] { return worker_stop || !full_chunks.empty(); });
+      if (full_chunks.empty()) {
+        return;  // stop requested and nothing left
+      }
+      chunk = std::move(full_chunks.front());
+      full_chunks.pop_front();
+      worker_busy = true;
     }
-    vars_prevs[var] = change_value;  // entered for #0
 
-  } else if (!reg) {
-    throw VCDTypeException{utils::format("VCDVariable '%s' do not registered", var->name.c_str())};
+    format_chunk(chunk);
+    write_out(false);
+
+    {
+      std::lock_guard<std::mutex> lock(chunk_mutex);
+      worker_busy = false;
+      chunk.clear();
+      free_chunks.emplace_back(std::move(chunk));
+    }
+    chunk_done.notify_all();
+  }
+}
+
+void VCDWriter::format_chunk(const Chunk &chunk) {
+  size_t i = 0;
+  while (i < chunk.size()) {
+    const auto    *var  = reinterpret_cast<const VCDVariable *>(chunk[i]);
+    const uint64_t meta = chunk[i + 1];
+    i += 2;
+    if (var == nullptr) {
+      emit_time(meta);
+      continue;
+    }
+    if (meta) {
+      out.append(reinterpret_cast<const char *>(&chunk[i]), meta);
+      if (meta != 1) {
+        out.push_back(' ');
+      }
+      i += (meta + 7) / 8;
+    } else {
+      append_binary(out, &chunk[i], var->size);
+      if (var->size != 1) {
+        out.push_back(' ');
+      }
+      i += var->bits.size();
+    }
+    out.append(var->ident);
+    out.push_back('\n');
+  }
+}
+
+void VCDWriter::emit_time(TimeStamp t) {
+  out.push_back('#');
+  out.append(std::to_string(t));
+  out.push_back('\n');
+}
+
+void VCDWriter::emit_value(const VCDVariable *var) {
+  if (var->is_text) {
+    out.append(var->text);
+    if (var->text.size() != 1) {
+      out.push_back(' ');  // the space gives the spacing between value and identifier in the dumped file
+    }
   } else {
-    vars_prevs.insert(std::make_pair(var, change_value));  // registering: inserted the pair for the first time
+    append_binary(out, var->bits.data(), var->size);
+    if (var->size != 1) {
+      out.push_back(' ');
+    }
   }
+  out.append(var->ident);
+  out.push_back('\n');
+}
 
-  // dump it into file
-  if (dumping && !registering) {  // not entered in 1st entry
+void VCDWriter::write_out(bool force) {
+  if (out.empty() || (!force && out.size() < block_bytes)) {
+    return;
+  }
+  if (format == OutputFormat::block) {
+    std::string block;
+    utils::lz_compress(out.data(), out.size(), block);
+    uint32_t sizes[2] = {static_cast<uint32_t>(out.size()), static_cast<uint32_t>(block.size())};
+    fwrite(sizes, sizeof(uint32_t), 2, ofile);
+    fwrite(block.data(), 1, block.size(), ofile);
+  } else {
+    fwrite(out.data(), 1, out.size(), ofile);
+  }
+  out.clear();
+}
 
-    if (change_value.size() != 1) {
-      fprintf(ofile, "%s %s\n", change_value.c_str(), var->ident.c_str());
-    } else {
-      fprintf(ofile, "%s%s\n", change_value.c_str(), var->ident.c_str());
+std::string decompress_vcd(const std::string &_filename) {
+  FILE *f = fopen(_filename.c_str(), "r");
+  if (!f) {
+    throw VCDTypeException{utils::format("Can't open file '%s' for reading", _filename.c_str())};
+  }
+  std::string vcd;
+  char        magic[sizeof(utils::block_magic)];
+  if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, utils::block_magic, sizeof(magic)) != 0) {
+    fclose(f);
+    throw VCDTypeException{utils::format("File '%s' is not a block compressed VCD", _filename.c_str())};
+  }
+  uint32_t    sizes[2];
+  std::string block;
+  while (fread(sizes, sizeof(uint32_t), 2, f) == 2) {
+    block.resize(sizes[1]);
+    if (fread(block.data(), 1, sizes[1], f) != sizes[1]) {
+      fclose(f);
+      throw VCDTypeException{utils::format("Truncated block in '%s'", _filename.c_str())};
+    }
+    auto start = vcd.size();
+    utils::lz_decompress(block.data(), block.size(), vcd);
+    if (vcd.size() - start != sizes[0]) {
+      fclose(f);
+      throw VCDTypeException{utils::format("Corrupted block in '%s'", _filename.c_str())};
     }
-    //            fprintf(ofile, "%s%s\n", change_value.c_str(), var->ident.c_str());
   }
-  return true;
+  fclose(f);
+  return vcd;
 }
 
 // -----------------------------
@@ -471,47 +744,39 @@ void VCDWriter::set_scope_type(std::string &scope, ScopeType scopetype) {
 
 // -----------------------------
 void VCDWriter::dump_off_int(TimeStamp _timestamp) {
-  fprintf(ofile, "#%d\n", _timestamp);
-  fprintf(ofile, "$dumpoff\n");
-  for (const auto &p : vars_prevs) {
-    const char *ident = p.first->ident.c_str();
-    const char *value = p.second.c_str();
-
-    if (value[0] == 'r') {
+  emit_time(_timestamp);
+  out.append("$dumpoff\n");
+  for (const auto *var : vars_prevs) {
+    if (var->is_text && var->type == VariableType::real) {
     }  // real variables cannot have "z" or "x" state
-    else if (value[0] == 'b') {
-      fprintf(ofile, "bx %s\n", ident);
-    }
-    // else if (value[0] == 's')
-    //{ fprintf(ofile, "sx %s\n", ident); }
-    else {
-      fprintf(ofile, "x%s\n", ident);
+    else if (var->size != 1 || (var->is_text && var->text[0] == 'b')) {
+      out.append("bx ");
+      out.append(var->ident);
+      out.push_back('\n');
+    } else {
+      out.push_back('x');
+      out.append(var->ident);
+      out.push_back('\n');
     }
   }
-  fprintf(ofile, "$end\n");
+  out.append("$end\n");
 }
 
 void VCDWriter::dump_values(const std::string &keyword) {
-  fprintf(ofile, "%s\n", keyword.c_str());
+  out.append(keyword);
+  out.push_back('\n');
   // TODO : events should be excluded
-  for (const auto &p : vars_prevs) {
-    const char *ident = p.first->ident.c_str();
-    const char *value = p.second.c_str();
-    if (p.second.size() != 1) {
-      fprintf(ofile, "%s %s\n", value, ident);
-    } else {
-      fprintf(ofile, "%s%s\n", value,
-              ident);  // the space gives the spacing between value and identifier in the dumped file
-    }
+  for (const auto *var : vars_prevs) {
+    emit_value(var);
   }
-  fprintf(ofile, "$end\n");
+  out.append("$end\n");
 }
 
 void VCDWriter::scope_declaration(const std::string &scope, size_t sub_beg, size_t sub_end) {
   const std::string SCOPEtypeS[] = {"begin", "fork", "function", "module", "task"};
   auto              scopename    = scope.substr(sub_beg, sub_end - sub_beg);
   auto              scopetype    = SCOPEtypeS[int(scope_def_type)].c_str();
-  fprintf(ofile, "$scope %s %s $end\n", scopetype, scopename.c_str());
+  out.append(utils::format("$scope %s %s $end\n", scopetype, scopename.c_str()));
 }
 
 void VCDWriter::write_header() {
@@ -522,7 +787,7 @@ void VCDWriter::write_header() {
       continue;
     }
     vcd::utils::replace_new_lines(kwvalue, "\n\t");
-    fprintf(ofile, "%s %s $end\n", kwname.c_str(), kwvalue.c_str());
+    out.append(utils::format("%s %s $end\n", kwname.c_str(), kwvalue.c_str()));
   }
 
   // nested scope
@@ -546,12 +811,12 @@ void VCDWriter::write_header() {
       }
       // last
       if (n_prev != (scope_prev.size() + scope_sep.size())) {
-        fprintf(ofile, "$upscope $end\n");
+        out.append("$upscope $end\n");
       }
       // close
       n = scope_prev.find(scope_sep, n_prev);
       while (n != std::string::npos) {
-        fprintf(ofile, "$upscope $end\n");
+        out.append("$upscope $end\n");
         n = scope_prev.find(scope_sep, n + scope_sep.size());
       }
     }
@@ -568,7 +833,8 @@ void VCDWriter::write_header() {
 
     // dump variable declartion
     for (const auto &var : s->vars) {
-      fprintf(ofile, "%s\n", var->declartion().c_str());
+      out.append(var->declartion());
+      out.push_back('\n');
     }
 
     scope_prev = scope;
@@ -577,15 +843,15 @@ void VCDWriter::write_header() {
   // scope print close (rest)
   if (scope_prev.size()) {
     // last
-    fprintf(ofile, "$upscope $end\n");
+    out.append("$upscope $end\n");
     n = scope_prev.find(scope_sep);
     while (n != std::string::npos) {
-      fprintf(ofile, "$upscope $end\n");
+      out.append("$upscope $end\n");
       n = scope_prev.find(scope_sep, n + scope_sep.size());
     }
   }
 
-  fprintf(ofile, "$enddefinitions $end\n");
+  out.append("$enddefinitions $end\n");
   // do not need anymore
   header.reset(nullptr);
 }
@@ -594,7 +860,7 @@ void VCDWriter::finalize_registration() {
   assert(registering);
   write_header();
   if (vars_prevs.size()) {
-    fprintf(ofile, "#%d\n", timestamp);
+    emit_time(timestamp);
     dump_values("$dumpvars");
     if (!dumping) {
       dump_off_int(timestamp);
@@ -624,14 +890,19 @@ std::string VCDVariable::declartion() const {
 VCDWriter *initialize_vcd_writer() {
   // = clock();
   const char *var = getenv("SIMLIB_DUMPDIR");
-  std::string dump_file{"SIMLIB_VCD.vcd"};
+  const char *fmt = getenv("SIMLIB_VCD_FORMAT");  // "block" for the compressed output
+
+  OutputFormat format = (fmt && std::string_view(fmt) == "block") ? OutputFormat::block : OutputFormat::vcd;
+  std::string  dump_file{format == OutputFormat::block ? "SIMLIB_VCD.vcdz" : "SIMLIB_VCD.vcd"};
   if (var) {
     std::string dir{var};
-    dump_file = dir + "/" + "SIMLIB_VCD.vcd";
+    dump_file = dir + "/" + dump_file;
   }
   static VCDWriter writer{
       dump_file,
-      makeVCDHeader(TimeScale::ONE, TimeScaleUnit::ns, utils::now(), "This is the VCD file", "generated by SimLibVCD")};
+      makeVCDHeader(TimeScale::ONE, TimeScaleUnit::ns, utils::now(), "This is the VCD file", "generated by SimLibVCD"),
+      0u,
+      format};
   return &writer;
 }
 //};
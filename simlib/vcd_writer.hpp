@@ -3,14 +3,20 @@
 
 #include <algorithm>
 #include <cctype>
+#include <condition_variable>
+#include <cstdint>
 #include <ctime>
+#include <deque>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace vcd {
 
@@ -109,26 +115,38 @@ using HeadPtr = std::unique_ptr<VCDHeader, VCDHeaderDeleter>;
 HeadPtr makeVCDHeader(TimeScale timescale_quan = TimeScale::ONE, TimeScaleUnit timescale_unit = TimeScaleUnit::ns,
                       const std::string &date = utils::now(), const std::string &comment = "", const std::string &version = "");
 
+// -----------------------------
+// Output encoding: plain VCD text, or the same text LZ-compressed in
+// independent blocks (see decompress_vcd to expand it back to VCD)
+enum class OutputFormat : char { vcd, block };
+
 // -----------------------------
 // Writer of a Value Change Dump file
-// A VCD file captures time-ordered changes to the value of variables
+// A VCD file captures time-ordered changes to the value of variables.
+//
+// Value changes are compared against the packed binary state of each
+// variable on the caller thread and queued as binary records in chunks. A
+// background thread formats the chunks to text and writes them out, so the
+// simulation thread never formats strings or touches stdio.
 class VCDWriter {
-  FILE     *ofile;
-  TimeStamp timestamp;
-  HeadPtr   header;
+  FILE        *ofile;
+  TimeStamp    timestamp;
+  HeadPtr      header;
+  OutputFormat format;
 
   // settings
   std::string filename;
   std::string scope_sep;
   ScopeType   scope_def_type;
 
-  // check changes of vars' values
-  std::unordered_map<VarPtr, VarValue> vars_prevs;
+  // variables with a value (dump order)
+  std::vector<VCDVariable *> vars_prevs;
 
   // state
   bool closed;
   bool dumping;
   bool registering;
+  bool time_pending;  // timestamp advanced but no "#time" record queued yet
   // gen var idents (internal names)
   unsigned     next_var_id;
   VarSearchPtr search;
@@ -136,13 +154,32 @@ class VCDWriter {
   std::set<ScopePtr, ScopePtrHash>                    scopes;
   std::unordered_set<VarPtr, VarPtrHash, VarPtrEqual> vars;
 
+  // change records: [VCDVariable*][str_len, 0 for binary][payload words],
+  // or [0][timestamp] to advance the time
+  using Chunk = std::vector<uint64_t>;
+
+  static constexpr size_t chunk_words = 8192;  // 64KB per chunk
+  static constexpr size_t max_chunks  = 8;     // back-pressure on the simulation thread
+  static constexpr size_t block_bytes = 1 << 20;
+
+  Chunk                   cur_chunk;
+  std::deque<Chunk>       full_chunks;
+  std::vector<Chunk>      free_chunks;
+  std::mutex              chunk_mutex;
+  std::condition_variable chunk_ready;
+  std::condition_variable chunk_done;
+  bool                    worker_busy;
+  bool                    worker_stop;
+  std::thread             worker;
+
+  // formatted text not yet written, owned by the worker unless drained
+  std::string out;
+
 public:
-  VCDWriter(const std::string &filename, HeadPtr &&header = {}, unsigned init_timestamp = 0u);
+  VCDWriter(const std::string &filename, HeadPtr &&header = {}, unsigned init_timestamp = 0u,
+            OutputFormat format = OutputFormat::vcd);
 
-  ~VCDWriter() {
-    flush();
-    fclose(this->ofile);
-  }
+  ~VCDWriter();
 
   // Register a VCD variable and return its mark to change value further.
   // Remember, all VCD variables must be registered prior to any value changes.
@@ -174,8 +211,24 @@ public:
 
   bool change(const std::string &scope, const std::string &name, const VarValue &value);
 
+  // Same as change, but with the value packed in binary: bit i of the
+  // variable is bit i%64 of words[i/64]. Avoids any string formatting.
+  bool change_bits(const VarPtr &var, const uint64_t *words);
+
+  // Same with n_words words: zero extended, or truncated, to the variable size
+  bool change_bits(const VarPtr &var, const uint64_t *words, size_t n_words);
+
+  // Change from a simlib value (UInt, Simlib_lanes) without going through a string
+  template <typename T>
+  bool change_value(const VarPtr &var, const T &v) {
+    uint64_t words[(T::bit_width + 63) / 64];
+    v.to_words(words);
+    return change_bits(var, words, std::size(words));
+  }
+
   // Suspend dumping to VCD file
   void dump_off(TimeStamp current) {
+    drain();
     if (dumping && !registering && vars_prevs.size()) {
       dump_off_int(current);
     }
@@ -183,8 +236,9 @@ public:
   }
   // Resume dumping to VCD file
   void dump_on(TimeStamp current) {
+    drain();
     if (!dumping && !registering && vars_prevs.size()) {
-      fprintf(ofile, "#%d", current);
+      emit_time(current);
     }
     dump_values("$dumpon");
     dumping = true;
@@ -200,9 +254,11 @@ public:
     if (registering) {
       finalize_registration();
     }
+    drain();
     if (current != NULL && *current > timestamp) {
-      fprintf(ofile, "#%d", *current);
+      emit_time(*current);
     }
+    write_out(true);
     fflush(ofile);
   }
   // Close VCD writer. Any buffered VCD data is flushed to the output file.
@@ -242,8 +298,25 @@ protected:
   void write_header();
   //! Turn to dumping phase, no more variables regestration allowed
   void finalize_registration();
+
+  //! Advance the timestamp; returns false if nothing has to be dumped
+  bool check_timestamp(const VCDVariable *var);
+  void push_record(const VCDVariable *var, const uint64_t *payload, size_t payload_words, uint64_t str_len);
+  void submit_chunk();
+  //! Wait until the worker formatted all the queued records (out is then owned by the caller)
+  void drain();
+  void worker_loop();
+  void format_chunk(const Chunk &chunk);
+  void emit_time(TimeStamp t);
+  void emit_value(const VCDVariable *var);
+  //! Write out to the file (or a compressed block). Partial blocks only when forced
+  void write_out(bool force);
 };
 
+// -----------------------------
+// Expand a file written with OutputFormat::block back to plain VCD text
+std::string decompress_vcd(const std::string &filename);
+
 // -----------------------------
 using WriterPtr = std::shared_ptr<VCDWriter>;
 // -----------------------------